@@ -111,6 +111,17 @@ extern "C"
         const char* program_info_hash_type;       ///< Type of the program info hash
     } program_entry_t;
 
+    /**
+     * @brief Runtime context for a program in an instanced module.
+     * Programs generated with bpf2c --instanced read helper and map addresses from this structure instead of from the
+     * module's static tables. This lets a single loaded module back several independent sets of maps and programs.
+     */
+    typedef struct _program_runtime_context
+    {
+        helper_function_entry_t* helpers; ///< Helper function entries of this instance of the program.
+        map_entry_t* maps;                ///< Map entries of this instance of the module.
+    } program_runtime_context_t;
+
     /**
      * @brief Version information for the bpf2c compiler.
      * This structure contains the version information for the bpf2c compiler that generated the module. It can be
@@ -144,6 +155,7 @@ extern "C"
         void (*map_initial_values)(
             _Outptr_result_buffer_maybenull_(*count) map_initial_values_t** map_initial_values,
             _Out_ size_t* count); ///< Returns the list of initial values for maps in this module.
+        bool instanced; ///< Programs take a program_runtime_context_t and the module can be loaded more than once.
     } metadata_table_t;
 
     /**
@@ -254,7 +254,8 @@ bpf_printk(const char* fmt, ...);
 #endif
 
 /**
- * @brief Insert an element at the end of the map (only valid for stack and queue).
+ * @brief Insert an element at the end of the map (only valid for stack and queue),
+ * or add an element to a bloom filter.
  *
  * @param[in] map Map to update.
  * @param[in] value Value to insert into the map.
@@ -285,14 +286,17 @@ EBPF_HELPER(int64_t, bpf_map_pop_elem, (void* map, void* value));
 #endif
 
 /**
- * @brief Copy an entry from the map (only valid for stack and queue).
+ * @brief Copy an entry from the map (only valid for stack and queue),
+ * or test whether a bloom filter contains the value.
  * Queue peeks at the beginning of the map.
  * Stack peeks at the end of the map.
  *
  * @param[in] map Map to search.
- * @param[out] value Value buffer to copy value from map into.
+ * @param[in, out] value Value buffer to copy value from map into, or the
+ *  value to test for in a bloom filter.
  * @retval EBPF_SUCCESS The operation was successful.
  * @retval -EBPF_OBJECT_NOT_FOUND The map is empty.
+ * @retval -EBPF_KEY_NOT_FOUND The value is not in the bloom filter.
  */
 EBPF_HELPER(int64_t, bpf_map_peek_elem, (void* map, void* value));
 #ifndef __doxygen
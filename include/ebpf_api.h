@@ -254,6 +254,89 @@ extern "C"
     ebpf_object_set_execution_type(_Inout_ struct bpf_object* object, ebpf_execution_type_t execution_type)
         EBPF_NO_EXCEPT;
 
+    /**
+     * @brief Set the number of threads used to verify the programs in an eBPF object file.
+     * The programs are still created in section order, so program IDs do not depend on
+     * the order in which verification completes.
+     *
+     * @param[in, out] object The eBPF object file.
+     * @param[in] thread_count Maximum number of programs to verify concurrently. 1 (the
+     *  default) verifies one program at a time, 0 uses one thread per logical processor.
+     *
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_INVALID_ARGUMENT The object is already loaded.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_object_set_load_thread_count(_Inout_ struct bpf_object* object, uint32_t thread_count) EBPF_NO_EXCEPT;
+
+    /**
+     * @brief Defer creating the maps of an eBPF object file that none of its programs
+     * reference. Such maps are created the first time their fd is requested, for
+     * example by bpf_map__fd() or bpf_map__pin(). Maps that are pinned on load are
+     * always created on load.
+     *
+     * @param[in, out] object The eBPF object file.
+     * @param[in] lazy_map_creation True to defer creating unreferenced maps.
+     *
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_INVALID_ARGUMENT The object is already loaded.
+     * @retval EBPF_OPERATION_NOT_SUPPORTED The object is a native eBPF object file.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_object_set_lazy_map_creation(_Inout_ struct bpf_object* object, bool lazy_map_creation) EBPF_NO_EXCEPT;
+
+    /**
+     * @brief Load a native eBPF object file as a new instance of an already loaded
+     * object from the same file. The instance shares the loaded driver's code, but
+     * gets its own maps and programs, so the driver is not loaded again. The
+     * native module must have been generated with bpf2c --instanced.
+     *
+     * @param[in, out] object The eBPF object file to load as an instance.
+     * @param[in] loaded_object Loaded eBPF object file to create the instance from.
+     *
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_INVALID_ARGUMENT The object is already loaded, or loaded_object
+     *  is not a loaded native eBPF object file.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_object_set_native_instance_of(
+        _Inout_ struct bpf_object* object, _In_ const struct bpf_object* loaded_object) EBPF_NO_EXCEPT;
+
+    /**
+     * @brief Load several eBPF object files in one operation. The maps of the
+     * objects are created in order, so a map pinned by name in one object is
+     * reused, and validated only once, by the objects after it. The programs of
+     * all the objects are then verified on a single pool of worker threads.
+     * Native eBPF object files are loaded individually.
+     *
+     * @param[in, out] objects The eBPF object files to load.
+     * @param[in] object_count Number of eBPF object files.
+     * @param[in] thread_count Maximum number of programs to verify concurrently,
+     *  or 0 to use one thread per logical processor.
+     * @param[out] results Result of loading each eBPF object file. An object that
+     *  fails to load is unloaded, without affecting the others.
+     *
+     * @returns EBPF_SUCCESS if all the objects were loaded, otherwise the result
+     *  of the first object that failed to load.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_object_load_multiple(
+        _Inout_updates_(object_count) struct bpf_object** objects,
+        size_t object_count,
+        uint32_t thread_count,
+        _Out_writes_(object_count) ebpf_result_t* results) EBPF_NO_EXCEPT;
+
+    /**
+     * @brief Get the time spent verifying and loading an eBPF program.
+     *
+     * @param[in] program The eBPF program.
+     *
+     * @returns Verification and load time in microseconds, or 0 if the program
+     *  was not loaded from an ELF file.
+     */
+    uint64_t
+    ebpf_program_get_verification_time(_In_ const struct bpf_program* program) EBPF_NO_EXCEPT;
+
     /**
      * @brief Attach an eBPF program.
      *
@@ -406,6 +489,25 @@ extern "C"
     ebpf_get_next_pinned_program_path(
         _In_z_ const char* start_path, _Out_writes_z_(EBPF_MAX_PIN_PATH_LENGTH) char* next_path) EBPF_NO_EXCEPT;
 
+    /**
+     * @brief Gets the next pinned path of any object type after a given path. Paths are returned in
+     *  lexicographic order, so all the paths under a prefix (such as a "directory") can be listed by starting
+     *  from the prefix itself and stopping at EBPF_NO_MORE_KEYS.
+     *
+     * @param[in] prefix Only return paths that start with this prefix. Pass an empty string to match all paths.
+     * @param[in] start_path Path to look for an entry greater than. Pass an empty string to start at the beginning.
+     * @param[out] next_path Returns the next path, if one exists.
+     *
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_NO_MORE_KEYS No more entries found.
+     * @retval EBPF_INVALID_ARGUMENT The prefix or start path is too long.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_get_next_pinned_path(
+        _In_z_ const char* prefix,
+        _In_z_ const char* start_path,
+        _Out_writes_z_(EBPF_MAX_PIN_PATH_LENGTH) char* next_path) EBPF_NO_EXCEPT;
+
     typedef struct _ebpf_program_info ebpf_program_info_t;
 
     /**
@@ -420,6 +522,90 @@ extern "C"
     _Must_inspect_result_ ebpf_result_t
     ebpf_get_program_info_from_verifier(_Outptr_ const ebpf_program_info_t** program_info) EBPF_NO_EXCEPT;
 
+    /**
+     * @brief Completion callback for an asynchronous map operation.
+     *
+     * Every operation that was submitted successfully invokes its callback exactly
+     * once, and submitted operations cannot be canceled. Each operation holds its
+     * own reference on the map, so the map file descriptor can be closed as soon as
+     * the operation has been submitted. The buffers and the callback context must
+     * stay valid, and the module containing the callback must stay loaded, until
+     * the callback has been invoked.
+     *
+     * @param[in, out] callback_context Context passed when the operation was submitted.
+     * @param[in] result Result of the map operation.
+     */
+    typedef void (*ebpf_map_async_completion_callback_t)(_Inout_opt_ void* callback_context, ebpf_result_t result);
+
+    /**
+     * @brief Submit an asynchronous lookup of an element in a map. The key and
+     * value buffers must stay valid until the callback has been invoked.
+     *
+     * @param[in] map_fd File descriptor of the map.
+     * @param[in] key Pointer to the key, or NULL for maps without keys.
+     * @param[out] value Buffer that receives the value.
+     * @param[in] callback Function invoked on a thread pool thread once the lookup completes.
+     * @param[in, out] callback_context Context passed to the callback.
+     *
+     * @retval EBPF_SUCCESS The operation was submitted; its result is passed to the callback.
+     * @retval EBPF_INVALID_ARGUMENT One or more parameters are wrong.
+     * @retval EBPF_INVALID_FD The map file descriptor is not valid.
+     * @retval EBPF_NO_MEMORY Out of memory.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_map_lookup_element_async(
+        fd_t map_fd,
+        _In_opt_ const void* key,
+        _Out_ void* value,
+        _In_ ebpf_map_async_completion_callback_t callback,
+        _Inout_opt_ void* callback_context) EBPF_NO_EXCEPT;
+
+    /**
+     * @brief Submit an asynchronous update of an element in a map. The key and
+     * value buffers must stay valid until the callback has been invoked.
+     *
+     * @param[in] map_fd File descriptor of the map.
+     * @param[in] key Pointer to the key, or NULL for maps without keys.
+     * @param[in] value Pointer to the value.
+     * @param[in] flags Map update flags (BPF_ANY, BPF_NOEXIST, or BPF_EXIST).
+     * @param[in] callback Function invoked on a thread pool thread once the update completes.
+     * @param[in, out] callback_context Context passed to the callback.
+     *
+     * @retval EBPF_SUCCESS The operation was submitted; its result is passed to the callback.
+     * @retval EBPF_INVALID_ARGUMENT One or more parameters are wrong.
+     * @retval EBPF_INVALID_FD The map file descriptor is not valid.
+     * @retval EBPF_NO_MEMORY Out of memory.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_map_update_element_async(
+        fd_t map_fd,
+        _In_opt_ const void* key,
+        _In_ const void* value,
+        uint64_t flags,
+        _In_ ebpf_map_async_completion_callback_t callback,
+        _Inout_opt_ void* callback_context) EBPF_NO_EXCEPT;
+
+    /**
+     * @brief Submit an asynchronous deletion of an element from a map. The key
+     * buffer must stay valid until the callback has been invoked.
+     *
+     * @param[in] map_fd File descriptor of the map.
+     * @param[in] key Pointer to the key.
+     * @param[in] callback Function invoked on a thread pool thread once the deletion completes.
+     * @param[in, out] callback_context Context passed to the callback.
+     *
+     * @retval EBPF_SUCCESS The operation was submitted; its result is passed to the callback.
+     * @retval EBPF_INVALID_ARGUMENT One or more parameters are wrong.
+     * @retval EBPF_INVALID_FD The map file descriptor is not valid.
+     * @retval EBPF_NO_MEMORY Out of memory.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_map_delete_element_async(
+        fd_t map_fd,
+        _In_ const void* key,
+        _In_ ebpf_map_async_completion_callback_t callback,
+        _Inout_opt_ void* callback_context) EBPF_NO_EXCEPT;
+
     typedef struct _ebpf_test_run_options
     {
         _Readable_bytes_(data_size_in) const uint8_t* data_in; ///< Input data to the program.
@@ -19,6 +19,17 @@ extern "C"
     extern ebpf_store_key_t ebpf_store_root_key;
     extern const wchar_t* ebpf_store_root_sub_key;
 
+    /**
+     * @brief Increment the generation counter of the eBPF store. Every update of the store increments it, so that
+     *  a snapshot of the store taken at an earlier generation is no longer used.
+     *
+     * @param[in] provider_key Open handle to the providers key of the store.
+     *
+     * @returns Status of the operation.
+     */
+    ebpf_result_t
+    ebpf_store_increment_generation(ebpf_store_key_t provider_key);
+
     /**
      * @brief Update global helper information in the eBPF store.
      *
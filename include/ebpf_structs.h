@@ -40,7 +40,8 @@ typedef enum bpf_map_type
     BPF_MAP_TYPE_QUEUE = 10,           ///< Queue.
     BPF_MAP_TYPE_LRU_PERCPU_HASH = 11, ///< Per-CPU least-recently-used hash table.
     BPF_MAP_TYPE_STACK = 12,           ///< Stack.
-    BPF_MAP_TYPE_RINGBUF = 13          ///< Ring buffer.
+    BPF_MAP_TYPE_RINGBUF = 13,         ///< Ring buffer.
+    BPF_MAP_TYPE_BLOOM_FILTER = 14     ///< Bloom filter, where values are added and tested without a key.
 } ebpf_map_type_t;
 
 #define BPF_MAP_TYPE_PER_CPU(X) \
@@ -61,6 +62,7 @@ static const char* const _ebpf_map_type_names[] = {
     BPF_ENUM_TO_STRING(BPF_MAP_TYPE_LRU_PERCPU_HASH),
     BPF_ENUM_TO_STRING(BPF_MAP_TYPE_STACK),
     BPF_ENUM_TO_STRING(BPF_MAP_TYPE_RINGBUF),
+    BPF_ENUM_TO_STRING(BPF_MAP_TYPE_BLOOM_FILTER),
 };
 
 static const char* const _ebpf_map_display_names[] = {
@@ -78,6 +80,7 @@ static const char* const _ebpf_map_display_names[] = {
     "lru_percpu_hash",
     "stack",
     "ringbuf",
+    "bloom_filter",
 };
 
 typedef enum ebpf_map_option
@@ -116,6 +119,7 @@ typedef struct _ebpf_map_definition_in_memory
     uint32_t max_entries; ///< Maximum number of entries allowed in the map.
     ebpf_id_t inner_map_id;
     ebpf_pin_type_t pinning;
+    uint32_t map_extra; ///< Map type specific option, such as the number of hash functions of a bloom filter.
 } ebpf_map_definition_in_memory_t;
 
 /**
@@ -386,6 +390,9 @@ struct bpf_map_info
     // Windows-specific fields.
     ebpf_id_t inner_map_id;     ///< ID of inner map template.
     uint32_t pinned_path_count; ///< Number of pinned paths.
+
+    // Fields added later are appended, so that callers built with an older, smaller structure still work.
+    uint64_t map_extra; ///< Map type specific option.
 };
 
 #define BPF_ANY 0x0
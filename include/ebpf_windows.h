@@ -37,6 +37,9 @@ typedef uint8_t GUID[16];
 
 #define EBPF_HELPER_DATA_PROTOTYPE L"Prototype"
 
+#define EBPF_STORE_GENERATION L"Generation"
+#define EBPF_STORE_SNAPSHOT L"Snapshot"
+
 #define EBPF_DATA_BPF_PROG_TYPE L"BpfProgType"
 #define EBPF_DATA_BPF_ATTACH_TYPE L"BpfAttachType"
 
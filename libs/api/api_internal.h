@@ -7,6 +7,8 @@
 #include "ebpf_api.h"
 #include "spec_type_descriptors.hpp"
 
+#include <mutex>
+
 #if !defined(EBPF_API_LOCKING)
 #define EBPF_API_LOCKING
 #endif
@@ -29,6 +31,8 @@ typedef struct bpf_program
     bool pinned;
     const char* log_buffer;
     uint32_t log_buffer_size;
+    // Time spent verifying and loading this program, in microseconds.
+    uint64_t verification_time;
 } ebpf_program_t;
 
 typedef struct bpf_map
@@ -59,6 +63,9 @@ typedef struct bpf_map
     // Whether this map is newly created or reused
     // from an existing map.
     bool reused;
+    // Whether creation of this map was deferred on load
+    // until its fd is first requested.
+    bool deferred;
 } ebpf_map_t;
 
 typedef struct bpf_link
@@ -78,6 +85,16 @@ typedef struct bpf_object
     std::vector<ebpf_map_t*> maps;
     bool loaded = false;
     ebpf_execution_type_t execution_type = EBPF_EXECUTION_ANY;
+    // Maximum number of programs verified concurrently. 0 means one per logical processor.
+    uint32_t load_thread_count = 1;
+    // Only create the maps referenced by the programs on load, and the rest on first use.
+    bool lazy_map_creation = false;
+    // Module ID of the loaded native module or module instance.
+    GUID native_module_id = {0};
+    // If set, the object is loaded as a new instance of this already loaded native module.
+    GUID native_instance_of = {0};
+    // Serializes creation of maps whose creation was deferred on load.
+    std::mutex deferred_map_mutex;
 } ebpf_object_t;
 
 /**
@@ -225,6 +242,17 @@ ebpf_object_close(_In_opt_ _Post_invalid_ struct bpf_object* object) noexcept;
 void
 initialize_map(_Out_ ebpf_map_t* map, _In_ const map_cache_t& map_cache) noexcept;
 
+/**
+ * @brief Create a map of a loaded object whose creation was deferred on load.
+ * Does nothing if the map has already been created.
+ * @param[in, out] map Pointer to eBPF map.
+ *
+ * @retval EBPF_SUCCESS The operation was successful.
+ * @retval EBPF_NO_MEMORY Out of memory.
+ */
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_create_deferred(_Inout_ struct bpf_map* map) noexcept;
+
 /**
  * @brief Pin an eBPF map to specified path.
  * @param[in] program Pointer to eBPF map.
@@ -276,7 +304,8 @@ ebpf_map_update_element(fd_t map_fd, _In_opt_ const void* key, _In_ const void*
  * @param[in] keys Pointer to buffer containing keys.
  * @param[in] values Pointer to buffer containing values.
  * @param[in, out] count On input, contains the maximum number of elements to
- * update. On output, contains the actual number of elements updated.
+ * update. On output, contains the actual number of elements updated, including
+ * when the operation fails part way through the batch.
  * @param[in] flags Flags to control the behavior of the API.
  *
  * @retval EBPF_SUCCESS The operation was successful.
@@ -380,7 +409,8 @@ ebpf_map_lookup_and_delete_element(fd_t map_fd, _In_opt_ const void* key, _Out_
  * @param[in] map_fd File descriptor for the eBPF map.
  * @param[in] in_batch Pointer to buffer containing keys.
  * @param[out] out_batch Pointer to buffer that contains values on success.
- * @param[out] keys Pointer to buffer that contains keys on success.
+ * @param[out] keys Pointer to buffer that contains keys on success, or NULL for a map with no keys. For a map
+ * with no keys, such as a queue or stack, the values are popped in order.
  * @param[out] values Pointer to buffer that contains values on success.
  * @param[in, out] count On input, contains the maximum number of elements to
  * return. On output, contains the actual number of elements returned.
@@ -396,7 +426,7 @@ ebpf_map_lookup_and_delete_element_batch(
     fd_t map_fd,
     _In_opt_ const void* in_batch,
     _Out_ void* out_batch,
-    _Out_ void* keys,
+    _Out_opt_ void* keys,
     _Out_ void* values,
     _Inout_ uint32_t* count,
     uint64_t flags) noexcept;
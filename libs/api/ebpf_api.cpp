@@ -36,11 +36,16 @@ typedef unsigned char boolean;
 #include "windows_platform_common.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <codecvt>
 #include <fcntl.h>
 #include <io.h>
 #include <mutex>
 #include <rpc.h>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
 
 using namespace peparse;
 using namespace Platform;
@@ -126,6 +131,41 @@ _Requires_lock_not_held_(_ebpf_state_mutex) static void _clean_up_ebpf_objects()
 // Used to serialize access to the pe-parse library.
 static std::mutex _pe_parse_mutex;
 
+typedef struct _map_descriptor_properties
+{
+    uint32_t type;
+    uint32_t key_size;
+    uint32_t value_size;
+    uint32_t max_entries;
+} map_descriptor_properties_t;
+
+// Cache of map properties for every map handle the map APIs have been called on,
+// so that map operations do not need to query the execution context each time.
+// Every file descriptor this library closes, and every one closed through ebpf_close_fd,
+// goes through _close_file_descriptor, which drops the entry of the closed handle. Every
+// handle this library hands out goes through _create_file_descriptor_for_handle, which
+// drops any stale entry left by a descriptor closed directly with _close.
+static std::shared_mutex _map_descriptor_cache_mutex;
+_Guarded_by_(_map_descriptor_cache_mutex) static std::unordered_map<
+    ebpf_handle_t,
+    map_descriptor_properties_t> _map_descriptor_cache;
+
+// Per-thread request and reply buffers for map lookups. They are resized rather than
+// reallocated, so after warming up a thread performs lookups without heap allocations.
+// Lookups whose request or reply is larger than EBPF_MAP_LOOKUP_BUFFER_MAX_CACHED_SIZE
+// use buffers allocated for the call, so a single large lookup doesn't pin memory on
+// the thread for its lifetime.
+#define EBPF_MAP_LOOKUP_BUFFER_MAX_CACHED_SIZE 4096
+thread_local static ebpf_protocol_buffer_t _map_lookup_request_buffer;
+thread_local static ebpf_protocol_buffer_t _map_lookup_reply_buffer;
+
+static void
+_invalidate_map_descriptor_cache_entry(ebpf_handle_t handle) noexcept
+{
+    std::unique_lock lock(_map_descriptor_cache_mutex);
+    _map_descriptor_cache.erase(handle);
+}
+
 static ebpf_result_t
 _ebpf_program_load_native(
     _In_z_ const char* file_name,
@@ -145,6 +185,7 @@ _ebpf_get_section_string(
 static fd_t
 _create_file_descriptor_for_handle(ebpf_handle_t handle) NO_EXCEPT_TRY
 {
+    _invalidate_map_descriptor_cache_entry(handle);
     return Platform::_open_osfhandle(handle, 0);
 }
 CATCH_NO_MEMORY_FD
@@ -156,6 +197,20 @@ _get_handle_from_file_descriptor(fd_t fd) NO_EXCEPT_TRY
 }
 CATCH_NO_MEMORY_FD
 
+/**
+ * @brief Close a file descriptor and drop the cached map properties of its handle.
+ *
+ * @param[in] fd File descriptor to close.
+ *
+ * @returns The result of _close.
+ */
+static int
+_close_file_descriptor(fd_t fd) noexcept
+{
+    _invalidate_map_descriptor_cache_entry(_get_handle_from_file_descriptor(fd));
+    return Platform::_close(fd);
+}
+
 inline static int
 _ebpf_create_registry_key(HKEY root_key, _In_z_ const wchar_t* path) NO_EXCEPT_TRY
 {
@@ -318,7 +373,7 @@ ebpf_map_create(
 
     ebpf_assert(map_fd);
 
-    if (opts && opts->map_flags != 0) {
+    if (opts && (opts->map_flags != 0 || opts->map_extra > UINT32_MAX)) {
         result = EBPF_INVALID_ARGUMENT;
         goto Exit;
     }
@@ -329,6 +384,7 @@ ebpf_map_create(
         map_definition.key_size = key_size;
         map_definition.value_size = value_size;
         map_definition.max_entries = max_entries;
+        map_definition.map_extra = (opts) ? (uint32_t)opts->map_extra : 0;
 
         // bpf_map_create_opts has inner_map_fd defined as __u32, so it cannot be set to
         // ebpf_fd_invalid (-1). Hence treat inner_map_fd = 0 as ebpf_fd_invalid.
@@ -375,10 +431,16 @@ _map_lookup_element(
     ebpf_result_t result = EBPF_SUCCESS;
     ebpf_assert(value);
     try {
-        ebpf_protocol_buffer_t request_buffer(
-            EBPF_OFFSET_OF(ebpf_operation_map_find_element_request_t, key) + key_size);
-        ebpf_protocol_buffer_t reply_buffer(
-            EBPF_OFFSET_OF(ebpf_operation_map_find_element_reply_t, value) + value_size);
+        size_t request_size = EBPF_OFFSET_OF(ebpf_operation_map_find_element_request_t, key) + key_size;
+        size_t reply_size = EBPF_OFFSET_OF(ebpf_operation_map_find_element_reply_t, value) + value_size;
+        ebpf_protocol_buffer_t local_request_buffer;
+        ebpf_protocol_buffer_t local_reply_buffer;
+        bool use_cached_buffers = request_size <= EBPF_MAP_LOOKUP_BUFFER_MAX_CACHED_SIZE &&
+                                  reply_size <= EBPF_MAP_LOOKUP_BUFFER_MAX_CACHED_SIZE;
+        ebpf_protocol_buffer_t& request_buffer = use_cached_buffers ? _map_lookup_request_buffer : local_request_buffer;
+        ebpf_protocol_buffer_t& reply_buffer = use_cached_buffers ? _map_lookup_reply_buffer : local_reply_buffer;
+        request_buffer.resize(request_size);
+        reply_buffer.resize(reply_size);
         auto request = reinterpret_cast<ebpf_operation_map_find_element_request_t*>(request_buffer.data());
         auto reply = reinterpret_cast<ebpf_operation_map_find_element_reply_t*>(reply_buffer.data());
 
@@ -419,6 +481,7 @@ _get_map_descriptor_properties(
     EBPF_LOG_ENTRY();
     ebpf_result_t result = EBPF_SUCCESS;
     ebpf_map_t* map;
+    map_descriptor_properties_t properties = {BPF_MAP_TYPE_UNSPEC};
 
     ebpf_assert(type);
     ebpf_assert(key_size);
@@ -430,24 +493,50 @@ _get_map_descriptor_properties(
     *value_size = 0;
     *max_entries = 0;
 
-    // First check if the map is present in the cache.
-    map = _get_ebpf_map_from_handle(handle);
-    if (map == nullptr) {
-        // Map is not present in the local cache. Query map descriptor from execution context.
-        ebpf_id_t id;
-        ebpf_id_t inner_map_id;
-        result = query_map_definition(handle, &id, type, key_size, value_size, max_entries, &inner_map_id);
-        if (result != EBPF_SUCCESS) {
-            result = EBPF_INVALID_ARGUMENT;
-            goto Exit;
+    // First check if the map properties have already been cached.
+    {
+        std::shared_lock lock(_map_descriptor_cache_mutex);
+        auto it = _map_descriptor_cache.find(handle);
+        if (it != _map_descriptor_cache.end()) {
+            properties = it->second;
         }
-    } else {
-        *type = map->map_definition.type;
-        *key_size = map->map_definition.key_size;
-        *value_size = map->map_definition.value_size;
-        *max_entries = map->map_definition.max_entries;
     }
 
+    if (properties.type == BPF_MAP_TYPE_UNSPEC) {
+        // Next check if the map belongs to an object loaded by this process.
+        map = _get_ebpf_map_from_handle(handle);
+        if (map == nullptr) {
+            // Map is not present in the local cache. Query map descriptor from execution context.
+            ebpf_id_t id;
+            ebpf_id_t inner_map_id;
+            result = query_map_definition(
+                handle,
+                &id,
+                &properties.type,
+                &properties.key_size,
+                &properties.value_size,
+                &properties.max_entries,
+                &inner_map_id);
+            if (result != EBPF_SUCCESS) {
+                result = EBPF_INVALID_ARGUMENT;
+                goto Exit;
+            }
+        } else {
+            properties.type = map->map_definition.type;
+            properties.key_size = map->map_definition.key_size;
+            properties.value_size = map->map_definition.value_size;
+            properties.max_entries = map->map_definition.max_entries;
+        }
+
+        std::unique_lock lock(_map_descriptor_cache_mutex);
+        _map_descriptor_cache[handle] = properties;
+    }
+
+    *type = properties.type;
+    *key_size = properties.key_size;
+    *value_size = properties.value_size;
+    *max_entries = properties.max_entries;
+
 Exit:
     EBPF_RETURN_RESULT(result);
 }
@@ -470,8 +559,6 @@ _ebpf_map_lookup_element_helper(fd_t map_fd, bool find_and_delete, _In_opt_ cons
         result = EBPF_INVALID_ARGUMENT;
         goto Exit;
     }
-    *((uint8_t*)value) = 0;
-
     map_handle = _get_handle_from_file_descriptor(map_fd);
     if (map_handle == ebpf_handle_invalid) {
         result = EBPF_INVALID_FD;
@@ -488,6 +575,13 @@ _ebpf_map_lookup_element_helper(fd_t map_fd, bool find_and_delete, _In_opt_ cons
         goto Exit;
     }
     assert(value_size != 0);
+    if (type == BPF_MAP_TYPE_BLOOM_FILTER) {
+        // A bloom filter lookup tests whether the value is in the map, so the value is sent as the key and
+        // nothing is returned.
+        result = _map_lookup_element(map_handle, find_and_delete, value_size, (uint8_t*)value, 0, (uint8_t*)value);
+        goto Exit;
+    }
+    *((uint8_t*)value) = 0;
     if (BPF_MAP_TYPE_PER_CPU(type)) {
         value_size = EBPF_PAD_8(value_size) * libbpf_num_possible_cpus();
     }
@@ -507,7 +601,7 @@ _ebpf_map_lookup_element_batch_helper(
     fd_t map_fd,
     _In_opt_ const void* in_batch,
     _Out_ void* out_batch,
-    _Out_ void* keys,
+    _Out_opt_ void* keys,
     _Out_ void* values,
     _Inout_ uint32_t* count,
     bool find_and_delete) NO_EXCEPT_TRY
@@ -528,7 +622,6 @@ _ebpf_map_lookup_element_batch_helper(
 
     const uint8_t* previous_key = reinterpret_cast<const uint8_t*>(in_batch);
 
-    ebpf_assert(keys);
     ebpf_assert(values);
     ebpf_assert(count);
 
@@ -557,7 +650,13 @@ _ebpf_map_lookup_element_batch_helper(
     key_size = key_size_u32;
     value_size = value_size_u32;
 
-    if (key_size == 0 || value_size == 0 || input_count == 0) {
+    // Maps without keys, such as queue and stack, can only be drained, which pops the values in order.
+    if ((key_size == 0 && !find_and_delete) || value_size == 0 || input_count == 0) {
+        result = EBPF_INVALID_ARGUMENT;
+        goto Exit;
+    }
+
+    if ((keys == nullptr) != (key_size == 0)) {
         result = EBPF_INVALID_ARGUMENT;
         goto Exit;
     }
@@ -588,6 +687,12 @@ _ebpf_map_lookup_element_batch_helper(
         }
 
         result = win32_error_code_to_ebpf_result(invoke_ioctl(request_buffer, reply_buffer));
+        if (result == EBPF_NO_MORE_KEYS && count_returned != 0) {
+            // The previous batch ended exactly at the last entry. Return what was fetched, as entries that were
+            // popped from a queue or stack can't be fetched again.
+            result = EBPF_SUCCESS;
+            break;
+        }
         if (result != EBPF_SUCCESS) {
             goto Exit;
         }
@@ -673,7 +778,7 @@ ebpf_map_lookup_and_delete_element_batch(
     fd_t map_fd,
     _In_opt_ const void* in_batch,
     _Out_ void* out_batch,
-    _Out_ void* keys,
+    _Out_opt_ void* keys,
     _Out_ void* values,
     _Inout_ uint32_t* count,
     uint64_t flags) NO_EXCEPT_TRY
@@ -749,11 +854,13 @@ _update_map_element_batch(
     ebpf_operation_map_update_element_batch_reply_t reply;
     size_t input_count = *count;
     size_t max_entries_per_batch = 0;
+    size_t key_index = 0;
 
     ebpf_assert(value);
     ebpf_assert(key || !key_size);
 
-    if (key_size == 0 || value_size == 0 || input_count == 0) {
+    // Maps without keys, such as queue and stack, push the values in order.
+    if (value_size == 0 || input_count == 0) {
         result = EBPF_INVALID_ARGUMENT;
         goto Exit;
     }
@@ -763,7 +870,7 @@ _update_map_element_batch(
     max_entries_per_batch /= (key_size + value_size);
 
     try {
-        for (size_t key_index = 0; key_index < input_count;) {
+        while (key_index < input_count) {
             // Compute the number of entries to update in this batch.
             size_t entries_to_update = min(input_count - key_index, max_entries_per_batch);
 
@@ -793,13 +900,20 @@ _update_map_element_batch(
                 goto Exit;
             }
 
-            // Check number of entries updated in this batch.
+            // Check number of entries updated in this batch. Entries before a failed one stay updated.
+            if (reply.count_of_elements_processed > entries_to_update) {
+                result = EBPF_INVALID_ARGUMENT;
+                goto Exit;
+            }
+            key_index += reply.count_of_elements_processed;
+            if (reply.result != EBPF_SUCCESS) {
+                result = reply.result;
+                goto Exit;
+            }
             if (reply.count_of_elements_processed != entries_to_update) {
                 result = EBPF_INVALID_ARGUMENT;
                 goto Exit;
             }
-
-            key_index += entries_to_update;
         }
         result = EBPF_SUCCESS;
     } catch (const std::bad_alloc&) {
@@ -811,6 +925,8 @@ _update_map_element_batch(
     }
 
 Exit:
+    // Report how many elements were updated, including on failure.
+    *count = static_cast<uint32_t>(key_index);
     EBPF_RETURN_RESULT(result);
 }
 CATCH_NO_MEMORY_EBPF_RESULT
@@ -968,6 +1084,7 @@ ebpf_map_update_element_batch(
             if (fd != ebpf_fd_invalid) {
                 handle = _get_handle_from_file_descriptor(fd);
                 if (handle == ebpf_handle_invalid) {
+                    *count = static_cast<uint32_t>(index);
                     EBPF_RETURN_RESULT(EBPF_INVALID_FD);
                 }
             }
@@ -976,6 +1093,7 @@ ebpf_map_update_element_batch(
             __analysis_assume(key_size != 0);
             result = _update_map_element_with_handle(map_handle, static_cast<uint32_t>(key_size), key, handle, flags);
             if (result != EBPF_SUCCESS) {
+                *count = static_cast<uint32_t>(index);
                 EBPF_RETURN_RESULT(result);
             }
         }
@@ -1223,6 +1341,167 @@ Exit:
 }
 CATCH_NO_MEMORY_EBPF_RESULT
 
+typedef enum _ebpf_map_async_operation_type
+{
+    EBPF_MAP_ASYNC_OPERATION_LOOKUP,
+    EBPF_MAP_ASYNC_OPERATION_UPDATE,
+    EBPF_MAP_ASYNC_OPERATION_DELETE,
+} ebpf_map_async_operation_type_t;
+
+typedef struct _ebpf_map_async_operation
+{
+    ebpf_map_async_operation_type_t type;
+    fd_t map_fd;
+    const void* key;
+    void* value;
+    uint64_t flags;
+    ebpf_map_async_completion_callback_t callback;
+    void* callback_context;
+} ebpf_map_async_operation_t;
+
+static void CALLBACK
+_ebpf_map_async_operation_worker(_Inout_ PTP_CALLBACK_INSTANCE instance, _Inout_opt_ void* context) noexcept
+{
+    UNREFERENCED_PARAMETER(instance);
+    ebpf_map_async_operation_t* operation = reinterpret_cast<ebpf_map_async_operation_t*>(context);
+    ebpf_assert(operation);
+    _Analysis_assume_(operation != nullptr);
+
+    // Each thread pool thread issues the IOCTL on its own synchronous device handle, so
+    // operations submitted back to back run concurrently on different CPUs.
+    ebpf_result_t result;
+    switch (operation->type) {
+    case EBPF_MAP_ASYNC_OPERATION_LOOKUP:
+        result = ebpf_map_lookup_element(operation->map_fd, operation->key, operation->value);
+        break;
+    case EBPF_MAP_ASYNC_OPERATION_UPDATE:
+        result = ebpf_map_update_element(operation->map_fd, operation->key, operation->value, operation->flags);
+        break;
+    case EBPF_MAP_ASYNC_OPERATION_DELETE:
+        result = ebpf_map_delete_element(operation->map_fd, operation->key);
+        break;
+    default:
+        result = EBPF_INVALID_ARGUMENT;
+        break;
+    }
+
+    // Drop the map reference taken when the operation was submitted.
+    _close_file_descriptor(operation->map_fd);
+
+    operation->callback(operation->callback_context, result);
+    ebpf_free(operation);
+}
+
+static ebpf_result_t
+_ebpf_map_submit_async_operation(
+    ebpf_map_async_operation_type_t type,
+    fd_t map_fd,
+    _In_opt_ const void* key,
+    _In_opt_ void* value,
+    uint64_t flags,
+    _In_ ebpf_map_async_completion_callback_t callback,
+    _Inout_opt_ void* callback_context) noexcept
+{
+    EBPF_LOG_ENTRY();
+    if (map_fd <= 0 || callback == nullptr) {
+        EBPF_RETURN_RESULT(EBPF_INVALID_ARGUMENT);
+    }
+
+    ebpf_result_t result = EBPF_SUCCESS;
+    ebpf_handle_t operation_map_handle = ebpf_handle_invalid;
+    ebpf_map_async_operation_t* operation = nullptr;
+
+    ebpf_handle_t map_handle = _get_handle_from_file_descriptor(map_fd);
+    if (map_handle == ebpf_handle_invalid) {
+        result = EBPF_INVALID_FD;
+        goto Exit;
+    }
+
+    operation = reinterpret_cast<ebpf_map_async_operation_t*>(ebpf_allocate(sizeof(ebpf_map_async_operation_t)));
+    if (operation == nullptr) {
+        result = EBPF_NO_MEMORY;
+        goto Exit;
+    }
+    operation->type = type;
+    operation->key = key;
+    operation->value = value;
+    operation->flags = flags;
+    operation->callback = callback;
+    operation->callback_context = callback_context;
+
+    // The operation holds its own reference on the map until it completes, so the caller can close map_fd as soon as
+    // the operation has been submitted.
+    if (!Platform::DuplicateHandle(
+            reinterpret_cast<ebpf_handle_t>(GetCurrentProcess()),
+            map_handle,
+            reinterpret_cast<ebpf_handle_t>(GetCurrentProcess()),
+            &operation_map_handle,
+            0,
+            FALSE,
+            DUPLICATE_SAME_ACCESS)) {
+        result = win32_error_code_to_ebpf_result(GetLastError());
+        EBPF_LOG_WIN32_API_FAILURE(EBPF_TRACELOG_KEYWORD_API, DuplicateHandle);
+        goto Exit;
+    }
+    operation->map_fd = _create_file_descriptor_for_handle(operation_map_handle);
+    if (operation->map_fd == ebpf_fd_invalid) {
+        result = EBPF_NO_MEMORY;
+        goto Exit;
+    }
+    operation_map_handle = ebpf_handle_invalid;
+
+    if (!TrySubmitThreadpoolCallback(_ebpf_map_async_operation_worker, operation, nullptr)) {
+        EBPF_LOG_WIN32_API_FAILURE(EBPF_TRACELOG_KEYWORD_API, TrySubmitThreadpoolCallback);
+        _close_file_descriptor(operation->map_fd);
+        result = EBPF_NO_MEMORY;
+        goto Exit;
+    }
+    operation = nullptr;
+
+Exit:
+    if (operation_map_handle != ebpf_handle_invalid) {
+        Platform::CloseHandle(operation_map_handle);
+    }
+    ebpf_free(operation);
+    EBPF_RETURN_RESULT(result);
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_lookup_element_async(
+    fd_t map_fd,
+    _In_opt_ const void* key,
+    _Out_ void* value,
+    _In_ ebpf_map_async_completion_callback_t callback,
+    _Inout_opt_ void* callback_context) noexcept
+{
+    return _ebpf_map_submit_async_operation(
+        EBPF_MAP_ASYNC_OPERATION_LOOKUP, map_fd, key, value, 0, callback, callback_context);
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_update_element_async(
+    fd_t map_fd,
+    _In_opt_ const void* key,
+    _In_ const void* value,
+    uint64_t flags,
+    _In_ ebpf_map_async_completion_callback_t callback,
+    _Inout_opt_ void* callback_context) noexcept
+{
+    return _ebpf_map_submit_async_operation(
+        EBPF_MAP_ASYNC_OPERATION_UPDATE, map_fd, key, const_cast<void*>(value), flags, callback, callback_context);
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_delete_element_async(
+    fd_t map_fd,
+    _In_ const void* key,
+    _In_ ebpf_map_async_completion_callback_t callback,
+    _Inout_opt_ void* callback_context) noexcept
+{
+    return _ebpf_map_submit_async_operation(
+        EBPF_MAP_ASYNC_OPERATION_DELETE, map_fd, key, nullptr, 0, callback, callback_context);
+}
+
 #if !defined(CONFIG_BPF_JIT_DISABLED) || !defined(CONFIG_BPF_INTERPRETER_DISABLED)
 static ebpf_result_t
 _create_program(
@@ -1352,9 +1631,13 @@ ebpf_map_pin(_In_ struct bpf_map* map, _In_opt_z_ const char* path) NO_EXCEPT_TR
             EBPF_RETURN_RESULT(EBPF_NO_MEMORY);
         }
     }
+    ebpf_result_t result = ebpf_map_create_deferred(map);
+    if (result != EBPF_SUCCESS) {
+        EBPF_RETURN_RESULT(result);
+    }
     assert(map->map_handle != ebpf_handle_invalid);
     assert(map->map_fd > 0);
-    ebpf_result_t result = ebpf_object_pin(map->map_fd, map->pin_path);
+    result = ebpf_object_pin(map->map_fd, map->pin_path);
     if (result == EBPF_SUCCESS) {
         map->pinned = true;
     }
@@ -1397,6 +1680,10 @@ ebpf_map_unpin(_In_ struct bpf_map* map, _In_opt_z_ const char* path) NO_EXCEPT_
     } else if (path == nullptr) {
         EBPF_RETURN_RESULT(EBPF_INVALID_ARGUMENT);
     }
+    if (map->deferred) {
+        // The map has not been created yet, so it can't be pinned.
+        EBPF_RETURN_RESULT(EBPF_SUCCESS);
+    }
     assert(map->map_handle != ebpf_handle_invalid);
     assert(map->map_fd > 0);
 
@@ -1588,7 +1875,7 @@ _clean_up_ebpf_link(_Frees_ptr_opt_ ebpf_link_t* link) noexcept
 #pragma warning(push)
 #pragma warning(disable : 6001)
     if (link->fd != ebpf_fd_invalid) {
-        Platform::_close(link->fd);
+        _close_file_descriptor(link->fd);
     }
     ebpf_free(link->pin_path);
     ebpf_free(link);
@@ -1774,10 +2061,24 @@ ebpf_api_close_handle(ebpf_handle_t handle) NO_EXCEPT_TRY
     ebpf_operation_close_handle_request_t request = {
         sizeof(request), ebpf_operation_id_t::EBPF_OPERATION_CLOSE_HANDLE, handle};
 
+    _invalidate_map_descriptor_cache_entry(handle);
+
     EBPF_RETURN_RESULT(win32_error_code_to_ebpf_result(invoke_ioctl(request)));
 }
 CATCH_NO_MEMORY_EBPF_RESULT
 
+_Must_inspect_result_ ebpf_result_t
+ebpf_close_fd(fd_t fd) NO_EXCEPT_TRY
+{
+    EBPF_LOG_ENTRY();
+    if (fd == ebpf_fd_invalid || _get_handle_from_file_descriptor(fd) == ebpf_handle_invalid) {
+        EBPF_RETURN_RESULT(EBPF_INVALID_FD);
+    }
+
+    EBPF_RETURN_RESULT((_close_file_descriptor(fd) == 0) ? EBPF_SUCCESS : EBPF_INVALID_FD);
+}
+CATCH_NO_MEMORY_EBPF_RESULT
+
 _Must_inspect_result_ ebpf_result_t
 ebpf_api_get_pinned_map_info(
     _Out_ uint16_t* map_count, _Outptr_result_buffer_maybenull_(*map_count) ebpf_map_info_t** map_info) NO_EXCEPT_TRY
@@ -1919,7 +2220,7 @@ _Requires_lock_not_held_(_ebpf_state_mutex) void clean_up_ebpf_map(_In_ _Post_in
     EBPF_LOG_ENTRY();
     ebpf_assert(map);
     if (map->map_fd > 0) {
-        Platform::_close(map->map_fd);
+        _close_file_descriptor(map->map_fd);
     }
     if (map->map_handle != ebpf_handle_invalid) {
         std::unique_lock lock(_ebpf_state_mutex);
@@ -1951,7 +2252,7 @@ _clean_up_ebpf_object(_In_opt_ _Post_invalid_ ebpf_object_t* object) noexcept
 
         if (object->native_module_fd != ebpf_fd_invalid) {
             ebpf_assert(object->execution_type == EBPF_EXECUTION_NATIVE);
-            Platform::_close(object->native_module_fd);
+            _close_file_descriptor(object->native_module_fd);
             object->native_module_fd = ebpf_fd_invalid;
         }
 
@@ -2357,6 +2658,32 @@ Done:
 }
 CATCH_NO_MEMORY_EBPF_RESULT
 
+// Find the inner map template of a map of maps, and remember it
+// in the map. Returns nullptr if there is none.
+static ebpf_map_t*
+_find_inner_map_template(_In_ const std::vector<ebpf_map_t*>& maps, _Inout_ ebpf_map_t* map) noexcept
+{
+    if (map->map_definition.type != BPF_MAP_TYPE_ARRAY_OF_MAPS &&
+        map->map_definition.type != BPF_MAP_TYPE_HASH_OF_MAPS) {
+        return nullptr;
+    }
+    if (map->inner_map == nullptr) {
+        // This map requires an inner map template, look up which one.
+        for (auto& inner_map : maps) {
+            if (!inner_map) {
+                continue;
+            }
+            if ((map->map_definition.inner_map_id != EBPF_ID_NONE &&
+                 inner_map->map_id == map->map_definition.inner_map_id) ||
+                (map->inner_map_original_fd == inner_map->original_fd)) {
+                map->inner_map = inner_map;
+                break;
+            }
+        }
+    }
+    return map->inner_map;
+}
+
 // Find a map that needs to be created and doesn't depend on
 // creating another map first.  That is, we want to create an
 // inner map template before creating an outer map that depends
@@ -2366,31 +2693,17 @@ _get_next_map_to_create(std::vector<ebpf_map_t*>& maps) NO_EXCEPT_TRY
 {
     EBPF_LOG_ENTRY();
     for (auto& map : maps) {
-        if (map->map_handle != ebpf_handle_invalid) {
-            // Already created.
+        if (map->map_handle != ebpf_handle_invalid || map->deferred) {
+            // Already created, or to be created on first use.
             continue;
         }
         if (map->map_definition.type != BPF_MAP_TYPE_ARRAY_OF_MAPS &&
             map->map_definition.type != BPF_MAP_TYPE_HASH_OF_MAPS) {
             EBPF_RETURN_POINTER(ebpf_map_t*, map);
         }
-        if (map->inner_map == nullptr) {
-            // This map requires an inner map template, look up which one.
-            for (auto& inner_map : maps) {
-                if (!inner_map) {
-                    continue;
-                }
-                if ((map->map_definition.inner_map_id != EBPF_ID_NONE &&
-                     inner_map->map_id == map->map_definition.inner_map_id) ||
-                    (map->inner_map_original_fd == inner_map->original_fd)) {
-                    map->inner_map = inner_map;
-                    break;
-                }
-            }
-            if (map->inner_map == nullptr) {
-                // We can't create this map because there is no inner template.
-                continue;
-            }
+        if (_find_inner_map_template(maps, map) == nullptr) {
+            // We can't create this map because there is no inner template.
+            continue;
         }
         if (map->inner_map->map_handle == ebpf_handle_invalid) {
             // We need to create the inner map template first.
@@ -2907,6 +3220,49 @@ ebpf_object_get_execution_type(_In_ const struct bpf_object* object) noexcept
     return object->execution_type;
 }
 
+_Must_inspect_result_ ebpf_result_t
+ebpf_object_set_load_thread_count(_Inout_ struct bpf_object* object, uint32_t thread_count) noexcept
+{
+    if (object->loaded) {
+        return EBPF_INVALID_ARGUMENT;
+    }
+
+    object->load_thread_count = thread_count;
+    return EBPF_SUCCESS;
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_object_set_lazy_map_creation(_Inout_ struct bpf_object* object, bool lazy_map_creation) noexcept
+{
+    if (object->loaded) {
+        return EBPF_INVALID_ARGUMENT;
+    }
+    if (object->execution_type == EBPF_EXECUTION_NATIVE) {
+        // The maps of a native module are created by the execution context when the module is loaded.
+        return EBPF_OPERATION_NOT_SUPPORTED;
+    }
+
+    object->lazy_map_creation = lazy_map_creation;
+    return EBPF_SUCCESS;
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_object_set_native_instance_of(
+    _Inout_ struct bpf_object* object, _In_ const struct bpf_object* loaded_object) noexcept
+{
+    if (object->loaded || object->execution_type != EBPF_EXECUTION_NATIVE || !loaded_object->loaded ||
+        loaded_object->execution_type != EBPF_EXECUTION_NATIVE ||
+        IsEqualGUID(loaded_object->native_module_id, GUID_NULL)) {
+        return EBPF_INVALID_ARGUMENT;
+    }
+
+    // Instances are always created from the module that was loaded from the driver.
+    object->native_instance_of = IsEqualGUID(loaded_object->native_instance_of, GUID_NULL)
+                                     ? loaded_object->native_module_id
+                                     : loaded_object->native_instance_of;
+    return EBPF_SUCCESS;
+}
+
 static ebpf_result_t
 _ebpf_validate_map(_In_ const ebpf_map_t* map, fd_t original_map_fd) NO_EXCEPT_TRY
 {
@@ -2923,7 +3279,8 @@ _ebpf_validate_map(_In_ const ebpf_map_t* map, fd_t original_map_fd) NO_EXCEPT_T
     }
 
     if (info.type != map->map_definition.type || info.key_size != map->map_definition.key_size ||
-        info.value_size != map->map_definition.value_size || info.max_entries != map->map_definition.max_entries) {
+        info.value_size != map->map_definition.value_size || info.max_entries != map->map_definition.max_entries ||
+        info.map_extra != map->map_definition.map_extra) {
         result = EBPF_INVALID_ARGUMENT;
         goto Exit;
     }
@@ -2950,13 +3307,43 @@ _ebpf_validate_map(_In_ const ebpf_map_t* map, fd_t original_map_fd) NO_EXCEPT_T
     }
 
 Exit:
-    Platform::_close(inner_map_info_fd);
+    _close_file_descriptor(inner_map_info_fd);
     EBPF_RETURN_RESULT(result);
 }
 CATCH_NO_MEMORY_EBPF_RESULT
 
+// Maps that have already been created or validated at a pin path while loading
+// a batch of objects, indexed by pin path.
+typedef std::map<std::string, const ebpf_map_t*> ebpf_pinned_map_cache_t;
+
+/**
+ * @brief Check whether the definition of a map matches that of a map which has
+ * already been validated against the map pinned at the same path.
+ */
+static bool
+_ebpf_map_definitions_match(_In_ const ebpf_map_t* map, _In_ const ebpf_map_t* validated_map) noexcept
+{
+    const ebpf_map_definition_in_memory_t& definition = map->map_definition;
+    const ebpf_map_definition_in_memory_t& validated_definition = validated_map->map_definition;
+    if (definition.type != validated_definition.type || definition.key_size != validated_definition.key_size ||
+        definition.value_size != validated_definition.value_size ||
+        definition.max_entries != validated_definition.max_entries ||
+        definition.map_extra != validated_definition.map_extra) {
+        return false;
+    }
+
+    if (_ebpf_is_map_in_map(map)) {
+        if (map->inner_map == nullptr || validated_map->inner_map == nullptr) {
+            return false;
+        }
+        return _ebpf_map_definitions_match(map->inner_map, validated_map->inner_map);
+    }
+
+    return true;
+}
+
 static ebpf_result_t
-_ebpf_object_reuse_map(_Inout_ ebpf_map_t* map) NO_EXCEPT_TRY
+_ebpf_object_reuse_map(_Inout_ ebpf_map_t* map, _In_opt_ const ebpf_pinned_map_cache_t* pinned_maps) NO_EXCEPT_TRY
 {
     EBPF_LOG_ENTRY();
     ebpf_result_t result = EBPF_SUCCESS;
@@ -2970,9 +3357,23 @@ _ebpf_object_reuse_map(_Inout_ ebpf_map_t* map) NO_EXCEPT_TRY
         EBPF_RETURN_RESULT(EBPF_SUCCESS);
     }
 
-    // Recursively validate that the map definition matches with the existing
-    // map.
-    result = _ebpf_validate_map(map, map_fd);
+    const ebpf_map_t* validated_map = nullptr;
+    if (pinned_maps != nullptr) {
+        auto entry = pinned_maps->find(map->pin_path);
+        if (entry != pinned_maps->end()) {
+            validated_map = entry->second;
+        }
+    }
+
+    if (validated_map != nullptr) {
+        // The pinned map was already validated earlier in this batch, so comparing
+        // with that definition avoids querying the existing map again.
+        result = _ebpf_map_definitions_match(map, validated_map) ? EBPF_SUCCESS : EBPF_INVALID_ARGUMENT;
+    } else {
+        // Recursively validate that the map definition matches with the existing
+        // map.
+        result = _ebpf_validate_map(map, map_fd);
+    }
     if (result != EBPF_SUCCESS) {
         goto Exit;
     }
@@ -2985,23 +3386,86 @@ _ebpf_object_reuse_map(_Inout_ ebpf_map_t* map) NO_EXCEPT_TRY
 
 Exit:
     if (result != EBPF_SUCCESS) {
-        Platform::_close(map_fd);
+        _close_file_descriptor(map_fd);
     }
     EBPF_RETURN_RESULT(result);
 }
 CATCH_NO_MEMORY_EBPF_RESULT
 
-_Requires_lock_not_held_(_ebpf_state_mutex) static ebpf_result_t
-    _ebpf_object_create_maps(_Inout_ ebpf_object_t* object) noexcept(false)
+/**
+ * @brief Defer creating the maps of an object that none of its programs reference.
+ * Maps that are pinned on load, and the inner map templates of maps that are
+ * created on load, are still created on load.
+ *
+ * @param[in, out] object Object whose maps are to be deferred.
+ */
+static void
+_ebpf_object_defer_unreferenced_maps(_Inout_ ebpf_object_t* object) noexcept
+{
+    for (auto& map : object->maps) {
+        map->deferred = (map->map_definition.pinning == LIBBPF_PIN_NONE && map->pin_path == nullptr);
+    }
+
+    for (auto& program : object->programs) {
+        for (uint32_t index = 0; index + 1 < program->instruction_count; index++) {
+            const ebpf_inst& instruction = program->instructions[index];
+            if (instruction.opcode != INST_OP_LDDW_IMM) {
+                continue;
+            }
+            index++;
+
+            // Check for the LD_MAP and LD_MAP_VALUE flags.
+            if (instruction.src != 1 && instruction.src != 2) {
+                continue;
+            }
+            for (auto& map : object->maps) {
+                if (map->original_fd == instruction.imm) {
+                    map->deferred = false;
+                }
+            }
+        }
+    }
+
+    // An outer map can only be created once its inner map template has been created.
+    for (auto& map : object->maps) {
+        if (map->deferred) {
+            continue;
+        }
+        for (ebpf_map_t* inner_map = _find_inner_map_template(object->maps, map);
+             inner_map != nullptr && inner_map->deferred;
+             inner_map = _find_inner_map_template(object->maps, inner_map)) {
+            inner_map->deferred = false;
+        }
+    }
+}
+
+/**
+ * @brief Create the maps of an object, reusing any compatible maps that are
+ * already pinned.
+ *
+ * @param[in, out] object Object whose maps are to be created.
+ * @param[in, out] pinned_maps Optionally, the maps pinned by objects loaded
+ *  earlier in the same batch. On success, the pinned maps of this object are
+ *  added to it.
+ */
+_Requires_lock_not_held_(_ebpf_state_mutex) static ebpf_result_t _ebpf_object_create_maps(
+    _Inout_ ebpf_object_t* object, _Inout_opt_ ebpf_pinned_map_cache_t* pinned_maps) noexcept(false)
 {
     EBPF_LOG_ENTRY();
     ebpf_assert(object);
 
     ebpf_result_t result = EBPF_SUCCESS;
+    size_t map_count = object->maps.size();
 
     clear_map_descriptors();
 
-    for (int count = 0; count < object->maps.size(); count++) {
+    if (object->lazy_map_creation) {
+        _ebpf_object_defer_unreferenced_maps(object);
+        map_count = std::count_if(
+            object->maps.begin(), object->maps.end(), [](const ebpf_map_t* map) { return !map->deferred; });
+    }
+
+    for (size_t count = 0; count < map_count; count++) {
         ebpf_map_t* map = _get_next_map_to_create(object->maps);
         if (map == nullptr) {
             // Any remaining maps cannot be created.
@@ -3010,7 +3474,7 @@ _Requires_lock_not_held_(_ebpf_state_mutex) static ebpf_result_t
         }
 
         if (map->map_definition.pinning == LIBBPF_PIN_BY_NAME) {
-            result = _ebpf_object_reuse_map(map);
+            result = _ebpf_object_reuse_map(map, pinned_maps);
             if (result != EBPF_SUCCESS) {
                 break;
             }
@@ -3039,7 +3503,16 @@ _Requires_lock_not_held_(_ebpf_state_mutex) static ebpf_result_t
         if (result == EBPF_SUCCESS) {
             std::unique_lock lock(_ebpf_state_mutex);
             for (auto& map : object->maps) {
-                _ebpf_maps.insert(std::pair<ebpf_handle_t, ebpf_map_t*>(map->map_handle, map));
+                if (!map->deferred) {
+                    _ebpf_maps.insert(std::pair<ebpf_handle_t, ebpf_map_t*>(map->map_handle, map));
+                }
+            }
+        }
+        if (result == EBPF_SUCCESS && pinned_maps != nullptr) {
+            for (auto& map : object->maps) {
+                if (map->pin_path && map->pinned) {
+                    pinned_maps->emplace(map->pin_path, map);
+                }
             }
         }
     } catch (const std::bad_alloc&) {
@@ -3062,16 +3535,76 @@ _Requires_lock_not_held_(_ebpf_state_mutex) static ebpf_result_t
     EBPF_RETURN_RESULT(result);
 }
 
-#if !defined(CONFIG_BPF_JIT_DISABLED) || !defined(CONFIG_BPF_INTERPRETER_DISABLED)
-_Must_inspect_result_ ebpf_result_t
-ebpf_program_load_bytes(
-    _In_ const ebpf_program_type_t* program_type,
-    _In_opt_z_ const char* program_name,
-    ebpf_execution_type_t execution_type,
-    _In_reads_(instruction_count) const ebpf_inst* instructions,
-    uint32_t instruction_count,
-    _Out_writes_opt_(log_buffer_size) char* log_buffer,
-    size_t log_buffer_size,
+// Must be called with the deferred_map_mutex of the map's object held.
+_Requires_lock_not_held_(_ebpf_state_mutex) _Must_inspect_result_ static ebpf_result_t
+_ebpf_map_create_deferred(_Inout_ struct bpf_map* map)
+{
+    if (!map->deferred) {
+        return EBPF_SUCCESS;
+    }
+
+    ebpf_result_t result = EBPF_SUCCESS;
+    ebpf_handle_t inner_map_handle = ebpf_handle_invalid;
+    std::vector<ebpf_map_t*>& maps = const_cast<ebpf_object_t*>(map->object)->maps;
+    if (map->map_definition.type == BPF_MAP_TYPE_ARRAY_OF_MAPS ||
+        map->map_definition.type == BPF_MAP_TYPE_HASH_OF_MAPS) {
+        // The inner map template has to be created before the outer map.
+        ebpf_map_t* inner_map = _find_inner_map_template(maps, map);
+        if (inner_map == nullptr) {
+            result = EBPF_INVALID_OBJECT;
+            goto Exit;
+        }
+        result = _ebpf_map_create_deferred(inner_map);
+        if (result != EBPF_SUCCESS) {
+            goto Exit;
+        }
+        map->map_definition.inner_map_id = inner_map->map_id;
+        inner_map_handle = inner_map->map_handle;
+    }
+
+    result = _create_map(map->name, &map->map_definition, inner_map_handle, &map->map_handle);
+    if (result != EBPF_SUCCESS) {
+        goto Exit;
+    }
+    map->map_fd = _create_file_descriptor_for_handle(map->map_handle);
+
+    {
+        std::unique_lock lock(_ebpf_state_mutex);
+        _ebpf_maps.insert(std::pair<ebpf_handle_t, ebpf_map_t*>(map->map_handle, map));
+    }
+
+    // Only clear the flag once the fd is valid, so concurrent callers never return an invalid fd.
+    map->deferred = false;
+
+Exit:
+    return result;
+}
+
+_Requires_lock_not_held_(_ebpf_state_mutex) _Must_inspect_result_ ebpf_result_t
+    ebpf_map_create_deferred(_Inout_ struct bpf_map* map) NO_EXCEPT_TRY
+{
+    EBPF_LOG_ENTRY();
+    ebpf_assert(map);
+
+    if (map->object == nullptr) {
+        EBPF_RETURN_RESULT(map->deferred ? EBPF_INVALID_OBJECT : EBPF_SUCCESS);
+    }
+
+    std::unique_lock lock(const_cast<ebpf_object_t*>(map->object)->deferred_map_mutex);
+    EBPF_RETURN_RESULT(_ebpf_map_create_deferred(map));
+}
+CATCH_NO_MEMORY_EBPF_RESULT
+
+#if !defined(CONFIG_BPF_JIT_DISABLED) || !defined(CONFIG_BPF_INTERPRETER_DISABLED)
+_Must_inspect_result_ ebpf_result_t
+ebpf_program_load_bytes(
+    _In_ const ebpf_program_type_t* program_type,
+    _In_opt_z_ const char* program_name,
+    ebpf_execution_type_t execution_type,
+    _In_reads_(instruction_count) const ebpf_inst* instructions,
+    uint32_t instruction_count,
+    _Out_writes_opt_(log_buffer_size) char* log_buffer,
+    size_t log_buffer_size,
     _Out_ fd_t* program_fd) NO_EXCEPT_TRY
 {
     EBPF_LOG_ENTRY();
@@ -3178,14 +3711,153 @@ ebpf_program_load_bytes(
 }
 CATCH_NO_MEMORY_EBPF_RESULT
 
-_Requires_lock_not_held_(_ebpf_state_mutex) static ebpf_result_t
-    _ebpf_object_load_programs(_Inout_ struct bpf_object* object) noexcept(false)
+/**
+ * @brief Verify and load the byte code of a program that has already been created.
+ * This is safe to call concurrently for different programs of the same object.
+ *
+ * @param[in] object Object the program belongs to.
+ * @param[in, out] program Program to verify and load.
+ * @param[in] handle_map Map handles referenced by the object.
+ *
+ * @returns Result of the verification and load.
+ */
+static ebpf_result_t
+_ebpf_object_load_program(
+    _In_ const struct bpf_object* object,
+    _Inout_ struct bpf_program* program,
+    _In_ const std::vector<original_fd_handle_map_t>& handle_map) noexcept
 {
     EBPF_LOG_ENTRY();
-    ebpf_assert(object);
+
+    // Populate load_info.
+    ebpf_program_load_info load_info = {0};
+    load_info.object_name = const_cast<char*>(object->object_name);
+    load_info.section_name = const_cast<char*>(program->section_name);
+    load_info.program_name = const_cast<char*>(program->program_name);
+    load_info.program_type = program->program_type;
+    load_info.program_handle = reinterpret_cast<file_handle_t>(program->handle);
+    load_info.execution_type = object->execution_type;
+    load_info.instructions = reinterpret_cast<ebpf_instruction_t*>(program->instructions);
+    load_info.instruction_count = program->instruction_count;
+    load_info.execution_context = execution_context_kernel_mode;
+    load_info.map_count = (uint32_t)handle_map.size();
+    if (load_info.map_count > 0) {
+        load_info.handle_map = const_cast<original_fd_handle_map_t*>(handle_map.data());
+    }
+
+    auto start_time = std::chrono::steady_clock::now();
+    ebpf_result_t result = ebpf_rpc_load_program(&load_info, &program->log_buffer, &program->log_buffer_size);
+    program->verification_time =
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count();
+
+    EBPF_LOG_MESSAGE_STRING(
+        EBPF_TRACELOG_LEVEL_VERBOSE, EBPF_TRACELOG_KEYWORD_API, "Verified section", program->section_name);
+    EBPF_LOG_MESSAGE_UINT64(
+        EBPF_TRACELOG_LEVEL_VERBOSE,
+        EBPF_TRACELOG_KEYWORD_API,
+        "Section verification time (us)",
+        program->verification_time);
+
+    EBPF_RETURN_RESULT(result);
+}
+
+typedef struct _ebpf_program_load_work_item
+{
+    const struct bpf_object* object;
+    struct bpf_program* program;
+    const std::vector<original_fd_handle_map_t>* handle_map;
+    size_t object_index; ///< Index of the object among the objects being loaded.
+    ebpf_result_t result;
+} ebpf_program_load_work_item_t;
+
+/**
+ * @brief Verify and load programs on a pool of worker threads. All the programs
+ * must already have been created. Once a program fails to load, the remaining
+ * programs of the same object are skipped.
+ *
+ * @param[in, out] work_items Programs to load. The result of each program is
+ *  stored in its work item.
+ * @param[in] object_count Number of objects the work items belong to.
+ * @param[in] thread_count Number of worker threads to use.
+ *
+ * @retval EBPF_SUCCESS The worker threads ran; see the work items for the results.
+ * @retval EBPF_NO_MEMORY Unable to start the worker threads.
+ */
+static ebpf_result_t
+_ebpf_load_programs_parallel(
+    _Inout_ std::vector<ebpf_program_load_work_item_t>& work_items,
+    size_t object_count,
+    uint32_t thread_count) noexcept(false)
+{
+    EBPF_LOG_ENTRY();
+    size_t work_item_count = work_items.size();
+    std::unique_ptr<std::atomic<bool>[]> failed(new std::atomic<bool>[object_count]());
+    std::atomic<size_t> next_index = 0;
+
+    auto worker = [&]() noexcept {
+        for (size_t index = next_index++; index < work_item_count; index = next_index++) {
+            ebpf_program_load_work_item_t& work_item = work_items[index];
+            if (failed[work_item.object_index]) {
+                continue;
+            }
+            work_item.result = _ebpf_object_load_program(work_item.object, work_item.program, *work_item.handle_map);
+            if (work_item.result != EBPF_SUCCESS) {
+                failed[work_item.object_index] = true;
+            }
+        }
+
+        // Worker threads are not reused, so release any per-thread state (such as the
+        // device handle and the verifier caches) acquired while loading programs.
+        ebpf_clear_thread_local_storage();
+    };
+
+    std::vector<std::thread> threads;
     ebpf_result_t result = EBPF_SUCCESS;
+    try {
+        for (uint32_t i = 0; i < thread_count; i++) {
+            threads.emplace_back(worker);
+        }
+    } catch (...) {
+        // Stop the workers that did start, then report the failure.
+        next_index = work_item_count;
+        result = EBPF_NO_MEMORY;
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EBPF_RETURN_RESULT(result);
+}
+
+/**
+ * @brief Get the map handles referenced by the programs of an object. All the
+ * maps must already have been created.
+ */
+static std::vector<original_fd_handle_map_t>
+_ebpf_object_get_handle_map(_In_ const struct bpf_object* object) noexcept(false)
+{
     std::vector<original_fd_handle_map_t> handle_map;
+    for (auto& map : object->maps) {
+        ebpf_id_t inner_map_id = (map->inner_map) ? map->inner_map->map_id : EBPF_ID_NONE;
+        handle_map.emplace_back(
+            map->original_fd,
+            map->map_id,
+            map->inner_map_original_fd,
+            inner_map_id,
+            reinterpret_cast<file_handle_t>(map->map_handle));
+    }
+    return handle_map;
+}
 
+/**
+ * @brief Create the programs of an object in section order, so that program IDs
+ * do not depend on the order in which verification completes.
+ */
+static ebpf_result_t
+_ebpf_object_create_programs(_Inout_ struct bpf_object* object) noexcept(false)
+{
+    ebpf_result_t result = EBPF_SUCCESS;
     for (auto& program : object->programs) {
         result = _create_program(
             program->program_type, object->object_name, program->section_name, program->program_name, &program->handle);
@@ -3194,45 +3866,81 @@ _Requires_lock_not_held_(_ebpf_state_mutex) static ebpf_result_t
         }
 
         program->fd = _create_file_descriptor_for_handle(program->handle);
+    }
+    return result;
+}
 
-        // Populate load_info.
-        ebpf_program_load_info load_info = {0};
-        load_info.object_name = const_cast<char*>(object->object_name);
-        load_info.section_name = const_cast<char*>(program->section_name);
-        load_info.program_name = const_cast<char*>(program->program_name);
-        load_info.program_type = program->program_type;
-        load_info.program_handle = reinterpret_cast<file_handle_t>(program->handle);
-        load_info.execution_type = object->execution_type;
-        load_info.instructions = reinterpret_cast<ebpf_instruction_t*>(program->instructions);
-        load_info.instruction_count = program->instruction_count;
-        load_info.execution_context = execution_context_kernel_mode;
-        load_info.map_count = (uint32_t)object->maps.size();
-
-        if (load_info.map_count > 0) {
-            for (auto& map : object->maps) {
-                ebpf_id_t inner_map_id = (map->inner_map) ? map->inner_map->map_id : EBPF_ID_NONE;
-                handle_map.emplace_back(
-                    map->original_fd,
-                    map->map_id,
-                    map->inner_map_original_fd,
-                    inner_map_id,
-                    reinterpret_cast<file_handle_t>(map->map_handle));
+_Requires_lock_not_held_(_ebpf_state_mutex) static void
+    _ebpf_object_register_programs(_In_ const struct bpf_object* object) noexcept(false)
+{
+    std::unique_lock lock(_ebpf_state_mutex);
+    for (auto& program : object->programs) {
+        _ebpf_programs.insert(std::pair<ebpf_handle_t, ebpf_program_t*>(program->handle, program));
+    }
+}
+
+static uint32_t
+_ebpf_get_load_thread_count(uint32_t thread_count, size_t program_count) noexcept
+{
+    if (thread_count == 0) {
+        thread_count = std::thread::hardware_concurrency();
+    }
+    if (thread_count > program_count) {
+        thread_count = (uint32_t)program_count;
+    }
+    return thread_count;
+}
+
+_Requires_lock_not_held_(_ebpf_state_mutex) static ebpf_result_t
+    _ebpf_object_load_programs(_Inout_ struct bpf_object* object) noexcept(false)
+{
+    EBPF_LOG_ENTRY();
+    ebpf_assert(object);
+    ebpf_result_t result = EBPF_SUCCESS;
+
+    // All maps have been created, so the handle map is the same for every program.
+    std::vector<original_fd_handle_map_t> handle_map = _ebpf_object_get_handle_map(object);
+
+    uint32_t thread_count = _ebpf_get_load_thread_count(object->load_thread_count, object->programs.size());
+
+    if (thread_count <= 1) {
+        for (auto& program : object->programs) {
+            result = _create_program(
+                program->program_type,
+                object->object_name,
+                program->section_name,
+                program->program_name,
+                &program->handle);
+            if (result != EBPF_SUCCESS) {
+                break;
             }
 
-            load_info.handle_map = handle_map.data();
+            program->fd = _create_file_descriptor_for_handle(program->handle);
+
+            result = _ebpf_object_load_program(object, program, handle_map);
+            if (result != EBPF_SUCCESS) {
+                break;
+            }
         }
+    } else {
+        result = _ebpf_object_create_programs(object);
 
-        result = ebpf_rpc_load_program(&load_info, &program->log_buffer, &program->log_buffer_size);
-        if (result != EBPF_SUCCESS) {
-            break;
+        if (result == EBPF_SUCCESS) {
+            std::vector<ebpf_program_load_work_item_t> work_items;
+            for (auto& program : object->programs) {
+                work_items.push_back({object, program, &handle_map, 0, EBPF_SUCCESS});
+            }
+            result = _ebpf_load_programs_parallel(work_items, 1, thread_count);
+
+            // Report the first program, in section order, that failed to load.
+            for (size_t index = 0; result == EBPF_SUCCESS && index < work_items.size(); index++) {
+                result = work_items[index].result;
+            }
         }
     }
 
     if (result == EBPF_SUCCESS) {
-        std::unique_lock lock(_ebpf_state_mutex);
-        for (auto& program : object->programs) {
-            _ebpf_programs.insert(std::pair<ebpf_handle_t, ebpf_program_t*>(program->handle, program));
-        }
+        _ebpf_object_register_programs(object);
     }
     EBPF_RETURN_RESULT(result);
 }
@@ -3265,7 +3973,7 @@ ebpf_object_load(_Inout_ struct bpf_object* object) NO_EXCEPT_TRY
     }
 
     try {
-        result = _ebpf_object_create_maps(object);
+        result = _ebpf_object_create_maps(object, nullptr);
         if (result != EBPF_SUCCESS) {
             goto Done;
         }
@@ -3293,6 +4001,123 @@ Done:
 }
 CATCH_NO_MEMORY_EBPF_RESULT
 
+_Must_inspect_result_ ebpf_result_t
+ebpf_object_load_multiple(
+    _Inout_updates_(object_count) struct bpf_object** objects,
+    size_t object_count,
+    uint32_t thread_count,
+    _Out_writes_(object_count) ebpf_result_t* results) NO_EXCEPT_TRY
+{
+    EBPF_LOG_ENTRY();
+    ebpf_assert(objects);
+    ebpf_assert(results);
+
+    ebpf_result_t result = EBPF_SUCCESS;
+    ebpf_pinned_map_cache_t pinned_maps;
+    std::vector<std::vector<original_fd_handle_map_t>> handle_maps(object_count);
+    // Objects whose maps and programs have been created, but whose programs are not loaded yet.
+    std::vector<bool> pending(object_count, false);
+
+    // Create the maps of the objects in order, so that a map pinned by one object
+    // is found, and validated only once, by the objects after it.
+    for (size_t index = 0; index < object_count; index++) {
+        struct bpf_object* object = objects[index];
+        if (object->loaded) {
+            results[index] = EBPF_INVALID_ARGUMENT;
+            continue;
+        }
+
+        if (Platform::_is_native_program(object->file_name)) {
+            // Native modules are verified when they are built, so they are loaded individually.
+            results[index] = ebpf_object_load(object);
+            continue;
+        }
+
+        try {
+            results[index] = _ebpf_object_create_maps(object, &pinned_maps);
+            if (results[index] == EBPF_SUCCESS) {
+                handle_maps[index] = _ebpf_object_get_handle_map(object);
+                results[index] = _ebpf_object_create_programs(object);
+            }
+        } catch (const std::bad_alloc&) {
+            results[index] = EBPF_NO_MEMORY;
+        } catch (...) {
+            results[index] = EBPF_FAILED;
+        }
+
+        if (results[index] == EBPF_SUCCESS) {
+            pending[index] = true;
+        } else {
+            ebpf_assert_success(ebpf_object_unload(object));
+        }
+    }
+
+#if !defined(CONFIG_BPF_JIT_DISABLED) || !defined(CONFIG_BPF_INTERPRETER_DISABLED)
+    // Verify and load the programs of all the objects on a single pool of worker
+    // threads, so that an object with few programs does not leave threads idle.
+    try {
+        std::vector<ebpf_program_load_work_item_t> work_items;
+        for (size_t index = 0; index < object_count; index++) {
+            if (!pending[index]) {
+                continue;
+            }
+            for (auto& program : objects[index]->programs) {
+                work_items.push_back({objects[index], program, &handle_maps[index], index, EBPF_SUCCESS});
+            }
+        }
+
+        if (!work_items.empty()) {
+            uint32_t pool_thread_count = _ebpf_get_load_thread_count(thread_count, work_items.size());
+            ebpf_result_t pool_result = _ebpf_load_programs_parallel(work_items, object_count, pool_thread_count);
+
+            // Report the first program of each object, in section order, that failed to load.
+            for (auto& work_item : work_items) {
+                ebpf_result_t& object_result = results[work_item.object_index];
+                if (object_result == EBPF_SUCCESS) {
+                    object_result = (pool_result != EBPF_SUCCESS) ? pool_result : work_item.result;
+                }
+            }
+        }
+    } catch (const std::bad_alloc&) {
+        for (size_t index = 0; index < object_count; index++) {
+            if (pending[index]) {
+                results[index] = EBPF_NO_MEMORY;
+            }
+        }
+    }
+#else
+    for (size_t index = 0; index < object_count; index++) {
+        if (pending[index]) {
+            results[index] = EBPF_OPERATION_NOT_SUPPORTED;
+        }
+    }
+#endif
+
+    for (size_t index = 0; index < object_count; index++) {
+        struct bpf_object* object = objects[index];
+        if (pending[index]) {
+            if (results[index] == EBPF_SUCCESS) {
+                try {
+                    _ebpf_object_register_programs(object);
+                    object->loaded = true;
+                } catch (const std::bad_alloc&) {
+                    results[index] = EBPF_NO_MEMORY;
+                }
+            }
+            if (results[index] != EBPF_SUCCESS) {
+                ebpf_assert_success(ebpf_object_unload(object));
+            }
+        }
+
+        if (result == EBPF_SUCCESS) {
+            result = results[index];
+        }
+    }
+
+    EBPF_RETURN_RESULT(result);
+}
+CATCH_NO_MEMORY_EBPF_RESULT
+
 // This function is intended to work like libbpf's bpf_object__unload().
 _Requires_lock_not_held_(_ebpf_state_mutex) _Must_inspect_result_ ebpf_result_t
     ebpf_object_unload(_Inout_ struct bpf_object* object) NO_EXCEPT_TRY
@@ -3301,8 +4126,9 @@ _Requires_lock_not_held_(_ebpf_state_mutex) _Must_inspect_result_ ebpf_result_t
     ebpf_assert(object);
 
     for (auto& map : object->maps) {
+        map->deferred = false;
         if (map->map_fd > 0) {
-            Platform::_close(map->map_fd);
+            _close_file_descriptor(map->map_fd);
             map->map_fd = ebpf_fd_invalid;
         }
         if (map->map_handle != ebpf_handle_invalid) {
@@ -3328,7 +4154,7 @@ _Requires_lock_not_held_(_ebpf_state_mutex) _Must_inspect_result_ ebpf_result_t
     ebpf_assert(program);
 
     if (program->fd != ebpf_fd_invalid) {
-        Platform::_close(program->fd);
+        _close_file_descriptor(program->fd);
         program->fd = ebpf_fd_invalid;
     }
     if (program->handle != ebpf_handle_invalid) {
@@ -3407,6 +4233,58 @@ Done:
     EBPF_RETURN_RESULT(result);
 }
 
+/**
+ * @brief Create a new instance of a loaded native module.
+ *
+ * @param[in] module_id Module ID of the loaded native module.
+ * @param[in] instance_id Module ID to assign to the new instance.
+ * @param[out] module_handle Handle to the new instance.
+ * @param[out] count_of_maps Count of maps present in the native module.
+ * @param[out] count_of_programs Count of programs present in the native module.
+ *
+ * @retval EBPF_SUCCESS The operation was successful.
+ * @retval EBPF_OBJECT_NOT_FOUND No native module exists with that module ID.
+ * @retval EBPF_OPERATION_NOT_SUPPORTED The native module is not instanced.
+ */
+static ebpf_result_t
+_load_native_module_instance(
+    _In_ const GUID* module_id,
+    _In_ const GUID* instance_id,
+    _Out_ ebpf_handle_t* module_handle,
+    _Out_ size_t* count_of_maps,
+    _Out_ size_t* count_of_programs) noexcept(false)
+{
+    EBPF_LOG_ENTRY();
+    ebpf_result_t result = EBPF_SUCCESS;
+    uint32_t error = ERROR_SUCCESS;
+    ebpf_operation_load_native_module_instance_request_t request;
+    ebpf_operation_load_native_module_instance_reply_t reply;
+
+    *count_of_maps = 0;
+    *count_of_programs = 0;
+    *module_handle = ebpf_handle_invalid;
+
+    request.header.id = ebpf_operation_id_t::EBPF_OPERATION_LOAD_NATIVE_MODULE_INSTANCE;
+    request.header.length = sizeof(request);
+    request.module_id = *module_id;
+    request.instance_id = *instance_id;
+
+    error = invoke_ioctl(request, reply);
+    if (error != ERROR_SUCCESS) {
+        result = win32_error_code_to_ebpf_result(error);
+        EBPF_LOG_WIN32_GUID_API_FAILURE(EBPF_TRACELOG_KEYWORD_API, module_id, invoke_ioctl);
+        goto Done;
+    }
+
+    ebpf_assert(reply.header.id == ebpf_operation_id_t::EBPF_OPERATION_LOAD_NATIVE_MODULE_INSTANCE);
+    *count_of_maps = reply.count_of_maps;
+    *count_of_programs = reply.count_of_programs;
+    *module_handle = reply.native_module_handle;
+
+Done:
+    EBPF_RETURN_RESULT(result);
+}
+
 /**
  * @brief Create maps and load programs from a loaded native module.
  *
@@ -3557,6 +4435,25 @@ _ebpf_program_load_native(
         &provider_module_id);
 
     try {
+        if (!IsEqualGUID(object->native_instance_of, GUID_NULL)) {
+            // The driver is already loaded. Create a new instance of its module instead of a new service.
+            result = _load_native_module_instance(
+                &object->native_instance_of,
+                &provider_module_id,
+                &native_module_handle,
+                &count_of_maps,
+                &count_of_programs);
+            if (result != EBPF_SUCCESS) {
+                EBPF_LOG_MESSAGE_STRING(
+                    EBPF_TRACELOG_LEVEL_ERROR,
+                    EBPF_TRACELOG_KEYWORD_API,
+                    "_ebpf_program_load_native: load native module instance failed",
+                    file_name);
+                goto Done;
+            }
+            goto ModuleLoaded;
+        }
+
         // Create a driver service with a random name.
         service_name = guid_to_wide_string(&service_name_guid);
 
@@ -3596,6 +4493,7 @@ _ebpf_program_load_native(
             goto Done;
         }
 
+    ModuleLoaded:
         // Create a file descriptor for the native module.
         native_module_fd = _create_file_descriptor_for_handle(native_module_handle);
         if (native_module_fd == ebpf_fd_invalid) {
@@ -3662,6 +4560,7 @@ _ebpf_program_load_native(
             goto Done;
         }
         native_module_fd = ebpf_fd_invalid;
+        object->native_module_id = provider_module_id;
 
         *program_fd = object->programs[0]->fd;
     } catch (const std::bad_alloc&) {
@@ -3693,7 +4592,7 @@ Done:
         }
 #pragma warning(pop)
         if (native_module_fd != ebpf_fd_invalid) {
-            Platform::_close(native_module_fd);
+            _close_file_descriptor(native_module_fd);
         } else if (native_module_handle != ebpf_handle_invalid) {
             Platform::CloseHandle(native_module_handle);
         }
@@ -3854,6 +4753,13 @@ ebpf_program_get_fd(_In_ const struct bpf_program* program) noexcept
     EBPF_RETURN_FD(program->fd);
 }
 
+uint64_t
+ebpf_program_get_verification_time(_In_ const struct bpf_program* program) noexcept
+{
+    ebpf_assert(program);
+    return program->verification_time;
+}
+
 void
 ebpf_object_close(_In_opt_ _Post_invalid_ struct bpf_object* object) noexcept
 {
@@ -3955,6 +4861,56 @@ ebpf_get_next_pinned_program_path(
 }
 CATCH_NO_MEMORY_EBPF_RESULT
 
+_Must_inspect_result_ ebpf_result_t
+ebpf_get_next_pinned_path(
+    _In_z_ const char* prefix,
+    _In_z_ const char* start_path,
+    _Out_writes_z_(EBPF_MAX_PIN_PATH_LENGTH) char* next_path) NO_EXCEPT_TRY
+{
+    EBPF_LOG_ENTRY();
+    ebpf_assert(prefix);
+    ebpf_assert(start_path);
+    ebpf_assert(next_path);
+
+    size_t prefix_length = strlen(prefix);
+    size_t start_path_length = strlen(start_path);
+    if (prefix_length >= EBPF_MAX_PIN_PATH_LENGTH || start_path_length >= EBPF_MAX_PIN_PATH_LENGTH) {
+        EBPF_RETURN_RESULT(EBPF_INVALID_ARGUMENT);
+    }
+
+    ebpf_protocol_buffer_t request_buffer(
+        EBPF_OFFSET_OF(ebpf_operation_get_next_pinned_path_request_t, data) + prefix_length + start_path_length);
+    ebpf_protocol_buffer_t reply_buffer(
+        EBPF_OFFSET_OF(ebpf_operation_get_next_pinned_path_reply_t, next_path) + EBPF_MAX_PIN_PATH_LENGTH - 1);
+    ebpf_operation_get_next_pinned_path_request_t* request =
+        reinterpret_cast<ebpf_operation_get_next_pinned_path_request_t*>(request_buffer.data());
+    ebpf_operation_get_next_pinned_path_reply_t* reply =
+        reinterpret_cast<ebpf_operation_get_next_pinned_path_reply_t*>(reply_buffer.data());
+
+    request->header.id = ebpf_operation_id_t::EBPF_OPERATION_GET_NEXT_PINNED_PATH;
+    request->header.length = static_cast<uint16_t>(request_buffer.size());
+    reply->header.length = static_cast<uint16_t>(reply_buffer.size());
+
+    request->prefix_length = static_cast<uint16_t>(prefix_length);
+    memcpy(request->data, prefix, prefix_length);
+    memcpy(request->data + prefix_length, start_path, start_path_length);
+
+    uint32_t error = invoke_ioctl(request_buffer, reply_buffer);
+    ebpf_result_t result = win32_error_code_to_ebpf_result(error);
+    if (result != EBPF_SUCCESS) {
+        EBPF_RETURN_RESULT(result);
+    }
+    ebpf_assert(reply->header.id == ebpf_operation_id_t::EBPF_OPERATION_GET_NEXT_PINNED_PATH);
+    size_t next_path_length =
+        reply->header.length - EBPF_OFFSET_OF(ebpf_operation_get_next_pinned_path_reply_t, next_path);
+    memcpy(next_path, reply->next_path, next_path_length);
+
+    next_path[next_path_length] = '\0';
+
+    EBPF_RETURN_RESULT(EBPF_SUCCESS);
+}
+CATCH_NO_MEMORY_EBPF_RESULT
+
 static ebpf_result_t
 _get_next_id(ebpf_operation_id_t operation, ebpf_id_t start_id, _Out_ ebpf_id_t* next_id) NO_EXCEPT_TRY
 {
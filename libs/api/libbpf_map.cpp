@@ -227,7 +227,16 @@ bpf_map__is_pinned(const struct bpf_map* map)
 int
 bpf_map__fd(const struct bpf_map* map)
 {
-    return map ? map->map_fd : libbpf_err(-EINVAL);
+    if (!map) {
+        return libbpf_err(-EINVAL);
+    }
+
+    // Maps whose creation was deferred when the object was loaded are created on first use.
+    ebpf_result_t result = ebpf_map_create_deferred(const_cast<struct bpf_map*>(map));
+    if (result != EBPF_SUCCESS) {
+        return libbpf_result_err(result);
+    }
+    return map->map_fd;
 }
 
 struct bpf_map*
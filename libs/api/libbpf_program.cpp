@@ -603,7 +603,7 @@ __bpf_set_link_xdp_fd_replace(int ifindex, int fd, int old_fd, __u32 flags)
                     }
                 }
 
-                Platform::_close(link_fd);
+                (void)ebpf_close_fd(link_fd);
             }
         }
     }
@@ -669,7 +669,7 @@ bpf_xdp_query_id(int ifindex, int flags, __u32* prog_id)
         struct bpf_link_info link_info;
         uint32_t info_size = sizeof(link_info);
         err = bpf_obj_get_info_by_fd(link_fd, &link_info, &info_size);
-        Platform::_close(link_fd);
+        (void)ebpf_close_fd(link_fd);
         if (err != 0) {
             return err;
         }
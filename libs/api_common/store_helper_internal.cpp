@@ -798,10 +798,586 @@ ebpf_store_delete_global_helper_information(_In_ ebpf_helper_function_prototype_
         goto Exit;
     }
 
+    result = ebpf_store_increment_generation(provider_key);
+
 Exit:
     ebpf_free(helper_name);
     ebpf_close_registry_key(helper_info_key);
     ebpf_close_registry_key(provider_key);
 
     return result;
-}
\ No newline at end of file
+}
+
+// The store snapshot is a single binary value under the store key that holds everything the functions above read
+// from the individual program, section and helper keys. Loading it takes two value reads plus one key query per
+// direct child of the store key, instead of several reads per entry. The snapshot records the store generation it
+// was built from, and readers ignore it as soon as an update to the store has incremented the generation. Writers
+// that bypass the store helper don't increment the generation, so the snapshot also records the number of keys in
+// the top two levels of the store and the latest last write time of the store key's direct children, which changes
+// whenever an entry is added or removed. Writers that bypass the store helper to change the values of an existing
+// entry must increment the generation themselves.
+
+#define EBPF_STORE_SNAPSHOT_MAGIC 0x53535045 // "EPSS"
+#define EBPF_STORE_SNAPSHOT_VERSION 3
+
+typedef struct _ebpf_store_snapshot_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t generation; ///< Store generation the snapshot was built from.
+    uint32_t size;       ///< Size of the snapshot, including this header.
+    uint32_t program_info_count;
+    uint32_t section_info_count;
+    uint32_t global_helper_count;
+    uint32_t key_count;       ///< Number of keys in the top two levels of the store when the snapshot was built.
+    uint64_t last_write_time; ///< Latest last write time of the direct children of the store key.
+} ebpf_store_snapshot_header_t;
+
+/**
+ * @brief Get the number of keys in the top two levels under the store key, and the latest last write time of its
+ * direct children. The store key's own last write time is not included, since the generation and the snapshot are
+ * values of the store key. Only the store key and its direct children are queried, so the cost doesn't grow with the
+ * number of entries in the store.
+ *
+ * @param[in] store_key Store key to query.
+ * @param[out] key_count Number of keys found.
+ * @param[out] last_write_time Latest last write time found, as a FILETIME.
+ *
+ * @retval EBPF_SUCCESS The operation was successful.
+ */
+static ebpf_result_t
+_get_store_key_state(HKEY store_key, _Out_ uint32_t* key_count, _Out_ uint64_t* last_write_time) noexcept
+{
+    ebpf_result_t result = EBPF_SUCCESS;
+    wchar_t subkey_name[256];
+
+    *key_count = 0;
+    *last_write_time = 0;
+
+    for (uint32_t index = 0;; index++) {
+        unsigned long name_length = _countof(subkey_name);
+        unsigned long subkey_count = 0;
+        FILETIME write_time;
+        HKEY subkey = nullptr;
+        int32_t status = RegEnumKeyEx(store_key, index, subkey_name, &name_length, nullptr, nullptr, nullptr, nullptr);
+        if (status == ERROR_NO_MORE_ITEMS) {
+            break;
+        }
+        if (status != ERROR_SUCCESS) {
+            result = win32_error_code_to_ebpf_result(status);
+            break;
+        }
+
+        status = RegOpenKeyEx(store_key, subkey_name, 0, KEY_READ, &subkey);
+        if (status != ERROR_SUCCESS) {
+            result = win32_error_code_to_ebpf_result(status);
+            break;
+        }
+        // Adding or removing an entry updates the last write time of its parent, which is a direct child.
+        status = RegQueryInfoKey(
+            subkey,
+            nullptr,
+            nullptr,
+            nullptr,
+            &subkey_count,
+            nullptr,
+            nullptr,
+            nullptr,
+            nullptr,
+            nullptr,
+            nullptr,
+            &write_time);
+        RegCloseKey(subkey);
+        if (status != ERROR_SUCCESS) {
+            result = win32_error_code_to_ebpf_result(status);
+            break;
+        }
+
+        *key_count += 1 + subkey_count;
+        uint64_t time = ((uint64_t)write_time.dwHighDateTime << 32) | write_time.dwLowDateTime;
+        if (time > *last_write_time) {
+            *last_write_time = time;
+        }
+    }
+
+    return result;
+}
+
+// Followed by the helper name.
+typedef struct _ebpf_store_snapshot_helper
+{
+    uint32_t helper_id;
+    ebpf_return_type_t return_type;
+    ebpf_argument_type_t arguments[5];
+    uint32_t name_length;
+} ebpf_store_snapshot_helper_t;
+
+// Followed by the program type name and helper_count helper records.
+typedef struct _ebpf_store_snapshot_program
+{
+    ebpf_program_type_t program_type;
+    ebpf_context_descriptor_t context_descriptor;
+    uint32_t bpf_prog_type;
+    uint32_t is_privileged;
+    uint32_t name_length;
+    uint32_t helper_count;
+} ebpf_store_snapshot_program_t;
+
+// Followed by the section prefix.
+typedef struct _ebpf_store_snapshot_section
+{
+    ebpf_program_type_t program_type;
+    ebpf_attach_type_t attach_type;
+    uint32_t bpf_prog_type;
+    uint32_t bpf_attach_type;
+    uint32_t prefix_length;
+} ebpf_store_snapshot_section_t;
+
+typedef struct _ebpf_store_snapshot_reader
+{
+    const uint8_t* current;
+    size_t remaining;
+} ebpf_store_snapshot_reader_t;
+
+template <typename T>
+static void
+_snapshot_append(_Inout_ std::vector<uint8_t>& snapshot, _In_ const T& record)
+{
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(&record);
+    snapshot.insert(snapshot.end(), data, data + sizeof(record));
+}
+
+static void
+_snapshot_append_helper(_Inout_ std::vector<uint8_t>& snapshot, _In_ const ebpf_helper_function_prototype_t* helper)
+{
+    ebpf_store_snapshot_helper_t record = {};
+    record.helper_id = helper->helper_id;
+    record.return_type = helper->return_type;
+    memcpy(record.arguments, helper->arguments, sizeof(record.arguments));
+    record.name_length = (uint32_t)strlen(helper->name);
+    _snapshot_append(snapshot, record);
+    snapshot.insert(snapshot.end(), helper->name, helper->name + record.name_length);
+}
+
+static bool
+_snapshot_read(_Inout_ ebpf_store_snapshot_reader_t* reader, _Out_writes_bytes_(length) void* data, size_t length)
+{
+    if (reader->remaining < length) {
+        return false;
+    }
+    memcpy(data, reader->current, length);
+    reader->current += length;
+    reader->remaining -= length;
+    return true;
+}
+
+static ebpf_result_t
+_snapshot_read_string(_Inout_ ebpf_store_snapshot_reader_t* reader, uint32_t length, _Outptr_ char** string)
+{
+    *string = nullptr;
+    if (reader->remaining < length) {
+        return EBPF_INVALID_OBJECT;
+    }
+    char* local_string = (char*)ebpf_allocate((size_t)length + 1);
+    if (local_string == nullptr) {
+        return EBPF_NO_MEMORY;
+    }
+    (void)_snapshot_read(reader, local_string, length);
+    *string = local_string;
+    return EBPF_SUCCESS;
+}
+
+static ebpf_result_t
+_snapshot_read_helper(_Inout_ ebpf_store_snapshot_reader_t* reader, _Out_ ebpf_helper_function_prototype_t* helper)
+{
+    ebpf_store_snapshot_helper_t record;
+    if (!_snapshot_read(reader, &record, sizeof(record))) {
+        return EBPF_INVALID_OBJECT;
+    }
+    helper->helper_id = record.helper_id;
+    helper->return_type = record.return_type;
+    memcpy(helper->arguments, record.arguments, sizeof(helper->arguments));
+    return _snapshot_read_string(reader, record.name_length, (char**)&helper->name);
+}
+
+static ebpf_result_t
+_snapshot_read_program(_Inout_ ebpf_store_snapshot_reader_t* reader, _Outptr_ ebpf_program_info_t** program_info)
+{
+    ebpf_result_t result;
+    ebpf_store_snapshot_program_t record;
+    ebpf_program_info_t* local_program_info = nullptr;
+    ebpf_context_descriptor_t* context_descriptor = nullptr;
+    ebpf_helper_function_prototype_t* helpers = nullptr;
+
+    *program_info = nullptr;
+
+    if (!_snapshot_read(reader, &record, sizeof(record))) {
+        result = EBPF_INVALID_OBJECT;
+        goto Exit;
+    }
+
+    local_program_info = (ebpf_program_info_t*)ebpf_allocate(sizeof(ebpf_program_info_t));
+    if (local_program_info == nullptr) {
+        result = EBPF_NO_MEMORY;
+        goto Exit;
+    }
+
+    result =
+        _snapshot_read_string(reader, record.name_length, (char**)&local_program_info->program_type_descriptor.name);
+    if (result != EBPF_SUCCESS) {
+        goto Exit;
+    }
+
+    context_descriptor = (ebpf_context_descriptor_t*)ebpf_allocate(sizeof(ebpf_context_descriptor_t));
+    if (context_descriptor == nullptr) {
+        result = EBPF_NO_MEMORY;
+        goto Exit;
+    }
+    *context_descriptor = record.context_descriptor;
+    local_program_info->program_type_descriptor.context_descriptor = context_descriptor;
+    local_program_info->program_type_descriptor.program_type = record.program_type;
+    local_program_info->program_type_descriptor.bpf_prog_type = record.bpf_prog_type;
+    local_program_info->program_type_descriptor.is_privileged = !!record.is_privileged;
+
+    if (record.helper_count > 0) {
+        // Each helper takes at least a record, so a larger count can only come from a malformed snapshot.
+        if (record.helper_count > reader->remaining / sizeof(ebpf_store_snapshot_helper_t)) {
+            result = EBPF_INVALID_OBJECT;
+            goto Exit;
+        }
+        helpers = (ebpf_helper_function_prototype_t*)ebpf_allocate(
+            record.helper_count * sizeof(ebpf_helper_function_prototype_t));
+        if (helpers == nullptr) {
+            result = EBPF_NO_MEMORY;
+            goto Exit;
+        }
+        local_program_info->program_type_specific_helper_prototype = helpers;
+        local_program_info->count_of_program_type_specific_helpers = record.helper_count;
+
+        for (uint32_t index = 0; index < record.helper_count; index++) {
+            result = _snapshot_read_helper(reader, &helpers[index]);
+            if (result != EBPF_SUCCESS) {
+                goto Exit;
+            }
+        }
+    }
+
+    *program_info = local_program_info;
+    local_program_info = nullptr;
+
+Exit:
+    ebpf_program_info_free(local_program_info);
+    return result;
+}
+
+static ebpf_result_t
+_snapshot_read_section(_Inout_ ebpf_store_snapshot_reader_t* reader, _Outptr_ ebpf_section_definition_t** section_info)
+{
+    ebpf_result_t result;
+    ebpf_store_snapshot_section_t record;
+    ebpf_section_definition_t* local_section_info = nullptr;
+
+    *section_info = nullptr;
+
+    if (!_snapshot_read(reader, &record, sizeof(record))) {
+        result = EBPF_INVALID_OBJECT;
+        goto Exit;
+    }
+
+    local_section_info = (ebpf_section_definition_t*)ebpf_allocate(sizeof(ebpf_section_definition_t));
+    if (local_section_info == nullptr) {
+        result = EBPF_NO_MEMORY;
+        goto Exit;
+    }
+    local_section_info->program_type = (ebpf_program_type_t*)ebpf_allocate(sizeof(ebpf_program_type_t));
+    local_section_info->attach_type = (ebpf_attach_type_t*)ebpf_allocate(sizeof(ebpf_attach_type_t));
+    if (local_section_info->program_type == nullptr || local_section_info->attach_type == nullptr) {
+        result = EBPF_NO_MEMORY;
+        goto Exit;
+    }
+    *local_section_info->program_type = record.program_type;
+    *local_section_info->attach_type = record.attach_type;
+    local_section_info->bpf_prog_type = (bpf_prog_type_t)record.bpf_prog_type;
+    local_section_info->bpf_attach_type = (bpf_attach_type_t)record.bpf_attach_type;
+
+    result = _snapshot_read_string(reader, record.prefix_length, (char**)&local_section_info->section_prefix);
+    if (result != EBPF_SUCCESS) {
+        goto Exit;
+    }
+
+    *section_info = local_section_info;
+    local_section_info = nullptr;
+
+Exit:
+    if (local_section_info != nullptr) {
+        ebpf_free(local_section_info->program_type);
+        ebpf_free(local_section_info->attach_type);
+        ebpf_free(local_section_info);
+    }
+    return result;
+}
+
+void
+ebpf_store_information_free(_Inout_ ebpf_store_information_t* information)
+{
+    if (information->program_info != nullptr) {
+        for (uint32_t index = 0; index < information->program_info_count; index++) {
+            ebpf_program_info_free(information->program_info[index]);
+        }
+        ebpf_free(information->program_info);
+    }
+    if (information->section_info != nullptr) {
+        for (uint32_t index = 0; index < information->section_info_count; index++) {
+            ebpf_section_definition_t* section_info = information->section_info[index];
+            if (section_info != nullptr) {
+                ebpf_free(section_info->program_type);
+                ebpf_free(section_info->attach_type);
+                ebpf_free((void*)section_info->section_prefix);
+                ebpf_free(section_info);
+            }
+        }
+        ebpf_free(information->section_info);
+    }
+    if (information->global_helper_info != nullptr) {
+        for (uint32_t index = 0; index < information->global_helper_info_count; index++) {
+            ebpf_free((void*)information->global_helper_info[index].name);
+        }
+        ebpf_free(information->global_helper_info);
+    }
+    memset(information, 0, sizeof(*information));
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_store_load_snapshot(_Out_ ebpf_store_information_t* information)
+{
+    ebpf_result_t result = EBPF_SUCCESS;
+    ebpf_store_key_t store_key = nullptr;
+    uint32_t generation;
+    unsigned long type;
+    unsigned long snapshot_size = 0;
+    std::vector<uint8_t> snapshot;
+    ebpf_store_snapshot_header_t header;
+    ebpf_store_snapshot_reader_t reader;
+    uint32_t key_count = 0;
+    uint64_t last_write_time = 0;
+
+    memset(information, 0, sizeof(*information));
+
+    result = _open_ebpf_store_key(&store_key);
+    if (result != EBPF_SUCCESS) {
+        result = EBPF_OBJECT_NOT_FOUND;
+        goto Exit;
+    }
+
+    if (ebpf_read_registry_value_dword(store_key, EBPF_STORE_GENERATION, &generation) != EBPF_SUCCESS) {
+        generation = 0;
+    }
+
+    try {
+        // Query the size of the snapshot, then read it.
+        if (RegQueryValueEx(store_key, EBPF_STORE_SNAPSHOT, nullptr, &type, nullptr, &snapshot_size) !=
+                ERROR_SUCCESS ||
+            type != REG_BINARY || snapshot_size < sizeof(header)) {
+            result = EBPF_OBJECT_NOT_FOUND;
+            goto Exit;
+        }
+        snapshot.resize(snapshot_size);
+        if (RegQueryValueEx(store_key, EBPF_STORE_SNAPSHOT, nullptr, &type, snapshot.data(), &snapshot_size) !=
+                ERROR_SUCCESS ||
+            snapshot_size != snapshot.size()) {
+            result = EBPF_OBJECT_NOT_FOUND;
+            goto Exit;
+        }
+    } catch (const std::bad_alloc&) {
+        result = EBPF_NO_MEMORY;
+        goto Exit;
+    }
+
+    reader.current = snapshot.data();
+    reader.remaining = snapshot.size();
+    (void)_snapshot_read(&reader, &header, sizeof(header));
+    if (header.magic != EBPF_STORE_SNAPSHOT_MAGIC || header.version != EBPF_STORE_SNAPSHOT_VERSION ||
+        header.size != snapshot.size()) {
+        result = EBPF_INVALID_OBJECT;
+        goto Exit;
+    }
+    if (header.generation != generation) {
+        // The store has been updated since the snapshot was taken.
+        result = EBPF_OBJECT_NOT_FOUND;
+        goto Exit;
+    }
+    result = _get_store_key_state(store_key, &key_count, &last_write_time);
+    if (result != EBPF_SUCCESS) {
+        goto Exit;
+    }
+    if (header.key_count != key_count || header.last_write_time != last_write_time) {
+        // The store has been updated without incrementing the generation.
+        result = EBPF_OBJECT_NOT_FOUND;
+        goto Exit;
+    }
+
+    if (header.global_helper_count > 0) {
+        information->global_helper_info = (ebpf_helper_function_prototype_t*)ebpf_allocate(
+            (size_t)header.global_helper_count * sizeof(ebpf_helper_function_prototype_t));
+        if (information->global_helper_info == nullptr) {
+            result = EBPF_NO_MEMORY;
+            goto Exit;
+        }
+        information->global_helper_info_count = header.global_helper_count;
+        for (uint32_t index = 0; index < header.global_helper_count; index++) {
+            result = _snapshot_read_helper(&reader, &information->global_helper_info[index]);
+            if (result != EBPF_SUCCESS) {
+                goto Exit;
+            }
+        }
+    }
+
+    if (header.program_info_count > 0) {
+        information->program_info =
+            (ebpf_program_info_t**)ebpf_allocate((size_t)header.program_info_count * sizeof(ebpf_program_info_t*));
+        if (information->program_info == nullptr) {
+            result = EBPF_NO_MEMORY;
+            goto Exit;
+        }
+        information->program_info_count = header.program_info_count;
+        for (uint32_t index = 0; index < header.program_info_count; index++) {
+            result = _snapshot_read_program(&reader, &information->program_info[index]);
+            if (result != EBPF_SUCCESS) {
+                goto Exit;
+            }
+        }
+    }
+
+    if (header.section_info_count > 0) {
+        information->section_info = (ebpf_section_definition_t**)ebpf_allocate(
+            (size_t)header.section_info_count * sizeof(ebpf_section_definition_t*));
+        if (information->section_info == nullptr) {
+            result = EBPF_NO_MEMORY;
+            goto Exit;
+        }
+        information->section_info_count = header.section_info_count;
+        for (uint32_t index = 0; index < header.section_info_count; index++) {
+            result = _snapshot_read_section(&reader, &information->section_info[index]);
+            if (result != EBPF_SUCCESS) {
+                goto Exit;
+            }
+        }
+    }
+
+    if (reader.remaining != 0) {
+        result = EBPF_INVALID_OBJECT;
+    }
+
+Exit:
+    if (result != EBPF_SUCCESS) {
+        ebpf_store_information_free(information);
+    }
+    if (store_key) {
+        ebpf_close_registry_key(store_key);
+    }
+    return result;
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_store_update_snapshot()
+{
+    ebpf_result_t result;
+    ebpf_store_key_t provider_key = nullptr;
+    uint32_t generation;
+    ebpf_store_information_t information = {};
+    std::vector<uint8_t> snapshot;
+    ebpf_store_snapshot_header_t header = {};
+    uint32_t key_count = 0;
+    uint64_t last_write_time = 0;
+
+    result = ebpf_open_registry_key(ebpf_store_root_key, EBPF_STORE_REGISTRY_PATH, REG_CREATE_FLAGS, &provider_key);
+    if (result != EBPF_SUCCESS) {
+        goto Exit;
+    }
+
+    // Read the generation and the state of the keys before the contents, so that an update made while the snapshot
+    // is being built leaves it stale rather than silently missing from it.
+    if (ebpf_read_registry_value_dword(provider_key, EBPF_STORE_GENERATION, &generation) != EBPF_SUCCESS) {
+        generation = 0;
+    }
+    result = _get_store_key_state(provider_key, &key_count, &last_write_time);
+    if (result != EBPF_SUCCESS) {
+        goto Exit;
+    }
+
+    result = ebpf_store_load_global_helper_information(
+        &information.global_helper_info, &information.global_helper_info_count);
+    if (result != EBPF_SUCCESS) {
+        goto Exit;
+    }
+    result = ebpf_store_load_program_information(&information.program_info, &information.program_info_count);
+    if (result != EBPF_SUCCESS) {
+        goto Exit;
+    }
+    result = ebpf_store_load_section_information(&information.section_info, &information.section_info_count);
+    if (result != EBPF_SUCCESS) {
+        goto Exit;
+    }
+
+    try {
+        header.magic = EBPF_STORE_SNAPSHOT_MAGIC;
+        header.version = EBPF_STORE_SNAPSHOT_VERSION;
+        header.generation = generation;
+        header.key_count = key_count;
+        header.last_write_time = last_write_time;
+        header.program_info_count = information.program_info_count;
+        header.section_info_count = information.section_info_count;
+        header.global_helper_count = information.global_helper_info_count;
+        _snapshot_append(snapshot, header);
+
+        for (uint32_t index = 0; index < information.global_helper_info_count; index++) {
+            _snapshot_append_helper(snapshot, &information.global_helper_info[index]);
+        }
+
+        for (uint32_t index = 0; index < information.program_info_count; index++) {
+            const ebpf_program_info_t* program_info = information.program_info[index];
+            const ebpf_program_type_descriptor_t* descriptor = &program_info->program_type_descriptor;
+            ebpf_store_snapshot_program_t record = {};
+            record.program_type = descriptor->program_type;
+            record.context_descriptor = *descriptor->context_descriptor;
+            record.bpf_prog_type = descriptor->bpf_prog_type;
+            record.is_privileged = descriptor->is_privileged;
+            record.name_length = (uint32_t)strlen(descriptor->name);
+            record.helper_count = program_info->count_of_program_type_specific_helpers;
+            _snapshot_append(snapshot, record);
+            snapshot.insert(snapshot.end(), descriptor->name, descriptor->name + record.name_length);
+            for (uint32_t helper_index = 0; helper_index < record.helper_count; helper_index++) {
+                _snapshot_append_helper(snapshot, &program_info->program_type_specific_helper_prototype[helper_index]);
+            }
+        }
+
+        for (uint32_t index = 0; index < information.section_info_count; index++) {
+            const ebpf_section_definition_t* section_info = information.section_info[index];
+            ebpf_store_snapshot_section_t record = {};
+            record.program_type = *section_info->program_type;
+            record.attach_type = *section_info->attach_type;
+            record.bpf_prog_type = section_info->bpf_prog_type;
+            record.bpf_attach_type = section_info->bpf_attach_type;
+            record.prefix_length = (uint32_t)strlen(section_info->section_prefix);
+            _snapshot_append(snapshot, record);
+            snapshot.insert(
+                snapshot.end(), section_info->section_prefix, section_info->section_prefix + record.prefix_length);
+        }
+    } catch (const std::bad_alloc&) {
+        result = EBPF_NO_MEMORY;
+        goto Exit;
+    }
+
+    // Patch in the final size.
+    header.size = (uint32_t)snapshot.size();
+    memcpy(snapshot.data(), &header, sizeof(header));
+
+    result = ebpf_write_registry_value_binary(provider_key, EBPF_STORE_SNAPSHOT, snapshot.data(), snapshot.size());
+
+Exit:
+    ebpf_store_information_free(&information);
+    if (provider_key) {
+        ebpf_close_registry_key(provider_key);
+    }
+    return result;
+}
@@ -20,6 +20,50 @@ ebpf_store_load_global_helper_information(
     _Outptr_result_buffer_maybenull_(*global_helper_info_count) ebpf_helper_function_prototype_t** global_helper_info,
     _Out_ uint32_t* global_helper_info_count);
 
+/**
+ * @brief Program, section and global helper information read from the eBPF store.
+ */
+typedef struct _ebpf_store_information
+{
+    _Field_size_(program_info_count) ebpf_program_info_t** program_info;
+    uint32_t program_info_count;
+    _Field_size_(section_info_count) ebpf_section_definition_t** section_info;
+    uint32_t section_info_count;
+    _Field_size_(global_helper_info_count) ebpf_helper_function_prototype_t* global_helper_info;
+    uint32_t global_helper_info_count;
+} ebpf_store_information_t;
+
+/**
+ * @brief Load all the information in the eBPF store from the store snapshot.
+ *
+ * @param[out] information Information read from the snapshot. Must be freed by the caller using
+ *  ebpf_store_information_free().
+ *
+ * @retval EBPF_SUCCESS The operation was successful.
+ * @retval EBPF_OBJECT_NOT_FOUND There is no snapshot, or the store has been updated since the snapshot was taken.
+ * @retval EBPF_INVALID_OBJECT The snapshot is malformed.
+ * @retval EBPF_NO_MEMORY Unable to allocate resources for the information.
+ */
+_Must_inspect_result_ ebpf_result_t
+ebpf_store_load_snapshot(_Out_ ebpf_store_information_t* information);
+
+/**
+ * @brief Rebuild the store snapshot from the current contents of the eBPF store.
+ *
+ * @returns Status of the operation.
+ */
+_Must_inspect_result_ ebpf_result_t
+ebpf_store_update_snapshot();
+
+/**
+ * @brief Free the arrays and any remaining entries in an ebpf_store_information_t. Entries that the caller has taken
+ *  ownership of must be set to nullptr first.
+ *
+ * @param[in, out] information Information to free.
+ */
+void
+ebpf_store_information_free(_Inout_ ebpf_store_information_t* information);
+
 _Must_inspect_result_ ebpf_result_t
 ebpf_store_clear(_In_ const ebpf_store_key_t root_key_path);
 
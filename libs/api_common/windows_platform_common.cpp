@@ -114,6 +114,16 @@ static std::map<ebpf_program_type_t, ebpf_program_descriptor_ptr_t, guid_compare
 static std::vector<ebpf_section_info_ptr_t> _windows_section_definitions;
 static std::map<ebpf_program_type_t, ebpf_program_info_ptr_t, guid_compare> _windows_program_information;
 
+// Prefix trie over the section prefixes in _windows_section_definitions, built when they are loaded. A section name
+// is resolved by walking it one character at a time and keeping the deepest node that ends a prefix, which gives
+// the longest matching prefix without comparing against every definition.
+typedef struct _section_prefix_trie_node
+{
+    std::map<char, std::unique_ptr<_section_prefix_trie_node>> children;
+    const ebpf_section_definition_t* definition = nullptr;
+} section_prefix_trie_node_t;
+static section_prefix_trie_node_t _windows_section_prefix_trie;
+
 static void
 _load_ebpf_provider_data();
 
@@ -256,27 +266,51 @@ get_program_type_windows(const GUID& program_type)
     throw std::runtime_error(std::string("ProgramType not found for GUID ") + guid_string);
 }
 
-static const ebpf_section_definition_t*
-_get_section_definition(const std::string& section)
+static void
+_clear_section_prefix_trie()
 {
-    int32_t match_index = -1;
-    size_t match_length = 0;
-    for (size_t index = 0; index < _windows_section_definitions.size(); index++) {
-        std::string section_prefix(_windows_section_definitions[index].get()->section_prefix);
-        if (section.find(section_prefix) == 0) {
-            size_t prefix_length = strlen(_windows_section_definitions[index].get()->section_prefix);
-            if (match_length < prefix_length) {
-                match_index = int32_t(index);
-                match_length = prefix_length;
+    _windows_section_prefix_trie.children.clear();
+    _windows_section_prefix_trie.definition = nullptr;
+}
+
+static void
+_build_section_prefix_trie()
+{
+    _clear_section_prefix_trie();
+    for (const auto& definition : _windows_section_definitions) {
+        section_prefix_trie_node_t* node = &_windows_section_prefix_trie;
+        for (const char* current = definition->section_prefix; *current != '\0'; current++) {
+            auto& child = node->children[*current];
+            if (!child) {
+                child = std::make_unique<section_prefix_trie_node_t>();
             }
+            node = child.get();
+        }
+
+        // An empty prefix matches nothing, and if two definitions have the same prefix the first one wins.
+        if (node != &_windows_section_prefix_trie && node->definition == nullptr) {
+            node->definition = definition.get();
         }
     }
+}
 
-    if (match_index >= 0) {
-        return _windows_section_definitions[match_index].get();
+static const ebpf_section_definition_t*
+_get_section_definition(const std::string& section)
+{
+    const ebpf_section_definition_t* match = nullptr;
+    const section_prefix_trie_node_t* node = &_windows_section_prefix_trie;
+    for (char character : section) {
+        auto it = node->children.find(character);
+        if (it == node->children.end()) {
+            break;
+        }
+        node = it->second.get();
+        if (node->definition != nullptr) {
+            match = node->definition;
+        }
     }
 
-    return nullptr;
+    return match;
 }
 
 _Ret_maybenull_ const ebpf_program_type_t*
@@ -437,6 +471,13 @@ static const EbpfMapType windows_map_types[] = {
     {BPF_MAP_TYPE(PERCPU_ARRAY), true},
     {BPF_MAP_TYPE(HASH_OF_MAPS), false, EbpfMapValueType::MAP},
     {BPF_MAP_TYPE(ARRAY_OF_MAPS), true, EbpfMapValueType::MAP},
+    {BPF_MAP_TYPE(LRU_HASH)},
+    {BPF_MAP_TYPE(LPM_TRIE)},
+    {BPF_MAP_TYPE(QUEUE)},
+    {BPF_MAP_TYPE(LRU_PERCPU_HASH)},
+    {BPF_MAP_TYPE(STACK)},
+    {BPF_MAP_TYPE(RINGBUF)},
+    {BPF_MAP_TYPE(BLOOM_FILTER)},
 };
 
 EbpfMapType
@@ -572,67 +613,31 @@ Exit:
     return result;
 }
 
-static void
-_helper_info_free(_Frees_ptr_opt_ ebpf_helper_function_prototype_t* helper_info, uint32_t helper_info_count)
-{
-    if (!helper_info) {
-        return;
-    }
-
-#pragma warning(push)
-#pragma warning(disable : 6001) // Using uninitialized memory '*helper_info.name'
-    for (uint32_t index = 0; index < helper_info_count; index++) {
-        ebpf_free((void*)helper_info[index].name);
-    }
-#pragma warning(pop)
-
-    ebpf_free(helper_info);
-}
-
 static ebpf_result_t
-_load_all_global_helper_information()
+_load_all_global_helper_information(_In_ const ebpf_store_information_t* information)
 {
-    ebpf_result_t result = EBPF_SUCCESS;
-    ebpf_helper_function_prototype_t* helper_info = nullptr;
-    uint32_t helper_info_count = 0;
-
-    result = ebpf_store_load_global_helper_information(&helper_info, &helper_info_count);
-    if (result != EBPF_SUCCESS) {
-        goto Exit;
-    }
-
-    if (!helper_info) {
-        goto Exit;
+    if (!information->global_helper_info) {
         // No global helper functions found.
+        return EBPF_SUCCESS;
     }
 
-    result = _update_global_helpers_for_program_information(helper_info, helper_info_count);
-
-Exit:
-    _helper_info_free(helper_info, helper_info_count);
-    return result;
+    return _update_global_helpers_for_program_information(
+        information->global_helper_info, information->global_helper_info_count);
 }
 
 static ebpf_result_t
-_load_all_section_data_information()
+_load_all_section_data_information(_Inout_ ebpf_store_information_t* information)
 {
     ebpf_result_t result = EBPF_SUCCESS;
-    ebpf_section_definition_t** section_info = nullptr;
-    uint32_t section_info_count = 0;
 
-    result = ebpf_store_load_section_information(&section_info, &section_info_count);
-    if (result != EBPF_SUCCESS) {
-        goto Exit;
-    }
-
-    if (section_info_count == 0 || section_info == nullptr) {
-        goto Exit;
+    if (information->section_info_count == 0 || information->section_info == nullptr) {
+        return result;
     }
 
     try {
-        for (uint32_t index = 0; index < section_info_count; index++) {
-            ebpf_section_definition_t* info = section_info[index];
-            section_info[index] = nullptr;
+        for (uint32_t index = 0; index < information->section_info_count; index++) {
+            ebpf_section_definition_t* info = information->section_info[index];
+            information->section_info[index] = nullptr;
             _windows_section_definitions.emplace_back(ebpf_section_info_ptr_t(info));
         }
     } catch (const std::bad_alloc&) {
@@ -641,41 +646,26 @@ _load_all_section_data_information()
         result = EBPF_FAILED;
     }
 
-Exit:
     if (result != EBPF_SUCCESS) {
         _windows_section_definitions.clear();
     }
-    if (section_info) {
-        for (uint32_t index = 0; index < section_info_count; index++) {
-            _ebpf_section_info_free(section_info[index]);
-            section_info[index] = nullptr;
-        }
-        ebpf_free(section_info);
-    }
     return result;
 }
 
 static ebpf_result_t
-_load_all_program_data_information()
+_load_all_program_data_information(_Inout_ ebpf_store_information_t* information)
 {
-    ebpf_result_t result;
-    ebpf_program_info_t** program_info = nullptr;
-    uint32_t program_info_count = 0;
-
-    result = ebpf_store_load_program_information(&program_info, &program_info_count);
-    if (result != EBPF_SUCCESS) {
-        goto Exit;
-    }
+    ebpf_result_t result = EBPF_SUCCESS;
 
-    if (program_info_count == 0 || program_info == nullptr) {
+    if (information->program_info_count == 0 || information->program_info == nullptr) {
         // No entries found in the store.
-        goto Exit;
+        return result;
     }
 
     try {
-        for (uint32_t index = 0; index < program_info_count; index++) {
-            ebpf_program_info_t* info = program_info[index];
-            program_info[index] = nullptr;
+        for (uint32_t index = 0; index < information->program_info_count; index++) {
+            ebpf_program_info_t* info = information->program_info[index];
+            information->program_info[index] = nullptr;
             ebpf_program_type_t program_type = info->program_type_descriptor.program_type;
             _windows_program_information[program_type] = ebpf_program_info_ptr_t(info);
 
@@ -697,12 +687,37 @@ Exit:
         _windows_program_information.clear();
         _windows_program_types.clear();
     }
-    if (program_info) {
-        for (uint32_t index = 0; index < program_info_count; index++) {
-            ebpf_program_info_free(program_info[index]);
-            program_info[index] = nullptr;
-        }
-        ebpf_free(program_info);
+    return result;
+}
+
+/**
+ * @brief Read all the information in the eBPF store, from the store snapshot if there is a current one, else from
+ * the individual registry keys.
+ */
+static ebpf_result_t
+_load_store_information(_Out_ ebpf_store_information_t* information)
+{
+    ebpf_result_t result = ebpf_store_load_snapshot(information);
+    if (result == EBPF_SUCCESS) {
+        return result;
+    }
+
+    result = ebpf_store_load_program_information(&information->program_info, &information->program_info_count);
+    if (result != EBPF_SUCCESS) {
+        goto Exit;
+    }
+
+    result = ebpf_store_load_section_information(&information->section_info, &information->section_info_count);
+    if (result != EBPF_SUCCESS) {
+        goto Exit;
+    }
+
+    result = ebpf_store_load_global_helper_information(
+        &information->global_helper_info, &information->global_helper_info_count);
+
+Exit:
+    if (result != EBPF_SUCCESS) {
+        ebpf_store_information_free(information);
     }
     return result;
 }
@@ -717,22 +732,27 @@ _load_ebpf_provider_data()
 {
     try {
         std::call_once(*_windows_program_information_init_flag, [] {
-            ebpf_result_t result = _load_all_program_data_information();
+            ebpf_store_information_t information;
+            ebpf_result_t result = _load_store_information(&information);
             if (result != EBPF_SUCCESS) {
-                throw std::runtime_error("Failed to load program information from eBPF store.");
+                throw std::runtime_error("Failed to read eBPF store.");
             }
 
-            result = _load_all_section_data_information();
-            if (result != EBPF_SUCCESS) {
-                throw std::runtime_error("Failed to load section information from eBPF store.");
+            result = _load_all_program_data_information(&information);
+            if (result == EBPF_SUCCESS) {
+                result = _load_all_section_data_information(&information);
+                if (result == EBPF_SUCCESS) {
+                    _build_section_prefix_trie();
+                    result = _load_all_global_helper_information(&information);
+                }
             }
-
-            result = _load_all_global_helper_information();
+            ebpf_store_information_free(&information);
             if (result != EBPF_SUCCESS) {
-                throw std::runtime_error("Failed to load global helper information from eBPF store.");
+                throw std::runtime_error("Failed to load provider information from eBPF store.");
             }
         });
     } catch (...) {
+        _clear_section_prefix_trie();
         _windows_program_types.clear();
         _windows_section_definitions.clear();
         _windows_program_information.clear();
@@ -742,6 +762,7 @@ _load_ebpf_provider_data()
 void
 clear_ebpf_provider_data()
 {
+    _clear_section_prefix_trie();
     _windows_program_types.clear();
     _windows_section_definitions.clear();
     _windows_program_information.clear();
@@ -65,7 +65,7 @@ handle_ebpf_show_maps(
                 info.name);
         }
 
-        Platform::_close(map_fd);
+        (void)ebpf_close_fd(map_fd);
     }
     return NO_ERROR;
 }
@@ -19,6 +19,7 @@
 #include "ebpf_tracelog.h"
 
 #include <errno.h>
+#include <intrin.h>
 
 const NPI_MODULEID ebpf_general_helper_function_module_id = {
     sizeof(ebpf_general_helper_function_module_id),
@@ -51,6 +52,8 @@ static uint64_t
 _ebpf_core_get_time_since_boot_ns();
 static uint64_t
 _ebpf_core_get_time_ns();
+static void
+_ebpf_core_printk_free_formats();
 static long
 _ebpf_core_trace_printk2(_In_reads_(fmt_size) const char* fmt, size_t fmt_size);
 static long
@@ -68,7 +71,7 @@ _ebpf_core_map_push_elem(_Inout_ ebpf_map_t* map, _In_ const uint8_t* value, uin
 static uint64_t
 _ebpf_core_map_pop_elem(_Inout_ ebpf_map_t* map, _Out_ uint8_t* value);
 static uint64_t
-_ebpf_core_map_peek_elem(_Inout_ ebpf_map_t* map, _Out_ uint8_t* value);
+_ebpf_core_map_peek_elem(_Inout_ ebpf_map_t* map, _Inout_ uint8_t* value);
 static uint64_t
 _ebpf_core_get_pid_tgid();
 static uint64_t
@@ -204,6 +207,8 @@ ebpf_core_initiate()
     ebpf_result_t return_value;
     NTSTATUS status;
 
+    ebpf_lock_create(&_ebpf_core_printk_format_lock);
+
     return_value = ebpf_platform_initiate();
     if (return_value != EBPF_SUCCESS) {
         goto Done;
@@ -312,11 +317,16 @@ ebpf_core_terminate()
     // cleanup work items have been executed by this time.
     ebpf_native_terminate();
 
+    // No programs are left that can call bpf_printk.
+    _ebpf_core_printk_free_formats();
+
     ebpf_trace_terminate();
 
     ebpf_random_terminate();
 
     ebpf_platform_terminate();
+
+    ebpf_lock_destroy(&_ebpf_core_printk_format_lock);
 }
 
 _Must_inspect_result_ ebpf_result_t
@@ -688,6 +698,21 @@ Done:
     EBPF_RETURN_RESULT(result);
 }
 
+static ebpf_result_t
+_ebpf_core_protocol_load_native_module_instance(
+    _In_ const ebpf_operation_load_native_module_instance_request_t* request,
+    _Out_ ebpf_operation_load_native_module_instance_reply_t* reply)
+{
+    EBPF_LOG_ENTRY();
+    ebpf_result_t result = ebpf_native_load_instance(
+        &request->module_id,
+        &request->instance_id,
+        &reply->native_module_handle,
+        &reply->count_of_maps,
+        &reply->count_of_programs);
+    EBPF_RETURN_RESULT(result);
+}
+
 static ebpf_result_t
 _ebpf_core_protocol_load_native_programs(
     _In_ const ebpf_operation_load_native_programs_request_t* request,
@@ -911,12 +936,15 @@ _ebpf_core_protocol_map_update_element_batch(
             request->option,
             0);
         if (retval != EBPF_SUCCESS) {
-            goto Done;
+            break;
         }
     }
 
+    // Elements before a failed update stay updated, so report how many were processed along with the failure.
     reply->header.length = (uint16_t)sizeof(ebpf_operation_map_update_element_batch_reply_t);
     reply->count_of_elements_processed = (uint32_t)output_count;
+    reply->result = retval;
+    retval = EBPF_SUCCESS;
 
 Done:
     EBPF_OBJECT_RELEASE_REFERENCE((ebpf_core_object_t*)map);
@@ -1782,7 +1810,7 @@ _ebpf_core_protocol_get_pinned_map_info(
 {
     EBPF_LOG_ENTRY();
     ebpf_result_t result = EBPF_SUCCESS;
-    uint16_t entry_count = 0;
+    uint32_t entry_count = 0;
     ebpf_pinning_entry_t* pinning_entries = NULL;
     ebpf_map_info_internal_t* map_info = NULL;
 
@@ -1790,7 +1818,7 @@ _ebpf_core_protocol_get_pinned_map_info(
 
     // Enumerate all the pinning entries for map objects.
     result = ebpf_pinning_table_enumerate_entries(
-        _ebpf_core_map_pinning_table, EBPF_OBJECT_MAP, &entry_count, &pinning_entries);
+        _ebpf_core_map_pinning_table, EBPF_OBJECT_MAP, NULL, &entry_count, &pinning_entries);
     if (result != EBPF_SUCCESS) {
         goto Exit;
     }
@@ -1800,8 +1828,15 @@ _ebpf_core_protocol_get_pinned_map_info(
         goto Exit;
     }
 
+    // The reply carries a 16-bit map count, and could not hold the serialized info for more maps than that anyway.
+    if (entry_count > UINT16_MAX) {
+        result = EBPF_INSUFFICIENT_BUFFER;
+        goto Exit;
+    }
+
     // Convert pinning entries to map_info_t array.
-    result = _ebpf_core_protocol_convert_pinning_entries_to_map_info_array(entry_count, pinning_entries, &map_info);
+    result = _ebpf_core_protocol_convert_pinning_entries_to_map_info_array(
+        (uint16_t)entry_count, pinning_entries, &map_info);
     if (result != EBPF_SUCCESS) {
         goto Exit;
     }
@@ -1810,7 +1845,7 @@ _ebpf_core_protocol_get_pinned_map_info(
 
     // Serialize map info array onto reply structure.
     _Analysis_assume_(map_info != NULL);
-    result = _ebpf_core_protocol_serialize_map_info_reply(entry_count, map_info, reply_length, reply);
+    result = _ebpf_core_protocol_serialize_map_info_reply((uint16_t)entry_count, map_info, reply_length, reply);
 
 Exit:
 
@@ -1927,8 +1962,8 @@ _ebpf_core_protocol_get_next_pinned_program_path(
     next_path.length = reply_length - EBPF_OFFSET_OF(ebpf_operation_get_next_pinned_program_path_reply_t, next_path);
     next_path.value = (uint8_t*)reply->next_path;
 
-    result =
-        ebpf_pinning_table_get_next_path(_ebpf_core_map_pinning_table, EBPF_OBJECT_PROGRAM, &start_path, &next_path);
+    result = ebpf_pinning_table_get_next_path(
+        _ebpf_core_map_pinning_table, EBPF_OBJECT_PROGRAM, NULL, &start_path, &next_path);
 
     if (result == EBPF_SUCCESS) {
         reply->header.length =
@@ -1937,6 +1972,45 @@ _ebpf_core_protocol_get_next_pinned_program_path(
     EBPF_RETURN_RESULT(result);
 }
 
+static ebpf_result_t
+_ebpf_core_protocol_get_next_pinned_path(
+    _In_ const ebpf_operation_get_next_pinned_path_request_t* request,
+    _Out_ ebpf_operation_get_next_pinned_path_reply_t* reply,
+    uint16_t reply_length)
+{
+    EBPF_LOG_ENTRY();
+    cxplat_utf8_string_t prefix;
+    cxplat_utf8_string_t start_path;
+    cxplat_utf8_string_t next_path;
+
+    size_t data_length;
+    ebpf_result_t result = ebpf_safe_size_t_subtract(
+        request->header.length, EBPF_OFFSET_OF(ebpf_operation_get_next_pinned_path_request_t, data), &data_length);
+    if (result != EBPF_SUCCESS) {
+        EBPF_RETURN_RESULT(result);
+    }
+    if (request->prefix_length > data_length) {
+        EBPF_RETURN_RESULT(EBPF_INVALID_ARGUMENT);
+    }
+
+    // The request data holds the prefix followed by the start path.
+    prefix.length = request->prefix_length;
+    prefix.value = (uint8_t*)request->data;
+    start_path.length = data_length - request->prefix_length;
+    start_path.value = (uint8_t*)request->data + request->prefix_length;
+    next_path.length = reply_length - EBPF_OFFSET_OF(ebpf_operation_get_next_pinned_path_reply_t, next_path);
+    next_path.value = (uint8_t*)reply->next_path;
+
+    result = ebpf_pinning_table_get_next_path(
+        _ebpf_core_map_pinning_table, EBPF_OBJECT_UNKNOWN, &prefix, &start_path, &next_path);
+
+    if (result == EBPF_SUCCESS) {
+        reply->header.length =
+            (uint16_t)next_path.length + EBPF_OFFSET_OF(ebpf_operation_get_next_pinned_path_reply_t, next_path);
+    }
+    EBPF_RETURN_RESULT(result);
+}
+
 static ebpf_result_t
 _ebpf_core_protocol_bind_map(_In_ const ebpf_operation_bind_map_request_t* request)
 {
@@ -2077,40 +2151,25 @@ Exit:
 static void*
 _ebpf_core_map_find_element(ebpf_map_t* map, const uint8_t* key)
 {
-    ebpf_result_t retval;
-    uint8_t* value;
-    retval = ebpf_map_find_entry(map, 0, key, sizeof(&value), (uint8_t*)&value, EBPF_MAP_FLAG_HELPER);
-    if (retval != EBPF_SUCCESS) {
-        return NULL;
-    } else {
-        return value;
-    }
+    return ebpf_map_helper_find_entry(map, key, false);
 }
 
 static int64_t
 _ebpf_core_map_update_element(ebpf_map_t* map, const uint8_t* key, const uint8_t* value, uint64_t flags)
 {
-    return -ebpf_map_update_entry(map, 0, key, 0, value, flags, EBPF_MAP_FLAG_HELPER);
+    return -ebpf_map_helper_update_entry(map, key, value, flags);
 }
 
 static int64_t
 _ebpf_core_map_delete_element(ebpf_map_t* map, const uint8_t* key)
 {
-    return -ebpf_map_delete_entry(map, 0, key, EBPF_MAP_FLAG_HELPER);
+    return -ebpf_map_helper_delete_entry(map, key);
 }
 
 static void*
 _ebpf_core_map_find_and_delete_element(_Inout_ ebpf_map_t* map, _In_ const uint8_t* key)
 {
-    ebpf_result_t retval;
-    uint8_t* value;
-    retval = ebpf_map_find_entry(
-        map, 0, key, sizeof(&value), (uint8_t*)&value, EBPF_MAP_FLAG_HELPER | EPBF_MAP_FIND_FLAG_DELETE);
-    if (retval != EBPF_SUCCESS) {
-        return NULL;
-    } else {
-        return value;
-    }
+    return ebpf_map_helper_find_entry(map, key, true);
 }
 
 static int64_t
@@ -2191,40 +2250,55 @@ _ebpf_core_is_current_admin(_In_ const void* ctx)
 // Only integers are currently supported.
 #define PRINTK_SPECIFIER_CHARS "diux"
 
-static long
-_ebpf_core_trace_printk(_In_reads_(fmt_size) const char* fmt, size_t fmt_size, int arg_count, ...)
-{
-    if (fmt_size > MAX_PRINTK_STRING_SIZE - 1) {
-        // Disallow large fmt_size values.
-        return -1;
-    }
+// Number of distinct format strings that are validated once and remembered. Must be a power of 2.
+#define PRINTK_FORMAT_TABLE_SIZE 1024
 
-    // Make a copy of the original format string.
-    char* output = (char*)ebpf_allocate_with_tag(fmt_size + 1, EBPF_POOL_TAG_CORE);
-    if (output == NULL) {
-        return -1;
-    }
-    memcpy(output, fmt, fmt_size);
+/**
+ * @brief A bpf_printk format string that has been validated and assigned an ID.
+ * Entries are immutable once published in the format table, except for logged_generation,
+ * and next_released once they have been removed from the table.
+ */
+typedef struct _ebpf_core_printk_format
+{
+    uint64_t hash;                       ///< Hash of the format string as passed by the program.
+    uint32_t id;                         ///< ID used to refer to the format in binary printk events.
+    uint32_t size;                       ///< Size of the format string as passed by the program.
+    int specifier_count;                 ///< Number of conversion specifiers, or -1 if the format is not valid.
+    volatile uint32_t logged_generation; ///< Trace enable generation the format was last logged in, or 0 if never.
+    bool cached;                         ///< Set if the entry is in the format table.
+    void* next_released;                 ///< Next entry removed from the table by the same release.
+    char* format;                        ///< Null-terminated format string with any trailing newline removed.
+    _Field_size_(size) char raw[];       ///< Format string as passed by the program.
+} ebpf_core_printk_format_t;
+
+static ebpf_core_printk_format_t* volatile _ebpf_core_printk_formats[PRINTK_FORMAT_TABLE_SIZE];
+static ebpf_lock_t _ebpf_core_printk_format_lock;
+static volatile long _ebpf_core_printk_next_format_id = 0;
 
-    // Make sure the output is null-terminated, and
-    // remove the newline if present.
-    // A well-formed input should be null terminated,
-    // so look at the next-to-last byte.
-    char* end = output + fmt_size - 2;
-    if (*end != '\n') {
-        end++;
+static uint64_t
+_ebpf_core_printk_format_hash(_In_reads_(fmt_size) const char* fmt, size_t fmt_size)
+{
+    // FNV-1a.
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < fmt_size; i++) {
+        hash ^= (uint8_t)fmt[i];
+        hash *= 0x100000001b3ull;
     }
-    *end = '\0';
+    return hash;
+}
 
-    /* Validate format string.
-     * The conversion specifiers are limited to:
-     * %d, %i, %u, %x, %ld, %li, %lu, %lx, %lld, %lli, %llu, %llx.
-     * No modifier (size of field, padding with zeroes, etc.) is available.
-     */
-    long bytes_written = -1;
+/* Validate format string.
+ * The conversion specifiers are limited to:
+ * %d, %i, %u, %x, %ld, %li, %lu, %lx, %lld, %lli, %llu, %llx.
+ * No modifier (size of field, padding with zeroes, etc.) is available.
+ * Returns the number of specifiers, or -1 if the format string is not valid.
+ */
+static int
+_ebpf_core_printk_count_specifiers(_In_z_ const char* format)
+{
     const char* p;
     int specifier_count = 0;
-    for (p = output; *p; p++) {
+    for (p = format; *p; p++) {
         if (*p != '%') {
             continue;
         }
@@ -2267,14 +2341,178 @@ _ebpf_core_trace_printk(_In_reads_(fmt_size) const char* fmt, size_t fmt_size, i
         break;
     }
 
-    if ((*p == 0) && (arg_count == specifier_count)) {
+    return (*p == 0) ? specifier_count : -1;
+}
+
+/**
+ * @brief Find the format table entry for a format string, validating and adding it on first use.
+ *
+ * @param[in] fmt Format string as passed by the program.
+ * @param[in] fmt_size Size of the format string.
+ * @returns Pointer to the entry, or NULL on allocation failure. If the table is full, the returned entry is not
+ * cached and must be freed by the caller.
+ */
+static _Ret_maybenull_ ebpf_core_printk_format_t*
+_ebpf_core_printk_get_format(_In_reads_(fmt_size) const char* fmt, size_t fmt_size)
+{
+    uint64_t hash = _ebpf_core_printk_format_hash(fmt, fmt_size);
+    ebpf_core_printk_format_t* entry;
+    size_t index;
+
+    // Lock-free lookup. Slots are only ever filled, except by ebpf_core_release_printk_formats, which clears all of
+    // them and frees the entries once every caller that may have found one has left its epoch.
+    for (size_t probe = 0; probe < PRINTK_FORMAT_TABLE_SIZE; probe++) {
+        index = (hash + probe) & (PRINTK_FORMAT_TABLE_SIZE - 1);
+        entry = (ebpf_core_printk_format_t*)ReadPointerAcquire((void* volatile*)&_ebpf_core_printk_formats[index]);
+        if (entry == NULL) {
+            break;
+        }
+        if (entry->hash == hash && entry->size == fmt_size && memcmp(entry->raw, fmt, fmt_size) == 0) {
+            return entry;
+        }
+    }
+
+    // First use of this format. Make a copy, normalize it and validate it.
+    entry = (ebpf_core_printk_format_t*)ebpf_allocate_with_tag(
+        sizeof(ebpf_core_printk_format_t) + (fmt_size * 2) + 1, EBPF_POOL_TAG_CORE);
+    if (entry == NULL) {
+        return NULL;
+    }
+    entry->hash = hash;
+    entry->size = (uint32_t)fmt_size;
+    memcpy(entry->raw, fmt, fmt_size);
+    entry->format = entry->raw + fmt_size;
+    memcpy(entry->format, fmt, fmt_size);
+
+    // Make sure the output is null-terminated, and
+    // remove the newline if present.
+    // A well-formed input should be null terminated,
+    // so look at the next-to-last byte.
+    char* end = entry->format + fmt_size - 1;
+    if (fmt_size >= 2 && end[-1] == '\n') {
+        end--;
+    }
+    *end = '\0';
+
+    entry->specifier_count = _ebpf_core_printk_count_specifiers(entry->format);
+    entry->id = (uint32_t)InterlockedIncrement(&_ebpf_core_printk_next_format_id);
+
+    ebpf_lock_state_t state = ebpf_lock_lock(&_ebpf_core_printk_format_lock);
+    for (size_t probe = 0; probe < PRINTK_FORMAT_TABLE_SIZE; probe++) {
+        index = (hash + probe) & (PRINTK_FORMAT_TABLE_SIZE - 1);
+        ebpf_core_printk_format_t* existing = _ebpf_core_printk_formats[index];
+        if (existing == NULL) {
+            entry->cached = true;
+            WritePointerRelease((void* volatile*)&_ebpf_core_printk_formats[index], entry);
+            break;
+        }
+        if (existing->hash == hash && existing->size == fmt_size && memcmp(existing->raw, fmt, fmt_size) == 0) {
+            // Another CPU added the same format first.
+            ebpf_lock_unlock(&_ebpf_core_printk_format_lock, state);
+            ebpf_free(entry);
+            return existing;
+        }
+    }
+    ebpf_lock_unlock(&_ebpf_core_printk_format_lock, state);
+
+    return entry;
+}
+
+static void
+_ebpf_core_printk_free_formats()
+{
+    for (size_t index = 0; index < PRINTK_FORMAT_TABLE_SIZE; index++) {
+        ebpf_free(_ebpf_core_printk_formats[index]);
+        _ebpf_core_printk_formats[index] = NULL;
+    }
+}
+
+static void
+_ebpf_core_printk_free_released_formats(_Inout_ void* context)
+{
+    ebpf_core_printk_format_t* entry = (ebpf_core_printk_format_t*)context;
+    while (entry != NULL) {
+        ebpf_core_printk_format_t* next = (ebpf_core_printk_format_t*)entry->next_released;
+        ebpf_free(entry);
+        entry = next;
+    }
+}
+
+void
+ebpf_core_release_printk_formats()
+{
+    ebpf_core_printk_format_t* released = NULL;
+
+    ebpf_lock_state_t state = ebpf_lock_lock(&_ebpf_core_printk_format_lock);
+    for (size_t index = 0; index < PRINTK_FORMAT_TABLE_SIZE; index++) {
+        ebpf_core_printk_format_t* entry = _ebpf_core_printk_formats[index];
+        if (entry != NULL) {
+            entry->next_released = released;
+            released = entry;
+        }
+    }
+    if (released == NULL) {
+        ebpf_lock_unlock(&_ebpf_core_printk_format_lock, state);
+        return;
+    }
+
+    ebpf_epoch_work_item_t* work_item =
+        ebpf_epoch_allocate_work_item(released, _ebpf_core_printk_free_released_formats);
+    if (work_item == NULL) {
+        // Keep the entries; they are freed by a later release or by ebpf_core_terminate.
+        ebpf_lock_unlock(&_ebpf_core_printk_format_lock, state);
+        return;
+    }
+    for (size_t index = 0; index < PRINTK_FORMAT_TABLE_SIZE; index++) {
+        WritePointerRelease((void* volatile*)&_ebpf_core_printk_formats[index], NULL);
+    }
+    ebpf_lock_unlock(&_ebpf_core_printk_format_lock, state);
+
+    // Programs that are still running may be using the entries, so free them once the current epoch ends.
+    ebpf_epoch_schedule_work_item(work_item);
+}
+
+static long
+_ebpf_core_trace_printk(_In_reads_(fmt_size) const char* fmt, size_t fmt_size, int arg_count, ...)
+{
+    if (fmt_size == 0 || fmt_size > MAX_PRINTK_STRING_SIZE - 1) {
+        // Disallow empty and large fmt_size values.
+        return -1;
+    }
+
+    // The format string is only copied and validated the first time it is seen.
+    ebpf_core_printk_format_t* entry = _ebpf_core_printk_get_format(fmt, fmt_size);
+    if (entry == NULL) {
+        return -1;
+    }
+
+    long bytes_written = -1;
+    if (arg_count == entry->specifier_count) {
         va_list arg_list;
         __va_start(&arg_list, arg_count);
-        bytes_written = ebpf_platform_printk(output, arg_list);
+        if (EBPF_LOG_PRINTK_BINARY_ENABLED()) {
+            // Defer formatting to the trace consumer: only the format ID and the raw arguments are logged.
+            uint64_t arguments[3] = {0};
+            for (int i = 0; i < arg_count; i++) {
+                arguments[i] = va_arg(arg_list, uint64_t);
+            }
+            // Log the format again for every new trace session, so that each session can decode the binary events.
+            uint32_t generation = ebpf_trace_get_enable_generation();
+            if (entry->logged_generation != generation) {
+                entry->logged_generation = generation;
+                ebpf_log_printk_format(entry->id, entry->format);
+            }
+            ebpf_log_printk_binary(entry->id, (uint32_t)arg_count, arguments);
+            bytes_written = (long)(sizeof(entry->id) + (arg_count * sizeof(uint64_t)));
+        } else {
+            bytes_written = ebpf_platform_printk(entry->format, arg_list);
+        }
         __va_end(&arg_list);
     }
 
-    ebpf_free(output);
+    if (!entry->cached) {
+        ebpf_free(entry);
+    }
     return bytes_written;
 }
 
@@ -2303,6 +2541,75 @@ _ebpf_core_trace_printk5(
     return _ebpf_core_trace_printk(fmt, fmt_size, 3, arg3, arg4, arg5);
 }
 
+// Number of 8-byte blocks that can be summed into 32-bit lanes before a lane can overflow.
+// Each block adds at most 2 * 0xFFFF to a lane, so 16384 blocks add at most 0x7FFF8000.
+#define EBPF_CSUM_BLOCKS_PER_LANE_FLUSH 16384
+
+/**
+ * @brief Sum a buffer as 16-bit words in host byte order.
+ *
+ * @param[in] buffer Buffer to sum.
+ * @param[in] length Length of the buffer in bytes. Must be even.
+ *
+ * @returns Sum of all the 16-bit words in the buffer, without any folding.
+ */
+static uint64_t
+_ebpf_core_sum_16bit_words(_In_reads_bytes_(length) const uint8_t* buffer, size_t length)
+{
+    uint64_t sum = 0;
+
+#if defined(_M_X64)
+    // SSE2 is part of the x64 baseline and can be used at any IRQL without saving
+    // extended processor state. Words are widened to 32-bit lanes and accumulated
+    // 16 bytes at a time, with the lanes flushed to 64 bits before they can overflow.
+    const __m128i zero = _mm_setzero_si128();
+    while (length >= 16) {
+        __m128i lanes = zero;
+        size_t blocks = length / 16;
+        if (blocks > EBPF_CSUM_BLOCKS_PER_LANE_FLUSH) {
+            blocks = EBPF_CSUM_BLOCKS_PER_LANE_FLUSH;
+        }
+        for (size_t i = 0; i < blocks; i++) {
+            __m128i words = _mm_loadu_si128((const __m128i*)buffer);
+            lanes = _mm_add_epi32(lanes, _mm_unpacklo_epi16(words, zero));
+            lanes = _mm_add_epi32(lanes, _mm_unpackhi_epi16(words, zero));
+            buffer += 16;
+        }
+        length -= blocks * 16;
+
+        __m128i wide = _mm_add_epi64(_mm_unpacklo_epi32(lanes, zero), _mm_unpackhi_epi32(lanes, zero));
+        sum += (uint64_t)_mm_cvtsi128_si64(wide) + (uint64_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(wide, wide));
+    }
+#endif
+
+    // Portable path: sum 8 bytes at a time as two 32-bit lanes of a 64-bit word.
+    while (length >= 8) {
+        uint64_t lanes = 0;
+        size_t blocks = length / 8;
+        if (blocks > EBPF_CSUM_BLOCKS_PER_LANE_FLUSH) {
+            blocks = EBPF_CSUM_BLOCKS_PER_LANE_FLUSH;
+        }
+        for (size_t i = 0; i < blocks; i++) {
+            uint64_t words;
+            memcpy(&words, buffer, sizeof(words));
+            lanes += (words & 0x0000FFFF0000FFFFull) + ((words >> 16) & 0x0000FFFF0000FFFFull);
+            buffer += 8;
+        }
+        length -= blocks * 8;
+        sum += (lanes & 0xFFFFFFFF) + (lanes >> 32);
+    }
+
+    while (length >= 2) {
+        uint16_t word;
+        memcpy(&word, buffer, sizeof(word));
+        sum += word;
+        buffer += 2;
+        length -= 2;
+    }
+
+    return sum;
+}
+
 int
 ebpf_core_csum_diff(
     _In_reads_bytes_opt_(from_size) const void* from,
@@ -2311,33 +2618,31 @@ ebpf_core_csum_diff(
     int to_size,
     int seed)
 {
-    int csum_diff = -EINVAL;
-
-    if ((from_size % 4 != 0) || (to_size % 4 != 0)) {
+    if ((from_size < 0) || (to_size < 0) || (from_size % 4 != 0) || (to_size % 4 != 0)) {
         // size of buffers should be a multiple of 4.
-        goto Exit;
+        return -EINVAL;
     }
 
-    csum_diff = seed;
+    uint64_t csum_diff = (uint32_t)seed;
     if (to != NULL) {
-        for (int i = 0; i < to_size / 2; i++) {
-            csum_diff += (uint16_t)(*((uint16_t*)to + i));
-        }
+        csum_diff += _ebpf_core_sum_16bit_words((const uint8_t*)to, to_size);
     }
     if (from != NULL) {
-        for (int i = 0; i < from_size / 2; i++) {
-            csum_diff += (uint16_t)(~*((uint16_t*)from + i));
-        }
+        // Adding the one's complement of each word of "from" is the same as adding 0xFFFF per word
+        // and subtracting the sum of the words.
+        uint64_t from_word_count = (uint64_t)from_size / 2;
+        csum_diff += (from_word_count * 0xFFFF) - _ebpf_core_sum_16bit_words((const uint8_t*)from, from_size);
     }
 
-    // Adding 16-bit unsigned integers or their one's complement will produce a positive 32-bit integer,
-    // unless the length of the buffers is so long, that the signed 32 bit output overflows and produces a negative
-    // result.
-    if (csum_diff < 0) {
-        csum_diff = -EINVAL;
+    // The sum is returned unfolded whenever it fits, to match the value produced by summing word by word.
+    // Otherwise, fold it with end-around carry, which gives the same 16-bit one's complement checksum.
+    if (csum_diff > INT32_MAX) {
+        while (csum_diff >> 16) {
+            csum_diff = (csum_diff & 0xFFFF) + (csum_diff >> 16);
+        }
     }
-Exit:
-    return csum_diff;
+
+    return (int)csum_diff;
 }
 
 static int
@@ -2362,7 +2667,7 @@ _ebpf_core_map_pop_elem(_Inout_ ebpf_map_t* map, _Out_ uint8_t* value)
 }
 
 static uint64_t
-_ebpf_core_map_peek_elem(_Inout_ ebpf_map_t* map, _Out_ uint8_t* value)
+_ebpf_core_map_peek_elem(_Inout_ ebpf_map_t* map, _Inout_ uint8_t* value)
 {
     return -ebpf_map_peek_entry(map, 0, value, EBPF_MAP_FLAG_HELPER);
 }
@@ -2616,6 +2921,8 @@ static ebpf_protocol_handler_t _ebpf_protocol_handlers[] = {
     DECLARE_PROTOCOL_HANDLER_VARIABLE_REQUEST_FIXED_REPLY(map_delete_element_batch, keys, PROTOCOL_ALL_MODES),
     DECLARE_PROTOCOL_HANDLER_VARIABLE_REQUEST_VARIABLE_REPLY(
         map_get_next_key_value_batch, previous_key, data, PROTOCOL_ALL_MODES),
+    DECLARE_PROTOCOL_HANDLER_FIXED_REQUEST_FIXED_REPLY(load_native_module_instance, PROTOCOL_NATIVE_MODE),
+    DECLARE_PROTOCOL_HANDLER_VARIABLE_REQUEST_VARIABLE_REPLY(get_next_pinned_path, data, next_path, PROTOCOL_ALL_MODES),
 };
 
 _Must_inspect_result_ ebpf_result_t
@@ -103,7 +103,8 @@ extern "C"
      * @param[in] seed  An optional integer that can be added to the value, which can be used to carry result of a
      * previous csum_diff operation.
      *
-     * @returns The checksum delta on success, or <0 on failure.
+     * @returns The checksum delta on success, or <0 on failure. Results that do not fit in a positive int are
+     * folded to 16 bits.
      */
     int
     ebpf_core_csum_diff(
@@ -245,6 +246,14 @@ extern "C"
     void
     ebpf_core_close_context(_In_opt_ void* context);
 
+    /**
+     * @brief Remove all the validated bpf_printk format strings from the format table. Called when a program that
+     * uses bpf_printk is freed, so that the table doesn't keep the formats of unloaded programs. The entries are
+     * freed once the current epoch ends, and the formats of programs still loaded are validated again on next use.
+     */
+    void
+    ebpf_core_release_printk_formats();
+
     /**
      * @brief Update the value of a map element with the provided handle.
      *
@@ -481,9 +481,7 @@ _ebpf_link_instance_invoke_batch_begin(
     _In_ const void* client_binding_context, size_t state_size, _Out_writes_(state_size) void* state)
 {
     ebpf_execution_context_state_t* execution_context_state = (ebpf_execution_context_state_t*)state;
-    bool epoch_entered = false;
-    bool provider_reference_held = false;
-    ebpf_result_t return_value;
+    ebpf_result_t return_value = EBPF_SUCCESS;
     ebpf_link_t* link = (ebpf_link_t*)client_binding_context;
 
     if (state_size < sizeof(ebpf_execution_context_state_t)) {
@@ -491,48 +489,59 @@ _ebpf_link_instance_invoke_batch_begin(
         goto Done;
     }
 
-    memset(execution_context_state, 0, sizeof(ebpf_execution_context_state_t));
+    if (KeGetCurrentIrql() == DISPATCH_LEVEL) {
+        // Lightweight path for hooks that invoke programs at DISPATCH_LEVEL: the caller stays on this CPU and the
+        // program state goes straight into this CPU's state slot.
+        execution_context_state->current_irql = DISPATCH_LEVEL;
+        execution_context_state->id.cpu = ebpf_get_current_cpu();
+        execution_context_state->tail_call_state.next_program = NULL;
+        execution_context_state->tail_call_state.count = 0;
+        ebpf_state_store_cpu(ebpf_program_get_state_index(), (uintptr_t)state, execution_context_state->id.cpu);
+        ebpf_epoch_enter_dispatch((ebpf_epoch_state_t*)(execution_context_state->epoch_state));
+    } else {
+        memset(execution_context_state, 0, sizeof(ebpf_execution_context_state_t));
 
-    ebpf_get_execution_context_state(execution_context_state);
-    return_value = ebpf_state_store(ebpf_program_get_state_index(), (uintptr_t)state, execution_context_state);
-    if (return_value != EBPF_SUCCESS) {
-        goto Done;
-    }
+        ebpf_get_execution_context_state(execution_context_state);
+        return_value = ebpf_state_store(ebpf_program_get_state_index(), (uintptr_t)state, execution_context_state);
+        if (return_value != EBPF_SUCCESS) {
+            goto Done;
+        }
 
-    ebpf_epoch_enter((ebpf_epoch_state_t*)(execution_context_state->epoch_state));
-    epoch_entered = true;
+        ebpf_epoch_enter((ebpf_epoch_state_t*)(execution_context_state->epoch_state));
+    }
 
-    return_value = ebpf_program_reference_providers(link->program);
-    if (return_value != EBPF_SUCCESS) {
+    // The program information provider cannot finish detaching while this epoch is held, so no per-batch rundown
+    // reference is needed.
+    if (!ebpf_program_are_providers_attached(link->program)) {
         EBPF_LOG_MESSAGE_GUID(
             EBPF_TRACELOG_LEVEL_ERROR,
             EBPF_TRACELOG_KEYWORD_LINK,
             "Program information provider is not loaded.",
             &link->attach_type);
-        goto Done;
+        (void)_ebpf_link_instance_invoke_batch_end(client_binding_context, state);
+        return_value = EBPF_EXTENSION_FAILED_TO_LOAD;
     }
-    provider_reference_held = true;
 
 Done:
-    if (return_value != EBPF_SUCCESS && provider_reference_held) {
-        ebpf_program_dereference_providers(link->program);
-    }
-
-    if (return_value != EBPF_SUCCESS && epoch_entered) {
-        ebpf_epoch_exit((ebpf_epoch_state_t*)(execution_context_state->epoch_state));
-    }
-
     return return_value;
 }
 
 static ebpf_result_t
 _ebpf_link_instance_invoke_batch_end(_In_ const void* extension_client_binding_context, _Inout_ void* state)
 {
+    UNREFERENCED_PARAMETER(extension_client_binding_context);
     ebpf_execution_context_state_t* execution_context_state = (ebpf_execution_context_state_t*)state;
-    ebpf_link_t* link = (ebpf_link_t*)extension_client_binding_context;
+    ebpf_epoch_state_t* epoch_state = (ebpf_epoch_state_t*)(execution_context_state->epoch_state);
+
+    // Begin took the lightweight path exactly when it was called at DISPATCH_LEVEL.
+    if (execution_context_state->current_irql == DISPATCH_LEVEL) {
+        ebpf_state_store_cpu(ebpf_program_get_state_index(), 0, execution_context_state->id.cpu);
+        ebpf_epoch_exit_dispatch(epoch_state);
+        return EBPF_SUCCESS;
+    }
+
     ebpf_assert_success(ebpf_state_store(ebpf_program_get_state_index(), 0, execution_context_state));
-    ebpf_program_dereference_providers(link->program);
-    ebpf_epoch_exit((ebpf_epoch_state_t*)(execution_context_state->epoch_state));
+    ebpf_epoch_exit(epoch_state);
     return EBPF_SUCCESS;
 }
 
@@ -547,6 +556,13 @@ _ebpf_link_instance_invoke_batch(
     ebpf_result_t return_value = EBPF_SUCCESS;
     ebpf_link_t* link = (ebpf_link_t*)client_binding_context;
 
+    // A hook provider may begin one batch on a link and invoke the programs of other links within it, so check the
+    // providers of this link's program too. The epoch entered by batch begin keeps them attached until batch end.
+    if (!ebpf_program_are_providers_attached(link->program)) {
+        *result = 0;
+        return EBPF_EXTENSION_FAILED_TO_LOAD;
+    }
+
     ebpf_program_invoke(link->program, program_context, result, (ebpf_execution_context_state_t*)state);
 
     EBPF_RETURN_RESULT(return_value);
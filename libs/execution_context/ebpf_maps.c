@@ -21,6 +21,14 @@ typedef struct _ebpf_core_map
     ebpf_map_definition_in_memory_t ebpf_map_definition;
     uint32_t original_value_size;
     uint8_t* data;
+    // Entry points used by helper functions, specialized for the map type when the map is created.
+    uint8_t* (*helper_find_entry)(_Inout_ struct _ebpf_core_map* map, _In_ const uint8_t* key, bool delete_on_success);
+    ebpf_result_t (*helper_update_entry)(
+        _Inout_ struct _ebpf_core_map* map,
+        _In_ const uint8_t* key,
+        _In_ const uint8_t* value,
+        ebpf_map_option_t option);
+    ebpf_result_t (*helper_delete_entry)(_Inout_ struct _ebpf_core_map* map, _In_ const uint8_t* key);
 } ebpf_core_map_t;
 
 typedef struct _ebpf_core_object_map
@@ -129,9 +137,9 @@ typedef struct _ebpf_core_ring_buffer_map_async_query_context
 } ebpf_core_ring_buffer_map_async_query_context_t;
 
 /**
- * Core map structure for BPF_MAP_TYPE_QUEUE and BPF_MAP_TYPE_STACK
+ * Core map structure for BPF_MAP_TYPE_STACK
  * ebpf_core_circular_map_t stores an array of uint8_t* pointers. Each pointer
- * stores a version of a value that has been pushed to the queue or stack. The
+ * stores a version of a value that has been pushed to the stack. The
  * structure can't store the map values directly as the caller expects items
  * returned from peek to remain unmodified. If items are stored directly in
  * the array, then a sequence of:
@@ -148,11 +156,6 @@ typedef struct _ebpf_core_circular_map
     ebpf_lock_t lock;
     size_t begin;
     size_t end;
-    enum
-    {
-        EBPF_CORE_QUEUE = 1,
-        EBPF_CORE_STACK = 2,
-    } type;
     uint8_t* slots[1];
 } ebpf_core_circular_map_t;
 
@@ -168,31 +171,16 @@ _ebpf_core_circular_map_peek_or_pop(_Inout_ ebpf_core_circular_map_t* map, bool
 {
     uint8_t* return_value = NULL;
 
-    if (map->type == EBPF_CORE_QUEUE) {
-        // Remove from the beginning.
-        return_value = map->slots[map->begin];
-        if (return_value == NULL) {
-            ebpf_assert(map->begin == map->end);
-            goto Done;
-        }
-        if (pop) {
-            map->slots[map->begin] = NULL;
-            map->begin = _ebpf_core_circular_map_add(map, map->begin, 1);
-        }
-    } else {
-        // Remove from the end.
-        size_t new_end = _ebpf_core_circular_map_add(map, map->end, -1);
-        return_value = map->slots[new_end];
-        if (return_value == NULL) {
-            ebpf_assert(map->begin == map->end);
-            goto Done;
-        }
-        if (pop) {
-            map->slots[new_end] = NULL;
-            map->end = new_end;
-        }
+    // Remove from the end.
+    size_t new_end = _ebpf_core_circular_map_add(map, map->end, -1);
+    return_value = map->slots[new_end];
+    if (return_value == NULL) {
+        ebpf_assert(map->begin == map->end);
+        goto Done;
     }
     if (pop) {
+        map->slots[new_end] = NULL;
+        map->end = new_end;
         // The return_value is not freed until the current epoch is retired.
         ebpf_epoch_free(return_value);
     }
@@ -271,6 +259,7 @@ typedef struct _ebpf_map_metadata_table
     ebpf_result_t (*update_entry_per_cpu)(
         _Inout_ ebpf_core_map_t* map, _In_ const uint8_t* key, _In_ const uint8_t* value, ebpf_map_option_t option);
     ebpf_result_t (*delete_entry)(_Inout_ ebpf_core_map_t* map, _In_ const uint8_t* key);
+    uint8_t* (*helper_find_entry)(_Inout_ ebpf_core_map_t* map, _In_ const uint8_t* key, bool delete_on_success);
     ebpf_result_t (*next_key_and_value)(
         _Inout_ ebpf_core_map_t* map,
         _In_ const uint8_t* previous_key,
@@ -280,6 +269,7 @@ typedef struct _ebpf_map_metadata_table
     int zero_length_value : 1;
     int per_cpu : 1;
     int key_history : 1;
+    int membership_only : 1;
 } ebpf_map_metadata_table_t;
 
 const ebpf_map_metadata_table_t ebpf_map_metadata_tables[];
@@ -317,12 +307,13 @@ _create_array_map_with_map_struct_size(
         goto Done;
     }
 
+    // The allocation is already zeroed, so the data doesn't need to be cleared again. This saves a second pass over
+    // large arrays. The memory is still committed up front, since it comes from nonpaged pool.
     local_map = ebpf_epoch_allocate_with_tag(full_map_size, EBPF_POOL_TAG_MAP);
     if (local_map == NULL) {
         retval = EBPF_NO_MEMORY;
         goto Done;
     }
-    memset(local_map, 0, full_map_size);
 
     local_map->ebpf_map_definition = *map_definition;
     local_map->data = ((uint8_t*)local_map) + EBPF_PAD_CACHE(map_struct_size);
@@ -1659,44 +1650,18 @@ _update_lpm_map_entry(
     return result;
 }
 
-static ebpf_result_t
-_create_queue_map(
-    _In_ const ebpf_map_definition_in_memory_t* map_definition,
-    ebpf_handle_t inner_map_handle,
-    _Outptr_ ebpf_core_map_t** map)
-{
-    ebpf_result_t result;
-    if (inner_map_handle != ebpf_handle_invalid || map_definition->key_size != 0) {
-        return EBPF_INVALID_ARGUMENT;
-    }
-    size_t circular_map_size =
-        EBPF_OFFSET_OF(ebpf_core_circular_map_t, slots) + map_definition->max_entries * sizeof(uint8_t*);
-    result = _create_array_map_with_map_struct_size(circular_map_size, map_definition, map);
-    if (result == EBPF_SUCCESS) {
-        ebpf_core_circular_map_t* circular_map = EBPF_FROM_FIELD(ebpf_core_circular_map_t, core_map, *map);
-        circular_map->type = EBPF_CORE_QUEUE;
-    }
-    return result;
-}
-
 static ebpf_result_t
 _create_stack_map(
     _In_ const ebpf_map_definition_in_memory_t* map_definition,
     ebpf_handle_t inner_map_handle,
     _Outptr_ ebpf_core_map_t** map)
 {
-    ebpf_result_t result;
     if (inner_map_handle != ebpf_handle_invalid || map_definition->key_size != 0) {
         return EBPF_INVALID_ARGUMENT;
     }
     size_t circular_map_size =
         EBPF_OFFSET_OF(ebpf_core_circular_map_t, slots) + map_definition->max_entries * sizeof(uint8_t*);
-    result = _create_array_map_with_map_struct_size(circular_map_size, map_definition, map);
-    if (result == EBPF_SUCCESS) {
-        ebpf_core_circular_map_t* circular_map = EBPF_FROM_FIELD(ebpf_core_circular_map_t, core_map, *map);
-        circular_map->type = EBPF_CORE_STACK;
-    }
-    return result;
+    return _create_array_map_with_map_struct_size(circular_map_size, map_definition, map);
 }
 
 static void
@@ -1750,6 +1715,396 @@ _update_circular_map_entry(
     return result;
 }
 
+/**
+ * Core map structure for BPF_MAP_TYPE_QUEUE.
+ * ebpf_core_queue_map_t is a bounded multi-producer, multi-consumer ring in
+ * which every slot carries a sequence number. A producer claims the slot at
+ * the tail once its sequence number shows that it is empty, and a consumer
+ * claims the slot at the head once its sequence number shows that it has been
+ * filled. Producers and consumers only contend with each other on their own
+ * end of the ring, and neither takes a lock.
+ *
+ * As with ebpf_core_circular_map_t, slots point to epoch allocated copies of
+ * the values, so that a value returned from peek or pop stays unmodified until
+ * the current epoch is retired.
+ */
+typedef struct _ebpf_core_queue_slot
+{
+    volatile int64_t sequence;
+    uint8_t* data;
+} ebpf_core_queue_slot_t;
+
+typedef struct _ebpf_core_queue_map
+{
+    ebpf_core_map_t core_map;
+    // Keep the consumer and producer positions on their own cache lines.
+    uint8_t padding0[EBPF_CACHE_LINE_SIZE];
+    volatile int64_t head;
+    uint8_t padding1[EBPF_CACHE_LINE_SIZE - sizeof(int64_t)];
+    volatile int64_t tail;
+    uint8_t padding2[EBPF_CACHE_LINE_SIZE - sizeof(int64_t)];
+    ebpf_core_queue_slot_t slots[1];
+} ebpf_core_queue_map_t;
+
+static __forceinline ebpf_core_queue_slot_t*
+_ebpf_core_queue_map_get_slot(_In_ ebpf_core_queue_map_t* map, int64_t position)
+{
+    return &map->slots[(uint64_t)position % map->core_map.ebpf_map_definition.max_entries];
+}
+
+static uint8_t*
+_ebpf_core_queue_map_peek_or_pop(_Inout_ ebpf_core_queue_map_t* map, bool pop)
+{
+    int64_t capacity = map->core_map.ebpf_map_definition.max_entries;
+
+    for (;;) {
+        int64_t position = ReadAcquire64(&map->head);
+        ebpf_core_queue_slot_t* slot = _ebpf_core_queue_map_get_slot(map, position);
+        int64_t difference = ReadAcquire64(&slot->sequence) - (position + 1);
+
+        if (difference < 0) {
+            // The slot at the head hasn't been filled, so the queue is empty.
+            return NULL;
+        }
+        if (difference > 0) {
+            // Another consumer has already taken this slot.
+            continue;
+        }
+
+        if (!pop) {
+            uint8_t* data = slot->data;
+            // The value is still at the head of the queue if no consumer claimed the slot while it was being read.
+            MemoryBarrier();
+            if (ReadNoFence64(&map->head) == position) {
+                return data;
+            }
+            continue;
+        }
+
+        if (ebpf_interlocked_compare_exchange_int64(&map->head, position + 1, position) == position) {
+            uint8_t* data = slot->data;
+            slot->data = NULL;
+            // Hand the slot to the producer of the next lap.
+            WriteRelease64(&slot->sequence, position + capacity);
+            // The data is not freed until the current epoch is retired.
+            ebpf_epoch_free(data);
+            return data;
+        }
+    }
+}
+
+static ebpf_result_t
+_ebpf_core_queue_map_push(_Inout_ ebpf_core_queue_map_t* map, _In_ const uint8_t* data, bool replace)
+{
+    uint8_t* new_data =
+        ebpf_epoch_allocate_with_tag(map->core_map.ebpf_map_definition.value_size, EBPF_POOL_TAG_MAP);
+    if (new_data == NULL) {
+        return EBPF_NO_MEMORY;
+    }
+    memcpy(new_data, data, map->core_map.ebpf_map_definition.value_size);
+
+    for (;;) {
+        int64_t position = ReadAcquire64(&map->tail);
+        ebpf_core_queue_slot_t* slot = _ebpf_core_queue_map_get_slot(map, position);
+        int64_t difference = ReadAcquire64(&slot->sequence) - position;
+
+        if (difference < 0) {
+            // The slot at the tail still holds a value from the previous lap, so the queue is full.
+            if (!replace) {
+                ebpf_epoch_free(new_data);
+                return EBPF_OUT_OF_SPACE;
+            }
+            // Discard the oldest value to make room.
+            (void)_ebpf_core_queue_map_peek_or_pop(map, true);
+            continue;
+        }
+        if (difference > 0) {
+            // Another producer has already taken this slot.
+            continue;
+        }
+
+        if (ebpf_interlocked_compare_exchange_int64(&map->tail, position + 1, position) == position) {
+            slot->data = new_data;
+            // Publish the value to consumers.
+            WriteRelease64(&slot->sequence, position + 1);
+            return EBPF_SUCCESS;
+        }
+    }
+}
+
+static ebpf_result_t
+_create_queue_map(
+    _In_ const ebpf_map_definition_in_memory_t* map_definition,
+    ebpf_handle_t inner_map_handle,
+    _Outptr_ ebpf_core_map_t** map)
+{
+    ebpf_result_t result;
+    ebpf_core_queue_map_t* queue_map = NULL;
+    size_t slots_size;
+    size_t queue_map_size;
+
+    *map = NULL;
+
+    if (inner_map_handle != ebpf_handle_invalid || map_definition->key_size != 0) {
+        return EBPF_INVALID_ARGUMENT;
+    }
+
+    result = ebpf_safe_size_t_multiply(map_definition->max_entries, sizeof(ebpf_core_queue_slot_t), &slots_size);
+    if (result != EBPF_SUCCESS) {
+        return result;
+    }
+
+    result = ebpf_safe_size_t_add(EBPF_OFFSET_OF(ebpf_core_queue_map_t, slots), slots_size, &queue_map_size);
+    if (result != EBPF_SUCCESS) {
+        return result;
+    }
+
+    queue_map = ebpf_epoch_allocate_with_tag(queue_map_size, EBPF_POOL_TAG_MAP);
+    if (queue_map == NULL) {
+        return EBPF_NO_MEMORY;
+    }
+
+    queue_map->core_map.ebpf_map_definition = *map_definition;
+
+    // Slot i is empty and ready for the producer at position i.
+    for (size_t i = 0; i < map_definition->max_entries; i++) {
+        queue_map->slots[i].sequence = (int64_t)i;
+    }
+
+    *map = &queue_map->core_map;
+    return EBPF_SUCCESS;
+}
+
+static void
+_delete_queue_map(_In_ _Post_invalid_ ebpf_core_map_t* map)
+{
+    ebpf_core_queue_map_t* queue_map = EBPF_FROM_FIELD(ebpf_core_queue_map_t, core_map, map);
+    // Free all the elements stored in the queue.
+    for (size_t i = 0; i < queue_map->core_map.ebpf_map_definition.max_entries; i++) {
+        ebpf_epoch_free(queue_map->slots[i].data);
+    }
+    ebpf_epoch_free(queue_map);
+}
+
+static ebpf_result_t
+_find_queue_map_entry(
+    _Inout_ ebpf_core_map_t* map, _In_opt_ const uint8_t* key, bool delete_on_success, _Outptr_ uint8_t** data)
+{
+    if (!map) {
+        return EBPF_INVALID_ARGUMENT;
+    }
+
+    // Queue uses no key, but the caller always passes in a non-null pointer (with a 0 key size)
+    // so we cannot require key to be null.
+    UNREFERENCED_PARAMETER(key);
+
+    ebpf_core_queue_map_t* queue_map = EBPF_FROM_FIELD(ebpf_core_queue_map_t, core_map, map);
+    *data = _ebpf_core_queue_map_peek_or_pop(queue_map, delete_on_success);
+    return *data == NULL ? EBPF_OBJECT_NOT_FOUND : EBPF_SUCCESS;
+}
+
+static ebpf_result_t
+_update_queue_map_entry(
+    _Inout_ ebpf_core_map_t* map, _In_opt_ const uint8_t* key, _In_opt_ const uint8_t* data, ebpf_map_option_t option)
+{
+    if (!map || !data) {
+        return EBPF_INVALID_ARGUMENT;
+    }
+
+    // Queue uses no key, but the caller always passes in a non-null pointer (with a 0 key size)
+    // so we cannot require key to be null.
+    UNREFERENCED_PARAMETER(key);
+
+    ebpf_core_queue_map_t* queue_map = EBPF_FROM_FIELD(ebpf_core_queue_map_t, core_map, map);
+    return _ebpf_core_queue_map_push(queue_map, data, option & BPF_EXIST);
+}
+
+/**
+ * Core map structure for BPF_MAP_TYPE_BLOOM_FILTER.
+ * The filter is split into cache line sized blocks of 512 bits. One hash of
+ * the value selects the block and a second hash derives the bit positions of
+ * all the hash functions within that block, so testing or adding a value
+ * touches a single cache line regardless of the number of hash functions.
+ */
+typedef struct _ebpf_core_bloom_filter_map
+{
+    ebpf_core_map_t core_map;
+    uint32_t hash_count;
+    uint32_t block_mask;
+    uint64_t seed;
+} ebpf_core_bloom_filter_map_t;
+
+#define EBPF_BLOOM_FILTER_BLOCK_WORDS (EBPF_CACHE_LINE_SIZE / sizeof(uint32_t))
+#define EBPF_BLOOM_FILTER_BLOCK_BITS (EBPF_CACHE_LINE_SIZE * 8)
+#define EBPF_BLOOM_FILTER_DEFAULT_HASH_COUNT 5
+#define EBPF_BLOOM_FILTER_MAX_HASH_COUNT 15
+
+static ebpf_result_t
+_create_bloom_filter_map(
+    _In_ const ebpf_map_definition_in_memory_t* map_definition,
+    ebpf_handle_t inner_map_handle,
+    _Outptr_ ebpf_core_map_t** map)
+{
+    ebpf_result_t result;
+    ebpf_core_bloom_filter_map_t* bloom_filter_map = NULL;
+    uint32_t hash_count = map_definition->map_extra ? map_definition->map_extra : EBPF_BLOOM_FILTER_DEFAULT_HASH_COUNT;
+    size_t bit_count;
+    size_t block_count = 1;
+    size_t data_size;
+    size_t map_size;
+
+    *map = NULL;
+
+    if (inner_map_handle != ebpf_handle_invalid || map_definition->key_size != 0 ||
+        hash_count > EBPF_BLOOM_FILTER_MAX_HASH_COUNT) {
+        result = EBPF_INVALID_ARGUMENT;
+        goto Done;
+    }
+
+    // Size the filter as n * k / ln(2) bits, so that about half the bits are set when the map holds max_entries
+    // values. Round up to a power of two number of blocks so that the block index is a mask of the hash.
+    result = ebpf_safe_size_t_multiply(map_definition->max_entries, (size_t)hash_count * 1443, &bit_count);
+    if (result != EBPF_SUCCESS) {
+        goto Done;
+    }
+    bit_count /= 1000;
+    while (block_count * EBPF_BLOOM_FILTER_BLOCK_BITS < bit_count) {
+        block_count <<= 1;
+        if (block_count > (size_t)UINT32_MAX + 1) {
+            result = EBPF_INVALID_ARGUMENT;
+            goto Done;
+        }
+    }
+
+    result = ebpf_safe_size_t_multiply(block_count, EBPF_CACHE_LINE_SIZE, &data_size);
+    if (result != EBPF_SUCCESS) {
+        goto Done;
+    }
+
+    // Leave room to align the blocks to a cache line.
+    result = ebpf_safe_size_t_add(
+        EBPF_PAD_CACHE(sizeof(ebpf_core_bloom_filter_map_t)) + EBPF_CACHE_LINE_SIZE, data_size, &map_size);
+    if (result != EBPF_SUCCESS) {
+        goto Done;
+    }
+
+    bloom_filter_map = ebpf_epoch_allocate_with_tag(map_size, EBPF_POOL_TAG_MAP);
+    if (bloom_filter_map == NULL) {
+        result = EBPF_NO_MEMORY;
+        goto Done;
+    }
+
+    bloom_filter_map->core_map.ebpf_map_definition = *map_definition;
+    bloom_filter_map->core_map.data = EBPF_CACHE_ALIGN_POINTER(
+        ((uint8_t*)bloom_filter_map) + EBPF_PAD_CACHE(sizeof(ebpf_core_bloom_filter_map_t)));
+    bloom_filter_map->hash_count = hash_count;
+    bloom_filter_map->block_mask = (uint32_t)(block_count - 1);
+    bloom_filter_map->seed = ((uint64_t)ebpf_random_uint32() << 32) | ebpf_random_uint32();
+
+    *map = &bloom_filter_map->core_map;
+
+Done:
+    return result;
+}
+
+static void
+_delete_bloom_filter_map(_In_ _Post_invalid_ ebpf_core_map_t* map)
+{
+    ebpf_epoch_free(EBPF_FROM_FIELD(ebpf_core_bloom_filter_map_t, core_map, map));
+}
+
+/**
+ * @brief Compute the block a value maps to and the bits that must be set in it.
+ *
+ * @param[in] bloom_filter_map Bloom filter map.
+ * @param[in] value Value to hash.
+ * @param[out] mask Bits of the block that represent the value.
+ * @return Pointer to the block.
+ */
+static __forceinline volatile int32_t*
+_ebpf_bloom_filter_map_get_block(
+    _In_ const ebpf_core_bloom_filter_map_t* bloom_filter_map,
+    _In_ const uint8_t* value,
+    _Out_writes_(EBPF_BLOOM_FILTER_BLOCK_WORDS) uint32_t* mask)
+{
+    uint64_t hash = ebpf_hash_bytes(
+        value, bloom_filter_map->core_map.ebpf_map_definition.value_size, bloom_filter_map->seed);
+    uint32_t block_index = (uint32_t)hash & bloom_filter_map->block_mask;
+
+    // Derive the bit positions by double hashing the upper half of the hash. The stride is odd, so the
+    // positions of the hash functions are distinct within the block.
+    uint32_t position = (uint32_t)(hash >> 32) & 0xffff;
+    uint32_t stride = (uint32_t)(hash >> 48) | 1;
+
+    memset(mask, 0, EBPF_CACHE_LINE_SIZE);
+    for (uint32_t i = 0; i < bloom_filter_map->hash_count; i++) {
+        uint32_t bit = position % EBPF_BLOOM_FILTER_BLOCK_BITS;
+        mask[bit / 32] |= 1u << (bit % 32);
+        position += stride;
+    }
+
+    return (volatile int32_t*)(bloom_filter_map->core_map.data + (size_t)block_index * EBPF_CACHE_LINE_SIZE);
+}
+
+static ebpf_result_t
+_find_bloom_filter_map_entry(
+    _Inout_ ebpf_core_map_t* map, _In_opt_ const uint8_t* key, bool delete_on_success, _Outptr_ uint8_t** data)
+{
+    uint32_t mask[EBPF_BLOOM_FILTER_BLOCK_WORDS];
+    uint32_t missing = 0;
+
+    if (delete_on_success) {
+        return EBPF_OPERATION_NOT_SUPPORTED;
+    }
+
+    // The key of a bloom filter lookup is the value to test for.
+    if (!map || !key) {
+        return EBPF_INVALID_ARGUMENT;
+    }
+
+    ebpf_core_bloom_filter_map_t* bloom_filter_map = EBPF_FROM_FIELD(ebpf_core_bloom_filter_map_t, core_map, map);
+    const volatile int32_t* block = _ebpf_bloom_filter_map_get_block(bloom_filter_map, key, mask);
+
+    // Test every word of the block without branching so the loop can be vectorized.
+    for (size_t i = 0; i < EBPF_BLOOM_FILTER_BLOCK_WORDS; i++) {
+        missing |= mask[i] & ~(uint32_t)block[i];
+    }
+    if (missing) {
+        return EBPF_KEY_NOT_FOUND;
+    }
+
+    // There is no value to return, so return the block as proof of membership.
+    *data = (uint8_t*)block;
+    return EBPF_SUCCESS;
+}
+
+static ebpf_result_t
+_update_bloom_filter_map_entry(
+    _Inout_ ebpf_core_map_t* map, _In_opt_ const uint8_t* key, _In_opt_ const uint8_t* data, ebpf_map_option_t option)
+{
+    uint32_t mask[EBPF_BLOOM_FILTER_BLOCK_WORDS];
+
+    if (!map || !data) {
+        return EBPF_INVALID_ARGUMENT;
+    }
+
+    // Bloom filter uses no key, but the caller always passes in a non-null pointer (with a 0 key size)
+    // so we cannot require key to be null. Values can't be replaced, so the option doesn't apply.
+    UNREFERENCED_PARAMETER(key);
+    UNREFERENCED_PARAMETER(option);
+
+    ebpf_core_bloom_filter_map_t* bloom_filter_map = EBPF_FROM_FIELD(ebpf_core_bloom_filter_map_t, core_map, map);
+    volatile int32_t* block = _ebpf_bloom_filter_map_get_block(bloom_filter_map, data, mask);
+
+    for (size_t i = 0; i < EBPF_BLOOM_FILTER_BLOCK_WORDS; i++) {
+        // Test if the bits are set before setting them. This avoids the overhead of the interlocked operation.
+        if (mask[i] & ~(uint32_t)block[i]) {
+            ebpf_interlocked_or_int32(&block[i], (int32_t)mask[i]);
+        }
+    }
+    return EBPF_SUCCESS;
+}
+
 static _Requires_lock_held_(ring_buffer_map->lock) void _ebpf_ring_buffer_map_signal_async_query_complete(
     _Inout_ ebpf_core_ring_buffer_map_t* ring_buffer_map)
 {
@@ -1962,6 +2317,78 @@ Exit:
     EBPF_RETURN_RESULT(result);
 }
 
+// Generate the find entry point used by helper functions for a map type. The
+// map type's find function is called directly, so the compiler can inline it.
+#define EBPF_MAP_HELPER_FIND_ENTRY(name, find_entry)                                                    \
+    static _Ret_maybenull_ uint8_t* _ebpf_map_helper_find_##name(                                       \
+        _Inout_ ebpf_core_map_t* map, _In_ const uint8_t* key, bool delete_on_success)                  \
+    {                                                                                                   \
+        uint8_t* value = NULL;                                                                          \
+        if (find_entry(map, key, delete_on_success, &value) != EBPF_SUCCESS) {                          \
+            return NULL;                                                                                \
+        }                                                                                               \
+        return value;                                                                                   \
+    }
+
+// Same as EBPF_MAP_HELPER_FIND_ENTRY, but returns the value of the current CPU.
+#define EBPF_MAP_HELPER_FIND_PER_CPU_ENTRY(name, find_entry)                                            \
+    static _Ret_maybenull_ uint8_t* _ebpf_map_helper_find_##name(                                       \
+        _Inout_ ebpf_core_map_t* map, _In_ const uint8_t* key, bool delete_on_success)                  \
+    {                                                                                                   \
+        uint8_t* value = NULL;                                                                          \
+        if (find_entry(map, key, delete_on_success, &value) != EBPF_SUCCESS || value == NULL) {         \
+            return NULL;                                                                                \
+        }                                                                                               \
+        return value + EBPF_PAD_8((size_t)map->original_value_size) * ebpf_get_current_cpu();           \
+    }
+
+// Maps of maps return the inner map itself to programs.
+#define EBPF_MAP_HELPER_FIND_OBJECT_ENTRY(name, get_object_from_entry)                                  \
+    static _Ret_maybenull_ uint8_t* _ebpf_map_helper_find_##name(                                       \
+        _Inout_ ebpf_core_map_t* map, _In_ const uint8_t* key, bool delete_on_success)                  \
+    {                                                                                                   \
+        UNREFERENCED_PARAMETER(delete_on_success);                                                      \
+        return (uint8_t*)get_object_from_entry(map, key);                                               \
+    }
+
+EBPF_MAP_HELPER_FIND_ENTRY(hash_map, _find_hash_map_entry)
+EBPF_MAP_HELPER_FIND_ENTRY(array_map, _find_array_map_entry)
+EBPF_MAP_HELPER_FIND_ENTRY(lpm_map, _find_lpm_map_entry)
+EBPF_MAP_HELPER_FIND_ENTRY(circular_map, _find_circular_map_entry)
+EBPF_MAP_HELPER_FIND_ENTRY(queue_map, _find_queue_map_entry)
+EBPF_MAP_HELPER_FIND_PER_CPU_ENTRY(per_cpu_hash_map, _find_hash_map_entry)
+EBPF_MAP_HELPER_FIND_PER_CPU_ENTRY(per_cpu_array_map, _find_array_map_entry)
+EBPF_MAP_HELPER_FIND_OBJECT_ENTRY(object_hash_map, _get_object_from_hash_map_entry)
+EBPF_MAP_HELPER_FIND_OBJECT_ENTRY(object_array_map, _get_object_from_array_map_entry)
+
+static _Ret_null_ uint8_t*
+_ebpf_map_helper_find_not_supported(_Inout_ ebpf_core_map_t* map, _In_ const uint8_t* key, bool delete_on_success)
+{
+    UNREFERENCED_PARAMETER(map);
+    UNREFERENCED_PARAMETER(key);
+    UNREFERENCED_PARAMETER(delete_on_success);
+    return NULL;
+}
+
+static ebpf_result_t
+_ebpf_map_helper_update_not_supported(
+    _Inout_ ebpf_core_map_t* map, _In_ const uint8_t* key, _In_ const uint8_t* value, ebpf_map_option_t option)
+{
+    UNREFERENCED_PARAMETER(map);
+    UNREFERENCED_PARAMETER(key);
+    UNREFERENCED_PARAMETER(value);
+    UNREFERENCED_PARAMETER(option);
+    return EBPF_OPERATION_NOT_SUPPORTED;
+}
+
+static ebpf_result_t
+_ebpf_map_helper_delete_not_supported(_Inout_ ebpf_core_map_t* map, _In_ const uint8_t* key)
+{
+    UNREFERENCED_PARAMETER(map);
+    UNREFERENCED_PARAMETER(key);
+    return EBPF_OPERATION_NOT_SUPPORTED;
+}
+
 const ebpf_map_metadata_table_t ebpf_map_metadata_tables[] = {
     {
         BPF_MAP_TYPE_UNSPEC,
@@ -1974,6 +2401,7 @@ const ebpf_map_metadata_table_t ebpf_map_metadata_tables[] = {
         .find_entry = _find_hash_map_entry,
         .update_entry = _update_hash_map_entry,
         .delete_entry = _delete_hash_map_entry,
+        .helper_find_entry = _ebpf_map_helper_find_hash_map,
         .next_key_and_value = _next_hash_map_key_and_value,
     },
     {
@@ -1983,6 +2411,7 @@ const ebpf_map_metadata_table_t ebpf_map_metadata_tables[] = {
         .find_entry = _find_array_map_entry,
         .update_entry = _update_array_map_entry,
         .delete_entry = _delete_array_map_entry,
+        .helper_find_entry = _ebpf_map_helper_find_array_map,
         .next_key_and_value = _next_array_map_key_and_value,
     },
     {
@@ -2004,6 +2433,7 @@ const ebpf_map_metadata_table_t ebpf_map_metadata_tables[] = {
         .update_entry = _update_hash_map_entry,
         .update_entry_per_cpu = _update_entry_per_cpu,
         .delete_entry = _delete_hash_map_entry,
+        .helper_find_entry = _ebpf_map_helper_find_per_cpu_hash_map,
         .next_key_and_value = _next_hash_map_key_and_value,
         .per_cpu = true,
     },
@@ -2015,6 +2445,7 @@ const ebpf_map_metadata_table_t ebpf_map_metadata_tables[] = {
         .update_entry = _update_array_map_entry,
         .update_entry_per_cpu = _update_entry_per_cpu,
         .delete_entry = _delete_array_map_entry,
+        .helper_find_entry = _ebpf_map_helper_find_per_cpu_array_map,
         .next_key_and_value = _next_array_map_key_and_value,
         .per_cpu = true,
     },
@@ -2026,6 +2457,7 @@ const ebpf_map_metadata_table_t ebpf_map_metadata_tables[] = {
         .get_object_from_entry = _get_object_from_hash_map_entry,
         .update_entry_with_handle = _update_map_hash_map_entry_with_handle,
         .delete_entry = _delete_map_hash_map_entry,
+        .helper_find_entry = _ebpf_map_helper_find_object_hash_map,
         .next_key_and_value = _next_hash_map_key_and_value,
     },
     {
@@ -2036,6 +2468,7 @@ const ebpf_map_metadata_table_t ebpf_map_metadata_tables[] = {
         .get_object_from_entry = _get_object_from_array_map_entry,
         .update_entry_with_handle = _update_map_array_map_entry_with_handle,
         .delete_entry = _delete_map_array_map_entry,
+        .helper_find_entry = _ebpf_map_helper_find_object_array_map,
         .next_key_and_value = _next_array_map_key_and_value,
     },
     {
@@ -2045,6 +2478,7 @@ const ebpf_map_metadata_table_t ebpf_map_metadata_tables[] = {
         .find_entry = _find_hash_map_entry,
         .update_entry = _update_hash_map_entry,
         .delete_entry = _delete_hash_map_entry,
+        .helper_find_entry = _ebpf_map_helper_find_hash_map,
         .next_key_and_value = _next_hash_map_key_and_value,
         .key_history = true,
     },
@@ -2056,14 +2490,16 @@ const ebpf_map_metadata_table_t ebpf_map_metadata_tables[] = {
         .find_entry = _find_lpm_map_entry,
         .update_entry = _update_lpm_map_entry,
         .delete_entry = _delete_lpm_map_entry,
+        .helper_find_entry = _ebpf_map_helper_find_lpm_map,
         .next_key_and_value = _next_hash_map_key_and_value,
     },
     {
         .map_type = BPF_MAP_TYPE_QUEUE,
         .create_map = _create_queue_map,
-        .delete_map = _delete_circular_map,
-        .find_entry = _find_circular_map_entry,
-        .update_entry = _update_circular_map_entry,
+        .delete_map = _delete_queue_map,
+        .find_entry = _find_queue_map_entry,
+        .update_entry = _update_queue_map_entry,
+        .helper_find_entry = _ebpf_map_helper_find_queue_map,
         .zero_length_key = true,
     },
     {
@@ -2074,6 +2510,7 @@ const ebpf_map_metadata_table_t ebpf_map_metadata_tables[] = {
         .update_entry = _update_hash_map_entry,
         .update_entry_per_cpu = _update_entry_per_cpu,
         .delete_entry = _delete_hash_map_entry,
+        .helper_find_entry = _ebpf_map_helper_find_per_cpu_hash_map,
         .next_key_and_value = _next_hash_map_key_and_value,
         .per_cpu = true,
         .key_history = true,
@@ -2084,6 +2521,7 @@ const ebpf_map_metadata_table_t ebpf_map_metadata_tables[] = {
         .delete_map = _delete_circular_map,
         .find_entry = _find_circular_map_entry,
         .update_entry = _update_circular_map_entry,
+        .helper_find_entry = _ebpf_map_helper_find_circular_map,
         .zero_length_key = true,
     },
     {
@@ -2093,6 +2531,15 @@ const ebpf_map_metadata_table_t ebpf_map_metadata_tables[] = {
         .zero_length_key = true,
         .zero_length_value = true,
     },
+    {
+        .map_type = BPF_MAP_TYPE_BLOOM_FILTER,
+        .create_map = _create_bloom_filter_map,
+        .delete_map = _delete_bloom_filter_map,
+        .find_entry = _find_bloom_filter_map_entry,
+        .update_entry = _update_bloom_filter_map_entry,
+        .zero_length_key = true,
+        .membership_only = true,
+    },
 };
 
 static void
@@ -2142,6 +2589,10 @@ ebpf_map_create(
         result = EBPF_INVALID_ARGUMENT;
         goto Exit;
     }
+    if (ebpf_map_definition->map_extra != 0 && type != BPF_MAP_TYPE_BLOOM_FILTER) {
+        result = EBPF_INVALID_ARGUMENT;
+        goto Exit;
+    }
 
     if (ebpf_map_metadata_tables[type].per_cpu) {
         local_map_definition.value_size = cpu_count * EBPF_PAD_8(local_map_definition.value_size);
@@ -2173,6 +2624,20 @@ ebpf_map_create(
     }
 
     const ebpf_map_metadata_table_t* table = &ebpf_map_metadata_tables[local_map->ebpf_map_definition.type];
+
+    // The map type never changes, so bind the helper entry points for it now.
+    local_map->helper_find_entry =
+        (table->helper_find_entry) ? table->helper_find_entry : _ebpf_map_helper_find_not_supported;
+    if (table->update_entry_per_cpu) {
+        local_map->helper_update_entry = table->update_entry_per_cpu;
+    } else if (table->update_entry) {
+        local_map->helper_update_entry = table->update_entry;
+    } else {
+        local_map->helper_update_entry = _ebpf_map_helper_update_not_supported;
+    }
+    local_map->helper_delete_entry =
+        (table->delete_entry) ? table->delete_entry : _ebpf_map_helper_delete_not_supported;
+
     ebpf_object_get_program_type_t get_program_type = (table->get_object_from_entry) ? _get_map_program_type : NULL;
     result = EBPF_OBJECT_INITIALIZE(&local_map->object, EBPF_OBJECT_MAP, _ebpf_map_delete, NULL, get_program_type);
     if (result != EBPF_SUCCESS) {
@@ -2201,6 +2666,17 @@ ebpf_map_find_entry(
 {
     // High volume call - Skip entry/exit logging.
     uint8_t* return_value = NULL;
+    if (ebpf_map_metadata_tables[map->ebpf_map_definition.type].membership_only) {
+        // The key is the value to test for and there is no value to return.
+        if ((flags & EBPF_MAP_FLAG_HELPER) || (key_size != map->ebpf_map_definition.value_size) || (value_size != 0)) {
+            return EBPF_INVALID_ARGUMENT;
+        }
+        if (flags & EPBF_MAP_FIND_FLAG_DELETE) {
+            return EBPF_OPERATION_NOT_SUPPORTED;
+        }
+        return ebpf_map_metadata_tables[map->ebpf_map_definition.type].find_entry(map, key, false, &return_value);
+    }
+
     if (!(flags & EBPF_MAP_FLAG_HELPER) && (key_size != map->ebpf_map_definition.key_size)) {
         EBPF_LOG_MESSAGE_UINT64_UINT64(
             EBPF_TRACELOG_LEVEL_ERROR,
@@ -2267,6 +2743,28 @@ ebpf_map_find_entry(
     return EBPF_SUCCESS;
 }
 
+_Ret_maybenull_ uint8_t*
+ebpf_map_helper_find_entry(_Inout_ ebpf_map_t* map, _In_ const uint8_t* key, bool delete_on_success)
+{
+    // High volume call - Skip entry/exit logging.
+    return map->helper_find_entry(map, key, delete_on_success);
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_helper_update_entry(
+    _Inout_ ebpf_map_t* map, _In_ const uint8_t* key, _In_ const uint8_t* value, ebpf_map_option_t option)
+{
+    // High volume call - Skip entry/exit logging.
+    return map->helper_update_entry(map, key, value, option);
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_map_helper_delete_entry(_Inout_ ebpf_map_t* map, _In_ const uint8_t* key)
+{
+    // High volume call - Skip entry/exit logging.
+    return map->helper_delete_entry(map, key);
+}
+
 _Must_inspect_result_ ebpf_result_t
 ebpf_map_associate_program(_Inout_ ebpf_map_t* map, _In_ const ebpf_program_t* program)
 {
@@ -2459,13 +2957,14 @@ ebpf_map_get_info(
     // High volume call - Skip entry/exit logging.
     struct bpf_map_info* info = (struct bpf_map_info*)buffer;
 
-    if (*info_size < sizeof(*info)) {
+    // Callers built before map_extra was added pass a buffer that ends just before it.
+    if (*info_size < EBPF_OFFSET_OF(struct bpf_map_info, map_extra)) {
         EBPF_LOG_MESSAGE_UINT64_UINT64(
             EBPF_TRACELOG_LEVEL_ERROR,
             EBPF_TRACELOG_KEYWORD_MAP,
             "ebpf_map_get_info buffer too small",
             *info_size,
-            sizeof(*info));
+            EBPF_OFFSET_OF(struct bpf_map_info, map_extra));
         return EBPF_INSUFFICIENT_BUFFER;
     }
 
@@ -2486,7 +2985,12 @@ ebpf_map_get_info(
     info->pinned_path_count = map->object.pinned_path_count;
     strncpy_s(info->name, sizeof(info->name), (char*)map->name.value, map->name.length);
 
-    *info_size = sizeof(*info);
+    if (*info_size >= sizeof(*info)) {
+        info->map_extra = map->ebpf_map_definition.map_extra;
+        *info_size = sizeof(*info);
+    } else {
+        *info_size = (uint16_t)EBPF_OFFSET_OF(struct bpf_map_info, map_extra);
+    }
     return EBPF_SUCCESS;
 }
 
@@ -2537,7 +3041,7 @@ ebpf_map_pop_entry(_Inout_ ebpf_map_t* map, size_t value_size, _Out_writes_(valu
 }
 
 _Must_inspect_result_ ebpf_result_t
-ebpf_map_peek_entry(_Inout_ ebpf_map_t* map, size_t value_size, _Out_writes_(value_size) uint8_t* value, int flags)
+ebpf_map_peek_entry(_Inout_ ebpf_map_t* map, size_t value_size, _Inout_updates_(value_size) uint8_t* value, int flags)
 {
     uint8_t* return_value;
     if (!(flags & EBPF_MAP_FLAG_HELPER) && (value_size != map->ebpf_map_definition.value_size)) {
@@ -2553,6 +3057,11 @@ ebpf_map_peek_entry(_Inout_ ebpf_map_t* map, size_t value_size, _Out_writes_(val
         return EBPF_OPERATION_NOT_SUPPORTED;
     }
 
+    if (ebpf_map_metadata_tables[map->ebpf_map_definition.type].membership_only) {
+        // Test whether the value is a member of the map rather than copying a value out.
+        return ebpf_map_metadata_tables[map->ebpf_map_definition.type].find_entry(map, value, false, &return_value);
+    }
+
     ebpf_result_t result =
         ebpf_map_metadata_tables[map->ebpf_map_definition.type].find_entry(map, NULL, false, &return_value);
     if (result != EBPF_SUCCESS) {
@@ -2569,6 +3078,56 @@ ebpf_map_get_id(_In_ const ebpf_map_t* map)
     return map->object.id;
 }
 
+/**
+ * @brief Pop as many values as fit in the output buffer from a map without keys, such as a queue or stack.
+ *
+ * @param[in, out] map Map to pop values from.
+ * @param[in, out] value_length On input, the size of the output buffer. On output, the number of bytes written.
+ * @param[out] values Buffer that receives the concatenated values.
+ * @param[in] flags EPBF_MAP_FIND_FLAG_DELETE must be set, as the values can only be read by removing them.
+ * @retval EBPF_SUCCESS At least one value was popped.
+ * @retval EBPF_NO_MORE_KEYS The map is empty.
+ * @retval EBPF_OPERATION_NOT_SUPPORTED EPBF_MAP_FIND_FLAG_DELETE was not set.
+ */
+static ebpf_result_t
+_ebpf_map_pop_entry_batch(
+    _Inout_ ebpf_map_t* map,
+    _Inout_ size_t* value_length,
+    _Out_writes_bytes_to_(*value_length, *value_length) uint8_t* values,
+    int flags)
+{
+    ebpf_result_t result = EBPF_SUCCESS;
+    size_t value_size = map->ebpf_map_definition.value_size;
+    size_t output_length = 0;
+
+    if (!(flags & EPBF_MAP_FIND_FLAG_DELETE)) {
+        EBPF_LOG_MESSAGE_UINT64(
+            EBPF_TRACELOG_LEVEL_ERROR,
+            EBPF_TRACELOG_KEYWORD_MAP,
+            "ebpf_map_get_next_key_and_value_batch without delete not supported on map",
+            map->ebpf_map_definition.type);
+        return EBPF_OPERATION_NOT_SUPPORTED;
+    }
+
+    while ((output_length + value_size) <= *value_length) {
+        uint8_t* value = NULL;
+        result = ebpf_map_metadata_tables[map->ebpf_map_definition.type].find_entry(map, NULL, true, &value);
+        if (result != EBPF_SUCCESS) {
+            break;
+        }
+        memcpy(values + output_length, value, value_size);
+        output_length += value_size;
+    }
+
+    if (result == EBPF_OBJECT_NOT_FOUND) {
+        // The map has been drained.
+        result = (output_length != 0) ? EBPF_SUCCESS : EBPF_NO_MORE_KEYS;
+    }
+
+    *value_length = output_length;
+    return result;
+}
+
 _Must_inspect_result_ ebpf_result_t
 ebpf_map_get_next_key_and_value_batch(
     _Inout_ ebpf_map_t* map,
@@ -2584,6 +3143,12 @@ ebpf_map_get_next_key_and_value_batch(
     size_t output_length = 0;
     size_t maximum_output_length = *key_and_value_length;
 
+    if (ebpf_map_metadata_tables[map->ebpf_map_definition.type].zero_length_key &&
+        !ebpf_map_metadata_tables[map->ebpf_map_definition.type].membership_only &&
+        ebpf_map_metadata_tables[map->ebpf_map_definition.type].find_entry != NULL) {
+        return _ebpf_map_pop_entry_batch(map, key_and_value_length, key_and_value, flags);
+    }
+
     if (ebpf_map_metadata_tables[map->ebpf_map_definition.type].next_key_and_value == NULL) {
         EBPF_LOG_MESSAGE_UINT64(
             EBPF_TRACELOG_LEVEL_ERROR,
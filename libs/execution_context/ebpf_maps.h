@@ -94,6 +94,47 @@ extern "C"
         ebpf_map_option_t option,
         int flags);
 
+    /**
+     * @brief Get a pointer to an entry in the map on behalf of an eBPF program.
+     * This calls the entry point specialized for the map type when the map was
+     * created, and skips the argument checks of ebpf_map_find_entry.
+     *
+     * @param[in, out] map Map to search and update metadata in.
+     * @param[in] key Key to search for, of the map's key size.
+     * @param[in] delete_on_success Remove the entry if found.
+     * @returns Pointer to the value of the current CPU if found or NULL.
+     */
+    _Ret_maybenull_ uint8_t*
+    ebpf_map_helper_find_entry(_Inout_ ebpf_map_t* map, _In_ const uint8_t* key, bool delete_on_success);
+
+    /**
+     * @brief Insert or update an entry in the map on behalf of an eBPF program.
+     * For per-CPU maps, only the value of the current CPU is updated.
+     *
+     * @param[in, out] map Map to update.
+     * @param[in] key Key to use when searching and updating the map.
+     * @param[in] value Value to insert into the map, of the map's value size.
+     * @param[in] option One of ebpf_map_option_t options.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_NO_MEMORY Unable to allocate resources for this entry.
+     * @retval EBPF_OPERATION_NOT_SUPPORTED The map type doesn't support updates from programs.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_map_helper_update_entry(
+        _Inout_ ebpf_map_t* map, _In_ const uint8_t* key, _In_ const uint8_t* value, ebpf_map_option_t option);
+
+    /**
+     * @brief Remove an entry from the map on behalf of an eBPF program.
+     *
+     * @param[in, out] map Map to update.
+     * @param[in] key Key to use when searching and updating the map.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_KEY_NOT_FOUND The key was not found in the map.
+     * @retval EBPF_OPERATION_NOT_SUPPORTED The map type doesn't support deletes.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_map_helper_delete_entry(_Inout_ ebpf_map_t* map, _In_ const uint8_t* key);
+
     /**
      * @brief Insert or update an entry in the map.
      *
@@ -180,7 +221,8 @@ extern "C"
      * On output, the number of bytes actually written.
      *
      * @retval EBPF_SUCCESS The operation was successful.
-     * @retval EBPF_INSUFFICIENT_BUFFER The buffer was too small to hold bpf_map_info.
+     * @retval EBPF_INSUFFICIENT_BUFFER The buffer was too small to hold bpf_map_info up to map_extra, which is only
+     * written if the buffer holds it.
      */
     _Must_inspect_result_ ebpf_result_t
     ebpf_map_get_info(
@@ -270,18 +312,21 @@ extern "C"
     ebpf_map_pop_entry(_Inout_ ebpf_map_t* map, size_t value_size, _Out_writes_(value_size) uint8_t* value, int flags);
 
     /**
-     * @brief Copy an entry from the map (only valid for stack and queue).
+     * @brief Copy an entry from the map (only valid for stack, queue and bloom filter).
      * Queue peeks at the beginning of the map.
      * Stack peeks at the end of the map.
+     * Bloom filter tests whether the value is in the map and leaves it unmodified.
      *
      * @param[in, out] map Map to search and update metadata on.
      * @param[in] value_size Size of the value buffer to copy value from map into.
-     * @param[out] value Value buffer to copy value from map into.
+     * @param[in, out] value Value buffer to copy value from map into, or the value to test for.
      * @retval EBPF_SUCCESS The operation was successful.
      * @retval EBPF_OBJECT_NOT_FOUND The map is empty.
+     * @retval EBPF_KEY_NOT_FOUND The value is not in the bloom filter.
      */
     _Must_inspect_result_ ebpf_result_t
-    ebpf_map_peek_entry(_Inout_ ebpf_map_t* map, size_t value_size, _Out_writes_(value_size) uint8_t* value, int flags);
+    ebpf_map_peek_entry(
+        _Inout_ ebpf_map_t* map, size_t value_size, _Inout_updates_(value_size) uint8_t* value, int flags);
 
     /**
      * @brief Get the ID of a given map.
@@ -294,6 +339,8 @@ extern "C"
 
     /**
      * @brief Copy keys and values from the map to the caller provided buffer.
+     * For maps without keys, such as queue and stack, values are popped in order
+     * and only the values are written. This requires EPBF_MAP_FIND_FLAG_DELETE.
      *
      * @param[in, out] map Map to search and update metadata on.
      * @param[in] previous_key_length The length of the previous key.
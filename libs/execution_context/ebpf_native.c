@@ -91,6 +91,13 @@ typedef struct _ebpf_native_module
     ebpf_list_entry_t list_entry;
     cxplat_preemptible_work_item_t* cleanup_work_item;
     ebpf_native_handle_cleanup_context_t handle_cleanup_context;
+    struct _ebpf_native_module* parent; // Module this is an instance of. NULL for modules bound through NMR.
+    // Per-instance copies of the map and program tables. Only used for instanced modules.
+    map_entry_t* instance_maps;
+    size_t instance_map_count;
+    program_entry_t* instance_programs;
+    size_t instance_program_count;
+    program_runtime_context_t* runtime_contexts;
 } ebpf_native_module_t;
 
 static const GUID _ebpf_native_npi_id = {/* c847aac8-a6f2-4b53-aea3-f4a94b9a80cb */
@@ -254,6 +261,135 @@ _ebpf_native_clean_up_programs(
     ebpf_free(programs);
 }
 
+/**
+ * @brief Free the per-instance map and program tables of an instanced module.
+ * @param[in,out] module The module to free the tables for.
+ */
+static void
+_ebpf_native_free_instance_tables(_Inout_ ebpf_native_module_t* module)
+{
+    for (size_t i = 0; i < module->instance_program_count; i++) {
+        ebpf_free(module->instance_programs[i].helpers);
+    }
+    ebpf_free(module->instance_programs);
+    ebpf_free(module->instance_maps);
+    ebpf_free(module->runtime_contexts);
+
+    module->instance_programs = NULL;
+    module->instance_program_count = 0;
+    module->instance_maps = NULL;
+    module->instance_map_count = 0;
+    module->runtime_contexts = NULL;
+}
+
+/**
+ * @brief Create the per-instance map and program tables of an instanced module.
+ *
+ * Each instance gets its own copy of the map entries and of the helper entries of every program, so map and helper
+ * addresses resolved for one instance are never seen by another. The generated code is shared and finds the tables
+ * through the runtime context passed to each program.
+ *
+ * @param[in,out] module The module to create the tables for.
+ * @retval EBPF_SUCCESS The operation was successful.
+ * @retval EBPF_NO_MEMORY Unable to allocate resources for this operation.
+ */
+static ebpf_result_t
+_ebpf_native_create_instance_tables(_Inout_ ebpf_native_module_t* module)
+{
+    ebpf_result_t result = EBPF_SUCCESS;
+    map_entry_t* maps = NULL;
+    size_t map_count = 0;
+    program_entry_t* programs = NULL;
+    size_t program_count = 0;
+
+    module->table.maps(&maps, &map_count);
+    module->table.programs(&programs, &program_count);
+
+    if (map_count > 0) {
+        module->instance_maps = ebpf_allocate_with_tag(map_count * sizeof(map_entry_t), EBPF_POOL_TAG_NATIVE);
+        if (module->instance_maps == NULL) {
+            result = EBPF_NO_MEMORY;
+            goto Done;
+        }
+        memcpy(module->instance_maps, maps, map_count * sizeof(map_entry_t));
+        module->instance_map_count = map_count;
+    }
+
+    if (program_count > 0) {
+        module->instance_programs =
+            ebpf_allocate_with_tag(program_count * sizeof(program_entry_t), EBPF_POOL_TAG_NATIVE);
+        if (module->instance_programs == NULL) {
+            result = EBPF_NO_MEMORY;
+            goto Done;
+        }
+        module->instance_program_count = program_count;
+
+        module->runtime_contexts =
+            ebpf_allocate_with_tag(program_count * sizeof(program_runtime_context_t), EBPF_POOL_TAG_NATIVE);
+        if (module->runtime_contexts == NULL) {
+            result = EBPF_NO_MEMORY;
+            goto Done;
+        }
+    }
+
+    for (size_t i = 0; i < program_count; i++) {
+        program_entry_t* program = &module->instance_programs[i];
+        *program = programs[i];
+        program->helpers = NULL;
+        if (programs[i].helper_count > 0) {
+            program->helpers = ebpf_allocate_with_tag(
+                programs[i].helper_count * sizeof(helper_function_entry_t), EBPF_POOL_TAG_NATIVE);
+            if (program->helpers == NULL) {
+                result = EBPF_NO_MEMORY;
+                goto Done;
+            }
+            memcpy(program->helpers, programs[i].helpers, programs[i].helper_count * sizeof(helper_function_entry_t));
+        }
+        module->runtime_contexts[i].helpers = program->helpers;
+        module->runtime_contexts[i].maps = module->instance_maps;
+    }
+
+Done:
+    if (result != EBPF_SUCCESS) {
+        _ebpf_native_free_instance_tables(module);
+    }
+    return result;
+}
+
+/**
+ * @brief Get the map entries to create maps for. Instanced modules use their own copy of the table.
+ */
+static void
+_ebpf_native_get_map_entries(
+    _In_ const ebpf_native_module_t* module,
+    _Outptr_result_buffer_maybenull_(*count) map_entry_t** maps,
+    _Out_ size_t* count)
+{
+    if (module->table.instanced) {
+        *maps = module->instance_maps;
+        *count = module->instance_map_count;
+    } else {
+        module->table.maps(maps, count);
+    }
+}
+
+/**
+ * @brief Get the program entries to load programs from. Instanced modules use their own copy of the table.
+ */
+static void
+_ebpf_native_get_program_entries(
+    _In_ const ebpf_native_module_t* module,
+    _Outptr_result_buffer_maybenull_(*count) program_entry_t** programs,
+    _Out_ size_t* count)
+{
+    if (module->table.instanced) {
+        *programs = module->instance_programs;
+        *count = module->instance_program_count;
+    } else {
+        module->table.programs(programs, count);
+    }
+}
+
 /**
  * @brief Free all state for a given module.
  * @param[in] module The module to free.
@@ -263,6 +399,7 @@ _ebpf_native_clean_up_module(_In_ _Post_invalid_ ebpf_native_module_t* module)
 {
     _ebpf_native_clean_up_maps(module->maps, module->map_count, false, true);
     _ebpf_native_clean_up_programs(module->programs, module->program_count, true);
+    _ebpf_native_free_instance_tables(module);
 
     module->maps = NULL;
     module->map_count = 0;
@@ -349,6 +486,13 @@ ebpf_native_release_reference(_In_opt_ _Post_invalid_ ebpf_native_module_t* modu
         __fastfail(FAST_FAIL_INVALID_REFERENCE_COUNT);
     }
 
+    if (new_ref_count == 1 && module->parent != NULL && !module->detaching) {
+        // All handle and program references to the instance have been released. There is no driver to unload for
+        // an instance, so release the "instance" reference as well.
+        module->detaching = true;
+        new_ref_count = --module->base.reference_count;
+    }
+
     if (new_ref_count == 1) {
         // Check if all the program references have been released. If that
         // is the case, explicitly unload the driver, if it is safe to do so.
@@ -376,17 +520,31 @@ ebpf_native_release_reference(_In_opt_ _Post_invalid_ ebpf_native_module_t* modu
             ebpf_hash_table_delete(_ebpf_native_client_table, (const uint8_t*)&module->client_module_id));
         ebpf_lock_unlock(&_ebpf_native_client_table_lock, state);
 
-        EBPF_LOG_MESSAGE_GUID(
-            EBPF_TRACELOG_LEVEL_INFO,
-            EBPF_TRACELOG_KEYWORD_NATIVE,
-            "ebpf_native_release_reference: ref is 0, complete detach callback",
-            &module->client_module_id);
+        if (module->parent != NULL) {
+            ebpf_native_module_t* parent = module->parent;
+
+            EBPF_LOG_MESSAGE_GUID(
+                EBPF_TRACELOG_LEVEL_INFO,
+                EBPF_TRACELOG_KEYWORD_NATIVE,
+                "ebpf_native_release_reference: ref is 0, free instance",
+                &module->client_module_id);
+
+            // Clean up the instance and release its reference on the module it was created from.
+            _ebpf_native_clean_up_module(module);
+            ebpf_native_release_reference(parent);
+        } else {
+            EBPF_LOG_MESSAGE_GUID(
+                EBPF_TRACELOG_LEVEL_INFO,
+                EBPF_TRACELOG_KEYWORD_NATIVE,
+                "ebpf_native_release_reference: ref is 0, complete detach callback",
+                &module->client_module_id);
 
-        // All references to the module have been released. Safe to complete the detach callback.
-        NmrProviderDetachClientComplete(module->nmr_binding_handle);
+            // All references to the module have been released. Safe to complete the detach callback.
+            NmrProviderDetachClientComplete(module->nmr_binding_handle);
 
-        // Clean up the native module.
-        _ebpf_native_clean_up_module(module);
+            // Clean up the native module.
+            _ebpf_native_clean_up_module(module);
+        }
     }
 
     if (lock_acquired) {
@@ -974,7 +1132,7 @@ _ebpf_native_create_maps(_Inout_ ebpf_native_module_t* module)
     ebpf_map_definition_in_memory_t map_definition = {0};
 
     // Get the maps
-    module->table.maps(&maps, &map_count);
+    _ebpf_native_get_map_entries(module, &maps, &map_count);
     if (map_count == 0) {
         EBPF_RETURN_RESULT(EBPF_SUCCESS);
     }
@@ -1232,7 +1390,7 @@ _ebpf_native_load_programs(_Inout_ ebpf_native_module_t* module)
     uint8_t* hash_type_name = NULL;
 
     // Get the programs.
-    module->table.programs(&programs, &program_count);
+    _ebpf_native_get_program_entries(module, &programs, &program_count);
     if (program_count == 0 || programs == NULL) {
         return EBPF_INVALID_OBJECT;
     }
@@ -1347,6 +1505,11 @@ _ebpf_native_load_programs(_Inout_ ebpf_native_module_t* module)
             break;
         }
 
+        if (module->table.instanced) {
+            // Programs in instanced modules find their maps and helpers through the runtime context.
+            ebpf_program_set_native_runtime_context(program_object, &module->runtime_contexts[count]);
+        }
+
         result = ebpf_program_register_for_helper_changes(program_object, _ebpf_native_helper_address_changed, context);
 
         EBPF_OBJECT_RELEASE_REFERENCE((ebpf_core_object_t*)program_object);
@@ -1612,6 +1775,16 @@ ebpf_native_load(
     module->state = MODULE_STATE_INITIALIZING;
     ebpf_lock_unlock(&module->lock, state);
 
+    if (module->table.instanced) {
+        result = _ebpf_native_create_instance_tables(module);
+        if (result != EBPF_SUCCESS) {
+            state = ebpf_lock_lock(&module->lock);
+            module->state = MODULE_STATE_UNINITIALIZED;
+            ebpf_lock_unlock(&module->lock, state);
+            goto Done;
+        }
+    }
+
     // Create handle for the native module. This should be the last step in initialization which can fail.
     // Else, we can have a case where the same thread enters epoch recursively.
     result = ebpf_handle_create(&local_module_handle, (ebpf_base_object_t*)module);
@@ -1656,6 +1829,160 @@ Done:
     EBPF_RETURN_RESULT(result);
 }
 
+_Must_inspect_result_ ebpf_result_t
+ebpf_native_load_instance(
+    _In_ const GUID* module_id,
+    _In_ const GUID* instance_id,
+    _Out_ ebpf_handle_t* instance_handle,
+    _Out_ size_t* count_of_maps,
+    _Out_ size_t* count_of_programs)
+{
+    EBPF_LOG_ENTRY();
+    ebpf_result_t result;
+    ebpf_lock_state_t hash_table_state = 0;
+    ebpf_lock_state_t state = 0;
+    bool table_lock_acquired = false;
+    bool instance_inserted = false;
+    ebpf_native_module_t* parent = NULL;
+    ebpf_native_module_t** existing_module = NULL;
+    ebpf_native_module_t** existing_instance = NULL;
+    ebpf_native_module_t* instance = NULL;
+    ebpf_handle_t local_instance_handle = ebpf_handle_invalid;
+
+    instance = ebpf_allocate_with_tag(sizeof(ebpf_native_module_t), EBPF_POOL_TAG_NATIVE);
+    if (instance == NULL) {
+        result = EBPF_NO_MEMORY;
+        goto Done;
+    }
+    ebpf_lock_create(&instance->lock);
+
+    // Find the module to create the instance from.
+    hash_table_state = ebpf_lock_lock(&_ebpf_native_client_table_lock);
+    table_lock_acquired = true;
+    result = ebpf_hash_table_find(_ebpf_native_client_table, (const uint8_t*)module_id, (uint8_t**)&existing_module);
+    if (result != EBPF_SUCCESS) {
+        result = EBPF_OBJECT_NOT_FOUND;
+        EBPF_LOG_MESSAGE_GUID(
+            EBPF_TRACELOG_LEVEL_ERROR,
+            EBPF_TRACELOG_KEYWORD_NATIVE,
+            "ebpf_native_load_instance: module not found",
+            module_id);
+        goto Done;
+    }
+    parent = *existing_module;
+    if (ebpf_hash_table_find(_ebpf_native_client_table, (const uint8_t*)instance_id, (uint8_t**)&existing_instance) ==
+        EBPF_SUCCESS) {
+        result = EBPF_OBJECT_ALREADY_EXISTS;
+        EBPF_LOG_MESSAGE_GUID(
+            EBPF_TRACELOG_LEVEL_ERROR,
+            EBPF_TRACELOG_KEYWORD_NATIVE,
+            "ebpf_native_load_instance: instance already exists",
+            instance_id);
+        parent = NULL;
+        goto Done;
+    }
+
+    state = ebpf_lock_lock(&parent->lock);
+    if (parent->detaching || parent->state == MODULE_STATE_UNLOADING) {
+        // This client is detaching / unloading.
+        result = EBPF_EXTENSION_FAILED_TO_LOAD;
+    } else if (parent->parent != NULL || parent->state < MODULE_STATE_INITIALIZED) {
+        // Instances can only be created from a module whose driver has been loaded with ebpf_native_load.
+        result = EBPF_INVALID_ARGUMENT;
+    } else if (!parent->table.instanced) {
+        // The generated code refers to the static map and helper tables, which only one instance can own.
+        result = EBPF_OPERATION_NOT_SUPPORTED;
+    } else {
+        // The instance holds a reference on the module it was created from, so the driver stays loaded until all
+        // instances have been freed.
+        _ebpf_native_acquire_reference_under_lock(parent);
+        result = EBPF_SUCCESS;
+    }
+    ebpf_lock_unlock(&parent->lock, state);
+    if (result != EBPF_SUCCESS) {
+        EBPF_LOG_MESSAGE_GUID(
+            EBPF_TRACELOG_LEVEL_ERROR,
+            EBPF_TRACELOG_KEYWORD_NATIVE,
+            "ebpf_native_load_instance: module cannot be instantiated",
+            module_id);
+        parent = NULL;
+        goto Done;
+    }
+
+    memcpy(&instance->table, &parent->table, sizeof(metadata_table_t));
+    instance->base.marker = _ebpf_native_marker;
+    instance->base.acquire_reference = _ebpf_native_acquire_reference_internal;
+    instance->base.release_reference = _ebpf_native_release_reference_internal;
+    // Acquire "instance" reference. Released once all handle and program references to the instance are released.
+    instance->base.reference_count = 1;
+    instance->client_module_id = *instance_id;
+    instance->state = MODULE_STATE_INITIALIZING;
+    instance->parent = parent;
+
+    result = _ebpf_native_create_instance_tables(instance);
+    if (result != EBPF_SUCCESS) {
+        goto Done;
+    }
+
+    result = ebpf_hash_table_update(
+        _ebpf_native_client_table,
+        (const uint8_t*)instance_id,
+        (const uint8_t*)&instance,
+        EBPF_HASH_TABLE_OPERATION_INSERT);
+    if (result != EBPF_SUCCESS) {
+        goto Done;
+    }
+    instance_inserted = true;
+    ebpf_lock_unlock(&_ebpf_native_client_table_lock, hash_table_state);
+    table_lock_acquired = false;
+
+    // Create handle for the instance. This should be the last step in initialization which can fail.
+    result = ebpf_handle_create(&local_instance_handle, (ebpf_base_object_t*)instance);
+    if (result != EBPF_SUCCESS) {
+        EBPF_LOG_MESSAGE_GUID(
+            EBPF_TRACELOG_LEVEL_ERROR,
+            EBPF_TRACELOG_KEYWORD_NATIVE,
+            "ebpf_native_load_instance: Failed to create handle.",
+            instance_id);
+        goto Done;
+    }
+
+    state = ebpf_lock_lock(&instance->lock);
+    instance->state = MODULE_STATE_INITIALIZED;
+    ebpf_lock_unlock(&instance->lock, state);
+
+    *count_of_maps = instance->instance_map_count;
+    *count_of_programs = instance->instance_program_count;
+    *instance_handle = local_instance_handle;
+    instance = NULL;
+    parent = NULL;
+
+Done:
+    if (instance != NULL) {
+        if (instance_inserted) {
+            if (!table_lock_acquired) {
+                hash_table_state = ebpf_lock_lock(&_ebpf_native_client_table_lock);
+                table_lock_acquired = true;
+            }
+            ebpf_assert_success(ebpf_hash_table_delete(_ebpf_native_client_table, (const uint8_t*)instance_id));
+        }
+    }
+    if (table_lock_acquired) {
+        ebpf_lock_unlock(&_ebpf_native_client_table_lock, hash_table_state);
+        table_lock_acquired = false;
+    }
+    if (instance != NULL) {
+        _ebpf_native_free_instance_tables(instance);
+        ebpf_lock_destroy(&instance->lock);
+        ebpf_free(instance);
+    }
+    if (parent != NULL) {
+        ebpf_native_release_reference(parent);
+    }
+
+    EBPF_RETURN_RESULT(result);
+}
+
 _Must_inspect_result_ ebpf_result_t
 ebpf_native_load_programs(
     _In_ const GUID* module_id,
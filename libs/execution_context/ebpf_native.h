@@ -56,6 +56,38 @@ extern "C"
         _Out_ size_t* count_of_maps,
         _Out_ size_t* count_of_programs);
 
+    /**
+     * @brief Create a new instance of a native module whose driver is already loaded.
+     *  The instance shares the module's code but gets its own map and helper tables,
+     *  so ebpf_native_load_programs can be called with instance_id to create an
+     *  independent set of maps and programs without loading the driver again.
+     *
+     * @param[in] module_id Identifier of the loaded native eBPF module.
+     * @param[in] instance_id Identifier to assign to the new instance.
+     * @param[out] instance_handle Handle to the new instance.
+     * @param[out] count_of_maps Count of maps in the native module.
+     * @param[out] count_of_programs Count of programs in the native module.
+     *
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_NO_MEMORY Unable to allocate resources for this
+     *  operation.
+     * @retval EBPF_OBJECT_NOT_FOUND Native module for that module ID not found.
+     * @retval EBPF_OBJECT_ALREADY_EXISTS A module or instance with that instance ID
+     *  already exists.
+     * @retval EBPF_INVALID_ARGUMENT The module has not been loaded or is itself an
+     *  instance.
+     * @retval EBPF_OPERATION_NOT_SUPPORTED The module was not generated with
+     *  bpf2c --instanced.
+     * @retval EBPF_EXTENSION_FAILED_TO_LOAD The module is unloading.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_native_load_instance(
+        _In_ const GUID* module_id,
+        _In_ const GUID* instance_id,
+        _Out_ ebpf_handle_t* instance_handle,
+        _Out_ size_t* count_of_maps,
+        _Out_ size_t* count_of_programs);
+
     /**
      * @brief Load programs, create maps and resolve map and helper addresses for
      *  already loaded native module.
@@ -48,6 +48,8 @@ typedef struct _ebpf_program
         {
             const ebpf_native_module_binding_context_t* module;
             const uint8_t* code_pointer;
+            // Set for programs from instanced modules, which take the runtime context as a second argument.
+            const program_runtime_context_t* runtime_context;
         } native;
     } code_or_vm;
 
@@ -63,6 +65,10 @@ typedef struct _ebpf_program
     const ebpf_extension_data_t* general_helper_provider_data;
     const ebpf_extension_data_t* info_extension_provider_data;
 
+    // Set once the program information provider is attached, cleared when it starts detaching. Links read this
+    // within an epoch instead of taking a rundown reference per invocation.
+    volatile bool providers_attached;
+
     bpf_prog_type_t bpf_prog_type;
 
     // Program type specific helper function count.
@@ -512,6 +518,8 @@ _ebpf_program_type_specific_program_information_attach_provider(
         goto Done;
     }
 
+    program->providers_attached = true;
+
 Done:
     ebpf_free(hash);
     ebpf_free(hash_algorithm.value);
@@ -528,9 +536,20 @@ _ebpf_program_type_specific_program_information_detach_provider(void* client_bin
 {
     ebpf_program_t* program = (ebpf_program_t*)client_binding_context;
 
+    ebpf_lock_state_t state = ebpf_lock_lock(&program->lock);
+    program->providers_attached = false;
+    bool links_attached = program->link_count > 0;
+    ebpf_lock_unlock(&program->lock, state);
+
+    // Links check providers_attached within their epoch, so wait for any invocation that saw the providers attached
+    // to leave its epoch. There are no links left when the program is being freed.
+    if (links_attached) {
+        ebpf_epoch_synchronize();
+    }
+
     ExWaitForRundownProtectionRelease(&program->program_information_rundown_reference);
 
-    ebpf_lock_state_t state = ebpf_lock_lock(&program->lock);
+    state = ebpf_lock_lock(&program->lock);
     program->info_extension_provider_data = NULL;
     ebpf_lock_unlock(&program->lock, state);
     return STATUS_SUCCESS;
@@ -643,6 +662,15 @@ _IRQL_requires_max_(PASSIVE_LEVEL) static void _ebpf_program_free(_In_opt_ _Post
 
     ebpf_free_trampoline_table(program->trampoline_table);
 
+    // Don't keep the bpf_printk format strings of a program that is no longer loaded.
+    for (size_t index = 0; index < program->helper_function_count; index++) {
+        uint32_t helper_id = program->helper_function_ids[index];
+        if (helper_id >= BPF_FUNC_trace_printk2 && helper_id <= BPF_FUNC_trace_printk5) {
+            ebpf_core_release_printk_formats();
+            break;
+        }
+    }
+
     ebpf_free(program->helper_function_ids);
 
     ebpf_free(program);
@@ -1387,6 +1415,12 @@ ebpf_program_dereference_providers(_Inout_ ebpf_program_t* program)
     ExReleaseRundownProtection(&program->program_information_rundown_reference);
 }
 
+bool
+ebpf_program_are_providers_attached(_In_ const ebpf_program_t* program)
+{
+    return program->providers_attached;
+}
+
 void
 ebpf_program_invoke(
     _In_ const ebpf_program_t* program,
@@ -1403,9 +1437,17 @@ ebpf_program_invoke(
 
         if (current_program->parameters.code_type == EBPF_CODE_JIT ||
             current_program->parameters.code_type == EBPF_CODE_NATIVE) {
-            ebpf_program_entry_point_t function_pointer;
-            function_pointer = (ebpf_program_entry_point_t)(current_program->code_or_vm.code.code_pointer);
-            *result = (function_pointer)(context);
+            if (current_program->parameters.code_type == EBPF_CODE_NATIVE &&
+                current_program->code_or_vm.native.runtime_context != NULL) {
+                ebpf_program_instanced_entry_point_t function_pointer;
+                function_pointer =
+                    (ebpf_program_instanced_entry_point_t)(current_program->code_or_vm.native.code_pointer);
+                *result = (function_pointer)(context, current_program->code_or_vm.native.runtime_context);
+            } else {
+                ebpf_program_entry_point_t function_pointer;
+                function_pointer = (ebpf_program_entry_point_t)(current_program->code_or_vm.code.code_pointer);
+                *result = (function_pointer)(context);
+            }
         } else {
 #if !defined(CONFIG_BPF_INTERPRETER_DISABLED)
             uint64_t out_value;
@@ -2392,6 +2434,14 @@ ebpf_program_register_for_helper_changes(
     return EBPF_SUCCESS;
 }
 
+void
+ebpf_program_set_native_runtime_context(
+    _Inout_ ebpf_program_t* program, _In_ const program_runtime_context_t* runtime_context)
+{
+    ebpf_assert(program->parameters.code_type == EBPF_CODE_NATIVE);
+    program->code_or_vm.native.runtime_context = runtime_context;
+}
+
 _Must_inspect_result_ ebpf_result_t
 ebpf_program_get_program_file_name(_In_ const ebpf_program_t* program, _Out_ cxplat_utf8_string_t* file_name)
 {
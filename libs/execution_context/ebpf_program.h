@@ -43,6 +43,8 @@ extern "C"
     } ebpf_program_parameters_t;
 
     typedef ebpf_result_t (*ebpf_program_entry_point_t)(void* context);
+    typedef ebpf_result_t (*ebpf_program_instanced_entry_point_t)(
+        void* context, const struct _program_runtime_context* runtime_context);
 
     /**
      * @brief Initialize global state for the ebpf program module.
@@ -384,6 +386,17 @@ extern "C"
         _In_opt_ ebpf_helper_function_addresses_changed_callback_t callback,
         _In_opt_ void* context);
 
+    /**
+     * @brief Set the runtime context passed to a native program from an instanced module. Must be called after the
+     * code is loaded and before the program can be invoked.
+     *
+     * @param[in, out] program Program to set the runtime context on.
+     * @param[in] runtime_context Runtime context of the program. Must remain valid until the program is freed.
+     */
+    void
+    ebpf_program_set_native_runtime_context(
+        _Inout_ ebpf_program_t* program, _In_ const struct _program_runtime_context* runtime_context);
+
     /**
      * @brief Acquire a reference to the program information provider.
      *
@@ -402,6 +415,17 @@ extern "C"
     void
     ebpf_program_dereference_providers(_Inout_ ebpf_program_t* program);
 
+    /**
+     * @brief Check whether the program information provider is attached. Must be called within an epoch; the
+     * provider does not finish detaching until every epoch that could have observed it attached has exited.
+     *
+     * @param[in] program Program to check.
+     * @retval true The provider is attached.
+     * @retval false The provider is not attached or is detaching.
+     */
+    bool
+    ebpf_program_are_providers_attached(_In_ const ebpf_program_t* program);
+
     /**
      * @brief Get the ebpf_state index assigned to the program module.
      *
@@ -45,6 +45,8 @@ typedef enum _ebpf_operation_id
     EBPF_OPERATION_MAP_UPDATE_ELEMENT_BATCH,
     EBPF_OPERATION_MAP_DELETE_ELEMENT_BATCH,
     EBPF_OPERATION_MAP_GET_NEXT_KEY_VALUE_BATCH,
+    EBPF_OPERATION_LOAD_NATIVE_MODULE_INSTANCE,
+    EBPF_OPERATION_GET_NEXT_PINNED_PATH,
 } ebpf_operation_id_t;
 
 typedef enum _ebpf_code_type
@@ -341,6 +343,20 @@ typedef struct _ebpf_operation_get_next_pinned_program_path_reply
     uint8_t next_path[1];
 } ebpf_operation_get_next_pinned_program_path_reply_t;
 
+typedef struct _ebpf_operation_get_next_pinned_path_request
+{
+    struct _ebpf_operation_header header;
+    uint16_t prefix_length;
+    // Data is the prefix followed by the start path.
+    uint8_t data[1];
+} ebpf_operation_get_next_pinned_path_request_t;
+
+typedef struct _ebpf_operation_get_next_pinned_path_reply
+{
+    struct _ebpf_operation_header header;
+    uint8_t next_path[1];
+} ebpf_operation_get_next_pinned_path_reply_t;
+
 typedef struct _ebpf_operation_get_object_info_request
 {
     struct _ebpf_operation_header header;
@@ -406,6 +422,21 @@ typedef struct _ebpf_operation_load_native_module_reply
     size_t count_of_programs;
 } ebpf_operation_load_native_module_reply_t;
 
+typedef struct _ebpf_operation_load_native_module_instance_request
+{
+    struct _ebpf_operation_header header;
+    GUID module_id;
+    GUID instance_id;
+} ebpf_operation_load_native_module_instance_request_t;
+
+typedef struct _ebpf_operation_load_native_module_instance_reply
+{
+    struct _ebpf_operation_header header;
+    ebpf_handle_t native_module_handle;
+    size_t count_of_maps;
+    size_t count_of_programs;
+} ebpf_operation_load_native_module_instance_reply_t;
+
 typedef struct _ebpf_operation_load_native_programs_request
 {
     struct _ebpf_operation_header header;
@@ -479,6 +510,9 @@ typedef struct _ebpf_operation_map_update_element_batch_reply
 {
     struct _ebpf_operation_header header;
     uint32_t count_of_elements_processed;
+    // Result of the update that stopped the batch, or EBPF_SUCCESS if every element was updated. Returned here rather
+    // than as the result of the operation, so that count_of_elements_processed reaches the caller.
+    ebpf_result_t result;
 } ebpf_operation_map_update_element_batch_reply_t;
 
 typedef struct _ebpf_operation_map_delete_element_batch_request
@@ -6,6 +6,7 @@
 #include "catch_wrapper.hpp"
 #include "ebpf_async.h"
 #include "ebpf_core.h"
+#include "ebpf_epoch.h"
 #include "ebpf_maps.h"
 #include "ebpf_object.h"
 #include "ebpf_program.h"
@@ -13,8 +14,10 @@
 #include "helpers.h"
 #include "test_helper.hpp"
 
+#include <atomic>
 #include <optional>
 #include <set>
+#include <thread>
 
 typedef struct _free_trampoline_table
 {
@@ -350,6 +353,29 @@ _test_crud_operations(ebpf_map_type_t map_type)
                 EPBF_MAP_FIND_FLAG_DELETE) == EBPF_INVALID_ARGUMENT);
     }
 
+    // The entry points used by helper functions operate on the same entries. For per-CPU
+    // maps they only see the value of the current CPU, which may change between calls.
+    {
+        uint32_t key = 1;
+        uint64_t helper_value = 42;
+        bool per_cpu = BPF_MAP_TYPE_PER_CPU(map_type);
+        REQUIRE(
+            ebpf_map_helper_update_entry(
+                map.get(),
+                reinterpret_cast<const uint8_t*>(&key),
+                reinterpret_cast<const uint8_t*>(&helper_value),
+                EBPF_ANY) == EBPF_SUCCESS);
+        uint64_t* found_value =
+            reinterpret_cast<uint64_t*>(ebpf_map_helper_find_entry(map.get(), reinterpret_cast<uint8_t*>(&key), false));
+        REQUIRE(found_value != nullptr);
+        REQUIRE((per_cpu || *found_value == helper_value));
+
+        REQUIRE(ebpf_map_helper_delete_entry(map.get(), reinterpret_cast<const uint8_t*>(&key)) == EBPF_SUCCESS);
+        if (!is_array) {
+            REQUIRE(ebpf_map_helper_find_entry(map.get(), reinterpret_cast<uint8_t*>(&key), false) == nullptr);
+        }
+    }
+
     auto retrieved_map_definition = *ebpf_map_get_definition(map.get());
     retrieved_map_definition.value_size = ebpf_map_get_effective_value_size(map.get());
     REQUIRE(memcmp(&retrieved_map_definition, &map_definition, sizeof(map_definition)) == 0);
@@ -648,6 +674,97 @@ TEST_CASE("map_crud_operations_queue", "[execution_context]")
         EBPF_INVALID_ARGUMENT);
 }
 
+TEST_CASE("map_queue_concurrent_push_pop", "[execution_context]")
+{
+    _ebpf_core_initializer core;
+    core.initialize();
+    const uint32_t producer_count = 4;
+    const uint32_t consumer_count = 4;
+    const uint32_t values_per_producer = 10000;
+    const uint32_t total_values = producer_count * values_per_producer;
+
+    // Keep the queue small so that producers regularly find it full and consumers find it empty.
+    ebpf_map_definition_in_memory_t map_definition{BPF_MAP_TYPE_QUEUE, 0, sizeof(uint32_t), 16};
+    map_ptr map;
+    {
+        ebpf_map_t* local_map;
+        cxplat_utf8_string_t map_name = {0};
+        REQUIRE(
+            ebpf_map_create(&map_name, &map_definition, (uintptr_t)ebpf_handle_invalid, &local_map) == EBPF_SUCCESS);
+        map.reset(local_map);
+    }
+
+    std::atomic<uint32_t> values_popped = 0;
+    std::atomic<bool> failed = false;
+    std::vector<std::vector<uint32_t>> popped_values(consumer_count);
+    std::vector<std::thread> threads;
+
+    for (uint32_t producer = 0; producer < producer_count; producer++) {
+        threads.emplace_back([&, producer]() {
+            for (uint32_t i = 0; i < values_per_producer && !failed;) {
+                uint32_t value = producer * values_per_producer + i;
+                ebpf_epoch_state_t epoch_state;
+                ebpf_epoch_enter(&epoch_state);
+                ebpf_result_t result =
+                    ebpf_map_push_entry(map.get(), sizeof(value), reinterpret_cast<uint8_t*>(&value), 0);
+                ebpf_epoch_exit(&epoch_state);
+                if (result == EBPF_SUCCESS) {
+                    i++;
+                } else if (result != EBPF_OUT_OF_SPACE) {
+                    failed = true;
+                }
+            }
+        });
+    }
+
+    for (uint32_t consumer = 0; consumer < consumer_count; consumer++) {
+        threads.emplace_back([&, consumer]() {
+            while (values_popped < total_values && !failed) {
+                uint32_t value;
+                ebpf_epoch_state_t epoch_state;
+                ebpf_epoch_enter(&epoch_state);
+                ebpf_result_t result =
+                    ebpf_map_pop_entry(map.get(), sizeof(value), reinterpret_cast<uint8_t*>(&value), 0);
+                ebpf_epoch_exit(&epoch_state);
+                if (result == EBPF_SUCCESS) {
+                    popped_values[consumer].push_back(value);
+                    values_popped++;
+                } else if (result != EBPF_OBJECT_NOT_FOUND) {
+                    failed = true;
+                }
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    REQUIRE(!failed);
+    REQUIRE(values_popped == total_values);
+
+    // Every value pushed was popped exactly once.
+    std::vector<uint32_t> pop_count(total_values);
+    for (const auto& values : popped_values) {
+        // A consumer sees the values of any one producer in the order they were pushed.
+        std::vector<int64_t> last_value(producer_count, -1);
+        for (uint32_t value : values) {
+            REQUIRE(value < total_values);
+            pop_count[value]++;
+            uint32_t producer = value / values_per_producer;
+            REQUIRE(static_cast<int64_t>(value) > last_value[producer]);
+            last_value[producer] = value;
+        }
+    }
+    for (uint32_t value = 0; value < total_values; value++) {
+        REQUIRE(pop_count[value] == 1);
+    }
+
+    uint32_t return_value;
+    REQUIRE(
+        ebpf_map_pop_entry(map.get(), sizeof(return_value), reinterpret_cast<uint8_t*>(&return_value), 0) ==
+        EBPF_OBJECT_NOT_FOUND);
+}
+
 TEST_CASE("map_crud_operations_stack", "[execution_context]")
 {
     _ebpf_core_initializer core;
@@ -700,6 +817,106 @@ TEST_CASE("map_crud_operations_stack", "[execution_context]")
         EBPF_OBJECT_NOT_FOUND);
 }
 
+TEST_CASE("map_crud_operations_bloom_filter", "[execution_context]")
+{
+    _ebpf_core_initializer core;
+    core.initialize();
+    ebpf_map_definition_in_memory_t map_definition{BPF_MAP_TYPE_BLOOM_FILTER, 0, sizeof(uint32_t), 100};
+    map_definition.map_extra = 3;
+    map_ptr map;
+    {
+        ebpf_map_t* local_map;
+        cxplat_utf8_string_t map_name = {0};
+        REQUIRE(
+            ebpf_map_create(&map_name, &map_definition, (uintptr_t)ebpf_handle_invalid, &local_map) == EBPF_SUCCESS);
+        map.reset(local_map);
+    }
+
+    for (uint32_t value = 0; value < 100; value += 2) {
+        REQUIRE(ebpf_map_push_entry(map.get(), sizeof(value), reinterpret_cast<uint8_t*>(&value), 0) == EBPF_SUCCESS);
+    }
+
+    // Every value that was added must be found, and peek must leave the value unmodified.
+    for (uint32_t value = 0; value < 100; value += 2) {
+        uint32_t test_value = value;
+        REQUIRE(
+            ebpf_map_peek_entry(map.get(), sizeof(test_value), reinterpret_cast<uint8_t*>(&test_value), 0) ==
+            EBPF_SUCCESS);
+        REQUIRE(test_value == value);
+        REQUIRE(
+            ebpf_map_find_entry(
+                map.get(),
+                sizeof(test_value),
+                reinterpret_cast<uint8_t*>(&test_value),
+                0,
+                reinterpret_cast<uint8_t*>(&test_value),
+                0) == EBPF_SUCCESS);
+    }
+
+    // Values that were not added are only found as false positives.
+    size_t false_positives = 0;
+    for (uint32_t value = 1000; value < 2000; value++) {
+        ebpf_result_t result = ebpf_map_peek_entry(map.get(), sizeof(value), reinterpret_cast<uint8_t*>(&value), 0);
+        REQUIRE((result == EBPF_SUCCESS || result == EBPF_KEY_NOT_FOUND));
+        if (result == EBPF_SUCCESS) {
+            false_positives++;
+        }
+    }
+    REQUIRE(false_positives < 100);
+
+    // Negative tests.
+    uint32_t value = 0;
+    REQUIRE(
+        ebpf_map_pop_entry(map.get(), sizeof(value), reinterpret_cast<uint8_t*>(&value), 0) ==
+        EBPF_OPERATION_NOT_SUPPORTED);
+
+    REQUIRE(
+        ebpf_map_find_entry(
+            map.get(),
+            sizeof(value),
+            reinterpret_cast<uint8_t*>(&value),
+            0,
+            reinterpret_cast<uint8_t*>(&value),
+            EPBF_MAP_FIND_FLAG_DELETE) == EBPF_OPERATION_NOT_SUPPORTED);
+
+    REQUIRE(
+        ebpf_map_find_entry(
+            map.get(),
+            sizeof(value),
+            reinterpret_cast<uint8_t*>(&value),
+            sizeof(value),
+            reinterpret_cast<uint8_t*>(&value),
+            0) == EBPF_INVALID_ARGUMENT);
+
+    REQUIRE(
+        ebpf_map_push_entry(map.get(), sizeof(value) - 1, reinterpret_cast<uint8_t*>(&value), 0) ==
+        EBPF_INVALID_ARGUMENT);
+
+    REQUIRE(
+        ebpf_map_delete_entry(map.get(), 0, reinterpret_cast<uint8_t*>(&value), 0) == EBPF_OPERATION_NOT_SUPPORTED);
+
+    // Too many hash functions.
+    {
+        ebpf_map_t* local_map;
+        cxplat_utf8_string_t map_name = {0};
+        map_definition.map_extra = 16;
+        REQUIRE(
+            ebpf_map_create(&map_name, &map_definition, (uintptr_t)ebpf_handle_invalid, &local_map) ==
+            EBPF_INVALID_ARGUMENT);
+    }
+
+    // map_extra is only valid for bloom filters.
+    {
+        ebpf_map_t* local_map;
+        cxplat_utf8_string_t map_name = {0};
+        ebpf_map_definition_in_memory_t hash_map_definition{BPF_MAP_TYPE_HASH, sizeof(uint32_t), sizeof(uint32_t), 10};
+        hash_map_definition.map_extra = 1;
+        REQUIRE(
+            ebpf_map_create(&map_name, &hash_map_definition, (uintptr_t)ebpf_handle_invalid, &local_map) ==
+            EBPF_INVALID_ARGUMENT);
+    }
+}
+
 #define TEST_FUNCTION_RETURN 42
 #define TOTAL_HELPER_COUNT 3
 
@@ -928,6 +1145,23 @@ TEST_CASE("test-csum-diff", "[execution_context]")
     REQUIRE(csum == 0xb861);
 }
 
+TEST_CASE("test-csum-diff-large-buffer", "[execution_context]")
+{
+    // The unfolded sum of this buffer does not fit in an int, so it must be folded rather than truncated.
+    std::vector<uint8_t> buffer(128 * 1024, 0xFF);
+    int csum = ebpf_core_csum_diff(nullptr, 0, buffer.data(), static_cast<int>(buffer.size()), 0);
+    REQUIRE(csum == 0xFFFF);
+
+    // Diffing a buffer against itself is a no-op in one's complement arithmetic.
+    csum = ebpf_core_csum_diff(
+        buffer.data(), static_cast<int>(buffer.size()), buffer.data(), static_cast<int>(buffer.size()), 0x1234);
+    csum = (csum >> 16) + (csum & 0xFFFF);
+    csum = (csum >> 16) + (csum & 0xFFFF);
+    REQUIRE((csum == 0x1234));
+
+    REQUIRE(ebpf_core_csum_diff(nullptr, 0, buffer.data(), 3, 0) < 0);
+}
+
 TEST_CASE("ring_buffer_async_query", "[execution_context]")
 {
     _ebpf_core_initializer core;
@@ -1128,6 +1362,15 @@ std::map<std::string, ebpf_map_definition_in_memory_t> _map_definitions = {
             10,
         },
     },
+    {
+        "BPF_MAP_TYPE_BLOOM_FILTER",
+        {
+            BPF_MAP_TYPE_BLOOM_FILTER,
+            0,
+            20,
+            10,
+        },
+    },
     {
         "BPF_MAP_TYPE_STACK",
         {
@@ -1521,6 +1764,36 @@ TEST_CASE("EBPF_OPERATION_LOAD_NATIVE_MODULE", "[execution_context][negative]")
     REQUIRE(invoke_protocol(EBPF_OPERATION_LOAD_NATIVE_MODULE, request, reply) == EBPF_INVALID_ARGUMENT);
 }
 
+TEST_CASE("EBPF_OPERATION_LOAD_NATIVE_MODULE_INSTANCE", "[execution_context][negative]")
+{
+    NEGATIVE_TEST_PROLOG();
+    ebpf_operation_load_native_module_instance_request_t request;
+    ebpf_operation_load_native_module_instance_reply_t reply;
+    request.module_id = {};
+    request.instance_id = {};
+
+    // Invalid module id.
+    REQUIRE(invoke_protocol(EBPF_OPERATION_LOAD_NATIVE_MODULE_INSTANCE, request, reply) == EBPF_OBJECT_NOT_FOUND);
+}
+
+TEST_CASE("EBPF_OPERATION_GET_NEXT_PINNED_PATH", "[execution_context][negative]")
+{
+    NEGATIVE_TEST_PROLOG();
+    std::vector<uint8_t> request(EBPF_OFFSET_OF(ebpf_operation_get_next_pinned_path_request_t, data) + 1);
+    std::vector<uint8_t> reply(EBPF_OFFSET_OF(ebpf_operation_get_next_pinned_path_reply_t, next_path) + 10);
+    auto pinned_path_request = reinterpret_cast<ebpf_operation_get_next_pinned_path_request_t*>(request.data());
+    pinned_path_request->header.length = static_cast<uint16_t>(request.size());
+
+    // Prefix longer than the request data.
+    pinned_path_request->prefix_length = 2;
+    REQUIRE(invoke_protocol(EBPF_OPERATION_GET_NEXT_PINNED_PATH, request, reply) == EBPF_INVALID_ARGUMENT);
+
+    // Nothing is pinned under the prefix.
+    pinned_path_request->prefix_length = 1;
+    pinned_path_request->data[0] = '\x01';
+    REQUIRE(invoke_protocol(EBPF_OPERATION_GET_NEXT_PINNED_PATH, request, reply) == EBPF_NO_MORE_KEYS);
+}
+
 TEST_CASE("EBPF_OPERATION_MAP_FIND_ELEMENT", "[execution_context][negative]")
 {
     NEGATIVE_TEST_PROLOG();
@@ -18,6 +18,12 @@
  * 2) The minimum epoch is committed as the release epoch and any memory that is older than the release epoch is
  * released.
  * 3) The epoch_computation_in_progress flag is cleared which allows the epoch computation to be initiated  again.
+ *
+ * Alternatively (EBPF_EPOCH_IMPLEMENTATION_COUNTER), readers are tracked with per-CPU counters of active readers, one
+ * per parity of a global epoch, in the style of QSBR/DEBRA. ebpf_epoch_enter snapshots the global epoch and increments
+ * the current CPU's counter for that epoch; ebpf_epoch_exit decrements the same counter, even if the thread has moved
+ * to another CPU. Phase 1 then becomes a check on CPU 0 that the counters for the previous epoch have drained on all
+ * CPUs, after which the global epoch is advanced; phases 2 and 3 are unchanged.
  */
 
 /**
@@ -30,6 +36,46 @@
  */
 #define EBPF_NANO_SECONDS_PER_FILETIME_TICK 100
 
+/**
+ * @brief Bytes pending release on a CPU above which epoch computation is started without waiting for the flush timer.
+ */
+#define EBPF_EPOCH_PENDING_FREE_THRESHOLD_IN_BYTES (1024 * 1024)
+
+/**
+ * @brief Number of allocations freed in the same epoch that are tracked by a single free list entry.
+ */
+#define EBPF_EPOCH_FREE_BATCH_SIZE 64
+
+/**
+ * @brief Largest allocation size, including the header, that is recorded exactly in the allocation header.
+ */
+#define EBPF_EPOCH_ALLOCATION_SIZE_MAX 0xFFFFFF
+
+/**
+ * @brief Number of released blocks each per-CPU allocation cache holds for one size class.
+ */
+#define EBPF_EPOCH_CACHE_DEPTH 32
+
+/**
+ * @brief Number of allocation cache size classes. Class N holds blocks of EBPF_EPOCH_CACHE_MIN_BLOCK_SIZE << N bytes,
+ * including the header.
+ */
+#define EBPF_EPOCH_CACHE_SIZE_CLASS_COUNT 5
+#define EBPF_EPOCH_CACHE_MIN_BLOCK_SIZE 64
+
+typedef struct _ebpf_epoch_free_batch ebpf_epoch_free_batch_t;
+typedef struct _ebpf_epoch_allocation_header ebpf_epoch_allocation_header_t;
+
+/**
+ * @brief Per-CPU cache of released blocks of one size class (a magazine). Blocks are only added after the epoch they
+ * were freed in is released, so handing one out again is always safe.
+ */
+typedef struct _ebpf_epoch_allocation_cache
+{
+    uint32_t count;                                                 ///< Number of blocks in the cache.
+    ebpf_epoch_allocation_header_t* blocks[EBPF_EPOCH_CACHE_DEPTH]; ///< Cached blocks, most recent last.
+} ebpf_epoch_allocation_cache_t;
+
 #define EBPF_EPOCH_FAIL_FAST(REASON, ASSERTION) \
     if (!(ASSERTION)) {                         \
         ebpf_assert(!#ASSERTION);               \
@@ -52,6 +98,16 @@ typedef __declspec(align(EBPF_CACHE_LINE_SIZE)) struct _ebpf_epoch_cpu_entry
     int rundown_in_progress : 1;           ///< Set if rundown is in progress.
     int epoch_computation_in_progress : 1; ///< Set if epoch computation is in progress.
     ebpf_timed_work_queue_t* work_queue;   ///< Work queue used to schedule work items.
+    uint32_t dispatch_reader_count;        ///< Number of ebpf_epoch_enter_dispatch callers active on this CPU.
+    int64_t dispatch_reader_epoch;         ///< Epoch of the outermost active ebpf_epoch_enter_dispatch caller.
+    volatile int64_t active_readers[2];    ///< Readers that entered on this CPU, by epoch parity (counter mode only).
+    int pressure_flush_requested : 1;      ///< Set if epoch computation was started early due to pending frees.
+    ebpf_epoch_free_batch_t* free_batch;   ///< Batch in the free list that frees in the current epoch are added to.
+    ebpf_epoch_free_batch_t* spare_free_batch; ///< Released batch kept for reuse.
+    volatile int64_t pending_free_count;       ///< Allocations in the free list waiting to be released.
+    volatile int64_t pending_free_bytes;       ///< Bytes in the free list waiting to be released.
+    ebpf_epoch_allocation_cache_t allocation_caches[EBPF_EPOCH_CACHE_SIZE_CLASS_COUNT]; ///< Caches by size class.
+    ebpf_epoch_cache_statistics_t cache_statistics; ///< Allocation cache statistics for this CPU.
 } ebpf_epoch_cpu_entry_t;
 
 /**
@@ -64,6 +120,31 @@ static _Writable_elements_(_ebpf_epoch_cpu_count) ebpf_epoch_cpu_entry_t* _ebpf_
  */
 static uint32_t _ebpf_epoch_cpu_count = 0;
 
+/**
+ * @brief Reader tracking implementation in use, selected before initialization.
+ */
+static ebpf_epoch_implementation_t _ebpf_epoch_implementation = EBPF_EPOCH_IMPLEMENTATION_LIST;
+
+/**
+ * @brief If false, ebpf_epoch_allocate always uses the platform allocator and released blocks are never cached.
+ */
+static bool _ebpf_epoch_allocation_cache_enabled = true;
+
+/**
+ * @brief Delay before the flush timer runs, selected before initialization.
+ */
+static uint64_t _ebpf_epoch_flush_delay_in_nanoseconds = EBPF_EPOCH_FLUSH_DELAY_IN_NANOSECONDS;
+
+/**
+ * @brief Non-zero if a CPU has asked for an early epoch computation that has not been started yet.
+ */
+static volatile int64_t _ebpf_epoch_pressure_flush_pending = 0;
+
+/**
+ * @brief Global epoch used by EBPF_EPOCH_IMPLEMENTATION_COUNTER. Only CPU 0 advances it.
+ */
+static volatile int64_t _ebpf_epoch_global_epoch = 1;
+
 /**
  * @brief Enum of messages sent between CPUs.
  */
@@ -165,6 +246,7 @@ typedef enum _ebpf_epoch_allocation_type
     EBPF_EPOCH_ALLOCATION_MEMORY,          ///< Memory allocation.
     EBPF_EPOCH_ALLOCATION_WORK_ITEM,       ///< Work item.
     EBPF_EPOCH_ALLOCATION_SYNCHRONIZATION, ///< Synchronization object.
+    EBPF_EPOCH_ALLOCATION_BATCH,           ///< Batch of memory allocations freed in the same epoch.
 } ebpf_epoch_allocation_type_t;
 
 /**
@@ -174,7 +256,10 @@ typedef struct _ebpf_epoch_allocation_header
 {
     ebpf_list_entry_t list_entry; ///< List entry used to insert the item into the free list.
     int64_t freed_epoch;          ///< Epoch when the item was freed. Used to determine when the item can be released.
-    ebpf_epoch_allocation_type_t entry_type; ///< Type of entry.
+    uint32_t entry_type : 4;      ///< Type of entry (ebpf_epoch_allocation_type_t).
+    uint32_t size_class : 4;      ///< Allocation cache size class plus one, or zero if the block isn't cacheable.
+    uint32_t size : 24; ///< Size of the allocation including the header, capped at EBPF_EPOCH_ALLOCATION_SIZE_MAX.
+    uint32_t tag;       ///< Pool tag the memory was allocated with.
 } ebpf_epoch_allocation_header_t;
 
 /**
@@ -190,6 +275,17 @@ typedef struct _ebpf_epoch_work_item
     const void (*callback)(_Inout_ void* context);         ///< Callback to invoke.
 } ebpf_epoch_work_item_t;
 
+/**
+ * @brief Array of memory allocations freed in the same epoch. Only the batch is linked into the free list, so
+ * releasing a burst of frees walks one list entry per EBPF_EPOCH_FREE_BATCH_SIZE allocations.
+ */
+typedef struct _ebpf_epoch_free_batch
+{
+    ebpf_epoch_allocation_header_t header; ///< Header used to insert the batch into the free list.
+    uint32_t count;                        ///< Number of allocations in the batch.
+    ebpf_epoch_allocation_header_t* allocations[EBPF_EPOCH_FREE_BATCH_SIZE]; ///< Allocations to free.
+} ebpf_epoch_free_batch_t;
+
 typedef struct _ebpf_epoch_synchronization
 {
     ebpf_epoch_allocation_header_t header; ///< Header used to insert the item into the free list.
@@ -221,6 +317,12 @@ _ebpf_epoch_insert_in_free_list(_In_ ebpf_epoch_allocation_header_t* header);
 
 static _IRQL_requires_(DISPATCH_LEVEL) void _ebpf_epoch_arm_timer_if_needed(ebpf_epoch_cpu_entry_t* cpu_entry);
 
+static _IRQL_requires_(DISPATCH_LEVEL) void _ebpf_epoch_request_pressure_flush_if_needed(
+    _Inout_ ebpf_epoch_cpu_entry_t* cpu_entry);
+
+static void
+_ebpf_epoch_counter_propose_release_epoch(_Inout_ ebpf_epoch_cpu_message_t* message);
+
 static void
 _ebpf_epoch_work_item_callback(_In_ cxplat_preemptible_work_item_t* preemptible_work_item, void* context);
 
@@ -256,6 +358,100 @@ _IRQL_requires_(DISPATCH_LEVEL) static inline void _ebpf_epoch_lower_to_previous
     }
 }
 
+_Must_inspect_result_ ebpf_result_t
+ebpf_epoch_set_implementation(ebpf_epoch_implementation_t implementation)
+{
+    if (_ebpf_epoch_cpu_table != NULL) {
+        return EBPF_INVALID_STATE;
+    }
+    if (implementation != EBPF_EPOCH_IMPLEMENTATION_LIST && implementation != EBPF_EPOCH_IMPLEMENTATION_COUNTER) {
+        return EBPF_INVALID_ARGUMENT;
+    }
+    _ebpf_epoch_implementation = implementation;
+    return EBPF_SUCCESS;
+}
+
+/**
+ * @brief Enter the epoch using the per-CPU reader counters. The counter for the snapshotted epoch is incremented, and
+ * the snapshot is retried if the global epoch advanced in the meantime, so that CPU 0 either sees this reader when it
+ * checks the counters or this reader sees the advanced epoch.
+ *
+ * @param[out] epoch_state Pointer to epoch state to be filled in.
+ */
+static inline void
+_ebpf_epoch_counter_enter(_Out_ ebpf_epoch_state_t* epoch_state)
+{
+    epoch_state->irql_at_enter = KeGetCurrentIrql();
+    epoch_state->cpu_id = ebpf_get_current_cpu();
+
+    volatile int64_t* active_readers = _ebpf_epoch_cpu_table[epoch_state->cpu_id].active_readers;
+    for (;;) {
+        int64_t epoch = ReadNoFence64(&_ebpf_epoch_global_epoch);
+        // The interlocked operation is a full barrier, ordering it before the re-read of the global epoch.
+        InterlockedIncrement64(&active_readers[epoch & 1]);
+        if (ReadNoFence64(&_ebpf_epoch_global_epoch) == epoch) {
+            epoch_state->epoch = epoch;
+            return;
+        }
+        InterlockedDecrement64(&active_readers[epoch & 1]);
+    }
+}
+
+/**
+ * @brief Exit an epoch entered with _ebpf_epoch_counter_enter. The counter is on the CPU the epoch was entered on,
+ * which is why it is updated with an interlocked operation.
+ *
+ * @param[in] epoch_state Pointer to epoch state filled in by _ebpf_epoch_counter_enter.
+ */
+static inline void
+_ebpf_epoch_counter_exit(_In_ const ebpf_epoch_state_t* epoch_state)
+{
+    InterlockedDecrement64(&_ebpf_epoch_cpu_table[epoch_state->cpu_id].active_readers[epoch_state->epoch & 1]);
+}
+
+/**
+ * @brief Check if every reader that entered during an epoch has exited. Only valid once the global epoch has advanced
+ * past that epoch.
+ *
+ * @param[in] epoch Epoch to check.
+ * @retval true No reader is still in the epoch.
+ * @retval false At least one reader is still in the epoch.
+ */
+static bool
+_ebpf_epoch_counter_is_drained(int64_t epoch)
+{
+    int64_t active_readers = 0;
+
+    // Readers can exit on a different CPU than they entered on, so only the sum over all CPUs is meaningful.
+    for (uint32_t cpu_id = 0; cpu_id < _ebpf_epoch_cpu_count; cpu_id++) {
+        active_readers += ReadNoFence64(&_ebpf_epoch_cpu_table[cpu_id].active_readers[epoch & 1]);
+    }
+    return active_readers == 0;
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_epoch_set_allocation_cache_enabled(bool enabled)
+{
+    if (_ebpf_epoch_cpu_table != NULL) {
+        return EBPF_INVALID_STATE;
+    }
+    _ebpf_epoch_allocation_cache_enabled = enabled;
+    return EBPF_SUCCESS;
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_epoch_set_flush_delay(uint64_t delay_in_nanoseconds)
+{
+    if (_ebpf_epoch_cpu_table != NULL) {
+        return EBPF_INVALID_STATE;
+    }
+    if (delay_in_nanoseconds < EBPF_NANO_SECONDS_PER_FILETIME_TICK) {
+        return EBPF_INVALID_ARGUMENT;
+    }
+    _ebpf_epoch_flush_delay_in_nanoseconds = delay_in_nanoseconds;
+    return EBPF_SUCCESS;
+}
+
 _Must_inspect_result_ ebpf_result_t
 ebpf_epoch_initiate()
 {
@@ -268,6 +464,8 @@ ebpf_epoch_initiate()
     cpu_count = ebpf_get_cpu_count();
 
     _ebpf_epoch_cpu_count = cpu_count;
+    _ebpf_epoch_global_epoch = 1;
+    _ebpf_epoch_pressure_flush_pending = 0;
 
     _ebpf_epoch_cpu_table = cxplat_allocate(
         CXPLAT_POOL_FLAG_NON_PAGED | CXPLAT_POOL_FLAG_CACHE_ALIGNED,
@@ -292,7 +490,7 @@ ebpf_epoch_initiate()
     for (uint32_t cpu_id = 0; cpu_id < _ebpf_epoch_cpu_count; cpu_id++) {
         ebpf_epoch_cpu_entry_t* cpu_entry = &_ebpf_epoch_cpu_table[cpu_id];
         LARGE_INTEGER interval;
-        interval.QuadPart = EBPF_EPOCH_FLUSH_DELAY_IN_NANOSECONDS / EBPF_NANO_SECONDS_PER_FILETIME_TICK;
+        interval.QuadPart = (int64_t)(_ebpf_epoch_flush_delay_in_nanoseconds / EBPF_NANO_SECONDS_PER_FILETIME_TICK);
 
         ebpf_result_t result = ebpf_timed_work_queue_create(
             &cpu_entry->work_queue, cpu_id, &interval, _ebpf_epoch_messenger_worker, cpu_entry);
@@ -347,6 +545,15 @@ ebpf_epoch_terminate()
         // Release all memory that is still in the free list.
         _ebpf_epoch_release_free_list(cpu_entry, MAXINT64);
         ebpf_assert(ebpf_list_is_empty(&cpu_entry->free_list));
+        ebpf_assert(cpu_entry->pending_free_count == 0);
+        ebpf_free(cpu_entry->spare_free_batch);
+        cpu_entry->spare_free_batch = NULL;
+        for (uint32_t size_class = 0; size_class < EBPF_EPOCH_CACHE_SIZE_CLASS_COUNT; size_class++) {
+            ebpf_epoch_allocation_cache_t* cache = &cpu_entry->allocation_caches[size_class];
+            while (cache->count > 0) {
+                ebpf_free(cache->blocks[--cache->count]);
+            }
+        }
         ebpf_timed_work_queue_destroy(cpu_entry->work_queue);
     }
 
@@ -368,6 +575,11 @@ ebpf_epoch_terminate()
 _IRQL_requires_same_ void
 ebpf_epoch_enter(_Out_ ebpf_epoch_state_t* epoch_state)
 {
+    if (_ebpf_epoch_implementation == EBPF_EPOCH_IMPLEMENTATION_COUNTER) {
+        _ebpf_epoch_counter_enter(epoch_state);
+        return;
+    }
+
     epoch_state->irql_at_enter = _ebpf_epoch_raise_to_dispatch_if_needed();
     epoch_state->cpu_id = ebpf_get_current_cpu();
 
@@ -386,6 +598,11 @@ ebpf_epoch_enter(_Out_ ebpf_epoch_state_t* epoch_state)
 _IRQL_requires_same_ void
 ebpf_epoch_exit(_In_ ebpf_epoch_state_t* epoch_state)
 {
+    if (_ebpf_epoch_implementation == EBPF_EPOCH_IMPLEMENTATION_COUNTER) {
+        _ebpf_epoch_counter_exit(epoch_state);
+        return;
+    }
+
     KIRQL old_irql = _ebpf_epoch_raise_to_dispatch_if_needed();
 
     // Assert the IRQL is the same as when ebpf_epoch_enter() was called.
@@ -425,6 +642,10 @@ ebpf_epoch_exit(_In_ ebpf_epoch_state_t* epoch_state)
     ebpf_list_remove_entry(&epoch_state->epoch_list_entry);
     _ebpf_epoch_arm_timer_if_needed(&_ebpf_epoch_cpu_table[cpu_id]);
 
+    // A pressure flush started while this reader was active could not release what it pinned, so ask again.
+    _ebpf_epoch_cpu_table[cpu_id].pressure_flush_requested = false;
+    _ebpf_epoch_request_pressure_flush_if_needed(&_ebpf_epoch_cpu_table[cpu_id]);
+
     // If there are items in the work queue, flush them.
     if (!ebpf_timed_work_queue_is_empty(_ebpf_epoch_cpu_table[cpu_id].work_queue)) {
         ebpf_timed_work_queued_flush(_ebpf_epoch_cpu_table[cpu_id].work_queue);
@@ -434,15 +655,113 @@ ebpf_epoch_exit(_In_ ebpf_epoch_state_t* epoch_state)
 }
 #pragma warning(pop)
 
+_IRQL_requires_(DISPATCH_LEVEL) void ebpf_epoch_enter_dispatch(_Out_ ebpf_epoch_state_t* epoch_state)
+{
+    if (_ebpf_epoch_implementation == EBPF_EPOCH_IMPLEMENTATION_COUNTER) {
+        _ebpf_epoch_counter_enter(epoch_state);
+        return;
+    }
+
+    epoch_state->irql_at_enter = DISPATCH_LEVEL;
+    epoch_state->cpu_id = ebpf_get_current_cpu();
+
+    // The caller can't be preempted and the messenger only runs on this CPU at DISPATCH_LEVEL, so a per-CPU count of
+    // active callers is enough to hold back the release epoch; no list entry is needed.
+    ebpf_epoch_cpu_entry_t* cpu_entry = &_ebpf_epoch_cpu_table[epoch_state->cpu_id];
+    epoch_state->epoch = cpu_entry->current_epoch;
+    if (cpu_entry->dispatch_reader_count++ == 0) {
+        cpu_entry->dispatch_reader_epoch = epoch_state->epoch;
+    }
+}
+
+_IRQL_requires_(DISPATCH_LEVEL) void ebpf_epoch_exit_dispatch(_In_ const ebpf_epoch_state_t* epoch_state)
+{
+    if (_ebpf_epoch_implementation == EBPF_EPOCH_IMPLEMENTATION_COUNTER) {
+        _ebpf_epoch_counter_exit(epoch_state);
+        return;
+    }
+
+    // The caller must not have dropped below DISPATCH_LEVEL since calling ebpf_epoch_enter_dispatch.
+    EBPF_EPOCH_FAIL_FAST(FAST_FAIL_INVALID_ARG, epoch_state->cpu_id == ebpf_get_current_cpu());
+
+    ebpf_epoch_cpu_entry_t* cpu_entry = &_ebpf_epoch_cpu_table[epoch_state->cpu_id];
+    ebpf_assert(cpu_entry->dispatch_reader_count > 0);
+    cpu_entry->dispatch_reader_count--;
+}
+
+/**
+ * @brief Take a block with a matching pool tag from the current CPU's cache for a size class.
+ *
+ * @param[in] size_class Size class to allocate from.
+ * @param[in] tag Pool tag the block must have been allocated with.
+ * @returns Pointer to the block, or NULL if the cache has no matching block.
+ */
+#pragma warning(push)
+#pragma warning(disable : 28166) // warning C28166: Code analysis incorrectly reports that the function
+                                 // '_ebpf_epoch_allocate_from_cache' does not restore the IRQL to the value that was
+                                 // current at function entry.
+_IRQL_requires_same_ static ebpf_epoch_allocation_header_t*
+_ebpf_epoch_allocate_from_cache(uint32_t size_class, uint32_t tag)
+{
+    ebpf_epoch_allocation_header_t* header = NULL;
+    KIRQL old_irql = _ebpf_epoch_raise_to_dispatch_if_needed();
+    ebpf_epoch_cpu_entry_t* cpu_entry = &_ebpf_epoch_cpu_table[ebpf_get_current_cpu()];
+    ebpf_epoch_allocation_cache_t* cache = &cpu_entry->allocation_caches[size_class];
+
+    // Blocks are only reused for the same pool tag, so that pool usage stays attributed to the right component.
+    for (uint32_t index = cache->count; index > 0; index--) {
+        if (cache->blocks[index - 1]->tag == tag) {
+            header = cache->blocks[index - 1];
+            cache->blocks[index - 1] = cache->blocks[--cache->count];
+            break;
+        }
+    }
+
+    if (header) {
+        cpu_entry->cache_statistics.hits++;
+    } else {
+        cpu_entry->cache_statistics.misses++;
+    }
+
+    _ebpf_epoch_lower_to_previous_irql(old_irql);
+    return header;
+}
+#pragma warning(pop)
+
 __drv_allocatesMem(Mem) _Must_inspect_result_
     _Ret_writes_maybenull_(size) void* ebpf_epoch_allocate_with_tag(size_t size, uint32_t tag)
 {
     ebpf_assert(size);
     ebpf_epoch_allocation_header_t* header;
+    uint32_t size_class = 0;
 
     size += sizeof(ebpf_epoch_allocation_header_t);
-    header = (ebpf_epoch_allocation_header_t*)ebpf_allocate_with_tag(size, tag);
+
+    while (size_class < EBPF_EPOCH_CACHE_SIZE_CLASS_COUNT &&
+           size > ((size_t)EBPF_EPOCH_CACHE_MIN_BLOCK_SIZE << size_class)) {
+        size_class++;
+    }
+
+    if (_ebpf_epoch_allocation_cache_enabled && _ebpf_epoch_cpu_table &&
+        size_class < EBPF_EPOCH_CACHE_SIZE_CLASS_COUNT) {
+        // Round up so that the block can be reused for any request in its size class.
+        size = (size_t)EBPF_EPOCH_CACHE_MIN_BLOCK_SIZE << size_class;
+        header = _ebpf_epoch_allocate_from_cache(size_class, tag);
+        if (header) {
+            memset(header, 0, size);
+        } else {
+            header = (ebpf_epoch_allocation_header_t*)ebpf_allocate_with_tag(size, tag);
+        }
+        if (header) {
+            header->size_class = size_class + 1;
+        }
+    } else {
+        header = (ebpf_epoch_allocation_header_t*)ebpf_allocate_with_tag(size, tag);
+    }
+
     if (header) {
+        header->size = (uint32_t)min(size, EBPF_EPOCH_ALLOCATION_SIZE_MAX);
+        header->tag = tag;
         header++;
     }
 
@@ -558,6 +877,57 @@ ebpf_epoch_is_free_list_empty(uint32_t cpu_id)
     return message.message.is_free_list_empty.is_empty;
 }
 
+_Must_inspect_result_ ebpf_result_t
+ebpf_epoch_get_cache_statistics(uint32_t cpu_id, _Out_ ebpf_epoch_cache_statistics_t* statistics)
+{
+    if (!_ebpf_epoch_cpu_table || cpu_id >= _ebpf_epoch_cpu_count) {
+        return EBPF_INVALID_ARGUMENT;
+    }
+
+    // The statistics are only written by the owning CPU, so this is a point in time estimate.
+    *statistics = _ebpf_epoch_cpu_table[cpu_id].cache_statistics;
+    return EBPF_SUCCESS;
+}
+
+_Must_inspect_result_ ebpf_result_t
+ebpf_epoch_get_pending_free(uint32_t cpu_id, _Out_ ebpf_epoch_pending_free_t* pending_free)
+{
+    if (!_ebpf_epoch_cpu_table || cpu_id >= _ebpf_epoch_cpu_count) {
+        return EBPF_INVALID_ARGUMENT;
+    }
+
+    // The counters are only written by the owning CPU, so this is a point in time estimate.
+    const ebpf_epoch_cpu_entry_t* cpu_entry = &_ebpf_epoch_cpu_table[cpu_id];
+    pending_free->count = (uint64_t)ReadNoFence64(&cpu_entry->pending_free_count);
+    pending_free->bytes = (uint64_t)ReadNoFence64(&cpu_entry->pending_free_bytes);
+    return EBPF_SUCCESS;
+}
+
+/**
+ * @brief Return a memory allocation from the free list to the CPU's allocation cache, or to the pool if it isn't
+ * cacheable or the cache is full, and update the pending free counters.
+ * @param[in] cpu_entry CPU entry whose free list held the allocation.
+ * @param[in] header Header of the allocation.
+ */
+static void
+_ebpf_epoch_free_allocation(
+    _Inout_ ebpf_epoch_cpu_entry_t* cpu_entry, _Frees_ptr_ ebpf_epoch_allocation_header_t* header)
+{
+    WriteNoFence64(&cpu_entry->pending_free_count, cpu_entry->pending_free_count - 1);
+    WriteNoFence64(&cpu_entry->pending_free_bytes, cpu_entry->pending_free_bytes - header->size);
+
+    if (header->size_class != 0 && !cpu_entry->rundown_in_progress) {
+        ebpf_epoch_allocation_cache_t* cache = &cpu_entry->allocation_caches[header->size_class - 1];
+        if (cache->count < EBPF_EPOCH_CACHE_DEPTH) {
+            cache->blocks[cache->count++] = header;
+            cpu_entry->cache_statistics.recycled++;
+            return;
+        }
+        cpu_entry->cache_statistics.overflows++;
+    }
+    ebpf_free(header);
+}
+
 /**
  * @brief Release any memory that is associated with expired epochs.
  * @param[in] cpu_entry CPU entry to release memory for.
@@ -577,8 +947,23 @@ _ebpf_epoch_release_free_list(_Inout_ ebpf_epoch_cpu_entry_t* cpu_entry, int64_t
             ebpf_list_remove_entry(entry);
             switch (header->entry_type) {
             case EBPF_EPOCH_ALLOCATION_MEMORY:
-                ebpf_free(header);
+                _ebpf_epoch_free_allocation(cpu_entry, header);
                 break;
+            case EBPF_EPOCH_ALLOCATION_BATCH: {
+                ebpf_epoch_free_batch_t* batch = CONTAINING_RECORD(header, ebpf_epoch_free_batch_t, header);
+                for (uint32_t index = 0; index < batch->count; index++) {
+                    _ebpf_epoch_free_allocation(cpu_entry, batch->allocations[index]);
+                }
+                if (cpu_entry->free_batch == batch) {
+                    cpu_entry->free_batch = NULL;
+                }
+                if (cpu_entry->spare_free_batch == NULL) {
+                    cpu_entry->spare_free_batch = batch;
+                } else {
+                    ebpf_free(batch);
+                }
+                break;
+            }
             case EBPF_EPOCH_ALLOCATION_WORK_ITEM: {
                 ebpf_epoch_work_item_t* work_item = CONTAINING_RECORD(header, ebpf_epoch_work_item_t, header);
                 cxplat_queue_preemptible_work_item(work_item->preemptible_work_item);
@@ -624,11 +1009,69 @@ _IRQL_requires_(DISPATCH_LEVEL) static void _ebpf_epoch_arm_timer_if_needed(ebpf
     }
     cpu_entry->timer_armed = true;
     LARGE_INTEGER due_time;
-    due_time.QuadPart = -(EBPF_EPOCH_FLUSH_DELAY_IN_NANOSECONDS / EBPF_NANO_SECONDS_PER_FILETIME_TICK);
+    due_time.QuadPart = -(int64_t)(_ebpf_epoch_flush_delay_in_nanoseconds / EBPF_NANO_SECONDS_PER_FILETIME_TICK);
     KeSetTimer(&_ebpf_epoch_compute_release_epoch_timer, due_time, &_ebpf_epoch_timer_dpc);
     return;
 }
 
+/**
+ * @brief Start an epoch computation now if this CPU has more than EBPF_EPOCH_PENDING_FREE_THRESHOLD_IN_BYTES waiting
+ * to be released and has not already asked for one since the last commit. If a computation is already running, a new
+ * one is started as soon as it completes.
+ *
+ * @param[in, out] cpu_entry CPU entry to check.
+ */
+_IRQL_requires_(DISPATCH_LEVEL) static void _ebpf_epoch_request_pressure_flush_if_needed(
+    _Inout_ ebpf_epoch_cpu_entry_t* cpu_entry)
+{
+    if (cpu_entry->rundown_in_progress || cpu_entry->pressure_flush_requested) {
+        return;
+    }
+    if (cpu_entry->pending_free_bytes <= EBPF_EPOCH_PENDING_FREE_THRESHOLD_IN_BYTES) {
+        return;
+    }
+    cpu_entry->pressure_flush_requested = true;
+    InterlockedExchange64(&_ebpf_epoch_pressure_flush_pending, 1);
+    LARGE_INTEGER due_time;
+    due_time.QuadPart = -1;
+    KeSetTimer(&_ebpf_epoch_compute_release_epoch_timer, due_time, &_ebpf_epoch_timer_dpc);
+}
+
+/**
+ * @brief Add a memory allocation to this CPU's batch for the epoch it was freed in, starting a new batch if needed.
+ *
+ * @param[in] cpu_entry CPU entry to add the allocation to.
+ * @param[in] header Header of the allocation, with freed_epoch set.
+ * @retval true The allocation was added to a batch.
+ * @retval false No batch could be allocated; the caller must insert the allocation in the free list itself.
+ */
+_IRQL_requires_(DISPATCH_LEVEL) static bool _ebpf_epoch_insert_in_free_batch(
+    _Inout_ ebpf_epoch_cpu_entry_t* cpu_entry, _In_ ebpf_epoch_allocation_header_t* header)
+{
+    ebpf_epoch_free_batch_t* batch = cpu_entry->free_batch;
+
+    if (batch == NULL || batch->header.freed_epoch != header->freed_epoch ||
+        batch->count == EBPF_EPOCH_FREE_BATCH_SIZE) {
+        batch = cpu_entry->spare_free_batch;
+        if (batch != NULL) {
+            cpu_entry->spare_free_batch = NULL;
+        } else {
+            batch = (ebpf_epoch_free_batch_t*)ebpf_allocate_with_tag(sizeof(*batch), EBPF_POOL_TAG_EPOCH);
+            if (batch == NULL) {
+                return false;
+            }
+        }
+        batch->header.entry_type = EBPF_EPOCH_ALLOCATION_BATCH;
+        batch->header.freed_epoch = header->freed_epoch;
+        batch->count = 0;
+        ebpf_list_insert_tail(&cpu_entry->free_list, &batch->header.list_entry);
+        cpu_entry->free_batch = batch;
+    }
+
+    batch->allocations[batch->count++] = header;
+    return true;
+}
+
 /**
  * @brief Insert the item into the free list. If rundown is in progress, then
  * the item is freed or queued to run on a worker thread depending on the type
@@ -672,12 +1115,28 @@ _ebpf_epoch_insert_in_free_list(_In_ ebpf_epoch_allocation_header_t* header)
         return;
     }
 
-    header->freed_epoch = cpu_entry->current_epoch;
+    if (_ebpf_epoch_implementation == EBPF_EPOCH_IMPLEMENTATION_COUNTER) {
+        // Order the caller's unlinking of the item before reading the epoch it is freed in.
+        MemoryBarrier();
+        header->freed_epoch = ReadNoFence64(&_ebpf_epoch_global_epoch);
+    } else {
+        header->freed_epoch = cpu_entry->current_epoch;
+    }
+
+    if (header->entry_type != EBPF_EPOCH_ALLOCATION_MEMORY || !_ebpf_epoch_insert_in_free_batch(cpu_entry, header)) {
+        ebpf_list_insert_tail(&cpu_entry->free_list, &header->list_entry);
+    }
 
-    ebpf_list_insert_tail(&cpu_entry->free_list, &header->list_entry);
+    if (header->entry_type == EBPF_EPOCH_ALLOCATION_MEMORY) {
+        WriteNoFence64(&cpu_entry->pending_free_count, cpu_entry->pending_free_count + 1);
+        WriteNoFence64(&cpu_entry->pending_free_bytes, cpu_entry->pending_free_bytes + header->size);
+    }
 
     _ebpf_epoch_arm_timer_if_needed(cpu_entry);
 
+    // Under heavy churn, start reclaiming now rather than letting the free list grow until the timer fires.
+    _ebpf_epoch_request_pressure_flush_if_needed(cpu_entry);
+
     _ebpf_epoch_lower_to_previous_irql(old_irql);
 }
 #pragma warning(pop)
@@ -709,15 +1168,18 @@ _Function_class_(KDEFERRED_ROUTINE) _IRQL_requires_(DISPATCH_LEVEL) static void
     if (!_ebpf_epoch_cpu_table[0].epoch_computation_in_progress) {
         _ebpf_epoch_cpu_table[0].epoch_computation_in_progress = true;
         _ebpf_epoch_skipped_timers = 0;
+        // A computation requested because of pending frees should not wait for each CPU's work queue timer.
+        bool pressure_flush = InterlockedExchange64(&_ebpf_epoch_pressure_flush_pending, 0) != 0;
         memset(&_ebpf_epoch_compute_release_epoch_message, 0, sizeof(_ebpf_epoch_compute_release_epoch_message));
         _ebpf_epoch_compute_release_epoch_message.message_type = EBPF_EPOCH_CPU_MESSAGE_TYPE_PROPOSE_RELEASE_EPOCH;
-        _ebpf_epoch_compute_release_epoch_message.wake_behavior = EBPF_WORK_QUEUE_WAKEUP_ON_TIMER;
+        _ebpf_epoch_compute_release_epoch_message.wake_behavior =
+            pressure_flush ? EBPF_WORK_QUEUE_WAKEUP_ON_INSERT : EBPF_WORK_QUEUE_WAKEUP_ON_TIMER;
         KeInitializeEvent(&_ebpf_epoch_compute_release_epoch_message.completion_event, NotificationEvent, false);
         _ebpf_epoch_send_message_async(&_ebpf_epoch_compute_release_epoch_message, 0);
     } else {
         _ebpf_epoch_skipped_timers++;
         LARGE_INTEGER due_time;
-        due_time.QuadPart = -(EBPF_EPOCH_FLUSH_DELAY_IN_NANOSECONDS / EBPF_NANO_SECONDS_PER_FILETIME_TICK);
+        due_time.QuadPart = -(int64_t)(_ebpf_epoch_flush_delay_in_nanoseconds / EBPF_NANO_SECONDS_PER_FILETIME_TICK);
         KeSetTimer(&_ebpf_epoch_compute_release_epoch_timer, due_time, &_ebpf_epoch_timer_dpc);
     }
 }
@@ -751,6 +1213,11 @@ _ebpf_epoch_messenger_propose_release_epoch(
     ebpf_epoch_state_t* epoch_state;
     uint32_t next_cpu;
 
+    if (_ebpf_epoch_implementation == EBPF_EPOCH_IMPLEMENTATION_COUNTER) {
+        _ebpf_epoch_counter_propose_release_epoch(message);
+        return;
+    }
+
     // First CPU updates the current epoch and proposes the release epoch.
     if (current_cpu == 0) {
         cpu_entry->current_epoch++;
@@ -774,6 +1241,12 @@ _ebpf_epoch_messenger_propose_release_epoch(
         entry = entry->Flink;
     }
 
+    // Account for callers that entered with ebpf_epoch_enter_dispatch. These can only be active here if the message
+    // is being processed from a nested ebpf_epoch_exit on this CPU.
+    if (cpu_entry->dispatch_reader_count > 0) {
+        minimum_epoch = min(minimum_epoch, (uint64_t)cpu_entry->dispatch_reader_epoch);
+    }
+
     // Set the proposed release epoch to the minimum epoch seen so far.
     message->message.propose_epoch.proposed_release_epoch = minimum_epoch;
 
@@ -790,6 +1263,40 @@ _ebpf_epoch_messenger_propose_release_epoch(
     _ebpf_epoch_send_message_async(message, next_cpu);
 }
 
+/**
+ * @brief Compute the release epoch from the per-CPU reader counters. Runs on CPU 0 in place of the propose message
+ * chain. The global epoch is advanced for as long as (at most twice) every reader of the epoch before the current one
+ * has exited. If it advanced, the release epoch is committed on every CPU as usual; otherwise the computation completes
+ * and the timer is re-armed to try again later.
+ *
+ * @param[in] message Message to process.
+ */
+static void
+_ebpf_epoch_counter_propose_release_epoch(_Inout_ ebpf_epoch_cpu_message_t* message)
+{
+    int64_t epoch = _ebpf_epoch_global_epoch;
+    int64_t released_epoch = 0;
+
+    for (uint32_t advance = 0; advance < 2 && _ebpf_epoch_counter_is_drained(epoch - 1); advance++) {
+        // Everything freed before epoch became current is no longer visible to any reader.
+        released_epoch = epoch - 1;
+        InterlockedIncrement64(&_ebpf_epoch_global_epoch);
+        epoch++;
+    }
+
+    if (released_epoch == 0) {
+        LARGE_INTEGER due_time;
+        due_time.QuadPart = -(int64_t)(_ebpf_epoch_flush_delay_in_nanoseconds / EBPF_NANO_SECONDS_PER_FILETIME_TICK);
+        KeSetTimer(&_ebpf_epoch_compute_release_epoch_timer, due_time, &_ebpf_epoch_timer_dpc);
+        message->message_type = EBPF_EPOCH_CPU_MESSAGE_TYPE_PROPOSE_EPOCH_COMPLETE;
+    } else {
+        // The commit message releases items older than the epoch it carries.
+        message->message.commit_epoch.released_epoch = released_epoch + 1;
+        message->message_type = EBPF_EPOCH_CPU_MESSAGE_TYPE_COMMIT_RELEASE_EPOCH;
+    }
+    _ebpf_epoch_send_message_async(message, 0);
+}
+
 /**
  * @brief Commit the release epoch and send it to the next CPU.
  * Message is sent to CPU 0.
@@ -813,6 +1320,7 @@ _ebpf_epoch_messenger_commit_release_epoch(
     uint32_t next_cpu;
 
     cpu_entry->timer_armed = false;
+    cpu_entry->pressure_flush_requested = false;
     // Set the released_epoch to the value computed by the EBPF_EPOCH_CPU_MESSAGE_TYPE_PROPOSE_RELEASE_EPOCH message.
     cpu_entry->released_epoch = message->message.commit_epoch.released_epoch - 1;
 
@@ -849,6 +1357,12 @@ _ebpf_epoch_messenger_compute_epoch_complete(
     // If this is the timer's DPC, then mark the computation as complete.
     if (message == &_ebpf_epoch_compute_release_epoch_message) {
         cpu_entry->epoch_computation_in_progress = false;
+        // A pressure flush requested while this computation was running may not have been covered by it.
+        if (ReadNoFence64(&_ebpf_epoch_pressure_flush_pending) != 0 && !cpu_entry->rundown_in_progress) {
+            LARGE_INTEGER due_time;
+            due_time.QuadPart = -1;
+            KeSetTimer(&_ebpf_epoch_compute_release_epoch_timer, due_time, &_ebpf_epoch_timer_dpc);
+        }
     } else {
         // This is an adhoc flush. Signal the caller that the flush is complete.
         KeSetEvent(&message->completion_event, 0, FALSE);
@@ -19,6 +19,60 @@ extern "C"
         KIRQL irql_at_enter;         /// The IRQL when this entry was added to the list.
     } ebpf_epoch_state_t;
 
+    typedef enum _ebpf_epoch_implementation
+    {
+        EBPF_EPOCH_IMPLEMENTATION_LIST,    ///< Readers are tracked in a per-CPU list of epoch states (default).
+        EBPF_EPOCH_IMPLEMENTATION_COUNTER, ///< Readers are tracked with per-CPU counters per global epoch parity.
+    } ebpf_epoch_implementation_t;
+
+    typedef struct _ebpf_epoch_cache_statistics
+    {
+        uint64_t hits;      ///< Allocations served from the CPU's allocation cache.
+        uint64_t misses;    ///< Cacheable allocations that fell back to the platform allocator.
+        uint64_t recycled;  ///< Released blocks added to the CPU's allocation cache.
+        uint64_t overflows; ///< Released blocks returned to the platform allocator because the cache was full.
+    } ebpf_epoch_cache_statistics_t;
+
+    typedef struct _ebpf_epoch_pending_free
+    {
+        uint64_t count; ///< Allocations freed but not yet returned to the pool.
+        uint64_t bytes; ///< Bytes freed but not yet returned to the pool.
+    } ebpf_epoch_pending_free_t;
+
+    /**
+     * @brief Select how readers are tracked by the epoch module. Must be called before ebpf_epoch_initiate.
+     *
+     * @param[in] implementation Implementation to use.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_INVALID_STATE The epoch module is already initialized.
+     * @retval EBPF_INVALID_ARGUMENT The implementation is not valid.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_epoch_set_implementation(ebpf_epoch_implementation_t implementation);
+
+    /**
+     * @brief Enable or disable the per-CPU caches of released blocks used by ebpf_epoch_allocate. When disabled, every
+     * allocation and release goes to the platform allocator. Must be called before ebpf_epoch_initiate.
+     *
+     * @param[in] enabled True to cache released blocks (the default), false to always use the platform allocator.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_INVALID_STATE The epoch module is already initialized.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_epoch_set_allocation_cache_enabled(bool enabled);
+
+    /**
+     * @brief Set the delay before freed memory is released when the pending free threshold is not reached. Must be
+     * called before ebpf_epoch_initiate.
+     *
+     * @param[in] delay_in_nanoseconds Delay to use, at least 100 nanoseconds.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_INVALID_STATE The epoch module is already initialized.
+     * @retval EBPF_INVALID_ARGUMENT The delay is too short.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_epoch_set_flush_delay(uint64_t delay_in_nanoseconds);
+
     /**
      * @brief Initialize the eBPF epoch tracking module.
      *
@@ -50,6 +104,21 @@ extern "C"
     _IRQL_requires_same_ void
     ebpf_epoch_exit(_In_ ebpf_epoch_state_t* epoch_state);
 
+    /**
+     * @brief Lightweight version of ebpf_epoch_enter for callers that are already running at DISPATCH_LEVEL and stay
+     * there until the matching ebpf_epoch_exit_dispatch. Instead of inserting the epoch state into the per-CPU list,
+     * this only increments a per-CPU counter.
+     * @param[out] epoch_state Pointer to epoch state to be filled in.
+     */
+    _IRQL_requires_(DISPATCH_LEVEL) void ebpf_epoch_enter_dispatch(_Out_ ebpf_epoch_state_t* epoch_state);
+
+    /**
+     * @brief Called after touching memory with lifetime under epoch control, for callers that entered the epoch with
+     * ebpf_epoch_enter_dispatch.
+     * @param[in] epoch_state Pointer to epoch state returned by ebpf_epoch_enter_dispatch.
+     */
+    _IRQL_requires_(DISPATCH_LEVEL) void ebpf_epoch_exit_dispatch(_In_ const ebpf_epoch_state_t* epoch_state);
+
     /**
      * @brief Allocate memory under epoch control.
      * @param[in] size Size of memory to allocate
@@ -119,6 +188,29 @@ extern "C"
     bool
     ebpf_epoch_is_free_list_empty(uint32_t cpu_id);
 
+    /**
+     * @brief Get the number of allocations and bytes on a CPU's free list that are waiting for their epoch to be
+     * released. Intended for monitoring; the values may be stale by the time they are returned.
+     *
+     * @param[in] cpu_id CPU to query.
+     * @param[out] pending_free Pending free counters for the CPU.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_INVALID_ARGUMENT The CPU is not valid or the epoch module is not initialized.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_epoch_get_pending_free(uint32_t cpu_id, _Out_ ebpf_epoch_pending_free_t* pending_free);
+
+    /**
+     * @brief Get the allocation cache statistics for a CPU.
+     *
+     * @param[in] cpu_id CPU to query.
+     * @param[out] statistics Allocation cache statistics for the CPU.
+     * @retval EBPF_SUCCESS The operation was successful.
+     * @retval EBPF_INVALID_ARGUMENT The CPU is not valid or the epoch module is not initialized.
+     */
+    _Must_inspect_result_ ebpf_result_t
+    ebpf_epoch_get_cache_statistics(uint32_t cpu_id, _Out_ ebpf_epoch_cache_statistics_t* statistics);
+
 #ifdef __cplusplus
 }
 #endif
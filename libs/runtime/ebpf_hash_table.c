@@ -45,6 +45,21 @@ typedef struct _ebpf_hash_bucket_header_and_lock
     ebpf_lock_t lock;
 } ebpf_hash_bucket_header_and_lock_t;
 
+/**
+ * @brief Hash function selected for a table when it is created. Fixed size keys get a specialization with the key
+ * length known at compile time, so the hot path has no loops or length checks.
+ */
+typedef enum _ebpf_hash_table_key_hash
+{
+    EBPF_HASH_TABLE_KEY_HASH_MURMUR3,  // Variable length keys in bits (extract function).
+    EBPF_HASH_TABLE_KEY_HASH_BYTES,    // Fixed size keys of any other length.
+    EBPF_HASH_TABLE_KEY_HASH_4_BYTES,  // 32-bit keys.
+    EBPF_HASH_TABLE_KEY_HASH_8_BYTES,  // 64-bit keys.
+    EBPF_HASH_TABLE_KEY_HASH_16_BYTES, // IPv6 addresses and similar keys.
+    EBPF_HASH_TABLE_KEY_HASH_40_BYTES, // IPv6 5-tuple keys.
+    EBPF_HASH_TABLE_KEY_HASH_CALLER,   // Caller supplied hash function.
+} ebpf_hash_table_key_hash_t;
+
 /**
  * @brief The ebpf_hash_table_t structure represents a hash table. It contains an array of pointers to buckets and a
  * a per bucket lock.
@@ -55,7 +70,7 @@ struct _ebpf_hash_table
     size_t bucket_count_mask;       // Mask to use to get bucket index from hash.
     volatile size_t entry_count;    // Count of entries in the hash table.
     size_t max_entry_count;         // Maximum number of entries allowed or EBPF_HASH_TABLE_NO_LIMIT if no maximum.
-    uint32_t seed;                  // Seed used for hashing.
+    uint64_t seed;                  // Seed used for hashing.
     size_t key_size;                // Size of key.
     size_t value_size;              // Size of value.
     size_t supplemental_value_size; // Size of supplemental value.
@@ -66,6 +81,9 @@ struct _ebpf_hash_table
         _Outptr_ const uint8_t** data,
         _Out_ size_t* num); // Function to extract bytes to hash from key.
 
+    ebpf_hash_table_key_hash_t key_hash;         // Hash function to use for keys.
+    ebpf_hash_table_hash_function hash_function; // Caller supplied hash function, if any.
+
     void* notification_context; //< Context to pass to notification functions.
     ebpf_hash_table_notification_function notification_callback;
     _Field_size_(bucket_count) ebpf_hash_bucket_header_and_lock_t buckets[1]; // Pointer to array of buckets.
@@ -154,6 +172,121 @@ _ebpf_murmur3_32(_In_reads_((length_in_bits + 7) / 8) const uint8_t* key, size_t
     return hash;
 }
 
+// Constants used by the multiply-mix hash below, taken from wyhash.
+// Quote from https://github.com/wangyi-fudan/wyhash/blob/46cebe9dc4e51f94d0dca287733bc5a94f76a10d/wyhash.h#L1
+// "This is free and unencumbered software released into the public domain under The Unlicense"
+#define EBPF_HASH_PRIME_0 0xa0761d6478bd642full
+#define EBPF_HASH_PRIME_1 0xe7037ed1a0b428dbull
+#define EBPF_HASH_PRIME_2 0x8ebc6af09c88c6e3ull
+#define EBPF_HASH_PRIME_3 0x589965cc75374cc3ull
+
+/**
+ * @brief Multiply two 64-bit values and fold the 128-bit product into 64 bits.
+ *
+ * @param[in] a First value.
+ * @param[in] b Second value.
+ * @return Low 64 bits of the product XOR the high 64 bits.
+ */
+static __forceinline uint64_t
+_ebpf_hash_multiply_mix(uint64_t a, uint64_t b)
+{
+#if defined(_M_ARM64)
+    return (a * b) ^ __umulh(a, b);
+#else
+    uint64_t high;
+    uint64_t low = _umul128(a, b, &high);
+    return low ^ high;
+#endif
+}
+
+/**
+ * @brief Read up to 8 bytes of a key as a little-endian 64-bit value, zero padding the rest.
+ *
+ * @param[in] key Pointer to the bytes to read.
+ * @param[in] length Number of bytes to read, at most 8.
+ * @return The bytes read.
+ */
+static __forceinline uint64_t
+_ebpf_hash_read_partial(_In_reads_(length) const uint8_t* key, size_t length)
+{
+    uint64_t value = 0;
+    memcpy(&value, key, length);
+    return value;
+}
+
+/**
+ * @brief A wyhash-class hash of whole byte keys. Each 16 bytes of key costs a single 64x64->128 bit multiply. The
+ * per-table seed is mixed into every round so collisions can't be precomputed without knowing the seed.
+ *
+ * This is force inlined so the fixed size wrappers below compile down to straight line code.
+ *
+ * @param[in] key Pointer to key to hash.
+ * @param[in] length Length of key in bytes.
+ * @param[in] seed Seed to randomize hash.
+ * @return 64-bit hash of key.
+ */
+static __forceinline uint64_t
+_ebpf_hash_bytes_64(_In_reads_(length) const uint8_t* key, size_t length, uint64_t seed)
+{
+    uint64_t hash = seed ^ EBPF_HASH_PRIME_0;
+    size_t index = 0;
+    for (; length - index >= 16; index += 16) {
+        uint64_t a = _ebpf_hash_read_partial(key + index, 8);
+        uint64_t b = _ebpf_hash_read_partial(key + index + 8, 8);
+        hash = _ebpf_hash_multiply_mix(a ^ EBPF_HASH_PRIME_1, b ^ hash);
+    }
+    size_t remaining = length - index;
+    if (remaining > 0) {
+        uint64_t a;
+        uint64_t b;
+        if (remaining > 8) {
+            a = _ebpf_hash_read_partial(key + index, 8);
+            b = _ebpf_hash_read_partial(key + index + 8, remaining - 8);
+        } else {
+            a = _ebpf_hash_read_partial(key + index, remaining);
+            b = 0;
+        }
+        hash = _ebpf_hash_multiply_mix(a ^ EBPF_HASH_PRIME_1, b ^ hash);
+    }
+    return _ebpf_hash_multiply_mix(hash ^ EBPF_HASH_PRIME_2, length ^ EBPF_HASH_PRIME_3);
+}
+
+static __forceinline uint32_t
+_ebpf_hash_bytes(_In_reads_(length) const uint8_t* key, size_t length, uint64_t seed)
+{
+    return (uint32_t)_ebpf_hash_bytes_64(key, length, seed);
+}
+
+uint64_t
+ebpf_hash_bytes(_In_reads_(length) const uint8_t* key, size_t length, uint64_t seed)
+{
+    return _ebpf_hash_bytes_64(key, length, seed);
+}
+
+static uint32_t
+_ebpf_hash_4_bytes(_In_reads_(4) const uint8_t* key, uint64_t seed)
+{
+    return _ebpf_hash_bytes(key, 4, seed);
+}
+
+static uint32_t
+_ebpf_hash_8_bytes(_In_reads_(8) const uint8_t* key, uint64_t seed)
+{
+    return _ebpf_hash_bytes(key, 8, seed);
+}
+
+static uint32_t
+_ebpf_hash_16_bytes(_In_reads_(16) const uint8_t* key, uint64_t seed)
+{
+    return _ebpf_hash_bytes(key, 16, seed);
+}
+
+static uint32_t
+_ebpf_hash_40_bytes(_In_reads_(40) const uint8_t* key, uint64_t seed)
+{
+    return _ebpf_hash_bytes(key, 40, seed);
+}
+
 /**
  * @brief Given two potentially non-comparable key values, extract the key and
  * compare them.
@@ -221,13 +354,37 @@ _ebpf_hash_table_compute_bucket_index(_In_ const ebpf_hash_table_t* hash_table,
 {
     size_t length;
     const uint8_t* data;
-    if (hash_table->extract) {
-        hash_table->extract(key, &data, &length);
-    } else {
-        length = hash_table->key_size * 8;
-        data = key;
+    uint32_t hash_value;
+    switch (hash_table->key_hash) {
+    case EBPF_HASH_TABLE_KEY_HASH_4_BYTES:
+        hash_value = _ebpf_hash_4_bytes(key, hash_table->seed);
+        break;
+    case EBPF_HASH_TABLE_KEY_HASH_8_BYTES:
+        hash_value = _ebpf_hash_8_bytes(key, hash_table->seed);
+        break;
+    case EBPF_HASH_TABLE_KEY_HASH_16_BYTES:
+        hash_value = _ebpf_hash_16_bytes(key, hash_table->seed);
+        break;
+    case EBPF_HASH_TABLE_KEY_HASH_40_BYTES:
+        hash_value = _ebpf_hash_40_bytes(key, hash_table->seed);
+        break;
+    case EBPF_HASH_TABLE_KEY_HASH_BYTES:
+        hash_value = _ebpf_hash_bytes(key, hash_table->key_size, hash_table->seed);
+        break;
+    default:
+        if (hash_table->extract) {
+            hash_table->extract(key, &data, &length);
+        } else {
+            length = hash_table->key_size * 8;
+            data = key;
+        }
+        if (hash_table->key_hash == EBPF_HASH_TABLE_KEY_HASH_CALLER) {
+            hash_value = hash_table->hash_function(data, length, hash_table->seed);
+        } else {
+            hash_value = _ebpf_murmur3_32(data, length, (uint32_t)hash_table->seed);
+        }
+        break;
     }
-    uint32_t hash_value = _ebpf_murmur3_32(data, length, hash_table->seed);
     return hash_value & hash_table->bucket_count_mask;
 }
 
@@ -626,8 +783,33 @@ ebpf_hash_table_create(_Out_ ebpf_hash_table_t** hash_table, _In_ const ebpf_has
     table->bucket_count = bucket_count;
     table->bucket_count_mask = bucket_count - 1;
     table->entry_count = 0;
-    table->seed = ebpf_random_uint32();
+    table->seed = ((uint64_t)ebpf_random_uint32() << 32) | ebpf_random_uint32();
     table->extract = options->extract_function;
+    table->hash_function = options->hash_function;
+    if (options->hash_function) {
+        table->key_hash = EBPF_HASH_TABLE_KEY_HASH_CALLER;
+    } else if (options->extract_function) {
+        // Extracted keys can end on a bit boundary, which only murmur3 handles.
+        table->key_hash = EBPF_HASH_TABLE_KEY_HASH_MURMUR3;
+    } else {
+        switch (options->key_size) {
+        case 4:
+            table->key_hash = EBPF_HASH_TABLE_KEY_HASH_4_BYTES;
+            break;
+        case 8:
+            table->key_hash = EBPF_HASH_TABLE_KEY_HASH_8_BYTES;
+            break;
+        case 16:
+            table->key_hash = EBPF_HASH_TABLE_KEY_HASH_16_BYTES;
+            break;
+        case 40:
+            table->key_hash = EBPF_HASH_TABLE_KEY_HASH_40_BYTES;
+            break;
+        default:
+            table->key_hash = EBPF_HASH_TABLE_KEY_HASH_BYTES;
+            break;
+        }
+    }
     table->max_entry_count = options->max_entries;
     table->supplemental_value_size = options->supplemental_value_size;
     table->notification_context = options->notification_context;
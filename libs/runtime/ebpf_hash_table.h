@@ -43,6 +43,17 @@ extern "C"
         _Outptr_result_buffer_((*length_in_bits + 7) / 8) const uint8_t** data,
         _Out_ size_t* length_in_bits);
 
+    /**
+     * @brief Function to compute the hash of a key.
+     *
+     * @param[in] key Key (or data extracted from the key) to hash.
+     * @param[in] length_in_bits Length of the key in bits.
+     * @param[in] seed Per-table random seed.
+     * @return Hash of the key.
+     */
+    typedef uint32_t (*ebpf_hash_table_hash_function)(
+        _In_reads_((length_in_bits + 7) / 8) const uint8_t* key, size_t length_in_bits, uint64_t seed);
+
     /**
      * @brief Options to pass to ebpf_hash_table_create.
      *
@@ -56,6 +67,7 @@ extern "C"
         size_t value_size; //< Size of value in bytes.
         // Optional fields.
         ebpf_hash_table_extract_function extract_function; //< Function to extract key from stored value.
+        ebpf_hash_table_hash_function hash_function;       //< Hash function - defaults to one chosen by key size.
         ebpf_hash_table_allocate allocate; //< Function to allocate memory - defaults to ebpf_epoch_allocate.
         ebpf_hash_table_free free;         //< Function to free memory - defaults to ebpf_epoch_free.
         size_t minimum_bucket_count;       //< Minimum number of buckets to use - defaults to
@@ -242,6 +254,18 @@ extern "C"
         _Out_ uint8_t* next_key,
         _Inout_opt_ uint8_t** next_value);
 
+    /**
+     * @brief Compute a 64-bit hash of a buffer, using the hash function of hash
+     * tables with whole byte keys.
+     *
+     * @param[in] key Pointer to the bytes to hash.
+     * @param[in] length Number of bytes to hash.
+     * @param[in] seed Seed to randomize the hash.
+     * @return Hash of the bytes.
+     */
+    uint64_t
+    ebpf_hash_bytes(_In_reads_(length) const uint8_t* key, size_t length, uint64_t seed);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
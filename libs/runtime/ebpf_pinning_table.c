@@ -1,41 +1,92 @@
 // Copyright (c) Microsoft Corporation
 // SPDX-License-Identifier: MIT
 
-// The pinning table stores ebpf_pinning_entry_t objects in an ebpf_hash_table_t, which is designed to store fixed
-// size keys and values. The pinning table uses cxplat_utf8_string_t as the key for this table, which is a variable
-// sized structure with embedded pointers. As a result, cxplat_utf8_string_t structures are not directly comparable.
-// To handle this case, the ebpf_hash_table_t exposes an extract method, that accepts a key and returns
-// a pointer to data that can be compared or hashed. The ebpf_hash_table_t is initialized to use cxplat_utf8_string_t*
-// as keys and ebpf_pinning_entry_t* as values.
-// Insertion - The key is a pointer to the cxplat_utf8_string_t embedded in the ebpf_pinning_entry_t and the value is
-// a pointer to the ebpf_pinning_entry_t object.
-// Find/Delete - The key is a pointer to an cxplat_utf8_string_t that contains the string to search for.
-// Find returns a pointer to the ebpf_pinning_entry_t object. Comparison is done based on the value pointed to by the
-// key. Delete erases the entry from the ebpf_hash_table_t, but doesn't free the memory associated with the
-// ebpf_pinning_entry_t.
+// The pinning table keeps pointers to its ebpf_pinning_entry_t objects in an array sorted by path. Paths are compared
+// byte by byte, with a path ordered before any longer path it is a prefix of. Find, insert and delete locate the
+// entry with a binary search, and enumeration walks the array in path order, so getting the next path after a given
+// one no longer rescans the table from the start. Paths that share a prefix are adjacent in the array, which makes it
+// cheap to enumerate all the pins under a "directory" by searching for the prefix and walking forward until a path no
+// longer starts with it.
 
 #define EBPF_FILE_ID EBPF_FILE_ID_PINNING_TABLE
 
 #include "ebpf_core_structs.h"
-#include "ebpf_hash_table.h"
 #include "ebpf_object.h"
 #include "ebpf_pinning_table.h"
 #include "ebpf_tracelog.h"
 
-#define EBPF_PINNING_TABLE_BUCKET_COUNT 64
+#define EBPF_PINNING_TABLE_INITIAL_CAPACITY 64
 
 typedef struct _ebpf_pinning_table
 {
-    _Guarded_by_(lock) ebpf_hash_table_t* hash_table;
+    _Guarded_by_(lock) ebpf_pinning_entry_t** entries; ///< Entries sorted by path.
+    _Guarded_by_(lock) size_t entry_count;
+    _Guarded_by_(lock) size_t entry_capacity;
     ebpf_lock_t lock;
 } ebpf_pinning_table_t;
 
-static void
-_ebpf_pinning_table_extract(_In_ const uint8_t* value, _Outptr_ const uint8_t** data, _Out_ size_t* length)
+static int
+_ebpf_pinning_table_compare_paths(_In_ const cxplat_utf8_string_t* left, _In_ const cxplat_utf8_string_t* right)
+{
+    size_t length = min(left->length, right->length);
+    int result = (length > 0) ? memcmp(left->value, right->value, length) : 0;
+    if (result != 0) {
+        return result;
+    }
+    return (left->length < right->length) ? -1 : (left->length > right->length) ? 1 : 0;
+}
+
+static bool
+_ebpf_pinning_table_path_has_prefix(_In_ const cxplat_utf8_string_t* path, _In_opt_ const cxplat_utf8_string_t* prefix)
+{
+    if (prefix == NULL || prefix->length == 0) {
+        return true;
+    }
+    return path->length >= prefix->length && memcmp(path->value, prefix->value, prefix->length) == 0;
+}
+
+/**
+ * @brief Find the index of the first entry whose path is not less than (or, if strict, greater than) the given path.
+ *
+ * @param[in] pinning_table Pinning table to search. The caller must hold the lock.
+ * @param[in] path Path to search for.
+ * @param[in] strict Skip an entry that is equal to the path.
+ * @returns Index of the entry, or the entry count if there is no such entry.
+ */
+static size_t
+_ebpf_pinning_table_search(
+    _In_ const ebpf_pinning_table_t* pinning_table, _In_ const cxplat_utf8_string_t* path, bool strict)
+{
+    size_t low = 0;
+    size_t high = pinning_table->entry_count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        int result = _ebpf_pinning_table_compare_paths(&pinning_table->entries[middle]->path, path);
+        if (result < 0 || (strict && result == 0)) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/**
+ * @brief Find the entry with the given path.
+ *
+ * @param[in] pinning_table Pinning table to search. The caller must hold the lock.
+ * @param[in] path Path to search for.
+ * @param[out] index Index of the entry if found, else the index at which to insert it.
+ * @retval true The entry was found.
+ * @retval false The entry was not found.
+ */
+static bool
+_ebpf_pinning_table_find_index(
+    _In_ const ebpf_pinning_table_t* pinning_table, _In_ const cxplat_utf8_string_t* path, _Out_ size_t* index)
 {
-    const cxplat_utf8_string_t* key = *(cxplat_utf8_string_t**)value;
-    *data = key->value;
-    *length = key->length * 8;
+    *index = _ebpf_pinning_table_search(pinning_table, path, false);
+    return *index < pinning_table->entry_count &&
+           _ebpf_pinning_table_compare_paths(&pinning_table->entries[*index]->path, path) == 0;
 }
 
 static void
@@ -64,25 +115,18 @@ ebpf_pinning_table_allocate(ebpf_pinning_table_t** pinning_table)
 
     ebpf_lock_create(&(*pinning_table)->lock);
 
-    const ebpf_hash_table_creation_options_t options = {
-        .key_size = sizeof(cxplat_utf8_string_t*),
-        .value_size = sizeof(ebpf_pinning_entry_t*),
-        .extract_function = _ebpf_pinning_table_extract,
-        .allocate = ebpf_allocate,
-        .free = ebpf_free,
-    };
-
-    return_value = ebpf_hash_table_create(&(*pinning_table)->hash_table, &options);
-
-    if (return_value != EBPF_SUCCESS) {
+    (*pinning_table)->entries = ebpf_allocate(EBPF_PINNING_TABLE_INITIAL_CAPACITY * sizeof(ebpf_pinning_entry_t*));
+    if ((*pinning_table)->entries == NULL) {
+        return_value = EBPF_NO_MEMORY;
         goto Done;
     }
+    (*pinning_table)->entry_capacity = EBPF_PINNING_TABLE_INITIAL_CAPACITY;
 
     return_value = EBPF_SUCCESS;
 Done:
     if (return_value != EBPF_SUCCESS) {
         if ((*pinning_table)) {
-            ebpf_hash_table_destroy((*pinning_table)->hash_table);
+            ebpf_lock_destroy(&(*pinning_table)->lock);
         }
 
         ebpf_free(*pinning_table);
@@ -96,17 +140,16 @@ void
 ebpf_pinning_table_free(ebpf_pinning_table_t* pinning_table)
 {
     EBPF_LOG_ENTRY();
-    ebpf_result_t return_value;
-    cxplat_utf8_string_t* key = NULL;
-    if (pinning_table && pinning_table->hash_table) {
-        for (;;) {
-            return_value = ebpf_hash_table_next_key(pinning_table->hash_table, NULL, (uint8_t*)&key);
-            if (return_value != EBPF_SUCCESS) {
-                break;
-            }
-            ebpf_assert_success(ebpf_pinning_table_delete(pinning_table, key));
+    if (pinning_table) {
+        for (size_t index = 0; index < pinning_table->entry_count; index++) {
+            ebpf_pinning_entry_t* entry = pinning_table->entries[index];
+            EBPF_LOG_MESSAGE_UTF8_STRING(
+                EBPF_TRACELOG_LEVEL_VERBOSE, EBPF_TRACELOG_KEYWORD_BASE, "Unpinned object", &entry->path);
+            ebpf_interlocked_decrement_int32(&entry->object->pinned_path_count);
+            _ebpf_pinning_entry_free(entry);
         }
-        ebpf_hash_table_destroy(pinning_table->hash_table);
+        ebpf_free(pinning_table->entries);
+        ebpf_lock_destroy(&pinning_table->lock);
     }
 
     ebpf_free(pinning_table);
@@ -114,6 +157,37 @@ ebpf_pinning_table_free(ebpf_pinning_table_t* pinning_table)
     EBPF_RETURN_VOID();
 }
 
+/**
+ * @brief Make room for one more entry in the pinning table.
+ *
+ * @param[in, out] pinning_table Pinning table to grow. The caller must hold the lock.
+ * @retval EBPF_SUCCESS The operation was successful.
+ * @retval EBPF_NO_MEMORY Unable to allocate resources for the entry.
+ */
+static ebpf_result_t
+_ebpf_pinning_table_reserve_entry(_Inout_ ebpf_pinning_table_t* pinning_table)
+{
+    if (pinning_table->entry_count < pinning_table->entry_capacity) {
+        return EBPF_SUCCESS;
+    }
+
+    // Entry counts are reported as 32-bit values.
+    if (pinning_table->entry_capacity > UINT32_MAX / 2) {
+        return EBPF_NO_MEMORY;
+    }
+
+    size_t new_capacity = pinning_table->entry_capacity * 2;
+    ebpf_pinning_entry_t** new_entries = ebpf_allocate(new_capacity * sizeof(ebpf_pinning_entry_t*));
+    if (new_entries == NULL) {
+        return EBPF_NO_MEMORY;
+    }
+    memcpy(new_entries, pinning_table->entries, pinning_table->entry_count * sizeof(ebpf_pinning_entry_t*));
+    ebpf_free(pinning_table->entries);
+    pinning_table->entries = new_entries;
+    pinning_table->entry_capacity = new_capacity;
+    return EBPF_SUCCESS;
+}
+
 _Must_inspect_result_ ebpf_result_t
 ebpf_pinning_table_insert(
     ebpf_pinning_table_t* pinning_table, const cxplat_utf8_string_t* path, ebpf_core_object_t* object)
@@ -121,8 +195,8 @@ ebpf_pinning_table_insert(
     EBPF_LOG_ENTRY();
     ebpf_lock_state_t state;
     ebpf_result_t return_value;
-    cxplat_utf8_string_t* new_key;
     ebpf_pinning_entry_t* new_pinning_entry;
+    size_t index;
 
     if (path->length >= EBPF_MAX_PIN_PATH_LENGTH || path->length == 0) {
         EBPF_RETURN_RESULT(EBPF_INVALID_ARGUMENT);
@@ -148,18 +222,21 @@ ebpf_pinning_table_insert(
 
     new_pinning_entry->object = object;
     EBPF_OBJECT_ACQUIRE_REFERENCE(object);
-    new_key = &new_pinning_entry->path;
 
     state = ebpf_lock_lock(&pinning_table->lock);
 
-    return_value = ebpf_hash_table_update(
-        pinning_table->hash_table,
-        (const uint8_t*)&new_key,
-        (const uint8_t*)&new_pinning_entry,
-        EBPF_HASH_TABLE_OPERATION_INSERT);
-    if (return_value == EBPF_KEY_ALREADY_EXISTS) {
+    if (_ebpf_pinning_table_find_index(pinning_table, path, &index)) {
         return_value = EBPF_OBJECT_ALREADY_EXISTS;
-    } else if (return_value == EBPF_SUCCESS) {
+    } else {
+        return_value = _ebpf_pinning_table_reserve_entry(pinning_table);
+    }
+    if (return_value == EBPF_SUCCESS) {
+        memmove(
+            &pinning_table->entries[index + 1],
+            &pinning_table->entries[index],
+            (pinning_table->entry_count - index) * sizeof(ebpf_pinning_entry_t*));
+        pinning_table->entries[index] = new_pinning_entry;
+        pinning_table->entry_count++;
         new_pinning_entry = NULL;
         ebpf_interlocked_increment_int32(&object->pinned_path_count);
     }
@@ -181,17 +258,14 @@ ebpf_pinning_table_find(
 {
     EBPF_LOG_ENTRY();
     ebpf_lock_state_t state;
-    ebpf_result_t return_value;
-    const cxplat_utf8_string_t* existing_key = path;
-    ebpf_pinning_entry_t** existing_pinning_entry;
+    ebpf_result_t return_value = EBPF_KEY_NOT_FOUND;
+    size_t index;
 
     state = ebpf_lock_lock(&pinning_table->lock);
-    return_value = ebpf_hash_table_find(
-        pinning_table->hash_table, (const uint8_t*)&existing_key, (uint8_t**)&existing_pinning_entry);
-
-    if (return_value == EBPF_SUCCESS) {
-        *object = (*existing_pinning_entry)->object;
+    if (_ebpf_pinning_table_find_index(pinning_table, path, &index)) {
+        *object = pinning_table->entries[index]->object;
         EBPF_OBJECT_ACQUIRE_REFERENCE(*object);
+        return_value = EBPF_SUCCESS;
     }
 
     ebpf_lock_unlock(&pinning_table->lock, state);
@@ -204,21 +278,19 @@ ebpf_pinning_table_delete(ebpf_pinning_table_t* pinning_table, const cxplat_utf8
 {
     EBPF_LOG_ENTRY();
     ebpf_lock_state_t state;
-    ebpf_result_t return_value;
-    const cxplat_utf8_string_t* existing_key = path;
-    ebpf_pinning_entry_t** existing_pinning_entry;
+    ebpf_result_t return_value = EBPF_KEY_NOT_FOUND;
     ebpf_pinning_entry_t* entry = NULL;
+    size_t index;
 
     state = ebpf_lock_lock(&pinning_table->lock);
-    return_value = ebpf_hash_table_find(
-        pinning_table->hash_table, (const uint8_t*)&existing_key, (uint8_t**)&existing_pinning_entry);
-    if (return_value == EBPF_SUCCESS) {
-        entry = *existing_pinning_entry;
-        return_value = ebpf_hash_table_delete(pinning_table->hash_table, (const uint8_t*)&existing_key);
-        // If unable to remove the entry from the table, don't delete it.
-        if (return_value != EBPF_SUCCESS) {
-            entry = NULL;
-        }
+    if (_ebpf_pinning_table_find_index(pinning_table, path, &index)) {
+        entry = pinning_table->entries[index];
+        pinning_table->entry_count--;
+        memmove(
+            &pinning_table->entries[index],
+            &pinning_table->entries[index + 1],
+            (pinning_table->entry_count - index) * sizeof(ebpf_pinning_entry_t*));
+        return_value = EBPF_SUCCESS;
     }
     ebpf_lock_unlock(&pinning_table->lock, state);
 
@@ -239,27 +311,35 @@ _Must_inspect_result_ ebpf_result_t
 ebpf_pinning_table_enumerate_entries(
     _Inout_ ebpf_pinning_table_t* pinning_table,
     ebpf_object_type_t object_type,
-    _Out_ uint16_t* entry_count,
+    _In_opt_ const cxplat_utf8_string_t* prefix,
+    _Out_ uint32_t* entry_count,
     _Outptr_result_buffer_maybenull_(*entry_count) ebpf_pinning_entry_t** pinning_entries)
 {
     EBPF_LOG_ENTRY();
     ebpf_result_t result = EBPF_SUCCESS;
     ebpf_lock_state_t state = 0;
-    bool lock_held = FALSE;
-    uint16_t local_entry_count = 0;
-    uint16_t entries_array_length = 0;
+    uint32_t local_entry_count = 0;
+    uint32_t entries_array_length = 0;
     ebpf_pinning_entry_t* local_pinning_entries = NULL;
-    cxplat_utf8_string_t* next_object_path;
-    ebpf_pinning_entry_t* new_entry = NULL;
+    size_t first_index;
+    size_t end_index;
 
     ebpf_assert(entry_count);
     ebpf_assert(pinning_entries);
 
     state = ebpf_lock_lock(&pinning_table->lock);
-    lock_held = TRUE;
 
-    // Get output array length by finding how many entries are there in the pinning table.
-    entries_array_length = (uint16_t)ebpf_hash_table_key_count(pinning_table->hash_table);
+    // Find the range of entries under the prefix, and how many of them match the input object type.
+    first_index = (prefix == NULL) ? 0 : _ebpf_pinning_table_search(pinning_table, prefix, false);
+    for (end_index = first_index; end_index < pinning_table->entry_count; end_index++) {
+        ebpf_pinning_entry_t* entry = pinning_table->entries[end_index];
+        if (!_ebpf_pinning_table_path_has_prefix(&entry->path, prefix)) {
+            break;
+        }
+        if (object_type == EBPF_OBJECT_UNKNOWN || object_type == ebpf_object_get_type(entry->object)) {
+            entries_array_length++;
+        }
+    }
 
     // Exit if there are no entries.
     if (entries_array_length == 0) {
@@ -267,61 +347,40 @@ ebpf_pinning_table_enumerate_entries(
     }
 
     // Allocate the output array for storing the pinning entries.
-    local_pinning_entries = (ebpf_pinning_entry_t*)ebpf_allocate(sizeof(ebpf_pinning_entry_t) * entries_array_length);
+    local_pinning_entries =
+        (ebpf_pinning_entry_t*)ebpf_allocate((size_t)entries_array_length * sizeof(ebpf_pinning_entry_t));
     if (local_pinning_entries == NULL) {
         result = EBPF_NO_MEMORY;
         goto Exit;
     }
 
-    // Loop through the entries in the hashtable.
-    next_object_path = NULL;
-    for (;;) {
-        ebpf_pinning_entry_t** next_pinning_entry = NULL;
-
-        // Find next pinning entry, if any.
-        result = ebpf_hash_table_next_key_and_value(
-            pinning_table->hash_table,
-            (const uint8_t*)((next_object_path == NULL) ? NULL : &next_object_path),
-            (uint8_t*)&next_object_path,
-            (uint8_t**)&next_pinning_entry);
-
-        if (result == EBPF_NO_MORE_KEYS) {
-            // Reached end of hashtable.
-            result = EBPF_SUCCESS;
-            break;
-        }
-
-        if (result != EBPF_SUCCESS) {
-            goto Exit;
-        }
+    for (size_t index = first_index; index < end_index; index++) {
+        ebpf_pinning_entry_t* entry = pinning_table->entries[index];
 
         // Skip entries that don't match the input object type.
-        if (object_type != ebpf_object_get_type((*next_pinning_entry)->object)) {
+        if (object_type != EBPF_OBJECT_UNKNOWN && object_type != ebpf_object_get_type(entry->object)) {
             continue;
         }
 
         local_entry_count++;
         ebpf_assert(local_entry_count <= entries_array_length);
 
-        // Copy the next pinning entry to a new entry in the output array.
-        new_entry = &local_pinning_entries[local_entry_count - 1];
-        new_entry->object = (*next_pinning_entry)->object;
+        // Copy the pinning entry to a new entry in the output array.
+        ebpf_pinning_entry_t* new_entry = &local_pinning_entries[local_entry_count - 1];
+        new_entry->object = entry->object;
 
         // Take reference on underlying ebpf_object.
         EBPF_OBJECT_ACQUIRE_REFERENCE(new_entry->object);
 
         // Duplicate pinning object path.
-        result = ebpf_duplicate_utf8_string(&new_entry->path, &(*next_pinning_entry)->path);
+        result = ebpf_duplicate_utf8_string(&new_entry->path, &entry->path);
         if (result != EBPF_SUCCESS) {
             goto Exit;
         }
     }
 
 Exit:
-    // Release lock if held.
-    if (lock_held) {
-        ebpf_lock_unlock(&pinning_table->lock, state);
-    }
+    ebpf_lock_unlock(&pinning_table->lock, state);
 
     if (result != EBPF_SUCCESS) {
         ebpf_pinning_entries_release(local_entry_count, local_pinning_entries);
@@ -340,6 +399,7 @@ _Must_inspect_result_ ebpf_result_t
 ebpf_pinning_table_get_next_path(
     _Inout_ ebpf_pinning_table_t* pinning_table,
     ebpf_object_type_t object_type,
+    _In_opt_ const cxplat_utf8_string_t* prefix,
     _In_ const cxplat_utf8_string_t* start_path,
     _Inout_ cxplat_utf8_string_t* next_path)
 {
@@ -348,34 +408,34 @@ ebpf_pinning_table_get_next_path(
         EBPF_RETURN_RESULT(EBPF_INVALID_ARGUMENT);
     }
 
-    const uint8_t* previous_key = (start_path->length == 0) ? NULL : (const uint8_t*)&start_path;
-
     ebpf_lock_state_t state = ebpf_lock_lock(&pinning_table->lock);
 
-    ebpf_result_t result;
-    ebpf_pinning_entry_t** next_pinning_entry = NULL;
+    ebpf_result_t result = EBPF_NO_MORE_KEYS;
 
-    for (;;) {
-        // Get the next entry in the table.
-        cxplat_utf8_string_t* next_object_path;
-        result = ebpf_hash_table_next_key_and_value(
-            pinning_table->hash_table, previous_key, (uint8_t*)&next_object_path, (uint8_t**)&next_pinning_entry);
-        if (result != EBPF_SUCCESS) {
+    // Start after the start path, but not before the first path under the prefix.
+    size_t index = _ebpf_pinning_table_search(pinning_table, start_path, true);
+    if (prefix != NULL && _ebpf_pinning_table_compare_paths(start_path, prefix) < 0) {
+        index = _ebpf_pinning_table_search(pinning_table, prefix, false);
+    }
+
+    for (; index < pinning_table->entry_count; index++) {
+        ebpf_pinning_entry_t* entry = pinning_table->entries[index];
+        if (!_ebpf_pinning_table_path_has_prefix(&entry->path, prefix)) {
+            // Paths under the prefix are contiguous, so there are no more matches.
             break;
         }
 
         // See if the entry matches the object type the caller is interested in.
-        if (object_type == ebpf_object_get_type((*next_pinning_entry)->object)) {
-            if (next_path->length < (*next_pinning_entry)->path.length) {
+        if (object_type == EBPF_OBJECT_UNKNOWN || object_type == ebpf_object_get_type(entry->object)) {
+            if (next_path->length < entry->path.length) {
                 result = EBPF_INSUFFICIENT_BUFFER;
             } else {
-                next_path->length = (*next_pinning_entry)->path.length;
-                memcpy(next_path->value, (*next_pinning_entry)->path.value, next_path->length);
+                next_path->length = entry->path.length;
+                memcpy(next_path->value, entry->path.value, next_path->length);
                 result = EBPF_SUCCESS;
             }
             break;
         }
-        previous_key = (uint8_t*)&next_object_path;
     }
 
     ebpf_lock_unlock(&pinning_table->lock, state);
@@ -383,10 +443,10 @@ ebpf_pinning_table_get_next_path(
 }
 
 void
-ebpf_pinning_entries_release(uint16_t entry_count, _In_opt_count_(entry_count) ebpf_pinning_entry_t* pinning_entries)
+ebpf_pinning_entries_release(uint32_t entry_count, _In_opt_count_(entry_count) ebpf_pinning_entry_t* pinning_entries)
 {
     EBPF_LOG_ENTRY();
-    uint16_t index;
+    uint32_t index;
     if (!pinning_entries) {
         EBPF_RETURN_VOID();
     }
@@ -85,9 +85,12 @@ extern "C"
 
     /**
      * @brief Returns all entries in the pinning table of specified object type after acquiring a reference.
+     *  Entries are returned in path order.
      *
      * @param[in, out] pinning_table Pinning table to enumerate.
-     * @param[in] object_type eBPF object type that will be used to filter pinning entries.
+     * @param[in] object_type eBPF object type that will be used to filter pinning entries, or EBPF_OBJECT_UNKNOWN
+     *  to return entries of any type.
+     * @param[in] prefix Optional path prefix. If present, only entries whose path starts with it are returned.
      * @param[out] entry_count Number of pinning entries being returned.
      * @param[out] pinning_entries Array of pinning entries being returned. Must be freed by caller
      * using ebpf_pinning_entries_release().
@@ -98,23 +101,27 @@ extern "C"
     ebpf_pinning_table_enumerate_entries(
         _Inout_ ebpf_pinning_table_t* pinning_table,
         ebpf_object_type_t object_type,
-        _Out_ uint16_t* entry_count,
+        _In_opt_ const cxplat_utf8_string_t* prefix,
+        _Out_ uint32_t* entry_count,
         _Outptr_result_buffer_maybenull_(*entry_count) ebpf_pinning_entry_t** pinning_entries);
 
     /**
-     * @brief Gets the next path in the pinning table after a given path.
+     * @brief Gets the next path in the pinning table after a given path, in path order.
      *
      * @param[in, out] pinning_table Pinning table to enumerate.
-     * @param[in] object_type Object type.
+     * @param[in] object_type Object type, or EBPF_OBJECT_UNKNOWN to match any type.
+     * @param[in] prefix Optional path prefix. If present, only paths that start with it are returned.
      * @param[in] start_path Path to look for an entry greater than.
      * @param[in, out] next_path Returns the next path, if one exists.
      * @retval EBPF_SUCCESS The operation was successful.
      * @retval EBPF_NO_MORE_KEYS No more entries found.
+     * @retval EBPF_INSUFFICIENT_BUFFER The next path does not fit in next_path.
      */
     _Must_inspect_result_ ebpf_result_t
     ebpf_pinning_table_get_next_path(
         _Inout_ ebpf_pinning_table_t* pinning_table,
         ebpf_object_type_t object_type,
+        _In_opt_ const cxplat_utf8_string_t* prefix,
         _In_ const cxplat_utf8_string_t* start_path,
         _Inout_ cxplat_utf8_string_t* next_path);
 
@@ -125,7 +132,7 @@ extern "C"
      */
     void
     ebpf_pinning_entries_release(
-        uint16_t entry_count, _In_opt_count_(entry_count) ebpf_pinning_entry_t* pinning_entries);
+        uint32_t entry_count, _In_opt_count_(entry_count) ebpf_pinning_entry_t* pinning_entries);
 
 #ifdef __cplusplus
 }
@@ -143,6 +143,13 @@ ebpf_state_store(size_t index, uintptr_t value, _In_ const ebpf_execution_contex
     return return_value;
 }
 
+_IRQL_requires_(DISPATCH_LEVEL) void ebpf_state_store_cpu(size_t index, uintptr_t value, uint32_t cpu_id)
+{
+    // High frequency call, don't log entry/exit.
+    ebpf_assert(cpu_id < _ebpf_state_cpu_table_size);
+    _ebpf_state_cpu_table[cpu_id].state[index] = value;
+}
+
 _Must_inspect_result_ ebpf_result_t
 ebpf_state_load(size_t index, _Out_ uintptr_t* value)
 {
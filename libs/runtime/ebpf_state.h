@@ -51,6 +51,16 @@ extern "C"
     _Must_inspect_result_ ebpf_result_t
     ebpf_state_store(size_t index, uintptr_t value, _In_ const ebpf_execution_context_state_t* execution_context_state);
 
+    /**
+     * @brief Store a value in the state tracker slot of a CPU. This is the same slot ebpf_state_store and
+     * ebpf_state_load use for callers running at DISPATCH_LEVEL on that CPU, without the lookup.
+     *
+     * @param[in] index Assigned for storing state.
+     * @param[in] value Value to be stored.
+     * @param[in] cpu_id CPU the caller is running on at DISPATCH_LEVEL.
+     */
+    _IRQL_requires_(DISPATCH_LEVEL) void ebpf_state_store_cpu(size_t index, uintptr_t value, uint32_t cpu_id);
+
     /**
      * @brief Load a value in the state tracker.
      *
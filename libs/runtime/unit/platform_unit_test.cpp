@@ -366,6 +366,57 @@ run_in_epoch(std::function<void()> function)
     function();
 }
 
+TEST_CASE("hash_table_key_sizes", "[platform]")
+{
+    _test_helper test_helper;
+    test_helper.initialize();
+
+    // Covers each of the fixed size specializations as well as the generic byte and caller supplied hash functions.
+    const size_t key_sizes[] = {1, 3, 4, 8, 13, 16, 17, 32, 40, 64};
+    const ebpf_hash_table_hash_function hash_functions[] = {
+        nullptr, [](const uint8_t*, size_t, uint64_t) -> uint32_t { return 7; }};
+    for (auto hash_function : hash_functions) {
+        for (size_t key_size : key_sizes) {
+            const size_t key_count = 256;
+            const ebpf_hash_table_creation_options_t options = {
+                .key_size = key_size,
+                .value_size = sizeof(size_t),
+                .hash_function = hash_function,
+                .allocate = ebpf_allocate,
+                .free = ebpf_free,
+                .minimum_bucket_count = key_count,
+            };
+            ebpf_hash_table_t* raw_ptr = nullptr;
+            REQUIRE(ebpf_hash_table_create(&raw_ptr, &options) == EBPF_SUCCESS);
+            ebpf_hash_table_ptr table(raw_ptr);
+
+            // Keys differ only in their last two bytes so that every byte of the key has to be hashed.
+            std::vector<uint8_t> keys(key_size * key_count);
+            for (size_t index = 0; index < key_count; index++) {
+                uint8_t* key = keys.data() + index * key_size;
+                key[key_size - 1] = static_cast<uint8_t>(index);
+                if (key_size > 1) {
+                    key[key_size - 2] = static_cast<uint8_t>(index >> 8);
+                }
+            }
+            for (size_t index = 0; index < key_count; index++) {
+                REQUIRE(
+                    ebpf_hash_table_update(
+                        table.get(),
+                        keys.data() + index * key_size,
+                        reinterpret_cast<uint8_t*>(&index),
+                        EBPF_HASH_TABLE_OPERATION_INSERT) == EBPF_SUCCESS);
+            }
+            REQUIRE(ebpf_hash_table_key_count(table.get()) == key_count);
+            for (size_t index = 0; index < key_count; index++) {
+                uint8_t* value = nullptr;
+                REQUIRE(ebpf_hash_table_find(table.get(), keys.data() + index * key_size, &value) == EBPF_SUCCESS);
+                REQUIRE(*reinterpret_cast<size_t*>(value) == index);
+            }
+        }
+    }
+}
+
 TEST_CASE("hash_table_stress_test", "[platform]")
 {
     _test_helper test_helper;
@@ -506,6 +557,74 @@ TEST_CASE("pinning_test", "[platform]")
     REQUIRE(ebpf_pinning_table_delete(pinning_table.get(), &foo) == EBPF_SUCCESS);
     REQUIRE(another_object.object.base.reference_count == 2);
 
+    auto to_utf8_string = [](const std::string& path) {
+        cxplat_utf8_string_t string;
+        string.value = (uint8_t*)path.data();
+        string.length = path.size();
+        return string;
+    };
+
+    // Paths are returned in order, regardless of insertion order.
+    std::vector<std::string> paths = {"/maps/b", "/progs/p", "/maps/a", "/maps2/x"};
+    for (const auto& path : paths) {
+        cxplat_utf8_string_t path_string = to_utf8_string(path);
+        REQUIRE(ebpf_pinning_table_insert(pinning_table.get(), &path_string, &an_object.object) == EBPF_SUCCESS);
+    }
+    REQUIRE(ebpf_pinning_table_insert(pinning_table.get(), &bar, &an_object.object) == EBPF_OBJECT_ALREADY_EXISTS);
+
+    auto get_all_paths = [&](const cxplat_utf8_string_t* prefix) {
+        std::vector<std::string> result;
+        std::string start_path;
+        for (;;) {
+            char buffer[EBPF_MAX_PIN_PATH_LENGTH];
+            cxplat_utf8_string_t start_path_string = to_utf8_string(start_path);
+            cxplat_utf8_string_t next_path;
+            next_path.value = (uint8_t*)buffer;
+            next_path.length = sizeof(buffer);
+            ebpf_result_t result_code = ebpf_pinning_table_get_next_path(
+                pinning_table.get(), EBPF_OBJECT_UNKNOWN, prefix, &start_path_string, &next_path);
+            if (result_code == EBPF_NO_MORE_KEYS) {
+                break;
+            }
+            REQUIRE(result_code == EBPF_SUCCESS);
+            start_path.assign(buffer, next_path.length);
+            result.push_back(start_path);
+        }
+        return result;
+    };
+    REQUIRE(get_all_paths(nullptr) == std::vector<std::string>{"/maps/a", "/maps/b", "/maps2/x", "/progs/p", "bar"});
+
+    // Prefix enumeration only returns the paths under the prefix.
+    cxplat_utf8_string_t maps_directory = CXPLAT_UTF8_STRING_FROM_CONST_STRING("/maps/");
+    REQUIRE(get_all_paths(&maps_directory) == std::vector<std::string>{"/maps/a", "/maps/b"});
+    cxplat_utf8_string_t no_match = CXPLAT_UTF8_STRING_FROM_CONST_STRING("/none/");
+    REQUIRE(get_all_paths(&no_match).empty());
+
+    uint32_t entry_count = 0;
+    ebpf_pinning_entry_t* entries = nullptr;
+    cxplat_utf8_string_t maps_prefix = CXPLAT_UTF8_STRING_FROM_CONST_STRING("/maps");
+    REQUIRE(
+        ebpf_pinning_table_enumerate_entries(
+            pinning_table.get(), EBPF_OBJECT_MAP, &maps_prefix, &entry_count, &entries) == EBPF_SUCCESS);
+    REQUIRE(entry_count == 3);
+    REQUIRE(std::string((const char*)entries[2].path.value, entries[2].path.length) == "/maps2/x");
+    ebpf_pinning_entries_release(entry_count, entries);
+
+    // The table is not limited to 16-bit entry counts.
+    const uint32_t many_count = UINT16_MAX + 100;
+    for (uint32_t index = 0; index < many_count; index++) {
+        // Keep the paths in insertion order so each insert appends.
+        std::string path = "/many/" + std::to_string(100000 + index);
+        cxplat_utf8_string_t path_string = to_utf8_string(path);
+        REQUIRE(ebpf_pinning_table_insert(pinning_table.get(), &path_string, &an_object.object) == EBPF_SUCCESS);
+    }
+    cxplat_utf8_string_t many_prefix = CXPLAT_UTF8_STRING_FROM_CONST_STRING("/many/");
+    REQUIRE(
+        ebpf_pinning_table_enumerate_entries(
+            pinning_table.get(), EBPF_OBJECT_UNKNOWN, &many_prefix, &entry_count, &entries) == EBPF_SUCCESS);
+    REQUIRE(entry_count == many_count);
+    ebpf_pinning_entries_release(entry_count, entries);
+
     ebpf_pinning_table_free(pinning_table.release());
     REQUIRE(an_object.object.base.reference_count == 1);
     REQUIRE(another_object.object.base.reference_count == 1);
@@ -550,6 +669,204 @@ TEST_CASE("epoch_test_two_threads", "[platform]")
     thread_2.join();
 }
 
+TEST_CASE("epoch_test_counter_implementation", "[platform]")
+{
+    REQUIRE(ebpf_epoch_set_implementation(EBPF_EPOCH_IMPLEMENTATION_COUNTER) == EBPF_SUCCESS);
+    {
+        _test_helper test_helper;
+        test_helper.initialize();
+
+        // The implementation can't change while the epoch module is in use.
+        REQUIRE(ebpf_epoch_set_implementation(EBPF_EPOCH_IMPLEMENTATION_LIST) == EBPF_INVALID_STATE);
+
+        auto epoch = []() {
+            ebpf_epoch_scope_t epoch_scope;
+            void* memory = ebpf_epoch_allocate(10);
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+            ebpf_epoch_free(memory);
+            epoch_scope.exit();
+            ebpf_epoch_synchronize();
+        };
+
+        std::thread thread_1(epoch);
+        std::thread thread_2(epoch);
+        thread_1.join();
+        thread_2.join();
+
+        // Memory freed while a reader is active is only reclaimed once that reader exits.
+        uintptr_t old_thread_affinity;
+        ebpf_assert_success(ebpf_set_current_thread_affinity(1, &old_thread_affinity));
+        _signal reader_entered;
+        _signal reader_exit;
+        std::thread reader([&]() {
+            ebpf_epoch_scope_t epoch_scope;
+            reader_entered.signal();
+            reader_exit.wait();
+        });
+        reader_entered.wait();
+
+        const size_t allocation_count = 10;
+        {
+            ebpf_epoch_scope_t epoch_scope;
+            for (size_t i = 0; i < allocation_count; i++) {
+                void* memory = ebpf_epoch_allocate(100);
+                REQUIRE(memory != nullptr);
+                ebpf_epoch_free(memory);
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        ebpf_epoch_pending_free_t pending_free;
+        REQUIRE(ebpf_epoch_get_pending_free(0, &pending_free) == EBPF_SUCCESS);
+        REQUIRE(pending_free.count >= allocation_count);
+
+        reader_exit.signal();
+        reader.join();
+        ebpf_epoch_synchronize();
+        REQUIRE(ebpf_epoch_get_pending_free(0, &pending_free) == EBPF_SUCCESS);
+        REQUIRE(pending_free.count == 0);
+        REQUIRE(pending_free.bytes == 0);
+        ebpf_restore_current_thread_affinity(old_thread_affinity);
+    }
+    REQUIRE(ebpf_epoch_set_implementation(EBPF_EPOCH_IMPLEMENTATION_LIST) == EBPF_SUCCESS);
+}
+
+TEST_CASE("epoch_test_pending_free", "[platform]")
+{
+    _test_helper test_helper;
+    test_helper.initialize();
+
+    // Keep the frees and the query on one CPU.
+    uintptr_t old_thread_affinity;
+    ebpf_assert_success(ebpf_set_current_thread_affinity(1, &old_thread_affinity));
+
+    // Enough allocations to span several free batches.
+    const size_t allocation_count = 1000;
+    ebpf_epoch_pending_free_t pending_free;
+    {
+        ebpf_epoch_scope_t epoch_scope;
+        for (size_t i = 0; i < allocation_count; i++) {
+            void* memory = ebpf_epoch_allocate(100);
+            REQUIRE(memory != nullptr);
+            ebpf_epoch_free(memory);
+        }
+        REQUIRE(ebpf_epoch_get_pending_free(0, &pending_free) == EBPF_SUCCESS);
+        REQUIRE(pending_free.count >= allocation_count);
+        REQUIRE(pending_free.bytes >= allocation_count * 100);
+    }
+
+    ebpf_epoch_synchronize();
+    REQUIRE(ebpf_epoch_get_pending_free(0, &pending_free) == EBPF_SUCCESS);
+    REQUIRE(pending_free.count == 0);
+    REQUIRE(pending_free.bytes == 0);
+
+    REQUIRE(ebpf_epoch_get_pending_free(ebpf_get_cpu_count(), &pending_free) == EBPF_INVALID_ARGUMENT);
+    ebpf_restore_current_thread_affinity(old_thread_affinity);
+}
+
+TEST_CASE("epoch_test_pending_free_threshold", "[platform]")
+{
+    // Matches EBPF_EPOCH_PENDING_FREE_THRESHOLD_IN_BYTES.
+    const size_t threshold = 1024 * 1024;
+    const size_t allocation_size = 4096;
+    const size_t allocation_count = 2 * threshold / allocation_size;
+
+    // Stretch the flush timer well past the test timeout so that only the threshold can release the memory.
+    const uint64_t flush_delay_in_nanoseconds = 60ull * 1000 * 1000 * 1000;
+    REQUIRE(ebpf_epoch_set_flush_delay(flush_delay_in_nanoseconds) == EBPF_SUCCESS);
+    {
+        _test_helper test_helper;
+        test_helper.initialize();
+
+        REQUIRE(ebpf_epoch_set_flush_delay(flush_delay_in_nanoseconds) == EBPF_INVALID_STATE);
+
+        uintptr_t old_thread_affinity;
+        ebpf_assert_success(ebpf_set_current_thread_affinity(1, &old_thread_affinity));
+
+        ebpf_epoch_pending_free_t pending_free;
+        {
+            ebpf_epoch_scope_t epoch_scope;
+            for (size_t i = 0; i < allocation_count; i++) {
+                void* memory = ebpf_epoch_allocate(allocation_size);
+                REQUIRE(memory != nullptr);
+                ebpf_epoch_free(memory);
+            }
+            // The reader still holds the epoch, so nothing can be released yet.
+            REQUIRE(ebpf_epoch_get_pending_free(0, &pending_free) == EBPF_SUCCESS);
+            REQUIRE(pending_free.bytes > threshold);
+        }
+
+        // Without ebpf_epoch_synchronize, the memory must be released once the reader leaves.
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        for (;;) {
+            REQUIRE(ebpf_epoch_get_pending_free(0, &pending_free) == EBPF_SUCCESS);
+            if (pending_free.bytes == 0 || std::chrono::steady_clock::now() > deadline) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        REQUIRE(pending_free.count == 0);
+        REQUIRE(pending_free.bytes == 0);
+
+        ebpf_restore_current_thread_affinity(old_thread_affinity);
+    }
+    // Restore the default delay (EBPF_EPOCH_FLUSH_DELAY_IN_NANOSECONDS).
+    REQUIRE(ebpf_epoch_set_flush_delay(1000000) == EBPF_SUCCESS);
+    REQUIRE(ebpf_epoch_set_flush_delay(0) == EBPF_INVALID_ARGUMENT);
+}
+
+TEST_CASE("epoch_test_allocation_cache", "[platform]")
+{
+    _test_helper test_helper;
+    test_helper.initialize();
+
+    uintptr_t old_thread_affinity;
+    ebpf_assert_success(ebpf_set_current_thread_affinity(1, &old_thread_affinity));
+
+    ebpf_epoch_cache_statistics_t before;
+    REQUIRE(ebpf_epoch_get_cache_statistics(0, &before) == EBPF_SUCCESS);
+
+    void* released_memory;
+    {
+        ebpf_epoch_scope_t epoch_scope;
+        released_memory = ebpf_epoch_allocate_with_tag(100, EBPF_POOL_TAG_EPOCH);
+        REQUIRE(released_memory != nullptr);
+        memset(released_memory, 0xcc, 100);
+        ebpf_epoch_free(released_memory);
+    }
+    ebpf_epoch_synchronize();
+
+    ebpf_epoch_cache_statistics_t after;
+    REQUIRE(ebpf_epoch_get_cache_statistics(0, &after) == EBPF_SUCCESS);
+    REQUIRE(after.recycled > before.recycled);
+    before = after;
+
+    // Blocks are not shared across pool tags: the released block is not used for another tag.
+    ebpf_epoch_scope_t epoch_scope;
+    void* other_tag_memory = ebpf_epoch_allocate_with_tag(90, EBPF_POOL_TAG_MAP);
+    REQUIRE(other_tag_memory != nullptr);
+    REQUIRE(other_tag_memory != released_memory);
+    REQUIRE(ebpf_epoch_get_cache_statistics(0, &after) == EBPF_SUCCESS);
+    REQUIRE(after.hits == before.hits);
+    REQUIRE(after.misses == before.misses + 1);
+    before = after;
+
+    // The released block is reused, zeroed, for an allocation of the same size class and tag.
+    uint8_t* memory = reinterpret_cast<uint8_t*>(ebpf_epoch_allocate_with_tag(90, EBPF_POOL_TAG_EPOCH));
+    REQUIRE(memory == released_memory);
+    for (size_t i = 0; i < 90; i++) {
+        REQUIRE(memory[i] == 0);
+    }
+    REQUIRE(ebpf_epoch_get_cache_statistics(0, &after) == EBPF_SUCCESS);
+    REQUIRE(after.hits == before.hits + 1);
+    REQUIRE(after.misses == before.misses);
+
+    ebpf_epoch_free(memory);
+    ebpf_epoch_free(other_tag_memory);
+    epoch_scope.exit();
+    ebpf_restore_current_thread_affinity(old_thread_affinity);
+}
+
 /**
  * @brief Verify that the stale item worker runs.
  * Epoch free can leave items on a CPU's free list until the next epoch exit.
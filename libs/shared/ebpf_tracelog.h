@@ -25,6 +25,8 @@ extern "C"
 #define EBPF_TRACELOG_EVENT_GENERIC_ERROR "EbpfGenericError"
 #define EBPF_TRACELOG_EVENT_GENERIC_MESSAGE "EbpfGenericMessage"
 #define EBPF_TRACELOG_EVENT_API_ERROR "EbpfApiError"
+#define EBPF_TRACELOG_EVENT_PRINTK_FORMAT "EbpfPrintkFormat"
+#define EBPF_TRACELOG_EVENT_PRINTK_BINARY "EbpfPrintkBinary"
 
 #define EBPF_TRACELOG_KEYWORD_FUNCTION_ENTRY_EXIT 0x1
 #define EBPF_TRACELOG_KEYWORD_BASE 0x2
@@ -37,6 +39,11 @@ extern "C"
 #define EBPF_TRACELOG_KEYWORD_API 0x100
 #define EBPF_TRACELOG_KEYWORD_PRINTK 0x200
 #define EBPF_TRACELOG_KEYWORD_NATIVE 0x400
+// Enables binary bpf_printk output: the format string is logged once per format ID and each call only logs the ID and
+// the raw arguments, leaving formatting to the trace consumer. Only used by the ebpf_log_printk_* functions. Binary
+// output is an explicit opt-in: it is only used while no session enables EBPF_TRACELOG_KEYWORD_PRINTK, so sessions
+// that enable all keywords keep getting text output.
+#define EBPF_TRACELOG_KEYWORD_PRINTK_BINARY 0x800
 
 #define EBPF_TRACELOG_LEVEL_LOG_ALWAYS WINEVENT_LEVEL_LOG_ALWAYS
 #define EBPF_TRACELOG_LEVEL_CRITICAL WINEVENT_LEVEL_CRITICAL
@@ -76,6 +83,16 @@ extern "C"
     void
     ebpf_trace_terminate();
 
+    /**
+     * @brief Get the trace enable generation, which changes whenever a trace session enables the provider or requests
+     * a rundown of its state. Events that are only logged once, such as printk formats, must be logged again when it
+     * changes, so that every session sees them.
+     *
+     * @returns Current trace enable generation. Never 0.
+     */
+    uint32_t
+    ebpf_trace_get_enable_generation();
+
 #define EBPF_LOG_FUNCTION_SUCCESS()                                                             \
     if (TraceLoggingProviderEnabled(                                                            \
             ebpf_tracelog_provider, EBPF_TRACELOG_LEVEL_VERBOSE, EBPF_TRACELOG_KEYWORD_BASE)) { \
@@ -243,6 +260,29 @@ extern "C"
         ebpf_log_ntstatus_api_failure_message(_##keyword##, #api, status, message); \
     }
 
+    /**
+     * @brief Log the format string that binary bpf_printk events with the given format ID refer to.
+     *
+     * @param[in] format_id ID assigned to the format string.
+     * @param[in] format Format string.
+     */
+    void
+    ebpf_log_printk_format(uint32_t format_id, _In_z_ const char* format);
+
+    /**
+     * @brief Log a bpf_printk call in binary form.
+     *
+     * @param[in] format_id ID of the format string, previously logged with ebpf_log_printk_format.
+     * @param[in] argument_count Number of valid arguments.
+     * @param[in] arguments Raw arguments to the format string.
+     */
+    void
+    ebpf_log_printk_binary(uint32_t format_id, uint32_t argument_count, _In_reads_(3) const uint64_t* arguments);
+#define EBPF_LOG_PRINTK_BINARY_ENABLED()                                                          \
+    (TraceLoggingProviderEnabled(                                                                 \
+         ebpf_tracelog_provider, EBPF_TRACELOG_LEVEL_INFO, EBPF_TRACELOG_KEYWORD_PRINTK_BINARY) && \
+     !TraceLoggingProviderEnabled(ebpf_tracelog_provider, EBPF_TRACELOG_LEVEL_INFO, EBPF_TRACELOG_KEYWORD_PRINTK))
+
     void
     ebpf_log_message(ebpf_tracelog_level_t trace_level, ebpf_tracelog_keyword_t keyword, _In_z_ const char* message);
 #define EBPF_LOG_MESSAGE(trace_level, keyword, message)                              \
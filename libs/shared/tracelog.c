@@ -18,13 +18,45 @@ TRACELOGGING_DEFINE_PROVIDER(
 
 static bool _ebpf_trace_initiated = false;
 
+// Incremented whenever a trace session enables the provider or asks it to capture its state. Starts at 1, so that 0
+// can mean "never logged".
+static volatile long _ebpf_trace_enable_generation = 1;
+
+static void NTAPI
+_ebpf_trace_enable_callback(
+    _In_ const GUID* source_id,
+    unsigned long control_code,
+    unsigned char level,
+    unsigned long long match_any_keyword,
+    unsigned long long match_all_keyword,
+    _In_opt_ EVENT_FILTER_DESCRIPTOR* filter_data,
+    _Inout_opt_ void* callback_context)
+{
+    UNREFERENCED_PARAMETER(source_id);
+    UNREFERENCED_PARAMETER(level);
+    UNREFERENCED_PARAMETER(match_any_keyword);
+    UNREFERENCED_PARAMETER(match_all_keyword);
+    UNREFERENCED_PARAMETER(filter_data);
+    UNREFERENCED_PARAMETER(callback_context);
+
+    if (control_code == EVENT_CONTROL_CODE_ENABLE_PROVIDER || control_code == EVENT_CONTROL_CODE_CAPTURE_STATE) {
+        InterlockedIncrement(&_ebpf_trace_enable_generation);
+    }
+}
+
+uint32_t
+ebpf_trace_get_enable_generation()
+{
+    return (uint32_t)_ebpf_trace_enable_generation;
+}
+
 _Must_inspect_result_ ebpf_result_t
 ebpf_trace_initiate()
 {
     if (_ebpf_trace_initiated) {
         return EBPF_SUCCESS;
     }
-    TLG_STATUS status = TraceLoggingRegister(ebpf_tracelog_provider);
+    TLG_STATUS status = TraceLoggingRegisterEx(ebpf_tracelog_provider, _ebpf_trace_enable_callback, NULL);
     if (status != 0) {
         return EBPF_NO_MEMORY;
     } else {
@@ -944,6 +976,34 @@ __declspec(noinline) void ebpf_log_message_uint64(
         ebpf_assert(!"Invalid keyword");                                                                    \
         break;                                                                                              \
     }
+
+__declspec(noinline) void
+ebpf_log_printk_format(uint32_t format_id, _In_z_ const char* format)
+{
+    TraceLoggingWrite(
+        ebpf_tracelog_provider,
+        EBPF_TRACELOG_EVENT_PRINTK_FORMAT,
+        TraceLoggingLevel(LEVEL_INFO),
+        TraceLoggingKeyword(EBPF_TRACELOG_KEYWORD_PRINTK_BINARY),
+        TraceLoggingUInt32(format_id, "FormatId"),
+        TraceLoggingString(format, "Format"));
+}
+
+__declspec(noinline) void
+ebpf_log_printk_binary(uint32_t format_id, uint32_t argument_count, _In_reads_(3) const uint64_t* arguments)
+{
+    TraceLoggingWrite(
+        ebpf_tracelog_provider,
+        EBPF_TRACELOG_EVENT_PRINTK_BINARY,
+        TraceLoggingLevel(LEVEL_INFO),
+        TraceLoggingKeyword(EBPF_TRACELOG_KEYWORD_PRINTK_BINARY),
+        TraceLoggingUInt32(format_id, "FormatId"),
+        TraceLoggingUInt32(argument_count, "ArgumentCount"),
+        TraceLoggingUInt64(arguments[0], "Argument1"),
+        TraceLoggingUInt64(arguments[1], "Argument2"),
+        TraceLoggingUInt64(arguments[2], "Argument3"));
+}
+
 __declspec(noinline) void ebpf_log_message_uint64_uint64(
     ebpf_tracelog_level_t trace_level,
     ebpf_tracelog_keyword_t keyword,
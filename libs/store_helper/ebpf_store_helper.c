@@ -33,6 +33,19 @@ Exit:
     return result;
 }
 
+ebpf_result_t
+ebpf_store_increment_generation(ebpf_store_key_t provider_key)
+{
+    uint32_t generation;
+
+    // The counter is created by the first update.
+    if (!IS_SUCCESS(ebpf_read_registry_value_dword(provider_key, EBPF_STORE_GENERATION, &generation))) {
+        generation = 0;
+    }
+
+    return ebpf_write_registry_value_dword(provider_key, EBPF_STORE_GENERATION, generation + 1);
+}
+
 static ebpf_result_t
 _ebpf_store_update_helper_prototype(
     ebpf_store_key_t helper_info_key, _In_ const ebpf_helper_function_prototype_t* helper_info)
@@ -111,6 +124,9 @@ ebpf_store_update_global_helper_information(
     }
 
 Exit:
+    if (IS_SUCCESS(result)) {
+        result = ebpf_store_increment_generation(provider_key);
+    }
     ebpf_close_registry_key(helper_info_key);
     ebpf_close_registry_key(provider_key);
 
@@ -193,6 +209,9 @@ ebpf_store_update_section_information(
     }
 
 Exit:
+    if (IS_SUCCESS(result)) {
+        result = ebpf_store_increment_generation(provider_key);
+    }
     ebpf_close_registry_key(section_info_key);
     ebpf_close_registry_key(provider_key);
 
@@ -316,6 +335,9 @@ ebpf_store_update_program_information(
     }
 
 Exit:
+    if (IS_SUCCESS(result)) {
+        result = ebpf_store_increment_generation(provider_key);
+    }
     ebpf_close_registry_key(program_info_key);
     ebpf_close_registry_key(provider_key);
 
@@ -355,6 +377,9 @@ ebpf_store_delete_program_information(_In_ const ebpf_program_info_t* program_in
     }
 
 Exit:
+    if (IS_SUCCESS(result)) {
+        result = ebpf_store_increment_generation(provider_key);
+    }
     ebpf_close_registry_key(program_info_key);
     ebpf_close_registry_key(provider_key);
 
@@ -386,6 +411,9 @@ ebpf_store_delete_section_information(_In_ const ebpf_program_section_info_t* se
     }
 
 Exit:
+    if (IS_SUCCESS(result)) {
+        result = ebpf_store_increment_generation(provider_key);
+    }
     ebpf_close_registry_key(section_info_key);
     ebpf_close_registry_key(provider_key);
 
@@ -261,6 +261,7 @@ net_ebpf_extension_wfp_filter_context_create(
         // rundown, it cannot fail. If it does, this is indicative of a fatal system level error.
         __fastfail(FAST_FAIL_INVALID_ARG);
     }
+    local_filter_context->active_client = client_context;
 
     *filter_context = local_filter_context;
     local_filter_context = NULL;
@@ -276,10 +277,11 @@ void
 net_ebpf_extension_wfp_filter_context_cleanup(_Frees_ptr_ net_ebpf_extension_wfp_filter_context_t* filter_context)
 {
     // Since the hook client is detaching, the eBPF program should not be invoked any further.
-    // The client_detached field in filter_context is set to false for this reason. This way any
-    // lingering WFP classify callbacks will exit as it would not find any hook client associated
-    // with the filter context. This is best effort & no locks are held.
-    filter_context->client_detached = TRUE;
+    // The active_client field in filter_context is cleared for this reason. This way any
+    // lingering WFP classify callbacks will exit as they would not find any hook client associated
+    // with the filter context. Classify callbacks that already read the client are drained by the
+    // hook provider before the client is freed.
+    WritePointerRelease((PVOID volatile*)&filter_context->active_client, NULL);
     DEREFERENCE_FILTER_CONTEXT(filter_context);
 }
 
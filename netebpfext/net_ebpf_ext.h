@@ -98,9 +98,27 @@ typedef struct _net_ebpf_extension_wfp_filter_context
     net_ebpf_ext_wfp_filter_id_t* filter_ids; ///< Array of WFP filter Ids.
     uint32_t filter_ids_count;                ///< Number of WFP filter Ids.
 
-    bool client_detached : 1; ///< True if client has detached.
+    const struct _net_ebpf_extension_hook_client* volatile active_client; /*!< Hook NPI client to invoke from classify
+                                                                          callbacks, or NULL once the client has
+                                                                          detached. */
 } net_ebpf_extension_wfp_filter_context_t;
 
+/**
+ * @brief Get the hook client that classify callbacks on this filter context should invoke. The filter context holds
+ * rundown protection on its hook client until the filter context itself is freed, so the returned client stays valid
+ * for as long as the filter context does, without acquiring rundown protection on every classify.
+ *
+ * @param[in] filter_context Filter context passed to the classify callback.
+ *
+ * @returns Pointer to the hook client, or NULL if the client has detached.
+ */
+__forceinline const struct _net_ebpf_extension_hook_client*
+net_ebpf_extension_wfp_filter_context_get_client(_In_ const net_ebpf_extension_wfp_filter_context_t* filter_context)
+{
+    return (const struct _net_ebpf_extension_hook_client*)ReadPointerAcquire(
+        (PVOID const volatile*)&filter_context->active_client);
+}
+
 #define REFERENCE_FILTER_CONTEXT(filter_context)                  \
     if ((filter_context) != NULL) {                               \
         InterlockedIncrement(&(filter_context)->reference_count); \
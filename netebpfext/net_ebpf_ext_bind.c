@@ -161,7 +161,7 @@ net_ebpf_ext_bind_register_providers()
     const net_ebpf_extension_program_info_provider_parameters_t program_info_provider_parameters = {
         &_ebpf_bind_program_info_provider_moduleid, &_ebpf_bind_program_info_provider_data};
     const net_ebpf_extension_hook_provider_parameters_t hook_provider_parameters = {
-        &_ebpf_bind_hook_provider_moduleid, &_net_ebpf_extension_bind_hook_provider_data};
+        &_ebpf_bind_hook_provider_moduleid, &_net_ebpf_extension_bind_hook_provider_data, BIND_PERMIT};
 
     // Set the program type as the provider module id.
     _ebpf_bind_program_info_provider_moduleid.Guid = EBPF_PROGRAM_TYPE_BIND;
@@ -263,7 +263,9 @@ net_ebpf_ext_resource_allocation_classify(
         goto Exit;
     }
 
-    if (filter_context->client_detached) {
+    attached_client =
+        (net_ebpf_extension_hook_client_t*)net_ebpf_extension_wfp_filter_context_get_client(filter_context);
+    if (attached_client == NULL) {
         NET_EBPF_EXT_LOG_MESSAGE_NTSTATUS(
             NET_EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
             NET_EBPF_EXT_TRACELOG_KEYWORD_BIND,
@@ -272,17 +274,6 @@ net_ebpf_ext_resource_allocation_classify(
         goto Exit;
     }
 
-    attached_client = (net_ebpf_extension_hook_client_t*)filter_context->client_context;
-    if (!net_ebpf_extension_hook_client_enter_rundown(attached_client)) {
-        NET_EBPF_EXT_LOG_MESSAGE_NTSTATUS(
-            NET_EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
-            NET_EBPF_EXT_TRACELOG_KEYWORD_BIND,
-            "net_ebpf_ext_resource_allocation_classify - Client detach detected.",
-            STATUS_INVALID_PARAMETER);
-        attached_client = NULL;
-        goto Exit;
-    }
-
     addr.sin_port =
         incoming_fixed_values->incomingValue[FWPS_FIELD_ALE_RESOURCE_ASSIGNMENT_V4_IP_LOCAL_PORT].value.uint16;
     addr.sin_addr.S_un.S_addr =
@@ -320,9 +311,6 @@ net_ebpf_ext_resource_allocation_classify(
     }
 
 Exit:
-    if (attached_client) {
-        net_ebpf_extension_hook_client_leave_rundown(attached_client);
-    }
     return;
 }
 
@@ -354,7 +342,9 @@ net_ebpf_ext_resource_release_classify(
         goto Exit;
     }
 
-    if (filter_context->client_detached) {
+    attached_client =
+        (net_ebpf_extension_hook_client_t*)net_ebpf_extension_wfp_filter_context_get_client(filter_context);
+    if (attached_client == NULL) {
         NET_EBPF_EXT_LOG_MESSAGE_NTSTATUS(
             NET_EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
             NET_EBPF_EXT_TRACELOG_KEYWORD_BIND,
@@ -363,17 +353,6 @@ net_ebpf_ext_resource_release_classify(
         goto Exit;
     }
 
-    attached_client = (net_ebpf_extension_hook_client_t*)filter_context->client_context;
-    if (!net_ebpf_extension_hook_client_enter_rundown(attached_client)) {
-        NET_EBPF_EXT_LOG_MESSAGE_NTSTATUS(
-            NET_EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
-            NET_EBPF_EXT_TRACELOG_KEYWORD_BIND,
-            "net_ebpf_ext_resource_release_classify - Rundown already started.",
-            STATUS_INVALID_PARAMETER);
-        attached_client = NULL;
-        goto Exit;
-    }
-
     addr.sin_port = incoming_fixed_values->incomingValue[FWPS_FIELD_ALE_RESOURCE_RELEASE_V4_IP_LOCAL_PORT].value.uint16;
     addr.sin_addr.S_un.S_addr =
         incoming_fixed_values->incomingValue[FWPS_FIELD_ALE_RESOURCE_RELEASE_V4_IP_LOCAL_ADDRESS].value.uint32;
@@ -398,9 +377,6 @@ net_ebpf_ext_resource_release_classify(
     classify_output->actionType = FWP_ACTION_PERMIT;
 
 Exit:
-    if (attached_client) {
-        net_ebpf_extension_hook_client_leave_rundown(attached_client);
-    }
     return;
 }
 
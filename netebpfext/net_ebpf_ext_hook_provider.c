@@ -11,23 +11,69 @@ typedef struct _net_ebpf_ext_hook_client_rundown
 } net_ebpf_ext_hook_client_rundown_t;
 
 struct _net_ebpf_extension_hook_provider;
+struct _net_ebpf_extension_hook_client;
 
 /**
- * @brief Data structure representing a hook NPI client (attached eBPF program). This is returned
- * as the provider binding context in the NMR client attach callback.
+ * @brief Data structure representing an attached eBPF program (hook NPI client). This is returned as the provider
+ * binding context in the NMR client attach callback. Programs that attach with the same attach parameter are chained
+ * on a single net_ebpf_extension_hook_client_t, which is what the hook modules see.
  */
-typedef struct _net_ebpf_extension_hook_client
+typedef struct _net_ebpf_extension_hook_program
 {
-    LIST_ENTRY link;                               ///< Link to next client (if any).
+    LIST_ENTRY link;                               ///< Link to next program in the same hook client (if any).
     HANDLE nmr_binding_handle;                     ///< NMR binding handle.
     GUID client_module_id;                         ///< NMR module Id.
     const void* client_binding_context;            ///< Client supplied context to be passed when invoking eBPF program.
-    const ebpf_extension_data_t* client_data;      ///< Client supplied attach parameters.
     ebpf_program_invoke_function_t invoke_program; ///< Pointer to function to invoke eBPF program.
+    ebpf_program_batch_begin_invoke_function_t batch_begin; ///< Pointer to function to begin a batch invocation.
+    ebpf_program_batch_invoke_function_t batch_invoke;      ///< Pointer to function to invoke eBPF program in a batch.
+    ebpf_program_batch_end_invoke_function_t batch_end;     ///< Pointer to function to end a batch invocation.
+    struct _net_ebpf_extension_hook_client* hook_client;    ///< Hook client this program is chained on.
+    PIO_WORKITEM detach_work_item; ///< Pointer to IO work item that is invoked to detach the program.
+    bool last_program;             ///< True if detaching this program detaches the hook client.
+} net_ebpf_extension_hook_program_t;
+
+/**
+ * @brief Array of programs to invoke, in invocation order. Arrays are never modified while classify callbacks may be
+ * walking them; updates fill in the inactive generation and then switch to it.
+ */
+typedef struct _net_ebpf_extension_hook_program_array
+{
+    uint32_t capacity; ///< Number of programs the array can hold.
+    uint32_t count;    ///< Number of programs in the array.
+    bool shared_batch; ///< True if all programs share the same batch functions, so the chain is entered only once.
+    _Field_size_(capacity) net_ebpf_extension_hook_program_t* programs[1];
+} net_ebpf_extension_hook_program_array_t;
+
+/**
+ * @brief One generation of the program array. Classify callbacks at DISPATCH_LEVEL walk the active generation without
+ * taking any reference: an update retires the previous generation only after a DPC has run on every CPU, which can't
+ * happen while a CPU is still walking it. Callers below DISPATCH_LEVEL can be preempted, so they hold the rundown
+ * protection of the generation they are walking instead.
+ */
+typedef struct _net_ebpf_extension_hook_program_generation
+{
+    EX_RUNDOWN_REF protection; ///< Held while the program array is walked below DISPATCH_LEVEL.
+    net_ebpf_extension_hook_program_array_t* programs; ///< Programs to invoke.
+} net_ebpf_extension_hook_program_generation_t;
+
+/**
+ * @brief Data structure representing a hook NPI client as seen by the hook modules. It owns the hook specific state
+ * (e.g. WFP filters) for one attach parameter, and the ordered chain of eBPF programs attached with that parameter.
+ */
+typedef struct _net_ebpf_extension_hook_client
+{
+    LIST_ENTRY link;                   ///< Link to next client (if any).
+    ebpf_extension_data_t client_data; ///< Copy of the attach parameters shared by all chained programs.
     void* provider_data; ///< Opaque pointer to hook specific data associated with this client.
     struct _net_ebpf_extension_hook_provider* provider_context; ///< Pointer to the hook NPI provider context.
-    PIO_WORKITEM detach_work_item;              ///< Pointer to IO work item that is invoked to detach the client.
     net_ebpf_ext_hook_client_rundown_t rundown; ///< Pointer to rundown object used to synchronize detach operation.
+    volatile long reference_count;              ///< One reference per chained program that has not finished detaching.
+    LIST_ENTRY programs_list;  ///< Programs chained on this client, in attach order. Guarded by the provider lock.
+    uint32_t program_count;    ///< Count of programs in programs_list. Guarded by the provider lock.
+    EX_PUSH_LOCK update_lock;  ///< Serializes updates of the program array generations.
+    volatile long active_generation; ///< Index of the generation classify callbacks should walk.
+    net_ebpf_extension_hook_program_generation_t generations[2]; ///< Current and previous program arrays.
 } net_ebpf_extension_hook_client_t;
 
 typedef struct _net_ebpf_extension_hook_clients_list
@@ -46,6 +92,10 @@ typedef struct _net_ebpf_extension_hook_provider
     net_ebpf_extension_hook_on_client_detach detach_callback; /*!< Pointer to hook specific callback to be invoked
                                                               when a client detaches. */
     const void* custom_data; ///< Opaque pointer to hook specific data associated for this provider.
+    uint32_t continue_result; ///< Program result that lets the next chained program run.
+    EX_PUSH_LOCK grace_period_lock; ///< Serializes use of the grace period DPCs.
+    uint32_t grace_period_dpc_count; ///< Number of grace period DPCs, one per CPU.
+    _Field_size_(grace_period_dpc_count) KDPC* grace_period_dpcs; ///< DPCs queued to wait for a grace period.
     _Guarded_by_(lock)
         LIST_ENTRY attached_clients_list; ///< Linked list of hook NPI clients that are attached to this provider.
 } net_ebpf_extension_hook_provider_t;
@@ -62,6 +112,9 @@ typedef struct _net_ebpf_extension_hook_provider
         KeLeaveCriticalRegion();       \
     }
 
+// Number of functions in a program dispatch table that includes the batch invoke functions.
+#define NET_EBPF_EXTENSION_BATCH_DISPATCH_TABLE_COUNT 4
+
 #define ACQUIRE_PUSH_LOCK_EXCLUSIVE(lock) _ACQUIRE_PUSH_LOCK(lock, Exclusive)
 #define ACQUIRE_PUSH_LOCK_SHARED(lock) _ACQUIRE_PUSH_LOCK(lock, Shared)
 
@@ -72,34 +125,19 @@ typedef struct _net_ebpf_extension_hook_provider
  * @brief Initialize the hook client rundown state.
  *
  * @param[in, out] hook_client Pointer to the attached hook NPI client.
- *
- * @retval STATUS_SUCCESS Operation succeeded.
- * @retval STATUS_INSUFFICIENT_RESOURCES IO work item could not be allocated.
  */
-static NTSTATUS
-_ebpf_ext_attach_init_rundown(net_ebpf_extension_hook_client_t* hook_client)
+static void
+_ebpf_ext_attach_init_rundown(_Inout_ net_ebpf_extension_hook_client_t* hook_client)
 {
-    NTSTATUS status = STATUS_SUCCESS;
     net_ebpf_ext_hook_client_rundown_t* rundown = &hook_client->rundown;
 
     NET_EBPF_EXT_LOG_ENTRY();
 
-    //
-    // Allocate work item for client detach processing.
-    //
-    hook_client->detach_work_item = IoAllocateWorkItem(_net_ebpf_ext_driver_device_object);
-    if (hook_client->detach_work_item == NULL) {
-        status = STATUS_INSUFFICIENT_RESOURCES;
-        NET_EBPF_EXT_LOG_NTSTATUS_API_FAILURE(NET_EBPF_EXT_TRACELOG_KEYWORD_EXTENSION, "IoAllocateWorkItem", status);
-        goto Exit;
-    }
-
     // Initialize the rundown and disable new references.
     ExInitializeRundownProtection(&rundown->protection);
     rundown->rundown_occurred = FALSE;
 
-Exit:
-    NET_EBPF_EXT_RETURN_NTSTATUS(status);
+    NET_EBPF_EXT_LOG_EXIT();
 }
 
 /**
@@ -119,13 +157,304 @@ _ebpf_ext_attach_wait_for_rundown(_Inout_ net_ebpf_ext_hook_client_rundown_t* ru
     NET_EBPF_EXT_LOG_EXIT();
 }
 
+/**
+ * @brief Allocate an empty program array.
+ *
+ * @param[in] capacity Number of programs the array must be able to hold.
+ *
+ * @returns Pointer to the program array, or NULL if it could not be allocated.
+ */
+static net_ebpf_extension_hook_program_array_t*
+_net_ebpf_extension_hook_program_array_allocate(uint32_t capacity)
+{
+    size_t size = EBPF_OFFSET_OF(net_ebpf_extension_hook_program_array_t, programs) +
+                  (size_t)capacity * sizeof(net_ebpf_extension_hook_program_t*);
+    net_ebpf_extension_hook_program_array_t* program_array =
+        (net_ebpf_extension_hook_program_array_t*)ExAllocatePoolUninitialized(
+            NonPagedPoolNx, size, NET_EBPF_EXTENSION_POOL_TAG);
+    if (program_array != NULL) {
+        memset(program_array, 0, size);
+        program_array->capacity = capacity;
+    }
+    return program_array;
+}
+
+/**
+ * @brief Determine whether a whole program array can be invoked under a single batch invocation. This is the case when
+ * every program is bound to the same execution context, i.e. shares the same batch functions. That execution context
+ * is then entered once, using the first program, and each program is invoked within it.
+ *
+ * @param[in, out] program_array Program array to update.
+ */
+static void
+_net_ebpf_extension_hook_program_array_update_shared_batch(
+    _Inout_ net_ebpf_extension_hook_program_array_t* program_array)
+{
+    const net_ebpf_extension_hook_program_t* first_program =
+        (program_array->count > 0) ? program_array->programs[0] : NULL;
+
+    program_array->shared_batch =
+        (first_program != NULL && first_program->batch_begin != NULL && first_program->batch_invoke != NULL &&
+         first_program->batch_end != NULL);
+    for (uint32_t index = 1; index < program_array->count && program_array->shared_batch; index++) {
+        const net_ebpf_extension_hook_program_t* program = program_array->programs[index];
+        program_array->shared_batch =
+            (program->batch_begin == first_program->batch_begin &&
+             program->batch_invoke == first_program->batch_invoke && program->batch_end == first_program->batch_end);
+    }
+}
+
+KDEFERRED_ROUTINE _net_ebpf_extension_hook_grace_period_dpc;
+
+void
+_net_ebpf_extension_hook_grace_period_dpc(
+    _In_ KDPC* dpc, _In_opt_ void* context, _In_opt_ void* system_argument1, _In_opt_ void* system_argument2)
+{
+    UNREFERENCED_PARAMETER(dpc);
+    UNREFERENCED_PARAMETER(context);
+    UNREFERENCED_PARAMETER(system_argument1);
+    UNREFERENCED_PARAMETER(system_argument2);
+}
+
+/**
+ * @brief Wait until every CPU has dropped below DISPATCH_LEVEL at least once, so that no classify callback that started
+ * walking a program array at DISPATCH_LEVEL before the call is still walking it.
+ *
+ * @param[in, out] provider_context Provider whose grace period DPCs are used.
+ */
+static void
+_net_ebpf_extension_hook_provider_wait_for_grace_period(_Inout_ net_ebpf_extension_hook_provider_t* provider_context)
+{
+    ACQUIRE_PUSH_LOCK_EXCLUSIVE(&provider_context->grace_period_lock);
+    for (uint32_t index = 0; index < provider_context->grace_period_dpc_count; index++) {
+        (void)KeInsertQueueDpc(&provider_context->grace_period_dpcs[index], NULL, NULL);
+    }
+    KeFlushQueuedDpcs();
+    RELEASE_PUSH_LOCK_EXCLUSIVE(&provider_context->grace_period_lock);
+}
+
+/**
+ * @brief Publish a new program array reflecting the programs currently chained on the hook client, and wait for
+ * classify callbacks to stop using the previous one. Both generations always have room for every chained program, so
+ * this never allocates memory.
+ *
+ * @param[in, out] hook_client Hook client whose program array is to be updated.
+ * @param[in] replacement_array Optional larger array to replace the previous generation's array with, once it is no
+ * longer in use.
+ */
+_Requires_exclusive_lock_held_(hook_client->update_lock) static void
+    _net_ebpf_extension_hook_client_publish_programs(
+        _Inout_ net_ebpf_extension_hook_client_t* hook_client,
+        _In_opt_ _Post_invalid_ net_ebpf_extension_hook_program_array_t* replacement_array)
+{
+    long active_generation = hook_client->active_generation;
+    net_ebpf_extension_hook_program_generation_t* generation = &hook_client->generations[1 - active_generation];
+    net_ebpf_extension_hook_program_array_t* program_array = generation->programs;
+
+    // Fill in the inactive generation from the programs currently chained on the hook client. The inactive generation
+    // is run down, so nothing can be walking its program array.
+    program_array->count = 0;
+    ACQUIRE_PUSH_LOCK_SHARED(&hook_client->provider_context->lock);
+    for (LIST_ENTRY* link = hook_client->programs_list.Flink;
+         link != &hook_client->programs_list && program_array->count < program_array->capacity;
+         link = link->Flink) {
+        program_array->programs[program_array->count++] =
+            CONTAINING_RECORD(link, net_ebpf_extension_hook_program_t, link);
+    }
+    RELEASE_PUSH_LOCK_SHARED(&hook_client->provider_context->lock);
+    _net_ebpf_extension_hook_program_array_update_shared_batch(program_array);
+
+    // Make the new generation available and switch classify callbacks over to it.
+    ExInitializeRundownProtection(&generation->protection);
+    InterlockedExchange(&hook_client->active_generation, 1 - active_generation);
+
+    // Wait for classify callbacks that are still walking the previous generation, at DISPATCH_LEVEL and below. Once
+    // this returns the previous generation is retired and can be refilled by the next update.
+    generation = &hook_client->generations[active_generation];
+    _net_ebpf_extension_hook_provider_wait_for_grace_period(hook_client->provider_context);
+    ExWaitForRundownProtectionRelease(&generation->protection);
+
+    if (replacement_array != NULL) {
+        ExFreePool(generation->programs);
+        generation->programs = replacement_array;
+    }
+}
+
+/**
+ * @brief Chain a program on an existing hook client and start invoking it after the programs already chained.
+ *
+ * @param[in, out] hook_client Hook client to chain the program on. The caller holds a reference on it.
+ * @param[in, out] program The program that is attaching.
+ *
+ * @retval STATUS_SUCCESS Operation succeeded.
+ * @retval STATUS_INSUFFICIENT_RESOURCES A program array could not be allocated.
+ * @retval STATUS_DELETE_PENDING The last program chained on the hook client is detaching.
+ */
+static NTSTATUS
+_net_ebpf_extension_hook_client_add_program(
+    _Inout_ net_ebpf_extension_hook_client_t* hook_client, _Inout_ net_ebpf_extension_hook_program_t* program)
+{
+    NTSTATUS status = STATUS_SUCCESS;
+    net_ebpf_extension_hook_program_array_t* new_arrays[EBPF_COUNT_OF(hook_client->generations)] = {0};
+    uint32_t required_capacity;
+    long active_generation;
+
+    NET_EBPF_EXT_LOG_ENTRY();
+
+    // Programs are only added with the update lock held, so the program count can't grow until the lock is released.
+    ACQUIRE_PUSH_LOCK_EXCLUSIVE(&hook_client->update_lock);
+
+    ACQUIRE_PUSH_LOCK_SHARED(&hook_client->provider_context->lock);
+    required_capacity = hook_client->program_count + 1;
+    RELEASE_PUSH_LOCK_SHARED(&hook_client->provider_context->lock);
+
+    // Allocate everything up front, so that removing programs never needs to allocate.
+    for (uint32_t index = 0; index < EBPF_COUNT_OF(hook_client->generations); index++) {
+        if (hook_client->generations[index].programs->capacity < required_capacity) {
+            new_arrays[index] = _net_ebpf_extension_hook_program_array_allocate(required_capacity);
+            NET_EBPF_EXT_BAIL_ON_ALLOC_FAILURE_STATUS(
+                NET_EBPF_EXT_TRACELOG_KEYWORD_EXTENSION, new_arrays[index], "program_array", status);
+        }
+    }
+
+    ACQUIRE_PUSH_LOCK_EXCLUSIVE(&hook_client->provider_context->lock);
+    if (hook_client->program_count == 0) {
+        status = STATUS_DELETE_PENDING;
+    } else {
+        InsertTailList(&hook_client->programs_list, &program->link);
+        hook_client->program_count++;
+        program->hook_client = hook_client;
+    }
+    RELEASE_PUSH_LOCK_EXCLUSIVE(&hook_client->provider_context->lock);
+    if (!NT_SUCCESS(status)) {
+        goto Exit;
+    }
+
+    // The inactive generation is run down, so its array can be replaced right away. The active one is replaced once
+    // classify callbacks have switched to the new generation.
+    active_generation = hook_client->active_generation;
+    if (new_arrays[1 - active_generation] != NULL) {
+        ExFreePool(hook_client->generations[1 - active_generation].programs);
+        hook_client->generations[1 - active_generation].programs = new_arrays[1 - active_generation];
+        new_arrays[1 - active_generation] = NULL;
+    }
+    _net_ebpf_extension_hook_client_publish_programs(hook_client, new_arrays[active_generation]);
+    new_arrays[active_generation] = NULL;
+
+Exit:
+    RELEASE_PUSH_LOCK_EXCLUSIVE(&hook_client->update_lock);
+
+    for (uint32_t index = 0; index < EBPF_COUNT_OF(new_arrays); index++) {
+        if (new_arrays[index] != NULL) {
+            ExFreePool(new_arrays[index]);
+        }
+    }
+
+    NET_EBPF_EXT_RETURN_NTSTATUS(status);
+}
+
+/**
+ * @brief Allocate a hook client for the first program attaching with a given attach parameter.
+ *
+ * @param[in] provider_context Provider module's context.
+ * @param[in] client_data Attach parameters supplied by the program.
+ * @param[in, out] program The program that is attaching.
+ * @param[out] hook_client Pointer to the allocated hook client.
+ *
+ * @retval STATUS_SUCCESS Operation succeeded.
+ * @retval STATUS_INSUFFICIENT_RESOURCES Not enough memory to allocate resources.
+ */
+static NTSTATUS
+_net_ebpf_extension_hook_client_create(
+    _In_ net_ebpf_extension_hook_provider_t* provider_context,
+    _In_opt_ const ebpf_extension_data_t* client_data,
+    _Inout_ net_ebpf_extension_hook_program_t* program,
+    _Outptr_ net_ebpf_extension_hook_client_t** hook_client)
+{
+    NTSTATUS status = STATUS_SUCCESS;
+    net_ebpf_extension_hook_client_t* local_hook_client = NULL;
+    size_t client_data_size = (client_data != NULL && client_data->data != NULL) ? client_data->size : 0;
+
+    NET_EBPF_EXT_LOG_ENTRY();
+
+    // The attach parameters are copied, as the hook client outlives the program that supplied them if other programs
+    // are chained on it.
+    local_hook_client = (net_ebpf_extension_hook_client_t*)ExAllocatePoolUninitialized(
+        NonPagedPoolNx, sizeof(net_ebpf_extension_hook_client_t) + client_data_size, NET_EBPF_EXTENSION_POOL_TAG);
+    NET_EBPF_EXT_BAIL_ON_ALLOC_FAILURE_STATUS(
+        NET_EBPF_EXT_TRACELOG_KEYWORD_EXTENSION, local_hook_client, "hook_client", status);
+
+    memset(local_hook_client, 0, sizeof(net_ebpf_extension_hook_client_t));
+    if (client_data != NULL) {
+        local_hook_client->client_data = *client_data;
+        if (client_data_size > 0) {
+            memcpy(local_hook_client + 1, client_data->data, client_data_size);
+            local_hook_client->client_data.data = local_hook_client + 1;
+        }
+    }
+    local_hook_client->provider_context = provider_context;
+    local_hook_client->reference_count = 1;
+    InitializeListHead(&local_hook_client->programs_list);
+    InsertTailList(&local_hook_client->programs_list, &program->link);
+    local_hook_client->program_count = 1;
+    ExInitializePushLock(&local_hook_client->update_lock);
+    _ebpf_ext_attach_init_rundown(local_hook_client);
+
+    for (uint32_t index = 0; index < EBPF_COUNT_OF(local_hook_client->generations); index++) {
+        net_ebpf_extension_hook_program_generation_t* generation = &local_hook_client->generations[index];
+        ExInitializeRundownProtection(&generation->protection);
+        generation->programs = _net_ebpf_extension_hook_program_array_allocate(1);
+        NET_EBPF_EXT_BAIL_ON_ALLOC_FAILURE_STATUS(
+            NET_EBPF_EXT_TRACELOG_KEYWORD_EXTENSION, generation->programs, "program_array", status);
+    }
+
+    // Generation 0 starts out active with just this program. Generation 1 starts out run down.
+    local_hook_client->generations[0].programs->programs[0] = program;
+    local_hook_client->generations[0].programs->count = 1;
+    _net_ebpf_extension_hook_program_array_update_shared_batch(local_hook_client->generations[0].programs);
+    ExWaitForRundownProtectionRelease(&local_hook_client->generations[1].protection);
+    local_hook_client->active_generation = 0;
+
+    program->hook_client = local_hook_client;
+    *hook_client = local_hook_client;
+    local_hook_client = NULL;
+
+Exit:
+    if (local_hook_client != NULL) {
+        for (uint32_t index = 0; index < EBPF_COUNT_OF(local_hook_client->generations); index++) {
+            if (local_hook_client->generations[index].programs != NULL) {
+                ExFreePool(local_hook_client->generations[index].programs);
+            }
+        }
+        ExFreePool(local_hook_client);
+    }
+
+    NET_EBPF_EXT_RETURN_NTSTATUS(status);
+}
+
+/**
+ * @brief Release a reference on a hook client, freeing it when the last chained program has finished detaching.
+ *
+ * @param[in, out] hook_client Hook client to release.
+ */
+static void
+_net_ebpf_extension_hook_client_release_reference(_Inout_ net_ebpf_extension_hook_client_t* hook_client)
+{
+    if (InterlockedDecrement(&hook_client->reference_count) == 0) {
+        for (uint32_t index = 0; index < EBPF_COUNT_OF(hook_client->generations); index++) {
+            ExFreePool(hook_client->generations[index].programs);
+        }
+        ExFreePool(hook_client);
+    }
+}
+
 IO_WORKITEM_ROUTINE _net_ebpf_extension_detach_client_completion;
 #if !defined(__cplusplus)
 #pragma alloc_text(PAGE, _net_ebpf_extension_detach_client_completion)
 #endif
 
 /**
- * @brief IO work item routine callback that waits on client rundown to complete.
+ * @brief IO work item routine callback that waits for classify callbacks to stop using a detaching program.
  *
  * @param[in] device_object IO Device object.
  * @param[in] context Pointer to work item context.
@@ -134,7 +463,8 @@ IO_WORKITEM_ROUTINE _net_ebpf_extension_detach_client_completion;
 void
 _net_ebpf_extension_detach_client_completion(_In_ DEVICE_OBJECT* device_object, _In_opt_ void* context)
 {
-    net_ebpf_extension_hook_client_t* hook_client = (net_ebpf_extension_hook_client_t*)context;
+    net_ebpf_extension_hook_program_t* program = (net_ebpf_extension_hook_program_t*)context;
+    net_ebpf_extension_hook_client_t* hook_client;
     PIO_WORKITEM work_item;
 
     PAGED_CODE();
@@ -142,22 +472,34 @@ _net_ebpf_extension_detach_client_completion(_In_ DEVICE_OBJECT* device_object,
 
     NET_EBPF_EXT_LOG_ENTRY();
 
-    ASSERT(hook_client != NULL);
-    _Analysis_assume_(hook_client != NULL);
+    ASSERT(program != NULL);
+    _Analysis_assume_(program != NULL);
 
-    work_item = hook_client->detach_work_item;
+    work_item = program->detach_work_item;
+    hook_client = program->hook_client;
 
     // The NMR model is async, but the only Windows run-down protection API available is a blocking API, so the
     // following call will block until all using threads are complete. This should be fixed in the future.
     // Issue: https://github.com/microsoft/ebpf-for-windows/issues/1854
 
-    // Wait for any in progress callbacks to complete.
-    _ebpf_ext_attach_wait_for_rundown(&hook_client->rundown);
+    // Wait until classify callbacks stop invoking this program. Classify callbacks don't take rundown protection on
+    // the hook client itself, so this is also what drains callbacks that read the client from a filter context just
+    // before the last program detached; they switch over to an empty program array.
+    ACQUIRE_PUSH_LOCK_EXCLUSIVE(&hook_client->update_lock);
+    _net_ebpf_extension_hook_client_publish_programs(hook_client, NULL);
+    RELEASE_PUSH_LOCK_EXCLUSIVE(&hook_client->update_lock);
+
+    if (program->last_program) {
+        // Wait for the hook specific state (e.g. WFP filter and flow contexts) to release the hook client.
+        _ebpf_ext_attach_wait_for_rundown(&hook_client->rundown);
+    }
+
+    _net_ebpf_extension_hook_client_release_reference(hook_client);
 
     IoFreeWorkItem(work_item);
 
-    // Note: This frees the provider binding context (hook_client).
-    NmrProviderDetachClientComplete(hook_client->nmr_binding_handle);
+    // Note: This frees the provider binding context (program).
+    NmrProviderDetachClientComplete(program->nmr_binding_handle);
 
     NET_EBPF_EXT_LOG_EXIT();
 }
@@ -180,7 +522,7 @@ net_ebpf_extension_hook_client_leave_rundown(_Inout_ net_ebpf_extension_hook_cli
 const ebpf_extension_data_t*
 net_ebpf_extension_hook_client_get_client_data(_In_ const net_ebpf_extension_hook_client_t* hook_client)
 {
-    return hook_client->client_data;
+    return &hook_client->client_data;
 }
 
 void
@@ -195,20 +537,142 @@ net_ebpf_extension_hook_client_get_provider_data(_In_ const net_ebpf_extension_h
     return hook_client->provider_data;
 }
 
+net_ebpf_extension_hook_client_t*
+net_ebpf_extension_hook_program_get_client(_In_ const void* provider_binding_context)
+{
+    return ((const net_ebpf_extension_hook_program_t*)provider_binding_context)->hook_client;
+}
+
 const void*
 net_ebpf_extension_hook_provider_get_custom_data(_In_ const net_ebpf_extension_hook_provider_t* provider_context)
 {
     return provider_context->custom_data;
 }
 
+/**
+ * @brief Acquire the current program array of a hook client below DISPATCH_LEVEL. Acquiring a generation only fails if
+ * an update has already switched to the other generation, so retry with the new one.
+ *
+ * @param[in, out] hook_client Hook client whose programs are to be invoked.
+ *
+ * @returns The acquired generation, to be released with ExReleaseRundownProtection.
+ */
+static net_ebpf_extension_hook_program_generation_t*
+_net_ebpf_extension_hook_client_acquire_programs(_Inout_ net_ebpf_extension_hook_client_t* hook_client)
+{
+    net_ebpf_extension_hook_program_generation_t* generation;
+    for (;;) {
+        generation = &hook_client->generations[ReadAcquire(&hook_client->active_generation)];
+        if (ExAcquireRundownProtection(&generation->protection)) {
+            return generation;
+        }
+    }
+}
+
+void
+net_ebpf_extension_hook_invoke_program_batch(
+    _Inout_ net_ebpf_extension_hook_client_t* client,
+    uint32_t context_count,
+    _In_reads_(context_count) void* const* contexts,
+    _Out_writes_(context_count) uint32_t* results,
+    _Out_writes_(context_count) ebpf_result_t* invoke_results)
+{
+    uint32_t continue_result = client->provider_context->continue_result;
+    ebpf_execution_context_state_t state;
+
+    ASSERT(context_count <= NET_EBPF_EXTENSION_HOOK_MAX_BATCH_SIZE);
+    _Analysis_assume_(context_count <= NET_EBPF_EXTENSION_HOOK_MAX_BATCH_SIZE);
+
+    // Bit i is set while context i still has to be handed to the next chained program.
+    uint64_t pending_contexts =
+        (context_count == NET_EBPF_EXTENSION_HOOK_MAX_BATCH_SIZE) ? UINT64_MAX : ((1ull << context_count) - 1);
+
+    for (uint32_t index = 0; index < context_count; index++) {
+        results[index] = 0;
+        invoke_results[index] = EBPF_SUCCESS;
+    }
+
+    // At DISPATCH_LEVEL the active generation can't be retired until this callback returns. Below DISPATCH_LEVEL the
+    // generation is held by its rundown protection instead.
+    bool preemptible = (KeGetCurrentIrql() < DISPATCH_LEVEL);
+    net_ebpf_extension_hook_program_generation_t* generation =
+        preemptible ? _net_ebpf_extension_hook_client_acquire_programs(client)
+                    : &client->generations[ReadAcquire(&client->active_generation)];
+
+    // Invoke each chained program on every context that is still pending. When the programs share their batch
+    // functions the execution context is entered once for the whole chain, otherwise once per program.
+    const net_ebpf_extension_hook_program_array_t* program_array = generation->programs;
+    const net_ebpf_extension_hook_program_t* batch_program = NULL;
+    if (program_array->shared_batch) {
+        batch_program = program_array->programs[0];
+        ebpf_result_t begin_result =
+            batch_program->batch_begin(batch_program->client_binding_context, sizeof(state), &state);
+        if (begin_result != EBPF_SUCCESS) {
+            for (uint32_t context_index = 0; context_index < context_count; context_index++) {
+                invoke_results[context_index] = begin_result;
+            }
+            goto Exit;
+        }
+    }
+
+    for (uint32_t index = 0; index < program_array->count && pending_contexts != 0; index++) {
+        const net_ebpf_extension_hook_program_t* program = program_array->programs[index];
+        bool batch = program_array->shared_batch ||
+                     (program->batch_begin != NULL && program->batch_invoke != NULL && program->batch_end != NULL);
+
+        if (batch && !program_array->shared_batch) {
+            ebpf_result_t begin_result = program->batch_begin(program->client_binding_context, sizeof(state), &state);
+            if (begin_result != EBPF_SUCCESS) {
+                for (uint32_t context_index = 0; context_index < context_count; context_index++) {
+                    if (pending_contexts & (1ull << context_index)) {
+                        invoke_results[context_index] = begin_result;
+                    }
+                }
+                break;
+            }
+        }
+
+        for (uint32_t context_index = 0; context_index < context_count; context_index++) {
+            if (!(pending_contexts & (1ull << context_index))) {
+                continue;
+            }
+            ebpf_result_t invoke_result =
+                batch ? program->batch_invoke(
+                            program->client_binding_context, contexts[context_index], &results[context_index], &state)
+                      : program->invoke_program(
+                            program->client_binding_context, contexts[context_index], &results[context_index]);
+            invoke_results[context_index] = invoke_result;
+            if (invoke_result != EBPF_SUCCESS ||
+                (continue_result != NET_EBPF_EXTENSION_HOOK_CONTINUE_ANY_RESULT &&
+                 results[context_index] != continue_result)) {
+                pending_contexts &= ~(1ull << context_index);
+            }
+        }
+
+        if (batch && !program_array->shared_batch) {
+            (void)program->batch_end(program->client_binding_context, &state);
+        }
+    }
+
+    if (batch_program != NULL) {
+        (void)batch_program->batch_end(batch_program->client_binding_context, &state);
+    }
+
+Exit:
+    if (preemptible) {
+        ExReleaseRundownProtection(&generation->protection);
+    }
+}
+
 _Must_inspect_result_ ebpf_result_t
 net_ebpf_extension_hook_invoke_program(
-    _In_ const net_ebpf_extension_hook_client_t* client, _Inout_ void* context, _Out_ uint32_t* result)
+    _Inout_ net_ebpf_extension_hook_client_t* client, _Inout_ void* context, _Out_ uint32_t* result)
 {
-    ebpf_program_invoke_function_t invoke_program = client->invoke_program;
-    const void* client_binding_context = client->client_binding_context;
+    ebpf_result_t invoke_result;
+
+    // A single context is a burst of one, so the chaining rules live in one place.
+    net_ebpf_extension_hook_invoke_program_batch(client, 1, &context, result, &invoke_result);
 
-    ebpf_result_t invoke_result = invoke_program(client_binding_context, context, result);
     NET_EBPF_EXT_RETURN_RESULT(invoke_result);
 }
 
@@ -251,7 +715,7 @@ net_ebpf_extension_hook_check_attach_parameter(
             net_ebpf_extension_hook_client_t* next_client =
                 (net_ebpf_extension_hook_client_t*)CONTAINING_RECORD(link, net_ebpf_extension_hook_client_t, link);
 
-            const ebpf_extension_data_t* next_client_data = next_client->client_data;
+            const ebpf_extension_data_t* next_client_data = &next_client->client_data;
             const void* next_client_attach_parameter =
                 (next_client_data->data == NULL) ? wild_card_attach_parameter : next_client_data->data;
             if (((memcmp(wild_card_attach_parameter, next_client_attach_parameter, attach_parameter_size) == 0)) ||
@@ -276,19 +740,45 @@ Exit:
     NET_EBPF_EXT_RETURN_RESULT(result);
 }
 
-void
-_net_ebpf_extension_hook_client_cleanup(_In_opt_ _Frees_ptr_opt_ net_ebpf_extension_hook_client_t* hook_client)
+/**
+ * @brief Find the hook client that programs attaching with the given attach parameters are chained on.
+ *
+ * @param[in] provider_context Provider module's context.
+ * @param[in] client_data Attach parameters supplied by the program.
+ *
+ * @returns Pointer to the hook client, or NULL if no program is attached with the same attach parameters.
+ */
+_Requires_lock_held_(provider_context->lock) static net_ebpf_extension_hook_client_t*
+    _net_ebpf_extension_hook_find_client(
+        _In_ const net_ebpf_extension_hook_provider_t* provider_context,
+        _In_opt_ const ebpf_extension_data_t* client_data)
 {
-    if (hook_client != NULL) {
-        if (hook_client->detach_work_item != NULL) {
-            IoFreeWorkItem(hook_client->detach_work_item);
+    const void* attach_parameter = (client_data != NULL) ? client_data->data : NULL;
+    size_t attach_parameter_size = (attach_parameter != NULL) ? client_data->size : 0;
+
+    for (LIST_ENTRY* link = provider_context->attached_clients_list.Flink;
+         link != &provider_context->attached_clients_list;
+         link = link->Flink) {
+        net_ebpf_extension_hook_client_t* hook_client =
+            (net_ebpf_extension_hook_client_t*)CONTAINING_RECORD(link, net_ebpf_extension_hook_client_t, link);
+        const void* hook_client_attach_parameter = hook_client->client_data.data;
+        size_t hook_client_attach_parameter_size =
+            (hook_client_attach_parameter != NULL) ? hook_client->client_data.size : 0;
+
+        if (attach_parameter_size == hook_client_attach_parameter_size &&
+            (attach_parameter_size == 0 ||
+             memcmp(attach_parameter, hook_client_attach_parameter, attach_parameter_size) == 0)) {
+            return hook_client;
         }
-        ExFreePool(hook_client);
     }
+
+    return NULL;
 }
 
 /**
- * @brief Callback invoked when an eBPF hook NPI client (a.k.a eBPF link object) attaches.
+ * @brief Callback invoked when an eBPF hook NPI client (a.k.a eBPF link object) attaches. The first program attaching
+ * with a given attach parameter creates a hook client and is handed to the hook specific attach callback. Later
+ * programs with the same attach parameter are chained on the existing hook client and are invoked after it.
  *
  * @param[in] nmr_binding_handle NMR binding between the client module and the provider module.
  * @param[in] provider_context Provider module's context.
@@ -314,7 +804,9 @@ _net_ebpf_extension_hook_provider_attach_client(
 {
     NTSTATUS status = STATUS_SUCCESS;
     net_ebpf_extension_hook_provider_t* local_provider_context = (net_ebpf_extension_hook_provider_t*)provider_context;
+    net_ebpf_extension_hook_program_t* program = NULL;
     net_ebpf_extension_hook_client_t* hook_client = NULL;
+    const ebpf_extension_data_t* client_data;
     ebpf_extension_program_dispatch_table_t* client_dispatch_table;
     ebpf_result_t result = EBPF_SUCCESS;
 
@@ -332,18 +824,6 @@ _net_ebpf_extension_hook_provider_attach_client(
     *provider_binding_context = NULL;
     *provider_dispatch = NULL;
 
-    hook_client = (net_ebpf_extension_hook_client_t*)ExAllocatePoolUninitialized(
-        NonPagedPoolNx, sizeof(net_ebpf_extension_hook_client_t), NET_EBPF_EXTENSION_POOL_TAG);
-    NET_EBPF_EXT_BAIL_ON_ALLOC_FAILURE_STATUS(
-        NET_EBPF_EXT_TRACELOG_KEYWORD_EXTENSION, hook_client, "hook_client", status);
-
-    memset(hook_client, 0, sizeof(net_ebpf_extension_hook_client_t));
-
-    hook_client->detach_work_item = NULL;
-    hook_client->nmr_binding_handle = nmr_binding_handle;
-    hook_client->client_module_id = client_registration_instance->ModuleId->Guid;
-    hook_client->client_binding_context = client_binding_context;
-    hook_client->client_data = (const ebpf_extension_data_t*)client_registration_instance->NpiSpecificCharacteristics;
     client_dispatch_table = (ebpf_extension_program_dispatch_table_t*)client_dispatch;
     if (client_dispatch_table == NULL) {
         status = STATUS_INVALID_PARAMETER;
@@ -353,16 +833,66 @@ _net_ebpf_extension_hook_provider_attach_client(
             "client_dispatch_table is NULL. Attach attempt rejected.");
         goto Exit;
     }
-    hook_client->invoke_program = client_dispatch_table->ebpf_program_invoke_function;
-    hook_client->provider_context = local_provider_context;
 
-    status = _ebpf_ext_attach_init_rundown(hook_client);
-    if (!NT_SUCCESS(status)) {
-        NET_EBPF_EXT_LOG_MESSAGE_NTSTATUS(
+    program = (net_ebpf_extension_hook_program_t*)ExAllocatePoolUninitialized(
+        NonPagedPoolNx, sizeof(net_ebpf_extension_hook_program_t), NET_EBPF_EXTENSION_POOL_TAG);
+    NET_EBPF_EXT_BAIL_ON_ALLOC_FAILURE_STATUS(NET_EBPF_EXT_TRACELOG_KEYWORD_EXTENSION, program, "program", status);
+
+    memset(program, 0, sizeof(net_ebpf_extension_hook_program_t));
+
+    program->nmr_binding_handle = nmr_binding_handle;
+    program->client_module_id = client_registration_instance->ModuleId->Guid;
+    program->client_binding_context = client_binding_context;
+    program->invoke_program = client_dispatch_table->ebpf_program_invoke_function;
+    if (client_dispatch_table->count >= NET_EBPF_EXTENSION_BATCH_DISPATCH_TABLE_COUNT) {
+        program->batch_begin = client_dispatch_table->ebpf_program_batch_begin_invoke_function;
+        program->batch_invoke = client_dispatch_table->ebpf_program_batch_invoke_function;
+        program->batch_end = client_dispatch_table->ebpf_program_batch_end_invoke_function;
+    }
+
+    program->detach_work_item = IoAllocateWorkItem(_net_ebpf_ext_driver_device_object);
+    if (program->detach_work_item == NULL) {
+        status = STATUS_INSUFFICIENT_RESOURCES;
+        NET_EBPF_EXT_LOG_MESSAGE(
             NET_EBPF_EXT_TRACELOG_LEVEL_ERROR,
             NET_EBPF_EXT_TRACELOG_KEYWORD_EXTENSION,
-            "_ebpf_ext_attach_init_rundown failed. Attach attempt rejected.",
-            status);
+            "IoAllocateWorkItem failed. Attach attempt rejected.");
+        goto Exit;
+    }
+
+    client_data = (const ebpf_extension_data_t*)client_registration_instance->NpiSpecificCharacteristics;
+
+    // Chain the program on an existing hook client with the same attach parameter, if there is one.
+    ACQUIRE_PUSH_LOCK_SHARED(&local_provider_context->lock);
+    hook_client = _net_ebpf_extension_hook_find_client(local_provider_context, client_data);
+    if (hook_client != NULL) {
+        InterlockedIncrement(&hook_client->reference_count);
+    }
+    RELEASE_PUSH_LOCK_SHARED(&local_provider_context->lock);
+
+    if (hook_client != NULL) {
+        status = _net_ebpf_extension_hook_client_add_program(hook_client, program);
+        if (NT_SUCCESS(status)) {
+            // The reference taken above is now held by the program.
+            goto Exit;
+        }
+        _net_ebpf_extension_hook_client_release_reference(hook_client);
+        hook_client = NULL;
+        if (status != STATUS_DELETE_PENDING) {
+            NET_EBPF_EXT_LOG_MESSAGE_NTSTATUS(
+                NET_EBPF_EXT_TRACELOG_LEVEL_ERROR,
+                NET_EBPF_EXT_TRACELOG_KEYWORD_EXTENSION,
+                "_net_ebpf_extension_hook_client_add_program failed. Attach attempt rejected.",
+                status);
+            goto Exit;
+        }
+
+        // The hook client is being detached, so start a new one.
+        status = STATUS_SUCCESS;
+    }
+
+    status = _net_ebpf_extension_hook_client_create(local_provider_context, client_data, program, &hook_client);
+    if (!NT_SUCCESS(status)) {
         goto Exit;
     }
 
@@ -380,21 +910,26 @@ _net_ebpf_extension_hook_provider_attach_client(
             "attach_callback returned failure. Attach attempt rejected.",
             result);
         status = STATUS_ACCESS_DENIED;
+        _net_ebpf_extension_hook_client_release_reference(hook_client);
     }
 
 Exit:
     if (NT_SUCCESS(status)) {
-        *provider_binding_context = hook_client;
-        hook_client = NULL;
-    } else {
-        _net_ebpf_extension_hook_client_cleanup(hook_client);
+        *provider_binding_context = program;
+        program = NULL;
+    } else if (program != NULL) {
+        if (program->detach_work_item != NULL) {
+            IoFreeWorkItem(program->detach_work_item);
+        }
+        ExFreePool(program);
     }
 
     NET_EBPF_EXT_RETURN_NTSTATUS(status);
 }
 
 /**
- * @brief Callback invoked when a hook NPI client (a.k.a. eBPF link object) detaches.
+ * @brief Callback invoked when a hook NPI client (a.k.a. eBPF link object) detaches. The hook specific detach callback
+ * is only invoked when the last program chained on a hook client detaches.
  *
  * @param[in] provider_binding_context Provider module's context for binding with the client.
  * @retval STATUS_SUCCESS The operation succeeded.
@@ -408,32 +943,36 @@ _net_ebpf_extension_hook_provider_detach_client(_In_ const void* provider_bindin
 
     NET_EBPF_EXT_LOG_ENTRY();
 
-    net_ebpf_extension_hook_client_t* local_client_context =
-        (net_ebpf_extension_hook_client_t*)provider_binding_context;
-
-    net_ebpf_extension_hook_provider_t* local_provider_context = local_client_context->provider_context;
+    net_ebpf_extension_hook_program_t* program = (net_ebpf_extension_hook_program_t*)provider_binding_context;
 
-    if (local_client_context == NULL) {
+    if (program == NULL) {
         NET_EBPF_EXT_LOG_MESSAGE(
             NET_EBPF_EXT_TRACELOG_LEVEL_ERROR,
             NET_EBPF_EXT_TRACELOG_KEYWORD_EXTENSION,
-            "local_client_context is NULL. Detach attempt rejected.");
+            "program is NULL. Detach attempt rejected.");
         status = STATUS_INVALID_PARAMETER;
         goto Exit;
     }
 
-    // Invoke hook specific handler for processing client detach.
-    local_provider_context->detach_callback(local_client_context);
+    net_ebpf_extension_hook_client_t* hook_client = program->hook_client;
+    net_ebpf_extension_hook_provider_t* local_provider_context = hook_client->provider_context;
 
     ACQUIRE_PUSH_LOCK_EXCLUSIVE(&local_provider_context->lock);
-    RemoveEntryList(&local_client_context->link);
+    RemoveEntryList(&program->link);
+    hook_client->program_count--;
+    if (hook_client->program_count == 0) {
+        program->last_program = TRUE;
+        RemoveEntryList(&hook_client->link);
+    }
     RELEASE_PUSH_LOCK_EXCLUSIVE(&local_provider_context->lock);
 
+    if (program->last_program) {
+        // Invoke hook specific handler for processing client detach.
+        local_provider_context->detach_callback(hook_client);
+    }
+
     IoQueueWorkItem(
-        local_client_context->detach_work_item,
-        _net_ebpf_extension_detach_client_completion,
-        DelayedWorkQueue,
-        (void*)local_client_context);
+        program->detach_work_item, _net_ebpf_extension_detach_client_completion, DelayedWorkQueue, (void*)program);
 
 Exit:
     NET_EBPF_EXT_RETURN_NTSTATUS(status);
@@ -464,6 +1003,9 @@ net_ebpf_extension_hook_provider_unregister(
                     NET_EBPF_EXT_TRACELOG_KEYWORD_EXTENSION, "NmrDeregisterProvider", status);
             }
         }
+        if (provider_context->grace_period_dpcs != NULL) {
+            ExFreePool(provider_context->grace_period_dpcs);
+        }
         ExFreePool(provider_context);
     }
     NET_EBPF_EXT_LOG_EXIT();
@@ -491,6 +1033,32 @@ net_ebpf_extension_hook_provider_register(
     ExInitializePushLock(&local_provider_context->lock);
     InitializeListHead(&local_provider_context->attached_clients_list);
 
+    // Allocate one grace period DPC per CPU up front, so that publishing a program array never needs to allocate.
+    ExInitializePushLock(&local_provider_context->grace_period_lock);
+    uint32_t cpu_count = KeQueryMaximumProcessorCountEx(ALL_PROCESSOR_GROUPS);
+    local_provider_context->grace_period_dpcs =
+        (KDPC*)ExAllocatePoolUninitialized(NonPagedPoolNx, sizeof(KDPC) * cpu_count, NET_EBPF_EXTENSION_POOL_TAG);
+    NET_EBPF_EXT_BAIL_ON_ALLOC_FAILURE_STATUS(
+        NET_EBPF_EXT_TRACELOG_KEYWORD_EXTENSION,
+        local_provider_context->grace_period_dpcs,
+        "grace_period_dpcs",
+        status);
+    for (uint32_t index = 0; index < cpu_count; index++) {
+        PROCESSOR_NUMBER processor_number;
+        KDPC* dpc = &local_provider_context->grace_period_dpcs[index];
+        KeInitializeDpc(dpc, _net_ebpf_extension_hook_grace_period_dpc, NULL);
+        status = KeGetProcessorNumberFromIndex(index, &processor_number);
+        if (NT_SUCCESS(status)) {
+            status = KeSetTargetProcessorDpcEx(dpc, &processor_number);
+        }
+        if (!NT_SUCCESS(status)) {
+            NET_EBPF_EXT_LOG_NTSTATUS_API_FAILURE(
+                NET_EBPF_EXT_TRACELOG_KEYWORD_EXTENSION, "KeSetTargetProcessorDpcEx", status);
+            goto Exit;
+        }
+    }
+    local_provider_context->grace_period_dpc_count = cpu_count;
+
     characteristics = &local_provider_context->characteristics;
     characteristics->Length = sizeof(NPI_PROVIDER_CHARACTERISTICS);
     characteristics->ProviderAttachClient =
@@ -506,6 +1074,7 @@ net_ebpf_extension_hook_provider_register(
     local_provider_context->attach_callback = attach_callback;
     local_provider_context->detach_callback = detach_callback;
     local_provider_context->custom_data = custom_data;
+    local_provider_context->continue_result = parameters->continue_result;
 
     status = NmrRegisterProvider(characteristics, local_provider_context, &local_provider_context->nmr_provider_handle);
     if (!NT_SUCCESS(status)) {
@@ -9,7 +9,8 @@
 
 /**
  *  @brief This is the per client binding context for the eBPF Hook
- *         NPI provider.
+ *         NPI provider. eBPF programs that attach with the same attach
+ *         parameter share a single hook client.
  */
 typedef struct _net_ebpf_extension_hook_client net_ebpf_extension_hook_client_t;
 
@@ -88,7 +89,8 @@ net_ebpf_extension_hook_provider_unregister(
 /**
  * @brief This callback function should be implemented by hook modules. This callback is invoked when a hook NPI client
  * is attempting to attach to the hook NPI provider. The hook NPI client is allowed to attach only if the API returns
- * success.
+ * success. Programs attaching with the attach parameter of an existing client are chained on that client without
+ * invoking this callback.
  * @param attaching_client Pointer to context of the hook NPI client that is requesting to be attached.
  * @param provider_context Pointer to the hook NPI provider context to which the client is being attached.
  *
@@ -102,11 +104,17 @@ typedef ebpf_result_t (*net_ebpf_extension_hook_on_client_attach)(
 
 /**
  * @brief This callback function should be implemented by hook modules. This callback is invoked when a hook NPI client
- * is attempting to detach from the hook NPI provider.
+ * is attempting to detach from the hook NPI provider, i.e. when the last program chained on it detaches.
  * @param detaching_client Pointer to context of the hook NPI client that is requesting to be detached.
  */
 typedef void (*net_ebpf_extension_hook_on_client_detach)(_In_ const net_ebpf_extension_hook_client_t* detaching_client);
 
+/**
+ * @brief Value of continue_result that lets every chained program run regardless of the results of the programs
+ * before it.
+ */
+#define NET_EBPF_EXTENSION_HOOK_CONTINUE_ANY_RESULT UINT32_MAX
+
 /**
  * @brief Data structure for hook NPI provider registration parameters.
  */
@@ -114,6 +122,7 @@ typedef struct _net_ebpf_extension_hook_provider_parameters
 {
     const NPI_MODULEID* provider_module_id;     ///< NPI provider module ID.
     const ebpf_extension_data_t* provider_data; ///< Hook provider data (contains supported program types).
+    uint32_t continue_result; ///< Program result after which the next chained program is invoked.
 } net_ebpf_extension_hook_provider_parameters_t;
 
 /**
@@ -137,10 +146,16 @@ net_ebpf_extension_hook_provider_register(
     _Outptr_ net_ebpf_extension_hook_provider_t** provider_context);
 
 /**
- * @brief Invoke the eBPF program attached to this hook. This must be called
- * inside a net_ebpf_extension_hook_client_enter_rundown/net_ebpf_extension_hook_client_leave_rundown block.
+ * @brief Invoke the eBPF programs attached to this hook. The caller must keep the hook client alive for the
+ * duration of the call, either by holding the rundown reference of a WFP filter context associated with it (see
+ * net_ebpf_extension_wfp_filter_context_get_client) or via net_ebpf_extension_hook_client_enter_rundown.
+ * Programs are invoked in the order they attached, which is their chain priority: the attach parameters are hook
+ * specific and carry no priority, so a program that must run first has to be attached first. Invocation stops after
+ * the first program that fails or that returns a result other than the continue_result the provider was registered
+ * with, and that program's result is returned. This is net_ebpf_extension_hook_invoke_program_batch on a single
+ * context.
  *
- * @param[in] client Pointer to Hook NPI Client (a.k.a. eBPF Link object).
+ * @param[in, out] client Pointer to Hook NPI Client (a.k.a. eBPF Link object).
  * @param[in] context Context to pass to eBPF program.
  * @param[out] result Return value from the eBPF program.
  * @retval EBPF_SUCCESS The operation was successful.
@@ -149,14 +164,40 @@ net_ebpf_extension_hook_provider_register(
  */
 _Must_inspect_result_ ebpf_result_t
 net_ebpf_extension_hook_invoke_program(
-    _In_ const net_ebpf_extension_hook_client_t* client, _Inout_ void* context, _Out_ uint32_t* result);
+    _Inout_ net_ebpf_extension_hook_client_t* client, _Inout_ void* context, _Out_ uint32_t* result);
+
+/**
+ * @brief Maximum number of program contexts that can be passed to net_ebpf_extension_hook_invoke_program_batch.
+ */
+#define NET_EBPF_EXTENSION_HOOK_MAX_BATCH_SIZE 64
 
 /**
- * @brief Return client attached to the hook NPI provider.
+ * @brief Invoke the eBPF programs attached to this hook on a burst of program contexts. Each chained program is
+ * invoked on every context in the burst under a single batch invocation, instead of entering and leaving the
+ * execution context once per context. Chained programs bound to the same execution context share one batch
+ * invocation for the whole burst. Each context gets its own result, following the same chaining rules as
+ * net_ebpf_extension_hook_invoke_program. The same hook client lifetime requirements as
+ * net_ebpf_extension_hook_invoke_program apply.
+ *
+ * @param[in, out] client Pointer to Hook NPI Client (a.k.a. eBPF Link object).
+ * @param[in] context_count Number of contexts in the burst. Must not exceed NET_EBPF_EXTENSION_HOOK_MAX_BATCH_SIZE.
+ * @param[in] contexts Contexts to pass to eBPF programs.
+ * @param[out] results Return value from the eBPF programs for each context.
+ * @param[out] invoke_results Status of the program invocation for each context.
+ */
+void
+net_ebpf_extension_hook_invoke_program_batch(
+    _Inout_ net_ebpf_extension_hook_client_t* client,
+    uint32_t context_count,
+    _In_reads_(context_count) void* const* contexts,
+    _Out_writes_(context_count) uint32_t* results,
+    _Out_writes_(context_count) ebpf_result_t* invoke_results);
+
+/**
+ * @brief Return the first client attached to the hook NPI provider. All programs attached with the same attach
+ * parameter are reached through this client.
  * @param[in, out] provider_context Provider module's context.
  * @returns Attached client.
- * (Note: this is a temporary helper routine that will be re-written when multiple attached clients are supported as fix
- * to #754)
  */
 net_ebpf_extension_hook_client_t*
 net_ebpf_extension_hook_get_attached_client(_Inout_ net_ebpf_extension_hook_provider_t* provider_context);
@@ -173,6 +214,14 @@ net_ebpf_extension_hook_get_next_attached_client(
     _Inout_ net_ebpf_extension_hook_provider_t* provider_context,
     _In_opt_ const net_ebpf_extension_hook_client_t* client_context);
 
+/**
+ * @brief Return the client an attached program is chained on.
+ * @param[in] provider_binding_context Provider binding context handed to the program when it attached.
+ * @returns The client the program is chained on.
+ */
+net_ebpf_extension_hook_client_t*
+net_ebpf_extension_hook_program_get_client(_In_ const void* provider_binding_context);
+
 /**
  * @brief Utility function called from net_ebpf_extension_hook_on_client_attach callback of hook providers, that
  * determines if the attach parameter provided by an attaching client is compatible with the existing clients.
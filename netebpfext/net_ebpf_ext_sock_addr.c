@@ -12,6 +12,7 @@
 
 #define TARGET_PROCESS_ID 1234
 #define EXPIRY_TIME 60000 // 60 seconds in ms.
+#define EXPIRY_TICK_TIME 2000 // Granularity of the connection context expiry timer wheel in ms.
 #define CONVERT_100NS_UNITS_TO_MS(x) ((x) / 10000)
 
 #define NET_EBPF_EXT_SOCK_ADDR_CLASSIFY_MESSAGE "NetEbpfExtSockAddrClassify"
@@ -208,9 +209,29 @@ typedef struct _net_ebpf_extension_connection_context
     uint32_t compartment_id;
     uint16_t protocol;
     uint64_t timestamp;
-    LIST_ENTRY list_entry;
+    LIST_ENTRY list_entry;        // Entry in the hash bucket.
+    LIST_ENTRY expiry_list_entry; // Entry in the expiry timer wheel slot.
 } net_ebpf_extension_connection_context_t;
 
+// Connection contexts are stored in a hash table split into shards, each with its own lock, so connects on different
+// CPUs rarely contend. Each shard also has a timer wheel with one slot per EXPIRY_TICK_TIME, so expiring stale entries
+// only visits slots whose time has passed instead of walking every entry.
+#define NET_EBPF_EXT_CONNECTION_CONTEXT_SHARD_COUNT 32
+#define NET_EBPF_EXT_CONNECTION_CONTEXT_BUCKETS_PER_SHARD 32
+// The wheel must have more slots than there are live ticks in EXPIRY_TIME, so that a slot never holds entries from
+// two different revolutions that are both still live.
+#define NET_EBPF_EXT_CONNECTION_CONTEXT_WHEEL_SLOTS 32
+C_ASSERT(NET_EBPF_EXT_CONNECTION_CONTEXT_WHEEL_SLOTS > (EXPIRY_TIME / EXPIRY_TICK_TIME) + 1);
+
+typedef __declspec(align(EBPF_CACHE_LINE_SIZE)) struct _net_ebpf_ext_connection_context_shard
+{
+    EX_SPIN_LOCK lock;
+    _Guarded_by_(lock) uint32_t count;
+    _Guarded_by_(lock) uint64_t expired_tick; // All entries with a tick at or before this have been purged.
+    _Guarded_by_(lock) LIST_ENTRY buckets[NET_EBPF_EXT_CONNECTION_CONTEXT_BUCKETS_PER_SHARD];
+    _Guarded_by_(lock) LIST_ENTRY wheel[NET_EBPF_EXT_CONNECTION_CONTEXT_WHEEL_SLOTS];
+} net_ebpf_ext_connection_context_shard_t;
+
 typedef struct _net_ebpf_ext_sock_addr_statistics
 {
     volatile long permit_connection_count;
@@ -220,10 +241,11 @@ typedef struct _net_ebpf_ext_sock_addr_statistics
 
 static net_ebpf_ext_sock_addr_statistics_t _net_ebpf_ext_statistics;
 
-static EX_SPIN_LOCK _net_ebpf_ext_sock_addr_lock;
-// TODO: Issue #1675 (Use hash table to store connection contexts in netebpfext)
-_Guarded_by_(_net_ebpf_ext_sock_addr_lock) static LIST_ENTRY _net_ebpf_ext_connect_context_list;
-static uint32_t _net_ebpf_ext_connect_context_count = 0;
+static net_ebpf_ext_connection_context_shard_t
+    _net_ebpf_ext_connection_context_shards[NET_EBPF_EXT_CONNECTION_CONTEXT_SHARD_COUNT];
+
+// Added to the current time of connection contexts, so that tests can expire them without waiting for EXPIRY_TIME.
+static volatile int64_t _net_ebpf_ext_connection_context_time_offset;
 
 static SECURITY_DESCRIPTOR* _net_ebpf_ext_security_descriptor_admin = NULL;
 static ACL* _net_ebpf_ext_dacl_admin = NULL;
@@ -735,7 +757,19 @@ _net_ebpf_sock_addr_clean_up_security_descriptor()
 static void
 _net_ebpf_sock_addr_initialize_globals()
 {
-    InitializeListHead(&_net_ebpf_ext_connect_context_list);
+    _net_ebpf_ext_connection_context_time_offset = 0;
+    for (uint32_t shard_index = 0; shard_index < NET_EBPF_EXT_CONNECTION_CONTEXT_SHARD_COUNT; shard_index++) {
+        net_ebpf_ext_connection_context_shard_t* shard = &_net_ebpf_ext_connection_context_shards[shard_index];
+        shard->lock = 0;
+        shard->count = 0;
+        shard->expired_tick = 0;
+        for (uint32_t index = 0; index < NET_EBPF_EXT_CONNECTION_CONTEXT_BUCKETS_PER_SHARD; index++) {
+            InitializeListHead(&shard->buckets[index]);
+        }
+        for (uint32_t index = 0; index < NET_EBPF_EXT_CONNECTION_CONTEXT_WHEEL_SLOTS; index++) {
+            InitializeListHead(&shard->wheel[index]);
+        }
+    }
 }
 
 /**
@@ -760,6 +794,18 @@ _net_ebpf_ext_compare_destination_address(_In_ const bpf_sock_addr_t* addr1, _In
 
 #define CONNECTION_CONTEXT_INITIALIZATION_SET_TIMESTAMP 0x1
 
+/**
+ * @brief Get the current time of the connection context table in ms.
+ *
+ * @return Interrupt time in ms, plus the offset added by net_ebpf_ext_sock_addr_expire_connection_contexts.
+ */
+static uint64_t
+_net_ebpf_ext_get_connection_context_time()
+{
+    return CONVERT_100NS_UNITS_TO_MS(KeQueryInterruptTime()) +
+           (uint64_t)ReadNoFence64(&_net_ebpf_ext_connection_context_time_offset);
+}
+
 static void
 _net_ebpf_extension_connection_context_initialize(
     _In_ const bpf_sock_addr_t* sock_addr_ctx,
@@ -780,7 +826,134 @@ _net_ebpf_extension_connection_context_initialize(
     connection_context->protocol = (uint16_t)sock_addr_ctx->protocol;
     connection_context->compartment_id = sock_addr_ctx->compartment_id;
     if (set_timestamp) {
-        connection_context->timestamp = CONVERT_100NS_UNITS_TO_MS(KeQueryInterruptTime());
+        connection_context->timestamp = _net_ebpf_ext_get_connection_context_time();
+    }
+}
+
+/**
+ * @brief Compute the hash of the key fields of a connection context.
+ *
+ * @param[in] connection_context Connection context to hash.
+ * @return Hash of the transport endpoint handle and tuple.
+ */
+static uint64_t
+_net_ebpf_ext_connection_context_hash(_In_ const net_ebpf_extension_connection_context_t* connection_context)
+{
+    const net_ebpf_ext_connect_context_address_info_t* address_info = &connection_context->address_info;
+    uint64_t hash = connection_context->transport_endpoint_handle;
+    hash ^= ((uint64_t)address_info->destination_port << 48) | ((uint64_t)address_info->source_port << 32) |
+            connection_context->protocol;
+    hash ^= ((uint64_t)address_info->destination_ip.ipv6[0] << 32) | address_info->destination_ip.ipv6[1];
+    hash ^= ((uint64_t)address_info->destination_ip.ipv6[2] << 32) | address_info->destination_ip.ipv6[3];
+
+    // Finalizer from murmur3 (fmix64) so that every input bit affects the shard and bucket bits.
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+/**
+ * @brief Find the shard and hash bucket a connection context belongs in.
+ *
+ * @param[in] connection_context Connection context to look up.
+ * @param[out] bucket Hash bucket within the returned shard.
+ * @return Shard the connection context belongs to.
+ */
+static net_ebpf_ext_connection_context_shard_t*
+_net_ebpf_ext_get_connection_context_shard(
+    _In_ const net_ebpf_extension_connection_context_t* connection_context, _Outptr_ LIST_ENTRY** bucket)
+{
+    uint64_t hash = _net_ebpf_ext_connection_context_hash(connection_context);
+    net_ebpf_ext_connection_context_shard_t* shard =
+        &_net_ebpf_ext_connection_context_shards[hash % NET_EBPF_EXT_CONNECTION_CONTEXT_SHARD_COUNT];
+    hash /= NET_EBPF_EXT_CONNECTION_CONTEXT_SHARD_COUNT;
+    *bucket = &shard->buckets[hash % NET_EBPF_EXT_CONNECTION_CONTEXT_BUCKETS_PER_SHARD];
+    return shard;
+}
+
+_Requires_exclusive_lock_held_(shard->lock) static void _net_ebpf_ext_remove_connection_context_under_lock(
+    _Inout_ net_ebpf_ext_connection_context_shard_t* shard,
+    _Inout_ net_ebpf_extension_connection_context_t* connection_context)
+{
+    RemoveEntryList(&connection_context->list_entry);
+    RemoveEntryList(&connection_context->expiry_list_entry);
+    shard->count--;
+}
+
+/**
+ * @brief Free the entries in one timer wheel slot that have expired.
+ *
+ * @param[in, out] shard Shard that owns the slot.
+ * @param[in, out] slot Timer wheel slot to purge.
+ * @param[in] expired_tick Entries with a tick at or before this are freed.
+ * @param[in] delete_all Free every entry in the slot regardless of its tick.
+ */
+_Requires_exclusive_lock_held_(shard->lock) static void _net_ebpf_ext_purge_wheel_slot_under_lock(
+    _Inout_ net_ebpf_ext_connection_context_shard_t* shard,
+    _Inout_ LIST_ENTRY* slot,
+    uint64_t expired_tick,
+    BOOLEAN delete_all)
+{
+    LIST_ENTRY* list_entry = slot->Flink;
+    while (list_entry != slot) {
+        net_ebpf_extension_connection_context_t* entry =
+            CONTAINING_RECORD(list_entry, net_ebpf_extension_connection_context_t, expiry_list_entry);
+        list_entry = list_entry->Flink;
+        if (!delete_all && (entry->timestamp / EXPIRY_TICK_TIME) > expired_tick) {
+            continue;
+        }
+        _net_ebpf_ext_remove_connection_context_under_lock(shard, entry);
+
+        NET_EBPF_EXT_LOG_MESSAGE_UINT64(
+            NET_EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
+            NET_EBPF_EXT_TRACELOG_KEYWORD_SOCK_ADDR,
+            "_net_ebpf_ext_purge_lru_contexts_under_lock: Delete",
+            entry->transport_endpoint_handle);
+
+        ExFreePool(entry);
+    }
+}
+
+_Requires_exclusive_lock_held_(shard->lock) static void _net_ebpf_ext_purge_lru_contexts_under_lock(
+    _Inout_ net_ebpf_ext_connection_context_shard_t* shard, BOOLEAN delete_all)
+{
+    uint32_t original_count = shard->count;
+
+    if (delete_all) {
+        for (uint32_t index = 0; index < NET_EBPF_EXT_CONNECTION_CONTEXT_WHEEL_SLOTS; index++) {
+            _net_ebpf_ext_purge_wheel_slot_under_lock(shard, &shard->wheel[index], 0, TRUE);
+        }
+    } else {
+        uint64_t current_time = _net_ebpf_ext_get_connection_context_time();
+        if (current_time < EXPIRY_TIME + EXPIRY_TICK_TIME) {
+            return;
+        }
+        // Only entries whose whole tick is older than EXPIRY_TIME are purged, so an entry lives for between
+        // EXPIRY_TIME and EXPIRY_TIME + 2 * EXPIRY_TICK_TIME.
+        uint64_t expired_tick = (current_time - EXPIRY_TIME) / EXPIRY_TICK_TIME - 1;
+        if (expired_tick <= shard->expired_tick) {
+            // Nothing has expired since the last purge, which is the common case.
+            return;
+        }
+        // Visit each slot whose tick has passed, at most once per revolution of the wheel.
+        uint64_t tick = shard->expired_tick + 1;
+        for (uint32_t visited = 0; tick <= expired_tick && visited < NET_EBPF_EXT_CONNECTION_CONTEXT_WHEEL_SLOTS;
+             tick++, visited++) {
+            _net_ebpf_ext_purge_wheel_slot_under_lock(
+                shard, &shard->wheel[tick % NET_EBPF_EXT_CONNECTION_CONTEXT_WHEEL_SLOTS], expired_tick, FALSE);
+        }
+        shard->expired_tick = expired_tick;
+    }
+
+    if (shard->count != original_count) {
+        NET_EBPF_EXT_LOG_MESSAGE_UINT64(
+            NET_EBPF_EXT_TRACELOG_LEVEL_INFO,
+            NET_EBPF_EXT_TRACELOG_KEYWORD_SOCK_ADDR,
+            "_net_ebpf_ext_purge_lru_contexts_under_lock",
+            shard->count);
     }
 }
 
@@ -791,87 +964,89 @@ _net_ebpf_ext_get_and_remove_connection_context(
     KIRQL old_irql;
     net_ebpf_extension_connection_context_t local_connection_context = {0};
     net_ebpf_extension_connection_context_t* connection_context = NULL;
+    net_ebpf_ext_connection_context_shard_t* shard;
+    LIST_ENTRY* bucket;
 
     _net_ebpf_extension_connection_context_initialize(
         sock_addr_ctx, transport_endpoint_handle, 0, &local_connection_context);
-    old_irql = ExAcquireSpinLockExclusive(&_net_ebpf_ext_sock_addr_lock);
+    shard = _net_ebpf_ext_get_connection_context_shard(&local_connection_context, &bucket);
+    old_irql = ExAcquireSpinLockExclusive(&shard->lock);
 
-    LIST_ENTRY* list_entry = _net_ebpf_ext_connect_context_list.Flink;
-    while (list_entry != &_net_ebpf_ext_connect_context_list) {
+    LIST_ENTRY* list_entry = bucket->Flink;
+    while (list_entry != bucket) {
         net_ebpf_extension_connection_context_t* entry =
             CONTAINING_RECORD(list_entry, net_ebpf_extension_connection_context_t, list_entry);
         if (memcmp(
                 &local_connection_context, entry, EBPF_OFFSET_OF(net_ebpf_extension_connection_context_t, timestamp)) ==
             0) {
-            // Found matching entry. Remove it from the list and return.
-            RemoveEntryList(&entry->list_entry);
-            _net_ebpf_ext_connect_context_count--;
+            // Found matching entry. Remove it from the table and return.
+            _net_ebpf_ext_remove_connection_context_under_lock(shard, entry);
             connection_context = entry;
             break;
         }
         list_entry = list_entry->Flink;
     }
 
-    ExReleaseSpinLockExclusive(&_net_ebpf_ext_sock_addr_lock, old_irql);
+    // Purge stale entries from this shard, so that shards without new inserts still age out.
+    _net_ebpf_ext_purge_lru_contexts_under_lock(shard, FALSE);
+
+    ExReleaseSpinLockExclusive(&shard->lock, old_irql);
 
     NET_EBPF_EXT_RETURN_POINTER(net_ebpf_extension_connection_context_t*, connection_context);
 }
 
-_Requires_exclusive_lock_held_(_net_ebpf_ext_sock_addr_lock) static void _net_ebpf_ext_purge_lru_contexts_under_lock(
-    BOOLEAN delete_all)
+static void
+_net_ebpf_ext_purge_lru_contexts(BOOLEAN delete_all)
 {
-    uint64_t expiry_time = CONVERT_100NS_UNITS_TO_MS(KeQueryInterruptTime()) - EXPIRY_TIME;
-
-    LIST_ENTRY* list_entry = _net_ebpf_ext_connect_context_list.Blink;
-    while (list_entry != &_net_ebpf_ext_connect_context_list) {
-        net_ebpf_extension_connection_context_t* entry =
-            CONTAINING_RECORD(list_entry, net_ebpf_extension_connection_context_t, list_entry);
-        if (!delete_all && entry->timestamp > expiry_time) {
-            break;
-        }
-#pragma warning(suppress : 6001) /* list entry is non-null */
-        list_entry = list_entry->Blink;
-        RemoveEntryList(&entry->list_entry);
-
-        _net_ebpf_ext_connect_context_count--;
-
-        NET_EBPF_EXT_LOG_MESSAGE_UINT64(
-            NET_EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
-            NET_EBPF_EXT_TRACELOG_KEYWORD_SOCK_ADDR,
-            "_net_ebpf_ext_purge_lru_contexts_under_lock: Delete",
-            entry->transport_endpoint_handle);
-
-        ExFreePool(entry);
+    for (uint32_t shard_index = 0; shard_index < NET_EBPF_EXT_CONNECTION_CONTEXT_SHARD_COUNT; shard_index++) {
+        net_ebpf_ext_connection_context_shard_t* shard = &_net_ebpf_ext_connection_context_shards[shard_index];
+        KIRQL old_irql = ExAcquireSpinLockExclusive(&shard->lock);
+        _net_ebpf_ext_purge_lru_contexts_under_lock(shard, delete_all);
+        ExReleaseSpinLockExclusive(&shard->lock, old_irql);
     }
+}
 
-    NET_EBPF_EXT_LOG_MESSAGE_UINT64(
-        NET_EBPF_EXT_TRACELOG_LEVEL_INFO,
-        NET_EBPF_EXT_TRACELOG_KEYWORD_SOCK_ADDR,
-        "_net_ebpf_ext_purge_lru_contexts_under_lock",
-        _net_ebpf_ext_connect_context_count);
+uint32_t
+net_ebpf_ext_sock_addr_get_connection_context_count()
+{
+    uint32_t count = 0;
+    for (uint32_t shard_index = 0; shard_index < NET_EBPF_EXT_CONNECTION_CONTEXT_SHARD_COUNT; shard_index++) {
+        net_ebpf_ext_connection_context_shard_t* shard = &_net_ebpf_ext_connection_context_shards[shard_index];
+        KIRQL old_irql = ExAcquireSpinLockShared(&shard->lock);
+        count += shard->count;
+        ExReleaseSpinLockShared(&shard->lock, old_irql);
+    }
+    return count;
 }
 
-static void
-_net_ebpf_ext_purge_lru_contexts(BOOLEAN delete_all)
+void
+net_ebpf_ext_sock_addr_expire_connection_contexts()
 {
-    KIRQL old_irql = ExAcquireSpinLockExclusive(&_net_ebpf_ext_sock_addr_lock);
-    _net_ebpf_ext_purge_lru_contexts_under_lock(delete_all);
-    ExReleaseSpinLockExclusive(&_net_ebpf_ext_sock_addr_lock, old_irql);
+    // Move the time of the table past the lifetime of every existing entry, then let the timer wheels purge them.
+    InterlockedAdd64(&_net_ebpf_ext_connection_context_time_offset, EXPIRY_TIME + (3 * EXPIRY_TICK_TIME));
+    _net_ebpf_ext_purge_lru_contexts(FALSE);
 }
 
 static void
 _net_ebpf_ext_insert_connection_context_to_list(_Inout_ net_ebpf_extension_connection_context_t* connection_context)
 {
-    KIRQL old_irql = ExAcquireSpinLockExclusive(&_net_ebpf_ext_sock_addr_lock);
+    LIST_ENTRY* bucket;
+    net_ebpf_ext_connection_context_shard_t* shard =
+        _net_ebpf_ext_get_connection_context_shard(connection_context, &bucket);
+    uint64_t tick = connection_context->timestamp / EXPIRY_TICK_TIME;
+
+    KIRQL old_irql = ExAcquireSpinLockExclusive(&shard->lock);
 
     // Insert the most recent entry at the head.
-    InsertHeadList(&_net_ebpf_ext_connect_context_list, &connection_context->list_entry);
-    _net_ebpf_ext_connect_context_count++;
+    InsertHeadList(bucket, &connection_context->list_entry);
+    InsertTailList(
+        &shard->wheel[tick % NET_EBPF_EXT_CONNECTION_CONTEXT_WHEEL_SLOTS], &connection_context->expiry_list_entry);
+    shard->count++;
 
-    // Purge stale entries from the list.
-    _net_ebpf_ext_purge_lru_contexts_under_lock(FALSE);
+    // Purge stale entries from this shard.
+    _net_ebpf_ext_purge_lru_contexts_under_lock(shard, FALSE);
 
-    ExReleaseSpinLockExclusive(&_net_ebpf_ext_sock_addr_lock, old_irql);
+    ExReleaseSpinLockExclusive(&shard->lock, old_irql);
 }
 
 NTSTATUS
@@ -913,7 +1088,9 @@ net_ebpf_ext_sock_addr_register_providers()
 
     for (int i = 0; i < NET_EBPF_SOCK_ADDR_HOOK_PROVIDER_COUNT; i++) {
         const net_ebpf_extension_hook_provider_parameters_t hook_provider_parameters = {
-            &_ebpf_sock_addr_hook_provider_moduleid[i], &_net_ebpf_extension_sock_addr_hook_provider_data[i]};
+            &_ebpf_sock_addr_hook_provider_moduleid[i],
+            &_net_ebpf_extension_sock_addr_hook_provider_data[i],
+            BPF_SOCK_ADDR_VERDICT_PROCEED};
 
         _net_ebpf_sock_addr_hook_provider_data[i].supported_program_type = EBPF_PROGRAM_TYPE_CGROUP_SOCK_ADDR;
         _net_ebpf_sock_addr_hook_provider_data[i].bpf_attach_type =
@@ -1168,7 +1345,9 @@ net_ebpf_extension_sock_addr_authorize_recv_accept_classify(
         goto Exit;
     }
 
-    if (filter_context->base.client_detached) {
+    attached_client =
+        (net_ebpf_extension_hook_client_t*)net_ebpf_extension_wfp_filter_context_get_client(&filter_context->base);
+    if (attached_client == NULL) {
         NET_EBPF_EXT_LOG_MESSAGE_NTSTATUS(
             NET_EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
             NET_EBPF_EXT_TRACELOG_KEYWORD_SOCK_ADDR,
@@ -1177,17 +1356,6 @@ net_ebpf_extension_sock_addr_authorize_recv_accept_classify(
         goto Exit;
     }
 
-    attached_client = (net_ebpf_extension_hook_client_t*)filter_context->base.client_context;
-    if (!net_ebpf_extension_hook_client_enter_rundown(attached_client)) {
-        NET_EBPF_EXT_LOG_MESSAGE_NTSTATUS(
-            NET_EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
-            NET_EBPF_EXT_TRACELOG_KEYWORD_SOCK_ADDR,
-            "net_ebpf_extension_sock_addr_authorize_recv_accept_classify - Rundown already started.",
-            STATUS_INVALID_PARAMETER);
-        attached_client = NULL;
-        goto Exit;
-    }
-
     _net_ebpf_extension_sock_addr_copy_wfp_connection_fields(
         incoming_fixed_values, incoming_metadata_values, &net_ebpf_sock_addr_ctx);
 
@@ -1224,10 +1392,6 @@ net_ebpf_extension_sock_addr_authorize_recv_accept_classify(
         "recv_accept_classify", incoming_metadata_values->transportEndpointHandle, sock_addr_ctx, NULL, result);
 
 Exit:
-    if (attached_client) {
-        net_ebpf_extension_hook_client_leave_rundown(attached_client);
-    }
-
     NET_EBPF_EXT_LOG_EXIT();
 }
 
@@ -1529,7 +1693,9 @@ net_ebpf_extension_sock_addr_redirect_connection_classify(
         goto Exit;
     }
 
-    if (filter_context->base.client_detached) {
+    attached_client =
+        (net_ebpf_extension_hook_client_t*)net_ebpf_extension_wfp_filter_context_get_client(&filter_context->base);
+    if (attached_client == NULL) {
         NET_EBPF_EXT_LOG_MESSAGE_NTSTATUS(
             NET_EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
             NET_EBPF_EXT_TRACELOG_KEYWORD_SOCK_ADDR,
@@ -1557,17 +1723,6 @@ net_ebpf_extension_sock_addr_redirect_connection_classify(
         goto Exit;
     }
 
-    attached_client = (net_ebpf_extension_hook_client_t*)filter_context->base.client_context;
-    if (!net_ebpf_extension_hook_client_enter_rundown(attached_client)) {
-        NET_EBPF_EXT_LOG_MESSAGE_NTSTATUS(
-            NET_EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
-            NET_EBPF_EXT_TRACELOG_KEYWORD_SOCK_ADDR,
-            "net_ebpf_extension_sock_addr_redirect_connection_classify - Rundown already started.",
-            STATUS_INVALID_PARAMETER);
-        attached_client = NULL;
-        goto Exit;
-    }
-
     // Get the redirect handle for this filter.
     redirect_handle = filter_context->redirect_handle;
     ASSERT(redirect_handle != NULL);
@@ -1708,10 +1863,6 @@ Exit:
         FwpsReleaseClassifyHandle(classify_handle);
     }
 
-    if (attached_client) {
-        net_ebpf_extension_hook_client_leave_rundown(attached_client);
-    }
-
     if (net_ebpf_sock_addr_ctx.redirect_context != NULL) {
         ExFreePool(net_ebpf_sock_addr_ctx.redirect_context);
     }
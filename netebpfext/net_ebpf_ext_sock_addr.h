@@ -152,3 +152,18 @@ net_ebpf_ext_sock_addr_unregister_providers();
  */
 NTSTATUS
 net_ebpf_ext_sock_addr_register_providers();
+
+/**
+ * @brief Get the number of connection contexts of blocked connections that are waiting for the AUTH_CONNECT layer.
+ *
+ * @returns Number of connection contexts in the table.
+ */
+uint32_t
+net_ebpf_ext_sock_addr_get_connection_context_count();
+
+/**
+ * @brief Advance the time of the connection context table past the lifetime of every existing entry, and purge the
+ * entries that have expired. Intended for tests that can't wait for entries to expire.
+ */
+void
+net_ebpf_ext_sock_addr_expire_connection_contexts();
@@ -22,19 +22,43 @@ struct _net_ebpf_extension_sock_ops_wfp_filter_context;
  */
 typedef struct _net_ebpf_extension_sock_ops_wfp_flow_context
 {
-    LIST_ENTRY link;                                         ///< Link to next flow context.
+    union
+    {
+        LIST_ENTRY link;         ///< Link to next flow context.
+        SLIST_ENTRY cache_entry; ///< Entry in a flow context cache, while the flow context is free.
+    };
     net_ebpf_extension_flow_context_parameters_t parameters; ///< WFP flow parameters.
     struct _net_ebpf_extension_sock_ops_wfp_filter_context*
         filter_context;     ///< WFP filter context associated with this flow.
+    uint32_t list_index;    ///< Index of the flow context list this flow context is in.
     bpf_sock_ops_t context; ///< sock_ops context.
 } net_ebpf_extension_sock_ops_wfp_flow_context_t;
 
-typedef struct _net_ebpf_extension_sock_ops_wfp_flow_context_list
+// Number of flow context lists per filter context. Flows are added to the list of the CPU they are established on, so
+// that flows set up concurrently on different CPUs don't contend on the same lock.
+#define NET_EBPF_SOCK_OPS_FLOW_CONTEXT_LIST_COUNT 32
+
+typedef __declspec(align(EBPF_CACHE_LINE_SIZE)) struct _net_ebpf_extension_sock_ops_wfp_flow_context_list
 {
-    uint32_t count;       ///< Number of flow contexts in the list.
-    LIST_ENTRY list_head; ///< Head to the list of WFP flow contexts.
+    KSPIN_LOCK lock;                         ///< Lock for synchronization.
+    _Guarded_by_(lock) uint32_t count;       ///< Number of flow contexts in the list.
+    _Guarded_by_(lock) LIST_ENTRY list_head; ///< Head to the list of WFP flow contexts.
 } net_ebpf_extension_sock_ops_wfp_flow_context_list_t;
 
+// Maximum number of free flow contexts cached per CPU.
+#define NET_EBPF_SOCK_OPS_FLOW_CONTEXT_CACHE_DEPTH 64
+
+/**
+ * @brief Per-CPU cache of free flow contexts, so that flow setup and teardown don't go to the pool allocator.
+ */
+typedef __declspec(align(EBPF_CACHE_LINE_SIZE)) struct _net_ebpf_extension_sock_ops_flow_context_cache
+{
+    SLIST_HEADER free_list; ///< Free flow contexts.
+} net_ebpf_extension_sock_ops_flow_context_cache_t;
+
+static net_ebpf_extension_sock_ops_flow_context_cache_t* _net_ebpf_sock_ops_flow_context_caches = NULL;
+static uint32_t _net_ebpf_sock_ops_flow_context_cache_count = 0;
+
 const net_ebpf_extension_wfp_filter_parameters_t _net_ebpf_extension_sock_ops_wfp_filter_parameters[] = {
     {&FWPM_LAYER_ALE_FLOW_ESTABLISHED_V4,
      NULL, // Default sublayer.
@@ -53,11 +77,111 @@ typedef struct _net_ebpf_extension_sock_ops_wfp_filter_context
 {
     net_ebpf_extension_wfp_filter_context_t base;
     uint32_t compartment_id; ///< Compartment Id condition value for the filters (if any).
-    KSPIN_LOCK lock;         ///< Lock for synchronization.
-    _Guarded_by_(lock) net_ebpf_extension_sock_ops_wfp_flow_context_list_t
-        flow_context_list; ///< List of flow contexts associated with WFP flows.
+    net_ebpf_extension_sock_ops_wfp_flow_context_list_t
+        flow_context_lists[NET_EBPF_SOCK_OPS_FLOW_CONTEXT_LIST_COUNT]; ///< Flow contexts associated with WFP flows.
 } net_ebpf_extension_sock_ops_wfp_filter_context_t;
 
+//
+// Flow context allocation.
+//
+
+static void
+_net_ebpf_sock_ops_flow_context_caches_uninitialize()
+{
+    if (_net_ebpf_sock_ops_flow_context_caches != NULL) {
+        for (uint32_t index = 0; index < _net_ebpf_sock_ops_flow_context_cache_count; index++) {
+            SLIST_ENTRY* entry;
+            while ((entry = InterlockedPopEntrySList(&_net_ebpf_sock_ops_flow_context_caches[index].free_list)) !=
+                   NULL) {
+                ExFreePool(CONTAINING_RECORD(entry, net_ebpf_extension_sock_ops_wfp_flow_context_t, cache_entry));
+            }
+        }
+        ExFreePool(_net_ebpf_sock_ops_flow_context_caches);
+        _net_ebpf_sock_ops_flow_context_caches = NULL;
+        _net_ebpf_sock_ops_flow_context_cache_count = 0;
+    }
+}
+
+static NTSTATUS
+_net_ebpf_sock_ops_flow_context_caches_initialize()
+{
+    NTSTATUS status = STATUS_SUCCESS;
+    uint32_t cache_count = KeQueryMaximumProcessorCountEx(ALL_PROCESSOR_GROUPS);
+
+    NET_EBPF_EXT_LOG_ENTRY();
+
+    _net_ebpf_sock_ops_flow_context_caches =
+        (net_ebpf_extension_sock_ops_flow_context_cache_t*)ExAllocatePoolUninitialized(
+            NonPagedPoolNx,
+            cache_count * sizeof(net_ebpf_extension_sock_ops_flow_context_cache_t),
+            NET_EBPF_EXTENSION_POOL_TAG);
+    NET_EBPF_EXT_BAIL_ON_ALLOC_FAILURE_STATUS(
+        NET_EBPF_EXT_TRACELOG_KEYWORD_SOCK_OPS, _net_ebpf_sock_ops_flow_context_caches, "flow_context_caches", status);
+
+    for (uint32_t index = 0; index < cache_count; index++) {
+        InitializeSListHead(&_net_ebpf_sock_ops_flow_context_caches[index].free_list);
+    }
+    _net_ebpf_sock_ops_flow_context_cache_count = cache_count;
+
+Exit:
+    NET_EBPF_EXT_RETURN_NTSTATUS(status);
+}
+
+/**
+ * @brief Allocate a zeroed flow context, from the current CPU's cache if possible.
+ *
+ * @returns Pointer to the flow context, or NULL if it could not be allocated.
+ */
+static net_ebpf_extension_sock_ops_wfp_flow_context_t*
+_net_ebpf_sock_ops_allocate_flow_context()
+{
+    net_ebpf_extension_sock_ops_wfp_flow_context_t* flow_context = NULL;
+
+    if (_net_ebpf_sock_ops_flow_context_caches != NULL) {
+        SLIST_ENTRY* entry = InterlockedPopEntrySList(
+            &_net_ebpf_sock_ops_flow_context_caches
+                 [KeGetCurrentProcessorNumberEx(NULL) % _net_ebpf_sock_ops_flow_context_cache_count]
+                     .free_list);
+        if (entry != NULL) {
+            flow_context = CONTAINING_RECORD(entry, net_ebpf_extension_sock_ops_wfp_flow_context_t, cache_entry);
+        }
+    }
+
+    if (flow_context == NULL) {
+        flow_context = (net_ebpf_extension_sock_ops_wfp_flow_context_t*)ExAllocatePoolUninitialized(
+            NonPagedPoolNx, sizeof(net_ebpf_extension_sock_ops_wfp_flow_context_t), NET_EBPF_EXTENSION_POOL_TAG);
+    }
+
+    if (flow_context != NULL) {
+        memset(flow_context, 0, sizeof(net_ebpf_extension_sock_ops_wfp_flow_context_t));
+    }
+
+    return flow_context;
+}
+
+/**
+ * @brief Free a flow context, returning it to the current CPU's cache unless the cache is full.
+ *
+ * @param[in] flow_context Flow context to free.
+ */
+static void
+_net_ebpf_sock_ops_free_flow_context(_In_ _Frees_ptr_ net_ebpf_extension_sock_ops_wfp_flow_context_t* flow_context)
+{
+    if (_net_ebpf_sock_ops_flow_context_caches != NULL) {
+        SLIST_HEADER* free_list =
+            &_net_ebpf_sock_ops_flow_context_caches
+                 [KeGetCurrentProcessorNumberEx(NULL) % _net_ebpf_sock_ops_flow_context_cache_count]
+                     .free_list;
+        // The depth check is racy, which only means a cache can briefly exceed its depth.
+        if (QueryDepthSList(free_list) < NET_EBPF_SOCK_OPS_FLOW_CONTEXT_CACHE_DEPTH) {
+            InterlockedPushEntrySList(free_list, &flow_context->cache_entry);
+            return;
+        }
+    }
+
+    ExFreePool(flow_context);
+}
+
 //
 // SOCK_OPS Program Information NPI Provider.
 //
@@ -173,8 +297,11 @@ net_ebpf_extension_sock_ops_on_client_attach(
     }
     filter_context->compartment_id = compartment_id;
     filter_context->base.filter_ids_count = NET_EBPF_SOCK_OPS_FILTER_COUNT;
-    KeInitializeSpinLock(&filter_context->lock);
-    InitializeListHead(&filter_context->flow_context_list.list_head);
+    for (uint32_t index = 0; index < NET_EBPF_SOCK_OPS_FLOW_CONTEXT_LIST_COUNT; index++) {
+        KeInitializeSpinLock(&filter_context->flow_context_lists[index].lock);
+        InitializeListHead(&filter_context->flow_context_lists[index].list_head);
+        filter_context->flow_context_lists[index].count = 0;
+    }
 
     // Add WFP filters at appropriate layers and set the hook NPI client as the filter's raw context.
     filter_count = NET_EBPF_SOCK_OPS_FILTER_COUNT;
@@ -216,17 +343,21 @@ _net_ebpf_extension_sock_ops_on_client_detach(_In_ const net_ebpf_extension_hook
     InitializeListHead(&local_list_head);
     net_ebpf_extension_delete_wfp_filters(filter_context->base.filter_ids_count, filter_context->base.filter_ids);
 
-    KeAcquireSpinLock(&filter_context->lock, &irql);
-    if (filter_context->flow_context_list.count > 0) {
+    for (uint32_t index = 0; index < NET_EBPF_SOCK_OPS_FLOW_CONTEXT_LIST_COUNT; index++) {
+        net_ebpf_extension_sock_ops_wfp_flow_context_list_t* flow_context_list =
+            &filter_context->flow_context_lists[index];
+        KeAcquireSpinLock(&flow_context_list->lock, &irql);
+        if (flow_context_list->count > 0) {
 
-        LIST_ENTRY* entry = filter_context->flow_context_list.list_head.Flink;
-        RemoveEntryList(&filter_context->flow_context_list.list_head);
-        InitializeListHead(&filter_context->flow_context_list.list_head);
-        AppendTailList(&local_list_head, entry);
+            LIST_ENTRY* entry = flow_context_list->list_head.Flink;
+            RemoveEntryList(&flow_context_list->list_head);
+            InitializeListHead(&flow_context_list->list_head);
+            AppendTailList(&local_list_head, entry);
 
-        filter_context->flow_context_list.count = 0;
+            flow_context_list->count = 0;
+        }
+        KeReleaseSpinLock(&flow_context_list->lock, irql);
     }
-    KeReleaseSpinLock(&filter_context->lock, irql);
 
     // Remove the flow context associated with the WFP flows.
     while (!IsListEmpty(&local_list_head)) {
@@ -255,13 +386,20 @@ net_ebpf_ext_sock_ops_register_providers()
 {
     NTSTATUS status = STATUS_SUCCESS;
     const net_ebpf_extension_hook_provider_parameters_t hook_provider_parameters = {
-        &_ebpf_sock_ops_hook_provider_moduleid, &_net_ebpf_extension_sock_ops_hook_provider_data};
+        &_ebpf_sock_ops_hook_provider_moduleid,
+        &_net_ebpf_extension_sock_ops_hook_provider_data,
+        NET_EBPF_EXTENSION_HOOK_CONTINUE_ANY_RESULT};
 
     const net_ebpf_extension_program_info_provider_parameters_t program_info_provider_parameters = {
         &_ebpf_sock_ops_program_info_provider_moduleid, &_ebpf_sock_ops_program_info_provider_data};
 
     NET_EBPF_EXT_LOG_ENTRY();
 
+    status = _net_ebpf_sock_ops_flow_context_caches_initialize();
+    if (!NT_SUCCESS(status)) {
+        goto Exit;
+    }
+
     // Set the program type as the provider module id.
     _ebpf_sock_ops_program_info_provider_moduleid.Guid = EBPF_PROGRAM_TYPE_SOCK_OPS;
     status = net_ebpf_extension_program_info_provider_register(
@@ -316,6 +454,7 @@ net_ebpf_ext_sock_ops_unregister_providers()
         net_ebpf_extension_program_info_provider_unregister(_ebpf_sock_ops_program_info_provider_context);
         _ebpf_sock_ops_program_info_provider_context = NULL;
     }
+    _net_ebpf_sock_ops_flow_context_caches_uninitialize();
 }
 
 wfp_ale_layer_fields_t wfp_flow_established_fields[] = {
@@ -397,6 +536,7 @@ net_ebpf_extension_sock_ops_flow_established_classify(
     uint32_t client_compartment_id = UNSPECIFIED_COMPARTMENT_ID;
     net_ebpf_extension_hook_id_t hook_id =
         net_ebpf_extension_get_hook_id_from_wfp_layer_id(incoming_fixed_values->layerId);
+    net_ebpf_extension_sock_ops_wfp_flow_context_list_t* flow_context_list;
     KIRQL irql;
 
     UNREFERENCED_PARAMETER(layer_data);
@@ -411,7 +551,9 @@ net_ebpf_extension_sock_ops_flow_established_classify(
         goto Exit;
     }
 
-    if (filter_context->base.client_detached) {
+    attached_client =
+        (net_ebpf_extension_hook_client_t*)net_ebpf_extension_wfp_filter_context_get_client(&filter_context->base);
+    if (attached_client == NULL) {
         NET_EBPF_EXT_LOG_MESSAGE_NTSTATUS(
             NET_EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
             NET_EBPF_EXT_TRACELOG_KEYWORD_SOCK_OPS,
@@ -420,22 +562,9 @@ net_ebpf_extension_sock_ops_flow_established_classify(
         goto Exit;
     }
 
-    attached_client = (net_ebpf_extension_hook_client_t*)filter_context->base.client_context;
-    if (!net_ebpf_extension_hook_client_enter_rundown(attached_client)) {
-        NET_EBPF_EXT_LOG_MESSAGE_NTSTATUS(
-            NET_EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
-            NET_EBPF_EXT_TRACELOG_KEYWORD_SOCK_OPS,
-            "net_ebpf_extension_sock_ops_flow_established_classify - Rundown already started.",
-            STATUS_INVALID_PARAMETER);
-        attached_client = NULL;
-        goto Exit;
-    }
-
-    local_flow_context = (net_ebpf_extension_sock_ops_wfp_flow_context_t*)ExAllocatePoolUninitialized(
-        NonPagedPoolNx, sizeof(net_ebpf_extension_sock_ops_wfp_flow_context_t), NET_EBPF_EXTENSION_POOL_TAG);
+    local_flow_context = _net_ebpf_sock_ops_allocate_flow_context();
     NET_EBPF_EXT_BAIL_ON_ALLOC_FAILURE_RESULT(
         NET_EBPF_EXT_TRACELOG_KEYWORD_SOCK_OPS, local_flow_context, "flow_context", result);
-    memset(local_flow_context, 0, sizeof(net_ebpf_extension_sock_ops_wfp_flow_context_t));
 
     // Associate the filter context with the local flow context.
     REFERENCE_FILTER_CONTEXT(&filter_context->base);
@@ -489,10 +618,12 @@ net_ebpf_extension_sock_ops_flow_established_classify(
         "New flow created.",
         local_flow_context->parameters.flow_id);
 
-    KeAcquireSpinLock(&filter_context->lock, &irql);
-    InsertTailList(&filter_context->flow_context_list.list_head, &local_flow_context->link);
-    filter_context->flow_context_list.count++;
-    KeReleaseSpinLock(&filter_context->lock, irql);
+    local_flow_context->list_index = KeGetCurrentProcessorNumberEx(NULL) % NET_EBPF_SOCK_OPS_FLOW_CONTEXT_LIST_COUNT;
+    flow_context_list = &filter_context->flow_context_lists[local_flow_context->list_index];
+    KeAcquireSpinLock(&flow_context_list->lock, &irql);
+    InsertTailList(&flow_context_list->list_head, &local_flow_context->link);
+    flow_context_list->count++;
+    KeReleaseSpinLock(&flow_context_list->lock, irql);
     local_flow_context = NULL;
 
     classify_output->actionType = (result == 0) ? FWP_ACTION_PERMIT : FWP_ACTION_BLOCK;
@@ -505,10 +636,7 @@ Exit:
         if (local_flow_context->filter_context != NULL) {
             DEREFERENCE_FILTER_CONTEXT(&local_flow_context->filter_context->base);
         }
-        ExFreePool(local_flow_context);
-    }
-    if (attached_client != NULL) {
-        net_ebpf_extension_hook_client_leave_rundown(attached_client);
+        _net_ebpf_sock_ops_free_flow_context(local_flow_context);
     }
 }
 
@@ -520,6 +648,7 @@ net_ebpf_extension_sock_ops_flow_delete(uint16_t layer_id, uint32_t callout_id,
     net_ebpf_extension_sock_ops_wfp_filter_context_t* filter_context = NULL;
     net_ebpf_extension_hook_client_t* attached_client = NULL;
     bpf_sock_ops_t* sock_ops_context = NULL;
+    net_ebpf_extension_sock_ops_wfp_flow_context_list_t* flow_context_list;
     uint32_t result;
     KIRQL irql = 0;
 
@@ -536,25 +665,17 @@ net_ebpf_extension_sock_ops_flow_delete(uint16_t layer_id, uint32_t callout_id,
         goto Exit;
     }
 
-    if (filter_context->base.client_detached) {
+    attached_client =
+        (net_ebpf_extension_hook_client_t*)net_ebpf_extension_wfp_filter_context_get_client(&filter_context->base);
+    if (attached_client == NULL) {
         goto Exit;
     }
 
-    attached_client = (net_ebpf_extension_hook_client_t*)filter_context->base.client_context;
-    if (!net_ebpf_extension_hook_client_enter_rundown(attached_client)) {
-        NET_EBPF_EXT_LOG_MESSAGE_NTSTATUS(
-            NET_EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
-            NET_EBPF_EXT_TRACELOG_KEYWORD_SOCK_OPS,
-            "net_ebpf_extension_sock_ops_flow_delete - Rundown already started.",
-            STATUS_INVALID_PARAMETER);
-        attached_client = NULL;
-        goto Exit;
-    }
-
-    KeAcquireSpinLock(&filter_context->lock, &irql);
+    flow_context_list = &filter_context->flow_context_lists[local_flow_context->list_index];
+    KeAcquireSpinLock(&flow_context_list->lock, &irql);
     RemoveEntryList(&local_flow_context->link);
-    filter_context->flow_context_list.count--;
-    KeReleaseSpinLock(&filter_context->lock, irql);
+    flow_context_list->count--;
+    KeReleaseSpinLock(&flow_context_list->lock, irql);
 
     NET_EBPF_EXT_LOG_MESSAGE_UINT64(
         NET_EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
@@ -575,12 +696,9 @@ Exit:
     }
 
     if (local_flow_context != NULL) {
-        ExFreePool(local_flow_context);
+        _net_ebpf_sock_ops_free_flow_context(local_flow_context);
     }
 
-    if (attached_client != NULL) {
-        net_ebpf_extension_hook_client_leave_rundown(attached_client);
-    }
 }
 
 static ebpf_result_t
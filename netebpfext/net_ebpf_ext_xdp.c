@@ -245,6 +245,12 @@ _net_ebpf_extension_xdp_on_client_detach(_In_ const net_ebpf_extension_hook_clie
     NET_EBPF_EXT_LOG_EXIT();
 }
 
+static NTSTATUS
+_net_ebpf_ext_xdp_linearization_pools_initialize();
+
+static void
+_net_ebpf_ext_xdp_linearization_pools_uninitialize();
+
 NTSTATUS
 net_ebpf_ext_xdp_register_providers()
 {
@@ -253,10 +259,15 @@ net_ebpf_ext_xdp_register_providers()
     const net_ebpf_extension_program_info_provider_parameters_t program_info_provider_parameters = {
         &_ebpf_xdp_test_program_info_provider_moduleid, &_ebpf_xdp_test_program_info_provider_data};
     const net_ebpf_extension_hook_provider_parameters_t hook_provider_parameters = {
-        &_ebpf_xdp_test_hook_provider_moduleid, &_net_ebpf_extension_xdp_test_hook_provider_data};
+        &_ebpf_xdp_test_hook_provider_moduleid, &_net_ebpf_extension_xdp_test_hook_provider_data, XDP_PASS};
 
     NET_EBPF_EXT_LOG_ENTRY();
 
+    status = _net_ebpf_ext_xdp_linearization_pools_initialize();
+    if (!NT_SUCCESS(status)) {
+        goto Exit;
+    }
+
     // Set the program type as the provider module id.
     _ebpf_xdp_test_program_info_provider_moduleid.Guid = EBPF_PROGRAM_TYPE_XDP_TEST;
     status = net_ebpf_extension_program_info_provider_register(
@@ -308,8 +319,29 @@ net_ebpf_ext_xdp_unregister_providers()
         net_ebpf_extension_program_info_provider_unregister(_ebpf_xdp_test_program_info_provider_context);
         _ebpf_xdp_test_program_info_provider_context = NULL;
     }
+    _net_ebpf_ext_xdp_linearization_pools_uninitialize();
 }
 
+//
+// Linearization buffer pool.
+//
+
+// Size of a linearization buffer. Non-contiguous packets larger than this are cloned instead.
+#define NET_EBPF_EXT_XDP_LINEARIZATION_BUFFER_SIZE 2048
+
+// Number of linearization buffers per CPU. Each buffer holds a copy of the packet followed by a snapshot used to
+// detect whether the program modified it.
+#define NET_EBPF_EXT_XDP_LINEARIZATION_BUFFERS_PER_CPU 4
+
+typedef __declspec(align(EBPF_CACHE_LINE_SIZE)) struct _net_ebpf_ext_xdp_linearization_pool
+{
+    volatile long buffers_in_use; ///< Bitmap of the buffers that are in use.
+    uint8_t* buffers;             ///< Linearization buffers, each 2 * NET_EBPF_EXT_XDP_LINEARIZATION_BUFFER_SIZE bytes.
+} net_ebpf_ext_xdp_linearization_pool_t;
+
+static net_ebpf_ext_xdp_linearization_pool_t* _net_ebpf_ext_xdp_linearization_pools = NULL;
+static uint32_t _net_ebpf_ext_xdp_linearization_pool_count = 0;
+
 /**
  *  @brief This is the internal data structure for XDP context.
  */
@@ -318,8 +350,173 @@ typedef struct _net_ebpf_xdp_md
     xdp_md_t base;
     NET_BUFFER_LIST* original_nbl;
     NET_BUFFER_LIST* cloned_nbl;
+    net_ebpf_ext_xdp_linearization_pool_t* linearization_pool; ///< Pool of the linearization buffer in use, if any.
+    uint32_t linearization_buffer_index;                       ///< Index of the linearization buffer in the pool.
 } net_ebpf_xdp_md_t;
 
+static void
+_net_ebpf_ext_xdp_linearization_pools_uninitialize()
+{
+    if (_net_ebpf_ext_xdp_linearization_pools != NULL) {
+        for (uint32_t index = 0; index < _net_ebpf_ext_xdp_linearization_pool_count; index++) {
+            if (_net_ebpf_ext_xdp_linearization_pools[index].buffers != NULL) {
+                ExFreePool(_net_ebpf_ext_xdp_linearization_pools[index].buffers);
+            }
+        }
+        ExFreePool(_net_ebpf_ext_xdp_linearization_pools);
+        _net_ebpf_ext_xdp_linearization_pools = NULL;
+        _net_ebpf_ext_xdp_linearization_pool_count = 0;
+    }
+}
+
+static NTSTATUS
+_net_ebpf_ext_xdp_linearization_pools_initialize()
+{
+    NTSTATUS status = STATUS_SUCCESS;
+    uint32_t pool_count = KeQueryMaximumProcessorCountEx(ALL_PROCESSOR_GROUPS);
+    size_t pool_buffer_size =
+        NET_EBPF_EXT_XDP_LINEARIZATION_BUFFERS_PER_CPU * 2 * NET_EBPF_EXT_XDP_LINEARIZATION_BUFFER_SIZE;
+
+    NET_EBPF_EXT_LOG_ENTRY();
+
+    _net_ebpf_ext_xdp_linearization_pools = (net_ebpf_ext_xdp_linearization_pool_t*)ExAllocatePoolUninitialized(
+        NonPagedPoolNx, pool_count * sizeof(net_ebpf_ext_xdp_linearization_pool_t), NET_EBPF_EXTENSION_POOL_TAG);
+    NET_EBPF_EXT_BAIL_ON_ALLOC_FAILURE_STATUS(
+        NET_EBPF_EXT_TRACELOG_KEYWORD_XDP, _net_ebpf_ext_xdp_linearization_pools, "linearization_pools", status);
+    memset(_net_ebpf_ext_xdp_linearization_pools, 0, pool_count * sizeof(net_ebpf_ext_xdp_linearization_pool_t));
+    _net_ebpf_ext_xdp_linearization_pool_count = pool_count;
+
+    for (uint32_t index = 0; index < pool_count; index++) {
+        _net_ebpf_ext_xdp_linearization_pools[index].buffers =
+            (uint8_t*)ExAllocatePoolUninitialized(NonPagedPoolNx, pool_buffer_size, NET_EBPF_EXTENSION_POOL_TAG);
+        NET_EBPF_EXT_BAIL_ON_ALLOC_FAILURE_STATUS(
+            NET_EBPF_EXT_TRACELOG_KEYWORD_XDP,
+            _net_ebpf_ext_xdp_linearization_pools[index].buffers,
+            "linearization_buffers",
+            status);
+    }
+
+Exit:
+    if (!NT_SUCCESS(status)) {
+        _net_ebpf_ext_xdp_linearization_pools_uninitialize();
+    }
+
+    NET_EBPF_EXT_RETURN_NTSTATUS(status);
+}
+
+/**
+ * @brief Copy a non-contiguous packet into a linearization buffer of the current CPU, so that the program can read it
+ * without cloning the NBL. The packet is only cloned later if the program modifies it.
+ *
+ * @param[in, out] net_xdp_ctx The XDP program context.
+ * @param[in] net_buffer The net buffer of the packet.
+ *
+ * @retval TRUE The packet was linearized.
+ * @retval FALSE No linearization buffer was available, or the packet is too large.
+ */
+static bool
+_net_ebpf_ext_xdp_linearize(_Inout_ net_ebpf_xdp_md_t* net_xdp_ctx, _In_ NET_BUFFER* net_buffer)
+{
+    net_ebpf_ext_xdp_linearization_pool_t* pool;
+    uint32_t data_length = net_buffer->DataLength;
+    uint8_t* buffer;
+
+    if (_net_ebpf_ext_xdp_linearization_pools == NULL || data_length > NET_EBPF_EXT_XDP_LINEARIZATION_BUFFER_SIZE) {
+        return FALSE;
+    }
+
+    // Buffers are claimed with interlocked operations, so it doesn't matter if the thread moves to another CPU.
+    pool = &_net_ebpf_ext_xdp_linearization_pools
+               [KeGetCurrentProcessorNumberEx(NULL) % _net_ebpf_ext_xdp_linearization_pool_count];
+    for (uint32_t index = 0; index < NET_EBPF_EXT_XDP_LINEARIZATION_BUFFERS_PER_CPU; index++) {
+        if (InterlockedBitTestAndSet(&pool->buffers_in_use, index)) {
+            continue;
+        }
+
+        buffer = pool->buffers + (size_t)index * 2 * NET_EBPF_EXT_XDP_LINEARIZATION_BUFFER_SIZE;
+        if (NdisGetDataBuffer(net_buffer, data_length, buffer, 1, 0) == NULL) {
+            InterlockedBitTestAndReset(&pool->buffers_in_use, index);
+            return FALSE;
+        }
+        memcpy(buffer + NET_EBPF_EXT_XDP_LINEARIZATION_BUFFER_SIZE, buffer, data_length);
+
+        net_xdp_ctx->linearization_pool = pool;
+        net_xdp_ctx->linearization_buffer_index = index;
+        net_xdp_ctx->base.data = buffer;
+        net_xdp_ctx->base.data_end = buffer + data_length;
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+static void
+_net_ebpf_ext_xdp_release_linearization(_Inout_ net_ebpf_xdp_md_t* net_xdp_ctx)
+{
+    if (net_xdp_ctx->linearization_pool != NULL) {
+        InterlockedBitTestAndReset(
+            &net_xdp_ctx->linearization_pool->buffers_in_use, net_xdp_ctx->linearization_buffer_index);
+        net_xdp_ctx->linearization_pool = NULL;
+    }
+}
+
+static NTSTATUS
+_net_ebpf_ext_allocate_cloned_nbl(_Inout_ net_ebpf_xdp_md_t* net_xdp_ctx, uint32_t unused_header_length);
+
+/**
+ * @brief Replace the linearization buffer of a packet with a cloned NBL holding the same data, including any changes
+ * the program made. This is needed before the packet can be modified in place, re-injected or transmitted. On
+ * failure the context keeps pointing into the linearization buffer, which stays claimed.
+ *
+ * @param[in, out] net_xdp_ctx The XDP program context.
+ *
+ * @retval STATUS_SUCCESS The operation was successful.
+ * @retval STATUS_INSUFFICIENT_RESOURCES Failed to allocate the cloned NBL.
+ */
+static NTSTATUS
+_net_ebpf_ext_xdp_clone_linearized_packet(_Inout_ net_ebpf_xdp_md_t* net_xdp_ctx)
+{
+    // The clone copies the packet from the context data pointers, which point into the linearization buffer.
+    NTSTATUS status = _net_ebpf_ext_allocate_cloned_nbl(net_xdp_ctx, 0);
+    if (NT_SUCCESS(status)) {
+        _net_ebpf_ext_xdp_release_linearization(net_xdp_ctx);
+    }
+    return status;
+}
+
+/**
+ * @brief Release the linearization buffer of a packet once the program has run. If the program modified the packet
+ * and did not drop it, the modified packet is cloned first.
+ *
+ * @param[in, out] net_xdp_ctx The XDP program context.
+ * @param[in, out] result The XDP verdict. Set to XDP_DROP if a modified packet could not be cloned.
+ */
+static void
+_net_ebpf_ext_xdp_complete_linearization(_Inout_ net_ebpf_xdp_md_t* net_xdp_ctx, _Inout_ uint32_t* result)
+{
+    if (net_xdp_ctx->linearization_pool == NULL) {
+        return;
+    }
+
+    const uint8_t* data = (const uint8_t*)net_xdp_ctx->base.data;
+    size_t data_length = (const uint8_t*)net_xdp_ctx->base.data_end - data;
+    if (*result != XDP_DROP && memcmp(data, data + NET_EBPF_EXT_XDP_LINEARIZATION_BUFFER_SIZE, data_length) != 0) {
+        NTSTATUS status = _net_ebpf_ext_xdp_clone_linearized_packet(net_xdp_ctx);
+        if (!NT_SUCCESS(status)) {
+            // The original packet doesn't carry the changes the program made, so don't let it through.
+            NET_EBPF_EXT_LOG_MESSAGE_NTSTATUS(
+                NET_EBPF_EXT_TRACELOG_LEVEL_ERROR,
+                NET_EBPF_EXT_TRACELOG_KEYWORD_XDP,
+                "_net_ebpf_ext_xdp_clone_linearized_packet failed.",
+                status);
+            _net_ebpf_ext_xdp_release_linearization(net_xdp_ctx);
+            *result = XDP_DROP;
+        }
+    } else {
+        _net_ebpf_ext_xdp_release_linearization(net_xdp_ctx);
+    }
+}
+
 //
 // NBL Clone Functions.
 //
@@ -384,10 +581,6 @@ _net_ebpf_ext_allocate_cloned_nbl(_Inout_ net_ebpf_xdp_md_t* net_xdp_ctx, uint32
         }
     }
 
-    // Adjust the XDP context data pointers.
-    net_xdp_ctx->base.data = packet_buffer;
-    net_xdp_ctx->base.data_end = packet_buffer + cloned_net_buffer_length;
-
     // Create a MDL with the packet buffer.
     mdl_chain = IoAllocateMdl(packet_buffer, cloned_net_buffer_length, FALSE, FALSE, NULL);
     if (mdl_chain == NULL) {
@@ -406,6 +599,11 @@ _net_ebpf_ext_allocate_cloned_nbl(_Inout_ net_ebpf_xdp_md_t* net_xdp_ctx, uint32
         goto Exit;
     }
     mdl_chain = NULL;
+
+    // Adjust the XDP context data pointers only once the clone can no longer fail, so that on failure they keep
+    // pointing at the old packet data.
+    net_xdp_ctx->base.data = packet_buffer;
+    net_xdp_ctx->base.data_end = packet_buffer + cloned_net_buffer_length;
     packet_buffer = NULL;
 
     // Set the new NBL as the cloned NBL in XDP context, after disposing any previous clones.
@@ -460,6 +658,14 @@ _net_ebpf_xdp_adjust_head(_Inout_ xdp_md_t* ctx, int delta)
         goto Exit;
     }
 
+    if (net_xdp_ctx->linearization_pool != NULL) {
+        // The packet was only copied into a linearization buffer. Clone it, so the headroom can be adjusted.
+        if (!NT_SUCCESS(_net_ebpf_ext_xdp_clone_linearized_packet(net_xdp_ctx))) {
+            return_value = -1;
+            goto Exit;
+        }
+    }
+
     nbl = (net_xdp_ctx->cloned_nbl != NULL) ? net_xdp_ctx->cloned_nbl : net_xdp_ctx->original_nbl;
     ASSERT(nbl != NULL);
     net_buffer = NET_BUFFER_LIST_FIRST_NB(nbl);
@@ -508,17 +714,25 @@ Exit:
 //
 
 static void
-_net_ebpf_ext_l2_receive_inject_complete(_In_ const void* context, _Inout_ NET_BUFFER_LIST* nbl, BOOLEAN dispatch_level)
+_net_ebpf_ext_l2_receive_inject_complete(
+    _In_opt_ const void* context, _Inout_ NET_BUFFER_LIST* nbl, BOOLEAN dispatch_level)
 {
-    UNREFERENCED_PARAMETER(context);
     UNREFERENCED_PARAMETER(dispatch_level);
-    // Free clone allocated using _net_ebpf_ext_allocate_cloned_nbl.
-    _net_ebpf_ext_free_nbl(nbl, TRUE);
+
+    if ((BOOLEAN)(uintptr_t)context == FALSE) {
+        // Free clone allocated using _net_ebpf_ext_allocate_cloned_nbl.
+        _net_ebpf_ext_free_nbl(nbl, TRUE);
+    } else {
+        // Free clone allocated using FwpsAllocateCloneNetBufferList.
+        FwpsFreeCloneNetBufferList(nbl, 0);
+    }
 }
 
 static NTSTATUS
 _net_ebpf_ext_receive_inject_cloned_nbl(
-    _In_ const NET_BUFFER_LIST* cloned_nbl, _In_ const FWPS_INCOMING_VALUES* incoming_fixed_values)
+    _In_ const NET_BUFFER_LIST* cloned_nbl,
+    bool wfp_cloned_packet,
+    _In_ const FWPS_INCOMING_VALUES* incoming_fixed_values)
 {
     uint32_t interface_index =
         incoming_fixed_values->incomingValue[FWPS_FIELD_INBOUND_MAC_FRAME_NATIVE_INTERFACE_INDEX].value.uint32;
@@ -534,7 +748,7 @@ _net_ebpf_ext_receive_inject_cloned_nbl(
         ndis_port,
         (NET_BUFFER_LIST*)cloned_nbl,
         (FWPS_INJECT_COMPLETE)_net_ebpf_ext_l2_receive_inject_complete,
-        NULL);
+        (void*)(uintptr_t)wfp_cloned_packet);
 
     if (!NT_SUCCESS(status)) {
         NET_EBPF_EXT_LOG_NTSTATUS_API_FAILURE(NET_EBPF_EXT_TRACELOG_KEYWORD_XDP, "FwpsInjectMacReceiveAsync", status);
@@ -620,6 +834,180 @@ Exit:
 // WFP Classify callback.
 //
 
+// Maximum number of NBLs of a chain handed to the XDP program in a single batch invocation.
+#define NET_EBPF_EXT_XDP_BURST_SIZE 16
+
+C_ASSERT(NET_EBPF_EXT_XDP_BURST_SIZE <= NET_EBPF_EXTENSION_HOOK_MAX_BATCH_SIZE);
+
+/**
+ * @brief Build the XDP program context for a received NBL.
+ *
+ * @param[in] nbl The received NBL.
+ * @param[in] ingress_ifindex Interface index the NBL was received on.
+ * @param[out] net_xdp_ctx The XDP program context.
+ *
+ * @retval STATUS_SUCCESS The operation was successful.
+ * @retval STATUS_INVALID_PARAMETER The NBL has no net buffer.
+ * @retval STATUS_INSUFFICIENT_RESOURCES Failed to allocate a contiguous copy of the packet.
+ */
+static NTSTATUS
+_net_ebpf_ext_xdp_prepare_context(
+    _In_ NET_BUFFER_LIST* nbl, uint32_t ingress_ifindex, _Out_ net_ebpf_xdp_md_t* net_xdp_ctx)
+{
+    NTSTATUS status = STATUS_SUCCESS;
+    NET_BUFFER* net_buffer;
+    uint8_t* packet_buffer;
+
+    memset(net_xdp_ctx, 0, sizeof(*net_xdp_ctx));
+    net_xdp_ctx->base.ingress_ifindex = ingress_ifindex;
+    net_xdp_ctx->original_nbl = nbl;
+
+    net_buffer = NET_BUFFER_LIST_FIRST_NB(nbl);
+    if (net_buffer == NULL) {
+        NET_EBPF_EXT_LOG_MESSAGE(
+            NET_EBPF_EXT_TRACELOG_LEVEL_ERROR, NET_EBPF_EXT_TRACELOG_KEYWORD_XDP, "net_buffer not present");
+        status = STATUS_INVALID_PARAMETER;
+        goto Exit;
+    }
+
+    packet_buffer = (uint8_t*)NdisGetDataBuffer(net_buffer, net_buffer->DataLength, NULL, sizeof(uint16_t), 0);
+    if (!packet_buffer) {
+        // Data in net_buffer not contiguous.
+        // Copy it into a linearization buffer, or if none is available, allocate a cloned NBL with contiguous data.
+        if (_net_ebpf_ext_xdp_linearize(net_xdp_ctx, net_buffer)) {
+            goto Exit;
+        }
+        status = _net_ebpf_ext_allocate_cloned_nbl(net_xdp_ctx, 0);
+        if (!NT_SUCCESS(status)) {
+            NET_EBPF_EXT_LOG_MESSAGE_NTSTATUS(
+                NET_EBPF_EXT_TRACELOG_LEVEL_ERROR,
+                NET_EBPF_EXT_TRACELOG_KEYWORD_XDP,
+                "_net_ebpf_ext_allocate_cloned_nbl failed.",
+                status);
+            goto Exit;
+        }
+    } else {
+        net_xdp_ctx->base.data = packet_buffer;
+        net_xdp_ctx->base.data_end = packet_buffer + net_buffer->DataLength;
+    }
+
+Exit:
+    return status;
+}
+
+/**
+ * @brief Carry out the XDP verdict for a packet that WFP classified on its own. The verdict is reported through the
+ * classify output.
+ *
+ * @param[in, out] net_xdp_ctx The XDP program context of the packet.
+ * @param[in] result The XDP verdict.
+ * @param[in] incoming_fixed_values The classify incoming values.
+ * @param[in, out] classify_output The classify output.
+ */
+static void
+_net_ebpf_ext_xdp_apply_verdict(
+    _Inout_ net_ebpf_xdp_md_t* net_xdp_ctx,
+    uint32_t result,
+    _In_ const FWPS_INCOMING_VALUES* incoming_fixed_values,
+    _Inout_ FWPS_CLASSIFY_OUT* classify_output)
+{
+    NTSTATUS status;
+
+    switch (result) {
+    case XDP_PASS:
+        if (net_xdp_ctx->cloned_nbl != NULL) {
+            // Drop the original NBL.
+            classify_output->actionType = FWP_ACTION_BLOCK;
+            classify_output->rights &= ~FWPS_RIGHT_ACTION_WRITE;
+
+            // Inject the cloned NBL in receive path.
+            status = _net_ebpf_ext_receive_inject_cloned_nbl(net_xdp_ctx->cloned_nbl, FALSE, incoming_fixed_values);
+            if (NT_SUCCESS(status)) {
+                // If cloned packet could be successfully injected, no need to audit for dropping the original.
+                // So absorb the original packet.
+                classify_output->flags |= FWPS_CLASSIFY_OUT_FLAG_ABSORB;
+            } else {
+                NET_EBPF_EXT_LOG_MESSAGE_NTSTATUS(
+                    NET_EBPF_EXT_TRACELOG_LEVEL_ERROR,
+                    NET_EBPF_EXT_TRACELOG_KEYWORD_XDP,
+                    "_net_ebpf_ext_receive_inject_cloned_nbl failed.",
+                    status);
+                _net_ebpf_ext_free_nbl(net_xdp_ctx->cloned_nbl, TRUE);
+            }
+        }
+        // No special processing required in the non-clone case.
+        // The inbound original NBL will be allowed to proceed in the ingress path.
+        break;
+    case XDP_TX:
+        _net_ebpf_ext_handle_xdp_tx(net_xdp_ctx, incoming_fixed_values);
+        // Absorb the original NBL.
+        classify_output->actionType = FWP_ACTION_BLOCK;
+        classify_output->rights &= ~FWPS_RIGHT_ACTION_WRITE;
+        classify_output->flags |= FWPS_CLASSIFY_OUT_FLAG_ABSORB;
+        break;
+    default:
+        ASSERT(FALSE);
+        __fallthrough;
+    case XDP_DROP:
+        classify_output->actionType = FWP_ACTION_BLOCK;
+        classify_output->rights &= ~FWPS_RIGHT_ACTION_WRITE;
+        // Do not audit XDP drops.
+        classify_output->flags |= FWPS_CLASSIFY_OUT_FLAG_ABSORB;
+        // Free cloned NBL, if any.
+        if (net_xdp_ctx->cloned_nbl != NULL) {
+            _net_ebpf_ext_free_nbl(net_xdp_ctx->cloned_nbl, TRUE);
+        }
+        break;
+    }
+}
+
+/**
+ * @brief Carry out the XDP verdict for one packet of an NBL chain whose original NBL does not stay in the permitted
+ * chain. Packets that pass are injected back into the receive path.
+ *
+ * @param[in, out] net_xdp_ctx The XDP program context of the packet.
+ * @param[in] result The XDP verdict.
+ * @param[in] incoming_fixed_values The classify incoming values.
+ */
+static void
+_net_ebpf_ext_xdp_apply_absorbed_verdict(
+    _Inout_ net_ebpf_xdp_md_t* net_xdp_ctx, uint32_t result, _In_ const FWPS_INCOMING_VALUES* incoming_fixed_values)
+{
+    NTSTATUS status = STATUS_SUCCESS;
+    NET_BUFFER_LIST* nbl = net_xdp_ctx->cloned_nbl;
+    bool wfp_cloned_packet = FALSE;
+
+    switch (result) {
+    case XDP_PASS:
+        if (nbl == NULL) {
+            status = FwpsAllocateCloneNetBufferList(net_xdp_ctx->original_nbl, NULL, NULL, 0, &nbl);
+            if (status != STATUS_SUCCESS) {
+                NET_EBPF_EXT_LOG_NTSTATUS_API_FAILURE(
+                    NET_EBPF_EXT_TRACELOG_KEYWORD_XDP, "FwpsAllocateCloneNetBufferList", status);
+                break;
+            }
+            wfp_cloned_packet = TRUE;
+        }
+        status = _net_ebpf_ext_receive_inject_cloned_nbl(nbl, wfp_cloned_packet, incoming_fixed_values);
+        if (!NT_SUCCESS(status)) {
+            _net_ebpf_ext_l2_receive_inject_complete(
+                (void*)(uintptr_t)wfp_cloned_packet, nbl, KeGetCurrentIrql() == DISPATCH_LEVEL);
+        }
+        break;
+    case XDP_TX:
+        _net_ebpf_ext_handle_xdp_tx(net_xdp_ctx, incoming_fixed_values);
+        break;
+    default:
+        ASSERT(FALSE);
+        __fallthrough;
+    case XDP_DROP:
+        if (nbl != NULL) {
+            _net_ebpf_ext_free_nbl(nbl, TRUE);
+        }
+        break;
+    }
+}
+
 void
 net_ebpf_ext_layer_2_classify(
     _In_ const FWPS_INCOMING_VALUES* incoming_fixed_values,
@@ -630,15 +1018,20 @@ net_ebpf_ext_layer_2_classify(
     uint64_t flow_context,
     _Inout_ FWPS_CLASSIFY_OUT* classify_output)
 {
-    NTSTATUS status = STATUS_SUCCESS;
     NET_BUFFER_LIST* nbl = (NET_BUFFER_LIST*)layer_data;
-    NET_BUFFER* net_buffer = NULL;
-    uint8_t* packet_buffer;
-    uint32_t result = 0;
-    net_ebpf_xdp_md_t net_xdp_ctx = {0};
+    NET_BUFFER_LIST* next_nbl;
+    net_ebpf_xdp_md_t net_xdp_ctx[NET_EBPF_EXT_XDP_BURST_SIZE];
+    void* program_contexts[NET_EBPF_EXT_XDP_BURST_SIZE];
+    uint32_t context_index[NET_EBPF_EXT_XDP_BURST_SIZE];
+    uint32_t verdicts[NET_EBPF_EXT_XDP_BURST_SIZE];
+    uint32_t results[NET_EBPF_EXT_XDP_BURST_SIZE];
+    ebpf_result_t invoke_results[NET_EBPF_EXT_XDP_BURST_SIZE];
     net_ebpf_extension_xdp_wfp_filter_context_t* filter_context = NULL;
     net_ebpf_extension_hook_client_t* attached_client = NULL;
     uint32_t client_if_index;
+    uint32_t ingress_ifindex;
+    bool absorb_chain = FALSE;
+    NET_BUFFER_LIST* last_permitted_nbl = NULL;
 
     UNREFERENCED_PARAMETER(incoming_metadata_values);
     UNREFERENCED_PARAMETER(classify_context);
@@ -659,13 +1052,27 @@ net_ebpf_ext_layer_2_classify(
         goto Exit;
     }
 
+    // Packets passed by the XDP program and injected back into the receive path are classified again. They have
+    // already been processed, so let them through. Packets are injected one at a time, so checking the first NBL is
+    // enough.
+    if (nbl != NULL) {
+        FWPS_PACKET_INJECTION_STATE injection_state =
+            FwpsQueryPacketInjectionState(_net_ebpf_ext_l2_injection_handle, nbl, NULL);
+        if (injection_state == FWPS_PACKET_INJECTED_BY_SELF ||
+            injection_state == FWPS_PACKET_PREVIOUSLY_INJECTED_BY_SELF) {
+            goto Exit;
+        }
+    }
+
     filter_context = (net_ebpf_extension_xdp_wfp_filter_context_t*)filter->context;
     ASSERT(filter_context != NULL);
     if (filter_context == NULL) {
         goto Exit;
     }
 
-    if (filter_context->base.client_detached) {
+    attached_client =
+        (net_ebpf_extension_hook_client_t*)net_ebpf_extension_wfp_filter_context_get_client(&filter_context->base);
+    if (attached_client == NULL) {
         NET_EBPF_EXT_LOG_MESSAGE_NTSTATUS(
             NET_EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
             NET_EBPF_EXT_TRACELOG_KEYWORD_XDP,
@@ -674,114 +1081,103 @@ net_ebpf_ext_layer_2_classify(
         goto Exit;
     }
 
-    attached_client = (net_ebpf_extension_hook_client_t*)filter_context->base.client_context;
-    if (!net_ebpf_extension_hook_client_enter_rundown(attached_client)) {
-        NET_EBPF_EXT_LOG_MESSAGE_NTSTATUS(
-            NET_EBPF_EXT_TRACELOG_LEVEL_VERBOSE,
-            NET_EBPF_EXT_TRACELOG_KEYWORD_XDP,
-            "net_ebpf_ext_layer_2_classify - Rundown already started.",
-            STATUS_INVALID_PARAMETER);
-        attached_client = NULL;
-        goto Exit;
-    }
-
     if (nbl == NULL) {
         NET_EBPF_EXT_LOG_MESSAGE(NET_EBPF_EXT_TRACELOG_LEVEL_ERROR, NET_EBPF_EXT_TRACELOG_KEYWORD_XDP, "Null NBL");
         goto Exit;
     }
 
-    net_xdp_ctx.base.ingress_ifindex =
+    ingress_ifindex =
         incoming_fixed_values->incomingValue[FWPS_FIELD_INBOUND_MAC_FRAME_NATIVE_INTERFACE_INDEX].value.uint32;
 
     client_if_index = filter_context->if_index;
-    ASSERT((client_if_index == 0) || (client_if_index == net_xdp_ctx.base.ingress_ifindex));
-    if (client_if_index != 0 && client_if_index != net_xdp_ctx.base.ingress_ifindex) {
+    ASSERT((client_if_index == 0) || (client_if_index == ingress_ifindex));
+    if (client_if_index != 0 && client_if_index != ingress_ifindex) {
         // The client is not interested in this ingress ifindex.
         goto Exit;
     }
 
-    net_xdp_ctx.original_nbl = nbl;
+    if (NET_BUFFER_LIST_NEXT_NBL(nbl) == NULL) {
+        // A single packet. Its verdict is reported through the classify output.
+        uint32_t result;
+        if (!NT_SUCCESS(_net_ebpf_ext_xdp_prepare_context(nbl, ingress_ifindex, &net_xdp_ctx[0]))) {
+            goto Exit;
+        }
 
-    net_buffer = NET_BUFFER_LIST_FIRST_NB(nbl);
-    if (net_buffer == NULL) {
-        NET_EBPF_EXT_LOG_MESSAGE(
-            NET_EBPF_EXT_TRACELOG_LEVEL_ERROR, NET_EBPF_EXT_TRACELOG_KEYWORD_XDP, "net_buffer not present");
+        if (net_ebpf_extension_hook_invoke_program(attached_client, &net_xdp_ctx[0], &result) != EBPF_SUCCESS) {
+            // Perform a default action if the program fails.
+            result = XDP_DROP;
+        }
+        _net_ebpf_ext_xdp_complete_linearization(&net_xdp_ctx[0], &result);
+
+        _net_ebpf_ext_xdp_apply_verdict(&net_xdp_ctx[0], result, incoming_fixed_values, classify_output);
         goto Exit;
     }
 
-    packet_buffer = (uint8_t*)NdisGetDataBuffer(net_buffer, net_buffer->DataLength, NULL, sizeof(uint16_t), 0);
-    if (!packet_buffer) {
-        // Data in net_buffer not contiguous.
-        // Allocate a cloned NBL with contiguous data.
-        status = _net_ebpf_ext_allocate_cloned_nbl(&net_xdp_ctx, 0);
-        if (!NT_SUCCESS(status)) {
-            NET_EBPF_EXT_LOG_MESSAGE_NTSTATUS(
-                NET_EBPF_EXT_TRACELOG_LEVEL_ERROR,
-                NET_EBPF_EXT_TRACELOG_KEYWORD_XDP,
-                "_net_ebpf_ext_allocate_cloned_nbl failed.",
-                status);
-            goto Exit;
+    // An NBL chain. Hand the packets to the XDP program in bursts, so that the program is entered once per burst rather
+    // than once per packet. Packets that pass unmodified stay in the chain, which is permitted in place. Other packets
+    // are unlinked from it and their verdicts carried out in bulk. Only the first NBL can't be unlinked: if it does not
+    // pass unmodified, the whole chain is absorbed and the packets that pass are injected back into the receive path.
+    next_nbl = nbl;
+    while (next_nbl != NULL) {
+        uint32_t burst_count = 0;
+        uint32_t invoke_count = 0;
+
+        // Build the program contexts for the next burst. Packets whose context can't be built pass unprocessed.
+        for (; next_nbl != NULL && burst_count < NET_EBPF_EXT_XDP_BURST_SIZE;
+             next_nbl = NET_BUFFER_LIST_NEXT_NBL(next_nbl), burst_count++) {
+            verdicts[burst_count] = XDP_PASS;
+            if (NT_SUCCESS(_net_ebpf_ext_xdp_prepare_context(next_nbl, ingress_ifindex, &net_xdp_ctx[burst_count]))) {
+                program_contexts[invoke_count] = &net_xdp_ctx[burst_count];
+                context_index[invoke_count] = burst_count;
+                invoke_count++;
+            } else {
+                net_xdp_ctx[burst_count].original_nbl = next_nbl;
+                net_xdp_ctx[burst_count].cloned_nbl = NULL;
+            }
         }
-    } else {
-        net_xdp_ctx.base.data = packet_buffer;
-        net_xdp_ctx.base.data_end = packet_buffer + net_buffer->DataLength;
-    }
 
-    if (net_ebpf_extension_hook_invoke_program(attached_client, &net_xdp_ctx, &result) != EBPF_SUCCESS) {
-        // Perform a default action if the program fails.
-        result = XDP_DROP;
-    }
+        net_ebpf_extension_hook_invoke_program_batch(
+            attached_client, invoke_count, program_contexts, results, invoke_results);
 
-    switch (result) {
-    case XDP_PASS:
-        if (net_xdp_ctx.cloned_nbl != NULL) {
-            // Drop the original NBL.
-            classify_output->actionType = FWP_ACTION_BLOCK;
-            classify_output->rights &= ~FWPS_RIGHT_ACTION_WRITE;
+        // Collect the verdicts of the burst.
+        for (uint32_t index = 0; index < invoke_count; index++) {
+            uint32_t slot = context_index[index];
+            // Perform a default action if the program fails.
+            verdicts[slot] = (invoke_results[index] == EBPF_SUCCESS) ? results[index] : XDP_DROP;
+            _net_ebpf_ext_xdp_complete_linearization(&net_xdp_ctx[slot], &verdicts[slot]);
+        }
 
-            // Inject the cloned NBL in receive path.
-            status = _net_ebpf_ext_receive_inject_cloned_nbl(net_xdp_ctx.cloned_nbl, incoming_fixed_values);
-            if (NT_SUCCESS(status)) {
-                // If cloned packet could be successfully injected, no need to audit for dropping the original.
-                // So absorb the original packet.
-                classify_output->flags |= FWPS_CLASSIFY_OUT_FLAG_ABSORB;
+        // Relink the packets that pass unmodified, and carry out the verdicts of the others.
+        for (uint32_t slot = 0; slot < burst_count; slot++) {
+            NET_BUFFER_LIST* slot_nbl = net_xdp_ctx[slot].original_nbl;
+            bool passed = (verdicts[slot] == XDP_PASS && net_xdp_ctx[slot].cloned_nbl == NULL);
+
+            if (slot_nbl == nbl && !passed) {
+                absorb_chain = TRUE;
+            }
+            if (passed && !absorb_chain) {
+                if (last_permitted_nbl != NULL) {
+                    NET_BUFFER_LIST_NEXT_NBL(last_permitted_nbl) = slot_nbl;
+                }
+                last_permitted_nbl = slot_nbl;
             } else {
-                NET_EBPF_EXT_LOG_MESSAGE_NTSTATUS(
-                    NET_EBPF_EXT_TRACELOG_LEVEL_ERROR,
-                    NET_EBPF_EXT_TRACELOG_KEYWORD_XDP,
-                    "_net_ebpf_ext_receive_inject_cloned_nbl failed.",
-                    status);
+                _net_ebpf_ext_xdp_apply_absorbed_verdict(&net_xdp_ctx[slot], verdicts[slot], incoming_fixed_values);
             }
         }
-        // No special processing required in the non-clone case.
-        // The inbound original NBL will be allowed to proceed in the ingress path.
-        break;
-    case XDP_TX:
-        _net_ebpf_ext_handle_xdp_tx(&net_xdp_ctx, incoming_fixed_values);
-        // Absorb the original NBL.
-        classify_output->actionType = FWP_ACTION_BLOCK;
-        classify_output->rights &= ~FWPS_RIGHT_ACTION_WRITE;
-        classify_output->flags |= FWPS_CLASSIFY_OUT_FLAG_ABSORB;
-        break;
-    default:
-        ASSERT(FALSE);
-        __fallthrough;
-    case XDP_DROP:
+    }
+
+    if (last_permitted_nbl != NULL) {
+        NET_BUFFER_LIST_NEXT_NBL(last_permitted_nbl) = NULL;
+    }
+
+    if (absorb_chain) {
         classify_output->actionType = FWP_ACTION_BLOCK;
         classify_output->rights &= ~FWPS_RIGHT_ACTION_WRITE;
-        // Do not audit XDP drops.
         classify_output->flags |= FWPS_CLASSIFY_OUT_FLAG_ABSORB;
-        // Free cloned NBL, if any.
-        if (net_xdp_ctx.cloned_nbl != NULL) {
-            _net_ebpf_ext_free_nbl(net_xdp_ctx.cloned_nbl, TRUE);
-        }
-        break;
     }
 
 Exit:
-    if (attached_client) {
-        net_ebpf_extension_hook_client_leave_rundown(attached_client);
-    }
+    return;
 }
 
 /**
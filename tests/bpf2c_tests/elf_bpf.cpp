@@ -263,7 +263,7 @@ TEST_CASE("help", "[bpf2c_cli]")
 
     auto [out, err, result_value] = run_test_main(argv);
     REQUIRE(result_value != 0);
-    std::vector<std::string> options = {"--sys", "--dll", "--no-verify", "--bpf", "--hash", "--help"};
+    std::vector<std::string> options = {"--sys", "--dll", "--no-verify", "--instanced", "--bpf", "--hash", "--help"};
     for (const auto& option : options) {
         REQUIRE(err.find(option) != std::string::npos);
     }
@@ -291,6 +291,28 @@ TEST_CASE("bad --hash", "[bpf2c_cli]")
     REQUIRE(!err.empty());
 }
 
+TEST_CASE("--instanced", "[bpf2c_cli]")
+{
+    std::vector<const char*> argv;
+    argv.push_back("bpf2c.exe");
+    argv.push_back("--instanced");
+    argv.push_back("--bpf");
+    argv.push_back("bindmonitor.o");
+    argv.push_back("--hash");
+    argv.push_back("none");
+    argv.push_back("--raw");
+
+    auto [out, err, result_value] = run_test_main(argv);
+    REQUIRE(result_value == 0);
+
+    // Programs must read map and helper addresses from the runtime context instead of the static tables.
+    REQUIRE(out.find("(void* context, const program_runtime_context_t* runtime_context)") != std::string::npos);
+    REQUIRE(out.find("runtime_context->maps[") != std::string::npos);
+    REQUIRE(out.find("runtime_context->helpers[") != std::string::npos);
+    REQUIRE(out.find("= POINTER(_maps[") == std::string::npos);
+    REQUIRE(out.find("_get_map_initial_values, true};") != std::string::npos);
+}
+
 // List of malformed ELF files and the expected error message.
 // Files are named after the SHA1 hash of the ELF file to avoid duplicates and merge conflicts.
 const std::map<std::string, std::string> _malformed_elf_expected_output{
@@ -1005,6 +1005,85 @@ map_test(ebpf_execution_type_t execution_type)
     bpf_object__close(unique_object.release());
 }
 
+void
+bloom_filter_test(ebpf_execution_type_t execution_type)
+{
+    _test_helper_end_to_end test_helper;
+    test_helper.initialize();
+
+    const char* error_message = nullptr;
+    int result;
+    bpf_object_ptr unique_object;
+    bpf_link_ptr link;
+    fd_t program_fd;
+
+    program_info_provider_t bind_program_info;
+    REQUIRE(bind_program_info.initialize(EBPF_PROGRAM_TYPE_BIND) == EBPF_SUCCESS);
+
+    const char* file_name = (execution_type == EBPF_EXECUTION_NATIVE ? "bloom_filter_um.dll" : "bloom_filter.o");
+
+    result =
+        ebpf_program_load(file_name, BPF_PROG_TYPE_UNSPEC, execution_type, &unique_object, &program_fd, &error_message);
+
+    if (error_message) {
+        printf("ebpf_program_load failed with %s\n", error_message);
+        ebpf_free((void*)error_message);
+    }
+    REQUIRE(result == 0);
+    fd_t bloom_filter_fd = bpf_object__find_map_fd_by_name(unique_object.get(), "bound_processes");
+    REQUIRE(bloom_filter_fd > 0);
+    fd_t peek_results_fd = bpf_object__find_map_fd_by_name(unique_object.get(), "peek_results");
+    REQUIRE(peek_results_fd > 0);
+
+    single_instance_hook_t hook(EBPF_PROGRAM_TYPE_BIND, EBPF_ATTACH_TYPE_BIND);
+    REQUIRE(hook.initialize() == EBPF_SUCCESS);
+
+    uint32_t ifindex = 0;
+    REQUIRE(hook.attach_link(program_fd, &ifindex, sizeof(ifindex), &link) == EBPF_SUCCESS);
+
+    std::function<ebpf_result_t(void*, uint32_t*)> invoke =
+        [&hook](_Inout_ void* context, _Out_ uint32_t* result) -> ebpf_result_t { return hook.fire(context, result); };
+    auto get_peek_result = [&](uint32_t index) {
+        uint64_t count = 0;
+        REQUIRE(bpf_map_lookup_elem(peek_results_fd, &index, &count) == 0);
+        return count;
+    };
+    const uint32_t hit_index = 0;
+    const uint32_t miss_index = 1;
+
+    // The first bind of a process misses and pushes the process ID, and later binds hit.
+    uint64_t fake_pid = 12345;
+    REQUIRE(emulate_bind(invoke, fake_pid, "fake_app_1") == BIND_PERMIT);
+    REQUIRE(get_peek_result(hit_index) == 0);
+    REQUIRE(get_peek_result(miss_index) == 1);
+    REQUIRE(emulate_bind(invoke, fake_pid, "fake_app_1") == BIND_DENY);
+    REQUIRE(get_peek_result(hit_index) == 1);
+    REQUIRE(get_peek_result(miss_index) == 1);
+
+    // Another process misses.
+    uint64_t other_pid = 54321;
+    REQUIRE(emulate_bind(invoke, other_pid, "fake_app_2") == BIND_PERMIT);
+    REQUIRE(get_peek_result(hit_index) == 1);
+    REQUIRE(get_peek_result(miss_index) == 2);
+
+    // Values pushed by the program are visible from user mode, and values that were never pushed are not.
+    REQUIRE(bpf_map_lookup_elem(bloom_filter_fd, nullptr, &fake_pid) == 0);
+    REQUIRE(bpf_map_lookup_elem(bloom_filter_fd, nullptr, &other_pid) == 0);
+    uint64_t unknown_pid = 99999;
+    REQUIRE(bpf_map_lookup_elem(bloom_filter_fd, nullptr, &unknown_pid) < 0);
+    REQUIRE(errno == ENOENT);
+
+    // Values pushed from user mode are visible to the program.
+    REQUIRE(bpf_map_update_elem(bloom_filter_fd, nullptr, &unknown_pid, 0) == 0);
+    REQUIRE(emulate_bind(invoke, unknown_pid, "fake_app_3") == BIND_DENY);
+    REQUIRE(get_peek_result(hit_index) == 2);
+    REQUIRE(get_peek_result(miss_index) == 2);
+
+    hook.detach_and_close_link(&link);
+
+    bpf_object__close(unique_object.release());
+}
+
 DECLARE_ALL_TEST_CASES("droppacket", "[end_to_end]", droppacket_test);
 DECLARE_ALL_TEST_CASES("divide_by_zero", "[end_to_end]", divide_by_zero_test_um);
 DECLARE_ALL_TEST_CASES("bindmonitor", "[end_to_end]", bindmonitor_test);
@@ -1013,6 +1092,7 @@ DECLARE_ALL_TEST_CASES("bindmonitor-ringbuf", "[end_to_end]", bindmonitor_ring_b
 DECLARE_ALL_TEST_CASES("utility-helpers", "[end_to_end]", _utility_helper_functions_test);
 DECLARE_ALL_TEST_CASES("map", "[end_to_end]", map_test);
 DECLARE_ALL_TEST_CASES("bad_map_name", "[end_to_end]", bad_map_name_um);
+DECLARE_JIT_TEST_CASES("bloom_filter", "[end_to_end]", bloom_filter_test);
 
 TEST_CASE("enum section", "[end_to_end]")
 {
@@ -1824,6 +1904,60 @@ TEST_CASE("printk", "[end_to_end]")
     // so subtract 6 from the length to get the expected return value.
     REQUIRE(hook_result == output_length - 6);
 }
+
+TEST_CASE("printk_binary", "[end_to_end]")
+{
+    _test_helper_end_to_end test_helper;
+    test_helper.initialize();
+    single_instance_hook_t hook(EBPF_PROGRAM_TYPE_BIND, EBPF_ATTACH_TYPE_BIND);
+    REQUIRE(hook.initialize() == EBPF_SUCCESS);
+    program_info_provider_t bind_program_info;
+    REQUIRE(bind_program_info.initialize(EBPF_PROGRAM_TYPE_BIND) == EBPF_SUCCESS);
+    uint32_t ifindex = 0;
+    program_load_attach_helper_t program_helper;
+    program_helper.initialize(
+        SAMPLE_PATH "printk.o", BPF_PROG_TYPE_BIND, "func", EBPF_EXECUTION_INTERPRET, &ifindex, sizeof(ifindex), hook);
+
+    SOCKADDR_IN addr = {AF_INET};
+    addr.sin_port = htons(80);
+    bind_md_t ctx = {0};
+    ctx.process_id = GetCurrentProcessId();
+    ctx.protocol = 2;
+    ctx.socket_address_length = sizeof(addr);
+    memcpy(&ctx.socket_address, &addr, ctx.socket_address_length);
+
+    uint32_t hook_result = 0;
+    usersim_trace_logging_set_enabled(true, EBPF_TRACELOG_LEVEL_INFO, EBPF_TRACELOG_KEYWORD_PRINTK_BINARY);
+    ebpf_result_t hook_fire_result = hook.fire(&ctx, &hook_result);
+    usersim_trace_logging_set_enabled(false, 0, 0);
+    REQUIRE(hook_fire_result == EBPF_SUCCESS);
+
+    // In binary mode each successful call writes a 4-byte format ID plus 8 bytes per argument.
+    // The eight valid calls take 0, 0, 1, 1, 1, 2, 3 and 0 arguments, and the six invalid calls return -1.
+    const uint32_t expected_bytes = (8 * sizeof(uint32_t)) + (8 * sizeof(uint64_t));
+    REQUIRE(hook_result == expected_bytes - 6);
+
+    // Binary output is an explicit opt-in. A session that enables every keyword, and so also enables text printk
+    // output, gets text output.
+    std::vector<std::string> expected_output = {
+        "Hello, world",
+        "Hello, world",
+        "PID: " + std::to_string(ctx.process_id) + " using %u",
+        "PID: " + std::to_string(ctx.process_id) + " using %lu",
+        "PID: " + std::to_string(ctx.process_id) + " using %llu",
+        "PID: " + std::to_string(ctx.process_id) + " PROTO: 2",
+        "PID: " + std::to_string(ctx.process_id) + " PROTO: 2 ADDRLEN: 16",
+        "100% done"};
+    size_t output_length = 0;
+    for (const auto& line : expected_output) {
+        output_length += line.length();
+    }
+    usersim_trace_logging_set_enabled(true, EBPF_TRACELOG_LEVEL_INFO, UINT64_MAX);
+    hook_fire_result = hook.fire(&ctx, &hook_result);
+    usersim_trace_logging_set_enabled(false, 0, 0);
+    REQUIRE(hook_fire_result == EBPF_SUCCESS);
+    REQUIRE(hook_result == output_length - 6);
+}
 #endif
 
 DECLARE_ALL_TEST_CASES("xdp-reflect-v4", "[xdp_tests]", _xdp_reflect_packet_test_v4);
@@ -2806,6 +2940,28 @@ TEST_CASE("ebpf_get_program_type_by_name invalid name", "[end-to-end]")
     REQUIRE(ebpf_get_program_type_by_name("invalid_name", &program_type, &attach_type) == EBPF_KEY_NOT_FOUND);
 }
 
+TEST_CASE("ebpf_get_program_type_by_name longest prefix", "[end-to-end]")
+{
+    _test_helper_end_to_end test_helper;
+    test_helper.initialize();
+    ebpf_program_type_t program_type;
+    ebpf_attach_type_t attach_type;
+
+    // A section name resolves to the longest registered prefix it starts with.
+    REQUIRE(ebpf_get_program_type_by_name("xdp_test/program", &program_type, &attach_type) == EBPF_SUCCESS);
+    REQUIRE(IsEqualGUID(program_type, EBPF_PROGRAM_TYPE_XDP_TEST));
+    REQUIRE(ebpf_get_program_type_by_name("xdp/program", &program_type, &attach_type) == EBPF_SUCCESS);
+    REQUIRE(IsEqualGUID(program_type, EBPF_PROGRAM_TYPE_XDP));
+    REQUIRE(ebpf_get_program_type_by_name("cgroup/connect4", &program_type, &attach_type) == EBPF_SUCCESS);
+    REQUIRE(IsEqualGUID(attach_type, EBPF_ATTACH_TYPE_CGROUP_INET4_CONNECT));
+    REQUIRE(ebpf_get_program_type_by_name("cgroup/connect6_v2", &program_type, &attach_type) == EBPF_SUCCESS);
+    REQUIRE(IsEqualGUID(attach_type, EBPF_ATTACH_TYPE_CGROUP_INET6_CONNECT));
+
+    // A name that is only a prefix of registered prefixes does not match.
+    REQUIRE(ebpf_get_program_type_by_name("cgroup/", &program_type, &attach_type) == EBPF_KEY_NOT_FOUND);
+    REQUIRE(ebpf_get_program_type_by_name("", &program_type, &attach_type) == EBPF_KEY_NOT_FOUND);
+}
+
 TEST_CASE("ebpf_get_program_type_name invalid types", "[end-to-end]")
 {
     _test_helper_end_to_end test_helper;
@@ -2933,6 +3089,335 @@ TEST_CASE("test_ebpf_object_set_execution_type", "[end_to_end]")
     bpf_object__close(jit_object);
 }
 
+TEST_CASE("test_ebpf_object_set_native_instance_of", "[end_to_end]")
+{
+    _test_helper_end_to_end test_helper;
+    test_helper.initialize();
+
+    program_info_provider_t sample_program_info;
+    REQUIRE(sample_program_info.initialize(EBPF_PROGRAM_TYPE_SAMPLE) == EBPF_SUCCESS);
+
+    bpf_object_ptr loaded_object(bpf_object__open("test_sample_ebpf_um.dll"));
+    REQUIRE(loaded_object != nullptr);
+    bpf_object_ptr instance_object(bpf_object__open("test_sample_ebpf_um.dll"));
+    REQUIRE(instance_object != nullptr);
+
+    // The object to create the instance from must be loaded first.
+    REQUIRE(ebpf_object_set_native_instance_of(instance_object.get(), loaded_object.get()) == EBPF_INVALID_ARGUMENT);
+    REQUIRE(bpf_object__load(loaded_object.get()) == 0);
+
+    // A loaded object cannot be turned into an instance.
+    REQUIRE(ebpf_object_set_native_instance_of(loaded_object.get(), loaded_object.get()) == EBPF_INVALID_ARGUMENT);
+
+    // The sample module was not generated with bpf2c --instanced, so no instance can be created from it.
+    REQUIRE(ebpf_object_set_native_instance_of(instance_object.get(), loaded_object.get()) == EBPF_SUCCESS);
+    REQUIRE(ebpf_object_load(instance_object.get()) == EBPF_OPERATION_NOT_SUPPORTED);
+
+    // The original module is unaffected.
+    REQUIRE(bpf_object__find_program_by_name(loaded_object.get(), "test_program_entry") != nullptr);
+}
+
+TEST_CASE("test_ebpf_object_native_instances", "[end_to_end]")
+{
+    _test_helper_end_to_end test_helper;
+    test_helper.initialize();
+
+    program_info_provider_t bind_program_info;
+    REQUIRE(bind_program_info.initialize(EBPF_PROGRAM_TYPE_BIND) == EBPF_SUCCESS);
+
+    // bind_count_instanced_um.dll is generated with bpf2c --instanced.
+    bpf_object_ptr first_object(bpf_object__open("bind_count_instanced_um.dll"));
+    REQUIRE(first_object != nullptr);
+    REQUIRE(bpf_object__load(first_object.get()) == 0);
+
+    bpf_object_ptr second_object(bpf_object__open("bind_count_instanced_um.dll"));
+    REQUIRE(second_object != nullptr);
+    REQUIRE(ebpf_object_set_native_instance_of(second_object.get(), first_object.get()) == EBPF_SUCCESS);
+    REQUIRE(bpf_object__load(second_object.get()) == 0);
+
+    // Each instance has its own map and program.
+    fd_t first_map_fd = bpf_object__find_map_fd_by_name(first_object.get(), "bind_count_map");
+    REQUIRE(first_map_fd > 0);
+    fd_t second_map_fd = bpf_object__find_map_fd_by_name(second_object.get(), "bind_count_map");
+    REQUIRE(second_map_fd > 0);
+    bpf_map_info first_map_info = {};
+    bpf_map_info second_map_info = {};
+    uint32_t map_info_size = sizeof(bpf_map_info);
+    REQUIRE(bpf_obj_get_info_by_fd(first_map_fd, &first_map_info, &map_info_size) == 0);
+    map_info_size = sizeof(bpf_map_info);
+    REQUIRE(bpf_obj_get_info_by_fd(second_map_fd, &second_map_info, &map_info_size) == 0);
+    REQUIRE(first_map_info.id != second_map_info.id);
+
+    fd_t first_program_fd = bpf_program__fd(bpf_object__find_program_by_name(first_object.get(), "count_bind"));
+    REQUIRE(first_program_fd > 0);
+    fd_t second_program_fd = bpf_program__fd(bpf_object__find_program_by_name(second_object.get(), "count_bind"));
+    REQUIRE(second_program_fd > 0);
+    bpf_prog_info first_program_info = {};
+    bpf_prog_info second_program_info = {};
+    uint32_t program_info_size = sizeof(bpf_prog_info);
+    REQUIRE(bpf_obj_get_info_by_fd(first_program_fd, &first_program_info, &program_info_size) == 0);
+    program_info_size = sizeof(bpf_prog_info);
+    REQUIRE(bpf_obj_get_info_by_fd(second_program_fd, &second_program_info, &program_info_size) == 0);
+    REQUIRE(first_program_info.id != second_program_info.id);
+
+    auto get_bind_count = [](fd_t map_fd) {
+        uint32_t key = 0;
+        uint64_t count = 0;
+        REQUIRE(bpf_map_lookup_elem(map_fd, &key, &count) == 0);
+        return count;
+    };
+
+    single_instance_hook_t hook(EBPF_PROGRAM_TYPE_BIND, EBPF_ATTACH_TYPE_BIND);
+    REQUIRE(hook.initialize() == EBPF_SUCCESS);
+    std::function<ebpf_result_t(void*, uint32_t*)> invoke =
+        [&hook](_Inout_ void* context, _Out_ uint32_t* result) -> ebpf_result_t { return hook.fire(context, result); };
+    uint32_t ifindex = 0;
+    bpf_link_ptr link;
+
+    // Each program runs with the runtime context of its own instance, so it only updates the map of that instance.
+    REQUIRE(hook.attach_link(first_program_fd, &ifindex, sizeof(ifindex), &link) == EBPF_SUCCESS);
+    REQUIRE(emulate_bind(invoke, 12345, "fake_app") == BIND_PERMIT);
+    hook.detach_and_close_link(&link);
+    REQUIRE(get_bind_count(first_map_fd) == 1);
+    REQUIRE(get_bind_count(second_map_fd) == 0);
+
+    REQUIRE(hook.attach_link(second_program_fd, &ifindex, sizeof(ifindex), &link) == EBPF_SUCCESS);
+    REQUIRE(emulate_bind(invoke, 12345, "fake_app") == BIND_PERMIT);
+    REQUIRE(emulate_bind(invoke, 12345, "fake_app") == BIND_PERMIT);
+    hook.detach_and_close_link(&link);
+    REQUIRE(get_bind_count(first_map_fd) == 1);
+    REQUIRE(get_bind_count(second_map_fd) == 2);
+
+    // Unloading the first instance leaves the second one working.
+    first_object.reset();
+    REQUIRE(hook.attach_link(second_program_fd, &ifindex, sizeof(ifindex), &link) == EBPF_SUCCESS);
+    REQUIRE(emulate_bind(invoke, 12345, "fake_app") == BIND_PERMIT);
+    hook.detach_and_close_link(&link);
+    REQUIRE(get_bind_count(second_map_fd) == 3);
+}
+
+#if !defined(CONFIG_BPF_JIT_DISABLED)
+TEST_CASE("test_ebpf_object_parallel_load", "[end_to_end]")
+{
+    _test_helper_end_to_end test_helper;
+    test_helper.initialize();
+
+    program_info_provider_t bind_program_info;
+    REQUIRE(bind_program_info.initialize(EBPF_PROGRAM_TYPE_BIND) == EBPF_SUCCESS);
+
+    bpf_object_ptr unique_object(bpf_object__open("bindmonitor_tailcall.o"));
+    REQUIRE(unique_object != nullptr);
+    REQUIRE(ebpf_object_set_execution_type(unique_object.get(), EBPF_EXECUTION_JIT) == EBPF_SUCCESS);
+
+    // No time is reported for programs that have not been verified yet.
+    struct bpf_program* program;
+    bpf_object__for_each_program(program, unique_object.get())
+    {
+        REQUIRE(ebpf_program_get_verification_time(program) == 0);
+    }
+
+    // Verify all the sections concurrently, using one thread per logical processor.
+    REQUIRE(ebpf_object_set_load_thread_count(unique_object.get(), 0) == EBPF_SUCCESS);
+    REQUIRE(bpf_object__load(unique_object.get()) == 0);
+
+    // The thread count cannot be changed once the object is loaded.
+    REQUIRE(ebpf_object_set_load_thread_count(unique_object.get(), 1) == EBPF_INVALID_ARGUMENT);
+
+    // Programs are created in section order and each one has been verified.
+    uint32_t previous_id = 0;
+    bpf_object__for_each_program(program, unique_object.get())
+    {
+        fd_t program_fd = bpf_program__fd(program);
+        REQUIRE(program_fd > 0);
+        REQUIRE(ebpf_program_get_verification_time(program) > 0);
+
+        bpf_prog_info info = {};
+        uint32_t info_size = sizeof(info);
+        REQUIRE(bpf_obj_get_info_by_fd(program_fd, &info, &info_size) == 0);
+        REQUIRE(info.id > previous_id);
+        previous_id = info.id;
+    }
+}
+
+TEST_CASE("test_ebpf_object_load_multiple", "[end_to_end]")
+{
+    _test_helper_end_to_end test_helper;
+    test_helper.initialize();
+
+    program_info_provider_t sample_program_info;
+    REQUIRE(sample_program_info.initialize(EBPF_PROGRAM_TYPE_SAMPLE) == EBPF_SUCCESS);
+
+    // Both objects pin outer_map and port_map by name.
+    bpf_object_ptr first_object(bpf_object__open("map_reuse.o"));
+    REQUIRE(first_object != nullptr);
+    bpf_object_ptr second_object(bpf_object__open("map_reuse.o"));
+    REQUIRE(second_object != nullptr);
+    REQUIRE(ebpf_object_set_execution_type(first_object.get(), EBPF_EXECUTION_JIT) == EBPF_SUCCESS);
+    REQUIRE(ebpf_object_set_execution_type(second_object.get(), EBPF_EXECUTION_JIT) == EBPF_SUCCESS);
+
+    struct bpf_object* objects[] = {first_object.get(), second_object.get()};
+    ebpf_result_t results[_countof(objects)];
+    REQUIRE(ebpf_object_load_multiple(objects, _countof(objects), 0, results) == EBPF_SUCCESS);
+    REQUIRE(results[0] == EBPF_SUCCESS);
+    REQUIRE(results[1] == EBPF_SUCCESS);
+
+    // The second object reused the maps pinned by the first one.
+    for (const char* map_name : {"outer_map", "port_map"}) {
+        struct bpf_map* first_map = bpf_object__find_map_by_name(first_object.get(), map_name);
+        struct bpf_map* second_map = bpf_object__find_map_by_name(second_object.get(), map_name);
+        REQUIRE(first_map != nullptr);
+        REQUIRE(second_map != nullptr);
+
+        bpf_map_info first_info = {};
+        bpf_map_info second_info = {};
+        uint32_t info_size = sizeof(first_info);
+        REQUIRE(bpf_obj_get_info_by_fd(bpf_map__fd(first_map), &first_info, &info_size) == 0);
+        info_size = sizeof(second_info);
+        REQUIRE(bpf_obj_get_info_by_fd(bpf_map__fd(second_map), &second_info, &info_size) == 0);
+        REQUIRE(first_info.id == second_info.id);
+    }
+
+    // Every program of both objects has been verified and loaded.
+    for (struct bpf_object* object : objects) {
+        struct bpf_program* program;
+        bpf_object__for_each_program(program, object)
+        {
+            REQUIRE(bpf_program__fd(program) > 0);
+            REQUIRE(ebpf_program_get_verification_time(program) > 0);
+        }
+    }
+
+    // Objects that are already loaded are rejected individually.
+    bpf_object_ptr third_object(bpf_object__open("map_reuse.o"));
+    REQUIRE(third_object != nullptr);
+    REQUIRE(ebpf_object_set_execution_type(third_object.get(), EBPF_EXECUTION_JIT) == EBPF_SUCCESS);
+    objects[1] = third_object.get();
+    REQUIRE(ebpf_object_load_multiple(objects, _countof(objects), 1, results) == EBPF_INVALID_ARGUMENT);
+    REQUIRE(results[0] == EBPF_INVALID_ARGUMENT);
+    REQUIRE(results[1] == EBPF_SUCCESS);
+
+    REQUIRE(ebpf_object_unpin("/ebpf/global/outer_map") == EBPF_SUCCESS);
+    REQUIRE(ebpf_object_unpin("/ebpf/global/port_map") == EBPF_SUCCESS);
+}
+
+TEST_CASE("test_ebpf_object_load_multiple_verification_failure", "[end_to_end]")
+{
+    _test_helper_end_to_end test_helper;
+    test_helper.initialize();
+
+    program_info_provider_t bind_program_info;
+    REQUIRE(bind_program_info.initialize(EBPF_PROGRAM_TYPE_BIND) == EBPF_SUCCESS);
+
+    // The program of printk_unsafe.o fails verification.
+    bpf_object_ptr unsafe_object(bpf_object__open("printk_unsafe.o"));
+    REQUIRE(unsafe_object != nullptr);
+    bpf_object_ptr first_object(bpf_object__open("bindmonitor.o"));
+    REQUIRE(first_object != nullptr);
+    bpf_object_ptr second_object(bpf_object__open("bindmonitor.o"));
+    REQUIRE(second_object != nullptr);
+
+    struct bpf_object* objects[] = {first_object.get(), unsafe_object.get(), second_object.get()};
+    for (struct bpf_object* object : objects) {
+        REQUIRE(ebpf_object_set_execution_type(object, EBPF_EXECUTION_JIT) == EBPF_SUCCESS);
+    }
+    ebpf_result_t results[_countof(objects)];
+    ebpf_result_t result = ebpf_object_load_multiple(objects, _countof(objects), 0, results);
+    REQUIRE(result != EBPF_SUCCESS);
+    REQUIRE(results[0] == EBPF_SUCCESS);
+    REQUIRE(results[1] == result);
+    REQUIRE(results[2] == EBPF_SUCCESS);
+
+    // The object that failed verification is unloaded.
+    struct bpf_program* program;
+    bpf_object__for_each_program(program, unsafe_object.get())
+    {
+        REQUIRE(bpf_program__fd(program) == ebpf_fd_invalid);
+    }
+
+    // The other objects stay loaded, along with their maps.
+    for (struct bpf_object* object : {first_object.get(), second_object.get()}) {
+        bpf_object__for_each_program(program, object)
+        {
+            REQUIRE(bpf_program__fd(program) > 0);
+        }
+        struct bpf_map* map;
+        bpf_object__for_each_map(map, object)
+        {
+            REQUIRE(bpf_map__fd(map) > 0);
+        }
+    }
+}
+
+TEST_CASE("test_ebpf_object_lazy_map_creation", "[end_to_end]")
+{
+    _test_helper_end_to_end test_helper;
+    test_helper.initialize();
+
+    program_info_provider_t bind_program_info;
+    REQUIRE(bind_program_info.initialize(EBPF_PROGRAM_TYPE_BIND) == EBPF_SUCCESS);
+
+    // The maps of a native module are always created when the module is loaded.
+    bpf_object_ptr native_object(bpf_object__open("test_sample_ebpf_um.dll"));
+    REQUIRE(native_object != nullptr);
+    REQUIRE(ebpf_object_set_lazy_map_creation(native_object.get(), true) == EBPF_OPERATION_NOT_SUPPORTED);
+
+    int initial_map_count = _get_total_map_count();
+
+    bpf_object_ptr unique_object(bpf_object__open("lazy_map.o"));
+    REQUIRE(unique_object != nullptr);
+    REQUIRE(ebpf_object_set_execution_type(unique_object.get(), EBPF_EXECUTION_JIT) == EBPF_SUCCESS);
+    REQUIRE(ebpf_object_set_lazy_map_creation(unique_object.get(), true) == EBPF_SUCCESS);
+    REQUIRE(bpf_object__load(unique_object.get()) == 0);
+
+    // The option cannot be changed once the object is loaded.
+    REQUIRE(ebpf_object_set_lazy_map_creation(unique_object.get(), false) == EBPF_INVALID_ARGUMENT);
+
+    // Referenced maps are created on load, and so is the inner map template of a map that is created.
+    struct bpf_map* bind_count_map = bpf_object__find_map_by_name(unique_object.get(), "bind_count_map");
+    struct bpf_map* outer_map = bpf_object__find_map_by_name(unique_object.get(), "outer_map");
+    struct bpf_map* inner_map = bpf_object__find_map_by_name(unique_object.get(), "inner_map");
+    struct bpf_map* unused_map = bpf_object__find_map_by_name(unique_object.get(), "unused_map");
+    struct bpf_map* unused_map2 = bpf_object__find_map_by_name(unique_object.get(), "unused_map2");
+    REQUIRE(bind_count_map != nullptr);
+    REQUIRE(outer_map != nullptr);
+    REQUIRE(inner_map != nullptr);
+    REQUIRE(unused_map != nullptr);
+    REQUIRE(unused_map2 != nullptr);
+    REQUIRE(!bind_count_map->deferred);
+    REQUIRE(!outer_map->deferred);
+    REQUIRE(!inner_map->deferred);
+
+    // The unreferenced maps don't exist yet.
+    REQUIRE(unused_map->deferred);
+    REQUIRE(unused_map2->deferred);
+    REQUIRE(_get_total_map_count() == initial_map_count + 3);
+
+    // A deferred map was never pinned, so unpinning it succeeds without creating it.
+    REQUIRE(bpf_map__unpin(unused_map2, "/ebpf/global/unused_map2") == 0);
+    REQUIRE(unused_map2->deferred);
+    REQUIRE(_get_total_map_count() == initial_map_count + 3);
+
+    // Asking for the fd of a deferred map creates it.
+    REQUIRE(bpf_map__fd(unused_map) > 0);
+    REQUIRE(!unused_map->deferred);
+    REQUIRE(_get_total_map_count() == initial_map_count + 4);
+
+    // So does pinning it.
+    REQUIRE(bpf_map__pin(unused_map2, "/ebpf/global/unused_map2") == 0);
+    REQUIRE(!unused_map2->deferred);
+    REQUIRE(bpf_map__fd(unused_map2) > 0);
+    REQUIRE(_get_total_map_count() == initial_map_count + 5);
+    REQUIRE(bpf_map__unpin(unused_map2, "/ebpf/global/unused_map2") == 0);
+
+    // Every map of the object can now be used.
+    struct bpf_map* map;
+    bpf_object__for_each_map(map, unique_object.get())
+    {
+        REQUIRE(bpf_map__fd(map) > 0);
+    }
+}
+#endif
+
 static void
 extension_reload_test(ebpf_execution_type_t execution_type)
 {
@@ -1,9 +1,13 @@
 // Copyright (c) Microsoft Corporation
 // SPDX-License-Identifier: MIT
 
+#include "net_ebpf_ext_hook_provider.h"
 #include "net_ebpf_ext_sock_addr.h"
+#include "net_ebpf_ext_xdp.h"
 #include "netebpf_ext_helper.h"
 
+#include <algorithm>
+
 DEVICE_OBJECT* _net_ebpf_ext_driver_device_object;
 
 constexpr uint32_t _test_destination_ipv4_address = 0x01020304;
@@ -95,6 +99,8 @@ _netebpf_ext_helper::_netebpf_ext_helper(
 
 _netebpf_ext_helper::~_netebpf_ext_helper()
 {
+    additional_hook_clients.clear();
+
     if (nmr_hook_client_handle) {
         nmr_hook_client_handle.reset(nullptr);
     }
@@ -124,6 +130,135 @@ _netebpf_ext_helper::~_netebpf_ext_helper()
     }
 }
 
+void
+_netebpf_ext_helper::add_hook_client(
+    _In_opt_ const void* npi_specific_characteristics, _In_ netebpfext_helper_base_client_context_t* client_context)
+{
+    auto additional_hook_client = std::make_unique<additional_hook_client_t>();
+
+    // Each NMR client needs its own module id.
+    additional_hook_client->module_id = module_id;
+    additional_hook_client->module_id.Guid.Data1 += (unsigned long)(additional_hook_clients.size() + 1);
+
+    additional_hook_client->characteristics = hook_client;
+    additional_hook_client->characteristics.ClientRegistrationInstance.ModuleId = &additional_hook_client->module_id;
+    additional_hook_client->characteristics.ClientRegistrationInstance.NpiSpecificCharacteristics =
+        npi_specific_characteristics;
+
+    client_context->helper = this;
+    additional_hook_client->registration =
+        std::make_unique<nmr_client_registration_t>(&additional_hook_client->characteristics, client_context);
+    additional_hook_clients.emplace_back(std::move(additional_hook_client));
+}
+
+static void
+_free_test_nbl(_In_ NET_BUFFER_LIST* nbl, _In_opt_ MDL* mdl_chain)
+{
+    while (mdl_chain != nullptr) {
+        MDL* next_mdl = mdl_chain->Next;
+        IoFreeMdl(mdl_chain);
+        mdl_chain = next_mdl;
+    }
+    if (nbl != nullptr) {
+        NET_BUFFER_LIST_NEXT_NBL(nbl) = nullptr;
+        FwpsFreeNetBufferList0(nbl);
+    }
+}
+
+FWP_ACTION_TYPE
+_netebpf_ext_helper::classify_test_nbl_chain(
+    _In_ const netebpfext_helper_base_client_context_t* client_context,
+    NET_IFINDEX if_index,
+    _In_ const std::vector<std::vector<std::vector<uint8_t>>>& packets,
+    _Out_opt_ bool* absorbed,
+    _Out_opt_ std::vector<size_t>* chained_packets)
+{
+    std::vector<std::vector<uint8_t>> segment_buffers;
+    std::vector<NET_BUFFER_LIST*> nbls;
+    FWPS_INCOMING_VALUE incoming_value[FWPS_FIELD_INBOUND_MAC_FRAME_NATIVE_MAX] = {};
+    FWPS_INCOMING_VALUES incoming_fixed_values = {};
+    FWPS_INCOMING_METADATA_VALUES incoming_metadata_values = {};
+    FWPS_FILTER filter = {};
+    FWPS_CLASSIFY_OUT classify_output = {};
+
+    if (absorbed != nullptr) {
+        *absorbed = false;
+    }
+    if (chained_packets != nullptr) {
+        chained_packets->clear();
+    }
+
+    // Build one NBL per packet, with one MDL per segment. Allocations can fail when fault injection is enabled.
+    classify_output.actionType = FWP_ACTION_NONE;
+    for (const auto& packet : packets) {
+        MDL* mdl_chain = nullptr;
+        MDL** next_mdl = &mdl_chain;
+        uint32_t packet_length = 0;
+        NET_BUFFER_LIST* nbl = nullptr;
+        for (const auto& segment : packet) {
+            auto& buffer = segment_buffers.emplace_back(segment);
+            MDL* mdl = IoAllocateMdl(buffer.data(), (unsigned long)buffer.size(), FALSE, FALSE, nullptr);
+            if (mdl == nullptr) {
+                _free_test_nbl(nullptr, mdl_chain);
+                goto Exit;
+            }
+            MmBuildMdlForNonPagedPool(mdl);
+            *next_mdl = mdl;
+            next_mdl = &mdl->Next;
+            packet_length += (uint32_t)buffer.size();
+        }
+
+        if (!NT_SUCCESS(FwpsAllocateNetBufferAndNetBufferList(
+                _net_ebpf_ext_nbl_pool_handle, 0, 0, mdl_chain, 0, packet_length, &nbl))) {
+            _free_test_nbl(nullptr, mdl_chain);
+            goto Exit;
+        }
+        if (!nbls.empty()) {
+            NET_BUFFER_LIST_NEXT_NBL(nbls.back()) = nbl;
+        }
+        nbls.push_back(nbl);
+    }
+
+    incoming_value[FWPS_FIELD_INBOUND_MAC_FRAME_NATIVE_INTERFACE_INDEX].value.type = FWP_UINT32;
+    incoming_value[FWPS_FIELD_INBOUND_MAC_FRAME_NATIVE_INTERFACE_INDEX].value.uint32 = if_index;
+    incoming_fixed_values.layerId = FWPS_LAYER_INBOUND_MAC_FRAME_NATIVE;
+    incoming_fixed_values.valueCount = FWPS_FIELD_INBOUND_MAC_FRAME_NATIVE_MAX;
+    incoming_fixed_values.incomingValue = incoming_value;
+
+    // The XDP hook keeps the WFP filter context of an attached client as the client's provider data.
+    filter.context = (uint64_t)net_ebpf_extension_hook_client_get_provider_data(
+        net_ebpf_extension_hook_program_get_client(client_context->provider_binding_context));
+    classify_output.rights = FWPS_RIGHT_ACTION_WRITE;
+
+    net_ebpf_ext_layer_2_classify(
+        &incoming_fixed_values,
+        &incoming_metadata_values,
+        nbls.empty() ? nullptr : nbls.front(),
+        nullptr,
+        &filter,
+        0,
+        &classify_output);
+
+    if (absorbed != nullptr) {
+        *absorbed = (classify_output.flags & FWPS_CLASSIFY_OUT_FLAG_ABSORB) != 0;
+    }
+
+    // The classify callback may unlink packets from the chain it permits.
+    if (chained_packets != nullptr && !nbls.empty()) {
+        for (NET_BUFFER_LIST* nbl = nbls.front(); nbl != nullptr; nbl = NET_BUFFER_LIST_NEXT_NBL(nbl)) {
+            chained_packets->push_back(std::find(nbls.begin(), nbls.end(), nbl) - nbls.begin());
+        }
+    }
+
+Exit:
+    // Like NDIS, the caller owns the original NBLs, whether or not they were absorbed.
+    for (auto nbl : nbls) {
+        _free_test_nbl(nbl, NET_BUFFER_FIRST_MDL(NET_BUFFER_LIST_FIRST_NB(nbl)));
+    }
+
+    return classify_output.actionType;
+}
+
 std::vector<GUID>
 _netebpf_ext_helper::program_info_provider_guids()
 {
@@ -197,8 +332,15 @@ _netebpf_ext_helper::_hook_client_attach_provider(
     if (base_client_context == nullptr) {
         return STATUS_INVALID_PARAMETER;
     }
-    const ebpf_extension_dispatch_table_t client_dispatch_table = {
-        .version = 1, .count = 1, .function = base_client_context->helper->hook_invoke_function};
+    // The provider only uses the batch invoke functions if the dispatch table is large enough to include them.
+    const ebpf_extension_program_dispatch_table_t client_dispatch_table = {
+        .version = 1,
+        .count = (uint16_t)(base_client_context->batch_invoke ? 4 : 1),
+        .ebpf_program_invoke_function =
+            (ebpf_program_invoke_function_t)base_client_context->helper->hook_invoke_function,
+        .ebpf_program_batch_begin_invoke_function = _hook_client_batch_begin,
+        .ebpf_program_batch_invoke_function = _hook_client_batch_invoke,
+        .ebpf_program_batch_end_invoke_function = _hook_client_batch_end};
     auto provider_characteristics =
         (const ebpf_extension_data_t*)provider_registration_instance->NpiSpecificCharacteristics;
     auto provider_data = (const ebpf_attach_provider_data_t*)provider_characteristics->data;
@@ -229,3 +371,36 @@ _netebpf_ext_helper::_hook_client_cleanup_binding_context(_In_ void* client_bind
 {
     UNREFERENCED_PARAMETER(client_binding_context);
 }
+
+ebpf_result_t
+_netebpf_ext_helper::_hook_client_batch_begin(
+    _In_ const void* client_binding_context, size_t state_size, _Out_writes_(state_size) void* state)
+{
+    auto base_client_context = (netebpfext_helper_base_client_context_t*)client_binding_context;
+    memset(state, 0, state_size);
+    InterlockedIncrement(&base_client_context->batch_begin_count);
+    return EBPF_SUCCESS;
+}
+
+ebpf_result_t
+_netebpf_ext_helper::_hook_client_batch_invoke(
+    _In_ const void* client_binding_context,
+    _Inout_ void* program_context,
+    _Out_ uint32_t* result,
+    _In_ const void* state)
+{
+    UNREFERENCED_PARAMETER(state);
+    auto base_client_context = (netebpfext_helper_base_client_context_t*)client_binding_context;
+    InterlockedIncrement(&base_client_context->batch_invoke_count);
+    return ((ebpf_program_invoke_function_t)base_client_context->helper->hook_invoke_function)(
+        client_binding_context, program_context, result);
+}
+
+ebpf_result_t
+_netebpf_ext_helper::_hook_client_batch_end(_In_ const void* client_binding_context, _Inout_ void* state)
+{
+    UNREFERENCED_PARAMETER(state);
+    auto base_client_context = (netebpfext_helper_base_client_context_t*)client_binding_context;
+    InterlockedIncrement(&base_client_context->batch_end_count);
+    return EBPF_SUCCESS;
+}
@@ -26,6 +26,10 @@ typedef struct _netebpfext_helper_base_client_context
     class _netebpf_ext_helper* helper;
     void* provider_binding_context;
     bpf_attach_type_t desired_attach_type; // BPF_ATTACH_TYPE_UNSPEC for any allowed.
+    bool batch_invoke;                     // Also offer batch invoke functions that wrap the dispatch function.
+    long batch_begin_count;                // Number of batches begun through the batch invoke functions.
+    long batch_end_count;                  // Number of batches ended through the batch invoke functions.
+    long batch_invoke_count;               // Number of program contexts invoked through the batch invoke functions.
 } netebpfext_helper_base_client_context_t;
 
 typedef class _netebpf_ext_helper
@@ -41,6 +45,12 @@ typedef class _netebpf_ext_helper
         bool initialize_platform = true);
     ~_netebpf_ext_helper();
 
+    // Register an additional hook NPI client, so that more than one program is attached to a hook.
+    // The client uses the dispatch function passed to the constructor.
+    void
+    add_hook_client(
+        _In_opt_ const void* npi_specific_characteristics, _In_ netebpfext_helper_base_client_context_t* client_context);
+
     std::vector<GUID>
     program_info_provider_guids();
 
@@ -53,6 +63,18 @@ typedef class _netebpf_ext_helper
         return usersim_fwp_classify_packet(layer_guid, if_index);
     }
 
+    // Classify a chain of inbound layer 2 packets for the XDP client attached through client_context. Each packet is
+    // given as a list of segments, and each segment is placed in its own MDL, so a packet with more than one segment
+    // is not contiguous. Optionally returns whether the chain was absorbed, and the indices of the packets left in
+    // the chain after classification. Returns FWP_ACTION_NONE if the chain could not be built.
+    FWP_ACTION_TYPE
+    classify_test_nbl_chain(
+        _In_ const netebpfext_helper_base_client_context_t* client_context,
+        NET_IFINDEX if_index,
+        _In_ const std::vector<std::vector<std::vector<uint8_t>>>& packets,
+        _Out_opt_ bool* absorbed = nullptr,
+        _Out_opt_ std::vector<size_t>* chained_packets = nullptr);
+
     FWP_ACTION_TYPE
     test_bind_ipv4(_In_ fwp_classify_parameters_t* parameters) { return usersim_fwp_bind_ipv4(parameters); }
 
@@ -189,6 +211,20 @@ typedef class _netebpf_ext_helper
     static void
     _hook_client_cleanup_binding_context(_In_ void* client_binding_context);
 
+    static ebpf_result_t
+    _hook_client_batch_begin(
+        _In_ const void* client_binding_context, size_t state_size, _Out_writes_(state_size) void* state);
+
+    static ebpf_result_t
+    _hook_client_batch_invoke(
+        _In_ const void* client_binding_context,
+        _Inout_ void* program_context,
+        _Out_ uint32_t* result,
+        _In_ const void* state);
+
+    static ebpf_result_t
+    _hook_client_batch_end(_In_ const void* client_binding_context, _Inout_ void* state);
+
     NPI_CLIENT_CHARACTERISTICS hook_client{
         1,
         sizeof(NPI_PROVIDER_CHARACTERISTICS),
@@ -207,8 +243,16 @@ typedef class _netebpf_ext_helper
 
     _ebpf_extension_dispatch_function hook_invoke_function = nullptr;
 
+    typedef struct _additional_hook_client
+    {
+        NPI_MODULEID module_id;
+        NPI_CLIENT_CHARACTERISTICS characteristics;
+        std::unique_ptr<nmr_client_registration_t> registration;
+    } additional_hook_client_t;
+
     std::unique_ptr<nmr_client_registration_t> nmr_program_info_client_handle;
     std::unique_ptr<nmr_client_registration_t> nmr_hook_client_handle;
+    std::vector<std::unique_ptr<additional_hook_client_t>> additional_hook_clients;
 
 } netebpf_ext_helper_t;
 
@@ -6,9 +6,14 @@
 #include "catch_wrapper.hpp"
 #include "cxplat_fault_injection.h"
 #include "cxplat_passed_test_log.h"
+#include "net_ebpf_ext_sock_addr.h"
 #include "netebpf_ext_helper.h"
 #include "watchdog.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <map>
 #include <stop_token>
 #include <thread>
@@ -207,6 +212,412 @@ TEST_CASE("xdp_context", "[netebpfext]")
     REQUIRE(output_context.ingress_ifindex == 67889);
 }
 
+typedef struct _test_xdp_packet_client_context
+{
+    netebpfext_helper_base_client_context_t base;
+    std::function<uint32_t(_Inout_ xdp_md_t*)> program; ///< Test program run on each packet.
+} test_xdp_packet_client_context_t;
+
+_Must_inspect_result_ ebpf_result_t
+netebpfext_unit_invoke_xdp_packet_program(
+    _In_ const void* client_binding_context, _Inout_ void* context, _Out_ uint32_t* result)
+{
+    auto client_context = (test_xdp_packet_client_context_t*)client_binding_context;
+    *result = client_context->program((xdp_md_t*)context);
+    return EBPF_SUCCESS;
+}
+
+static std::vector<uint8_t>
+_get_test_xdp_packet(size_t length)
+{
+    std::vector<uint8_t> packet(length);
+    for (size_t index = 0; index < length; index++) {
+        packet[index] = (uint8_t)index;
+    }
+    return packet;
+}
+
+// Split a packet into two segments, so that it is not contiguous.
+static std::vector<std::vector<uint8_t>>
+_split_test_xdp_packet(const std::vector<uint8_t>& packet, size_t first_segment_length)
+{
+    return {
+        std::vector<uint8_t>(packet.begin(), packet.begin() + first_segment_length),
+        std::vector<uint8_t>(packet.begin() + first_segment_length, packet.end())};
+}
+
+static std::vector<uint8_t>
+_get_xdp_packet_data(_In_ const xdp_md_t* ctx)
+{
+    return std::vector<uint8_t>((const uint8_t*)ctx->data, (const uint8_t*)ctx->data_end);
+}
+
+TEST_CASE("xdp_linearize_packet", "[netebpfext]")
+{
+    NET_IFINDEX if_index = 0;
+    ebpf_extension_data_t npi_specific_characteristics = {.size = sizeof(if_index), .data = &if_index};
+    test_xdp_packet_client_context_t client_context = {};
+    client_context.base.desired_attach_type = BPF_XDP_TEST;
+    bool fault_injection_enabled = cxplat_fault_injection_is_enabled();
+    std::vector<uint8_t> packet = _get_test_xdp_packet(100);
+    std::vector<std::vector<std::vector<uint8_t>>> chain = {_split_test_xdp_packet(packet, 40)};
+
+    netebpf_ext_helper_t helper(
+        &npi_specific_characteristics,
+        (_ebpf_extension_dispatch_function)netebpfext_unit_invoke_xdp_packet_program,
+        (netebpfext_helper_base_client_context_t*)&client_context);
+
+    // A non-contiguous packet is handed to the program as a single buffer. As long as the program doesn't modify it,
+    // the original packet passes as is, without being cloned and re-injected. Classify more packets than there are
+    // linearization buffers per CPU, to check that the buffers are released.
+    for (uint32_t iteration = 0; iteration < 16; iteration++) {
+        std::vector<uint8_t> program_packet;
+        bool absorbed;
+        client_context.program = [&](xdp_md_t* ctx) {
+            program_packet = _get_xdp_packet_data(ctx);
+            return (uint32_t)XDP_PASS;
+        };
+        FWP_ACTION_TYPE result = helper.classify_test_nbl_chain(&client_context.base, if_index, chain, &absorbed);
+        if (result == FWP_ACTION_NONE && fault_injection_enabled) {
+            continue;
+        }
+        REQUIRE(result == FWP_ACTION_PERMIT);
+        REQUIRE(!absorbed);
+        REQUIRE(program_packet == packet);
+    }
+}
+
+TEST_CASE("xdp_linearize_modify_packet", "[netebpfext]")
+{
+    NET_IFINDEX if_index = 0;
+    ebpf_extension_data_t npi_specific_characteristics = {.size = sizeof(if_index), .data = &if_index};
+    test_xdp_packet_client_context_t client_context = {};
+    client_context.base.desired_attach_type = BPF_XDP_TEST;
+    bool fault_injection_enabled = cxplat_fault_injection_is_enabled();
+    std::vector<uint8_t> packet = _get_test_xdp_packet(100);
+    std::vector<std::vector<std::vector<uint8_t>>> chain = {_split_test_xdp_packet(packet, 40)};
+    bool absorbed;
+
+    netebpf_ext_helper_t helper(
+        &npi_specific_characteristics,
+        (_ebpf_extension_dispatch_function)netebpfext_unit_invoke_xdp_packet_program,
+        (netebpfext_helper_base_client_context_t*)&client_context);
+
+    for (uint32_t iteration = 0; iteration < 16; iteration++) {
+        // A modified packet that passes is cloned, and the clone is injected in place of the original. If the clone
+        // fails the packet is dropped, since the original doesn't carry the change. Either way the original is
+        // absorbed.
+        client_context.program = [&](xdp_md_t* ctx) {
+            ((uint8_t*)ctx->data)[0] ^= 0xff;
+            return (uint32_t)XDP_PASS;
+        };
+        FWP_ACTION_TYPE result = helper.classify_test_nbl_chain(&client_context.base, if_index, chain, &absorbed);
+        REQUIRE(((result == FWP_ACTION_BLOCK && absorbed) || fault_injection_enabled));
+
+        // A modified packet that is dropped is not cloned.
+        client_context.program = [&](xdp_md_t* ctx) {
+            ((uint8_t*)ctx->data)[0] ^= 0xff;
+            return (uint32_t)XDP_DROP;
+        };
+        result = helper.classify_test_nbl_chain(&client_context.base, if_index, chain, &absorbed);
+        REQUIRE(((result == FWP_ACTION_BLOCK && absorbed) || fault_injection_enabled));
+
+        // The linearization buffers were released, so an unmodified packet still passes without a clone.
+        client_context.program = [&](xdp_md_t* ctx) {
+            REQUIRE(_get_xdp_packet_data(ctx) == packet);
+            return (uint32_t)XDP_PASS;
+        };
+        result = helper.classify_test_nbl_chain(&client_context.base, if_index, chain, &absorbed);
+        REQUIRE(((result == FWP_ACTION_PERMIT && !absorbed) || fault_injection_enabled));
+    }
+}
+
+TEST_CASE("xdp_linearize_adjust_head", "[netebpfext]")
+{
+    NET_IFINDEX if_index = 0;
+    ebpf_extension_data_t npi_specific_characteristics = {.size = sizeof(if_index), .data = &if_index};
+    test_xdp_packet_client_context_t client_context = {};
+    client_context.base.desired_attach_type = BPF_XDP_TEST;
+    bool fault_injection_enabled = cxplat_fault_injection_is_enabled();
+    std::vector<uint8_t> packet = _get_test_xdp_packet(100);
+    std::vector<std::vector<std::vector<uint8_t>>> chain = {_split_test_xdp_packet(packet, 40)};
+    const int delta = 10;
+
+    netebpf_ext_helper_t helper(
+        &npi_specific_characteristics,
+        (_ebpf_extension_dispatch_function)netebpfext_unit_invoke_xdp_packet_program,
+        (netebpfext_helper_base_client_context_t*)&client_context);
+
+    auto xdp_extension_data = helper.get_program_info_provider_data(EBPF_PROGRAM_TYPE_XDP_TEST);
+    auto xdp_program_data = (ebpf_program_data_t*)xdp_extension_data.data;
+    bpf_xdp_adjust_head_t adjust_head = reinterpret_cast<bpf_xdp_adjust_head_t>(
+        xdp_program_data->program_type_specific_helper_function_addresses->helper_function_address[0]);
+
+    // Adjusting the head of a linearized packet clones it first. If the clone fails (which only happens with fault
+    // injection), the helper fails and the program keeps reading the linearized packet, which must stay intact until
+    // the program completes.
+    for (uint32_t iteration = 0; iteration < 16; iteration++) {
+        int adjust_head_result = -1;
+        client_context.program = [&](xdp_md_t* ctx) {
+            adjust_head_result = adjust_head(ctx, delta);
+            if (adjust_head_result == 0) {
+                REQUIRE(_get_xdp_packet_data(ctx) == std::vector<uint8_t>(packet.begin() + delta, packet.end()));
+            } else {
+                REQUIRE(fault_injection_enabled);
+                REQUIRE(_get_xdp_packet_data(ctx) == packet);
+            }
+            return (uint32_t)XDP_PASS;
+        };
+        bool absorbed;
+        FWP_ACTION_TYPE result = helper.classify_test_nbl_chain(&client_context.base, if_index, chain, &absorbed);
+        if (result == FWP_ACTION_NONE && fault_injection_enabled) {
+            continue;
+        }
+
+        if (adjust_head_result == 0) {
+            // The adjusted clone is injected in place of the original.
+            REQUIRE(result == FWP_ACTION_BLOCK);
+            REQUIRE(absorbed);
+        } else {
+            // The unmodified original passes as is.
+            REQUIRE(result == FWP_ACTION_PERMIT);
+            REQUIRE(!absorbed);
+        }
+    }
+}
+
+// Build a chain of contiguous packets. The first byte of each packet is its index in the chain.
+static std::vector<std::vector<std::vector<uint8_t>>>
+_get_test_xdp_chain(uint32_t packet_count)
+{
+    std::vector<std::vector<std::vector<uint8_t>>> chain;
+    for (uint32_t index = 0; index < packet_count; index++) {
+        std::vector<uint8_t> packet = _get_test_xdp_packet(64);
+        packet[0] = (uint8_t)index;
+        chain.push_back({packet});
+    }
+    return chain;
+}
+
+TEST_CASE("xdp_chain_pass", "[netebpfext]")
+{
+    NET_IFINDEX if_index = 0;
+    ebpf_extension_data_t npi_specific_characteristics = {.size = sizeof(if_index), .data = &if_index};
+    test_xdp_packet_client_context_t client_context = {};
+    client_context.base.desired_attach_type = BPF_XDP_TEST;
+    client_context.base.batch_invoke = true;
+    bool fault_injection_enabled = cxplat_fault_injection_is_enabled();
+    // Enough packets for the chain to be processed in three bursts, the last one partial.
+    const uint32_t packet_count = 40;
+    auto chain = _get_test_xdp_chain(packet_count);
+    std::vector<uint8_t> seen_packets;
+    bool absorbed;
+
+    netebpf_ext_helper_t helper(
+        &npi_specific_characteristics,
+        (_ebpf_extension_dispatch_function)netebpfext_unit_invoke_xdp_packet_program,
+        (netebpfext_helper_base_client_context_t*)&client_context);
+
+    client_context.program = [&](xdp_md_t* ctx) {
+        seen_packets.push_back(((uint8_t*)ctx->data)[0]);
+        return (uint32_t)XDP_PASS;
+    };
+
+    // A chain in which every packet passes unmodified is permitted as is. Each burst is handed to the program in
+    // one batch.
+    FWP_ACTION_TYPE result = helper.classify_test_nbl_chain(&client_context.base, if_index, chain, &absorbed);
+    if (result == FWP_ACTION_NONE && fault_injection_enabled) {
+        return;
+    }
+    REQUIRE(result == FWP_ACTION_PERMIT);
+    REQUIRE(!absorbed);
+    REQUIRE(seen_packets.size() == packet_count);
+    for (uint32_t index = 0; index < packet_count; index++) {
+        REQUIRE(seen_packets[index] == index);
+    }
+    REQUIRE(client_context.base.batch_begin_count == 3);
+    REQUIRE(client_context.base.batch_end_count == 3);
+    REQUIRE(client_context.base.batch_invoke_count == packet_count);
+}
+
+TEST_CASE("xdp_chain_mixed_verdicts", "[netebpfext]")
+{
+    NET_IFINDEX if_index = 0;
+    ebpf_extension_data_t npi_specific_characteristics = {.size = sizeof(if_index), .data = &if_index};
+    test_xdp_packet_client_context_t client_context = {};
+    client_context.base.desired_attach_type = BPF_XDP_TEST;
+    client_context.base.batch_invoke = true;
+    bool fault_injection_enabled = cxplat_fault_injection_is_enabled();
+    const uint32_t packet_count = 40;
+    const uint8_t split_packet = 5;
+    const uint8_t drop_packet = 20;
+    const uint8_t tx_packet = 33;
+    auto chain = _get_test_xdp_chain(packet_count);
+    std::vector<uint8_t> seen_packets;
+    std::vector<size_t> chained_packets;
+    bool absorbed;
+
+    // A non-contiguous packet is linearized, passes unmodified, and stays in the chain.
+    chain[split_packet] = _split_test_xdp_packet(chain[split_packet][0], 20);
+
+    netebpf_ext_helper_t helper(
+        &npi_specific_characteristics,
+        (_ebpf_extension_dispatch_function)netebpfext_unit_invoke_xdp_packet_program,
+        (netebpfext_helper_base_client_context_t*)&client_context);
+
+    client_context.program = [&](xdp_md_t* ctx) {
+        uint8_t index = ((uint8_t*)ctx->data)[0];
+        seen_packets.push_back(index);
+        if (index == drop_packet) {
+            return (uint32_t)XDP_DROP;
+        }
+        if (index == tx_packet) {
+            return (uint32_t)XDP_TX;
+        }
+        return (uint32_t)XDP_PASS;
+    };
+
+    // Packets that are not passed as is are unlinked from the chain, and the rest of the chain is permitted in place.
+    // The program still sees every packet once, in order.
+    FWP_ACTION_TYPE result =
+        helper.classify_test_nbl_chain(&client_context.base, if_index, chain, &absorbed, &chained_packets);
+    if (result == FWP_ACTION_NONE && fault_injection_enabled) {
+        return;
+    }
+    REQUIRE(result == FWP_ACTION_PERMIT);
+    REQUIRE(!absorbed);
+    REQUIRE(((seen_packets.size() == packet_count) || fault_injection_enabled));
+    for (uint32_t index = 0; index < seen_packets.size() && !fault_injection_enabled; index++) {
+        REQUIRE(seen_packets[index] == index);
+    }
+    if (!fault_injection_enabled) {
+        REQUIRE(chained_packets.size() == packet_count - 2);
+        for (size_t index = 0; index < chained_packets.size(); index++) {
+            size_t packet = chained_packets[index];
+            REQUIRE(packet != drop_packet);
+            REQUIRE(packet != tx_packet);
+            REQUIRE((index == 0 || packet > chained_packets[index - 1]));
+        }
+    }
+    REQUIRE(client_context.base.batch_begin_count == 3);
+    REQUIRE(client_context.base.batch_end_count == 3);
+
+    // The first packet can't be unlinked, so a chain whose first packet is dropped is absorbed, and the packets that
+    // pass are injected back into the receive path.
+    seen_packets.clear();
+    client_context.program = [&](xdp_md_t* ctx) {
+        uint8_t index = ((uint8_t*)ctx->data)[0];
+        seen_packets.push_back(index);
+        return (uint32_t)((index == 0) ? XDP_DROP : XDP_PASS);
+    };
+    result = helper.classify_test_nbl_chain(&client_context.base, if_index, chain, &absorbed);
+    REQUIRE(((result == FWP_ACTION_BLOCK && absorbed) || fault_injection_enabled));
+    REQUIRE(((seen_packets.size() == packet_count) || fault_injection_enabled));
+}
+
+TEST_CASE("xdp_chain_multiple_programs", "[netebpfext]")
+{
+    NET_IFINDEX if_index = 0;
+    ebpf_extension_data_t npi_specific_characteristics = {.size = sizeof(if_index), .data = &if_index};
+    test_xdp_packet_client_context_t first_client_context = {};
+    test_xdp_packet_client_context_t second_client_context = {};
+    first_client_context.base.desired_attach_type = BPF_XDP_TEST;
+    first_client_context.base.batch_invoke = true;
+    // The second program only offers the single invoke function, so it is invoked once per packet.
+    second_client_context.base.desired_attach_type = BPF_XDP_TEST;
+    bool fault_injection_enabled = cxplat_fault_injection_is_enabled();
+    const uint32_t packet_count = 20;
+    const uint8_t drop_packet = 10;
+    auto chain = _get_test_xdp_chain(packet_count);
+    std::vector<uint8_t> first_seen_packets;
+    std::vector<uint8_t> second_seen_packets;
+    std::vector<size_t> chained_packets;
+    bool absorbed;
+
+    netebpf_ext_helper_t helper(
+        &npi_specific_characteristics,
+        (_ebpf_extension_dispatch_function)netebpfext_unit_invoke_xdp_packet_program,
+        (netebpfext_helper_base_client_context_t*)&first_client_context);
+
+    // Attach a second program with the same (wildcard) attach parameter. It is chained after the first one.
+    helper.add_hook_client(
+        &npi_specific_characteristics, (netebpfext_helper_base_client_context_t*)&second_client_context);
+
+    first_client_context.program = [&](xdp_md_t* ctx) {
+        uint8_t index = ((uint8_t*)ctx->data)[0];
+        first_seen_packets.push_back(index);
+        return (uint32_t)((index == drop_packet) ? XDP_DROP : XDP_PASS);
+    };
+    second_client_context.program = [&](xdp_md_t* ctx) {
+        second_seen_packets.push_back(((uint8_t*)ctx->data)[0]);
+        return (uint32_t)XDP_PASS;
+    };
+
+    // The second program sees every packet the first one passed, and none that it dropped.
+    FWP_ACTION_TYPE result = helper.classify_test_nbl_chain(
+        &first_client_context.base, if_index, chain, &absorbed, &chained_packets);
+    if (result == FWP_ACTION_NONE && fault_injection_enabled) {
+        return;
+    }
+    REQUIRE(result == FWP_ACTION_PERMIT);
+    REQUIRE(!absorbed);
+    REQUIRE(chained_packets.size() == packet_count - 1);
+    REQUIRE(std::find(chained_packets.begin(), chained_packets.end(), drop_packet) == chained_packets.end());
+    REQUIRE(first_seen_packets.size() == packet_count);
+    REQUIRE(second_seen_packets.size() == packet_count - 1);
+    REQUIRE(
+        std::find(second_seen_packets.begin(), second_seen_packets.end(), drop_packet) == second_seen_packets.end());
+    REQUIRE(first_client_context.base.batch_begin_count == 2);
+    REQUIRE(first_client_context.base.batch_end_count == 2);
+    REQUIRE(first_client_context.base.batch_invoke_count == packet_count);
+    REQUIRE(second_client_context.base.batch_begin_count == 0);
+    REQUIRE(second_client_context.base.batch_invoke_count == 0);
+}
+
+TEST_CASE("xdp_chain_multiple_programs_shared_batch", "[netebpfext]")
+{
+    NET_IFINDEX if_index = 0;
+    ebpf_extension_data_t npi_specific_characteristics = {.size = sizeof(if_index), .data = &if_index};
+    test_xdp_packet_client_context_t first_client_context = {};
+    test_xdp_packet_client_context_t second_client_context = {};
+    first_client_context.base.desired_attach_type = BPF_XDP_TEST;
+    first_client_context.base.batch_invoke = true;
+    second_client_context.base.desired_attach_type = BPF_XDP_TEST;
+    second_client_context.base.batch_invoke = true;
+    bool fault_injection_enabled = cxplat_fault_injection_is_enabled();
+    // A single burst.
+    const uint32_t packet_count = 16;
+    auto chain = _get_test_xdp_chain(packet_count);
+    bool absorbed;
+
+    netebpf_ext_helper_t helper(
+        &npi_specific_characteristics,
+        (_ebpf_extension_dispatch_function)netebpfext_unit_invoke_xdp_packet_program,
+        (netebpfext_helper_base_client_context_t*)&first_client_context);
+    helper.add_hook_client(
+        &npi_specific_characteristics, (netebpfext_helper_base_client_context_t*)&second_client_context);
+
+    first_client_context.program = [&](xdp_md_t* ctx) {
+        UNREFERENCED_PARAMETER(ctx);
+        return (uint32_t)XDP_PASS;
+    };
+    second_client_context.program = first_client_context.program;
+
+    // Both programs share the same batch functions, so the burst enters the execution context once, through the first
+    // program, and both programs are invoked within it.
+    FWP_ACTION_TYPE result = helper.classify_test_nbl_chain(&first_client_context.base, if_index, chain, &absorbed);
+    if (result == FWP_ACTION_NONE && fault_injection_enabled) {
+        return;
+    }
+    REQUIRE(result == FWP_ACTION_PERMIT);
+    REQUIRE(first_client_context.base.batch_begin_count == 1);
+    REQUIRE(first_client_context.base.batch_end_count == 1);
+    REQUIRE(first_client_context.base.batch_invoke_count == packet_count);
+    REQUIRE(second_client_context.base.batch_begin_count == 0);
+    REQUIRE(second_client_context.base.batch_end_count == 0);
+    REQUIRE(second_client_context.base.batch_invoke_count == packet_count);
+}
+
 #pragma endregion xdp
 #pragma region bind
 
@@ -338,6 +749,7 @@ typedef struct test_sock_addr_client_context_t
     netebpfext_helper_base_client_context_t base;
     int sock_addr_action;
     bool validate_sock_addr_entries = true;
+    volatile long invocation_count;
 } test_sock_addr_client_context_t;
 
 static inline sock_addr_test_action_t
@@ -367,6 +779,8 @@ netebpfext_unit_invoke_sock_addr_program(
     int action = SOCK_ADDR_TEST_ACTION_BLOCK;
     int32_t is_admin = 0;
 
+    InterlockedIncrement(&client_context->invocation_count);
+
     ebpf_extension_data_t sock_addr_extension_data =
         client_context->base.helper->get_program_info_provider_data(EBPF_PROGRAM_TYPE_CGROUP_SOCK_ADDR);
     auto sock_addr_program_data = (ebpf_program_data_t*)sock_addr_extension_data.data;
@@ -559,6 +973,65 @@ sock_addr_thread_function(
     }
 }
 
+TEST_CASE("sock_addr_invoke_multiple_programs", "[netebpfext]")
+{
+    ebpf_extension_data_t npi_specific_characteristics = {};
+    test_sock_addr_client_context_t first_client_context = {};
+    test_sock_addr_client_context_t second_client_context = {};
+    fwp_classify_parameters_t parameters = {};
+
+    netebpf_ext_helper_t helper(
+        &npi_specific_characteristics,
+        (_ebpf_extension_dispatch_function)netebpfext_unit_invoke_sock_addr_program,
+        (netebpfext_helper_base_client_context_t*)&first_client_context);
+
+    // Attach a second program with the same (wildcard) attach parameter. It is chained after the first one.
+    helper.add_hook_client(
+        &npi_specific_characteristics, (netebpfext_helper_base_client_context_t*)&second_client_context);
+
+    netebpfext_initialize_fwp_classify_parameters(&parameters);
+
+    // Both programs are invoked when the first one lets the operation proceed.
+    first_client_context.sock_addr_action = SOCK_ADDR_TEST_ACTION_PERMIT;
+    second_client_context.sock_addr_action = SOCK_ADDR_TEST_ACTION_PERMIT;
+
+    FWP_ACTION_TYPE result = helper.test_cgroup_inet4_recv_accept(&parameters);
+    REQUIRE(result == FWP_ACTION_PERMIT);
+    REQUIRE(first_client_context.invocation_count == 1);
+    REQUIRE(second_client_context.invocation_count == 1);
+
+    result = helper.test_cgroup_inet4_connect(&parameters);
+    REQUIRE(result == FWP_ACTION_PERMIT);
+
+    // The verdict of the last program invoked wins.
+    second_client_context.sock_addr_action = SOCK_ADDR_TEST_ACTION_BLOCK;
+    long first_invocation_count = first_client_context.invocation_count;
+    long second_invocation_count = second_client_context.invocation_count;
+
+    result = helper.test_cgroup_inet6_recv_accept(&parameters);
+    REQUIRE(result == FWP_ACTION_BLOCK);
+    REQUIRE(first_client_context.invocation_count == first_invocation_count + 1);
+    REQUIRE(second_client_context.invocation_count == second_invocation_count + 1);
+
+    result = helper.test_cgroup_inet6_connect(&parameters);
+    REQUIRE(result == FWP_ACTION_BLOCK);
+
+    // Programs after one that rejects the operation are not invoked.
+    first_client_context.sock_addr_action = SOCK_ADDR_TEST_ACTION_BLOCK;
+    second_client_context.sock_addr_action = SOCK_ADDR_TEST_ACTION_PERMIT;
+    first_invocation_count = first_client_context.invocation_count;
+    second_invocation_count = second_client_context.invocation_count;
+
+    result = helper.test_cgroup_inet4_recv_accept(&parameters);
+    REQUIRE(result == FWP_ACTION_BLOCK);
+    REQUIRE(first_client_context.invocation_count == first_invocation_count + 1);
+    REQUIRE(second_client_context.invocation_count == second_invocation_count);
+
+    result = helper.test_cgroup_inet4_connect(&parameters);
+    REQUIRE(result == FWP_ACTION_BLOCK);
+    REQUIRE(second_client_context.invocation_count == second_invocation_count);
+}
+
 // Invoke SOCK_ADDR_CONNECT concurrently with same classify parameters.
 
 TEST_CASE("sock_addr_invoke_concurrent1", "[netebpfext_concurrent]")
@@ -692,6 +1165,73 @@ TEST_CASE("sock_addr_invoke_concurrent3", "[netebpfext_concurrent]")
     }
 }
 
+// Storm of connects across the whole port range, so that blocked connection contexts for many distinct tuples are
+// inserted and removed concurrently in every shard of the connection context table. The table must stay bounded while
+// the storm runs, and must be empty once its entries have expired.
+TEST_CASE("sock_addr_connect_storm", "[netebpfext_concurrent]")
+{
+    ebpf_extension_data_t npi_specific_characteristics = {};
+    test_sock_addr_client_context_t client_context = {};
+    std::vector<std::jthread> threads;
+    std::vector<fwp_classify_parameters_t> parameters;
+    const uint32_t connects_per_thread = 100000;
+
+    netebpf_ext_helper_t helper(
+        &npi_specific_characteristics,
+        (_ebpf_extension_dispatch_function)netebpfext_unit_invoke_sock_addr_program,
+        (netebpfext_helper_base_client_context_t*)&client_context);
+
+    client_context.sock_addr_action = SOCK_ADDR_TEST_ACTION_ROUND_ROBIN;
+    client_context.validate_sock_addr_entries = false;
+
+    bool fault_injection_enabled = cxplat_fault_injection_is_enabled();
+    uint32_t thread_count = 2 * ebpf_get_cpu_count();
+    uint16_t ports_per_thread = (uint16_t)(UINT16_MAX / thread_count);
+    parameters.resize(thread_count);
+
+    for (uint32_t i = 0; i < thread_count; i++) {
+        netebpfext_initialize_fwp_classify_parameters(&parameters[i]);
+        threads.emplace_back([&, i]() {
+            uint16_t start_port = (uint16_t)(i * ports_per_thread);
+            for (uint32_t connect = 0; connect < connects_per_thread; connect++) {
+                uint16_t port_number = start_port + (uint16_t)(connect % ports_per_thread);
+                parameters[i].destination_port = htons(port_number);
+                FWP_ACTION_TYPE result = (connect % 2) ? helper.test_cgroup_inet6_connect(&parameters[i])
+                                                       : helper.test_cgroup_inet4_connect(&parameters[i]);
+                REQUIRE((result == _get_fwp_sock_addr_action(port_number) || fault_injection_enabled));
+            }
+        });
+    }
+
+    // Each connect removes the context its CONNECT_REDIRECT classify inserted before it returns, so each thread
+    // has at most one context in the table at any time.
+    std::atomic<bool> storm_done = false;
+    uint32_t max_connection_context_count = 0;
+    std::jthread monitor([&]() {
+        while (!storm_done) {
+            max_connection_context_count =
+                std::max(max_connection_context_count, net_ebpf_ext_sock_addr_get_connection_context_count());
+            std::this_thread::yield();
+        }
+    });
+
+    // Wait for all threads to finish.
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    storm_done = true;
+    monitor.join();
+
+    // With fault injection, a connect can fail after its context was inserted and leave it behind until it expires.
+    if (!fault_injection_enabled) {
+        REQUIRE(max_connection_context_count <= thread_count);
+    }
+
+    // Every context left in the table is freed by the timer wheel once it expires.
+    net_ebpf_ext_sock_addr_expire_connection_contexts();
+    REQUIRE(net_ebpf_ext_sock_addr_get_connection_context_count() == 0);
+}
+
 TEST_CASE("sock_addr_context", "[netebpfext]")
 {
     netebpf_ext_helper_t helper;
@@ -19,7 +19,7 @@ typedef class _ebpf_program_test_state
 {
   public:
     _ebpf_program_test_state(std::vector<ebpf_instruction_t> byte_code)
-        : byte_code(byte_code), program_info_provider(nullptr)
+        : byte_code(byte_code), program_info_provider(nullptr), hook(nullptr), link(nullptr)
     {
         ebpf_program_parameters_t parameters = {EBPF_PROGRAM_TYPE_SAMPLE};
         REQUIRE(ebpf_core_initiate() == EBPF_SUCCESS);
@@ -33,6 +33,11 @@ typedef class _ebpf_program_test_state
     }
     ~_ebpf_program_test_state()
     {
+        if (link != nullptr) {
+            ebpf_link_detach_program(link);
+            EBPF_OBJECT_RELEASE_REFERENCE(reinterpret_cast<ebpf_core_object_t*>(link));
+        }
+        delete hook;
         EBPF_OBJECT_RELEASE_REFERENCE(reinterpret_cast<ebpf_core_object_t*>(program));
         delete program_info_provider;
         ebpf_core_terminate();
@@ -86,10 +91,36 @@ typedef class _ebpf_program_test_state
         ebpf_epoch_exit(&epoch_state);
     }
 
+    void
+    prepare_link()
+    {
+        hook = new single_instance_hook_t(EBPF_PROGRAM_TYPE_SAMPLE, EBPF_ATTACH_TYPE_SAMPLE);
+        REQUIRE(hook->initialize() == EBPF_SUCCESS);
+        REQUIRE(ebpf_link_create(EBPF_ATTACH_TYPE_SAMPLE, nullptr, 0, &link) == EBPF_SUCCESS);
+        REQUIRE(ebpf_link_attach_program(link, program) == EBPF_SUCCESS);
+    }
+
+    void
+    test_link(void* context, bool reference_providers)
+    {
+        uint32_t result;
+        // The link used to take a rundown reference on the program information provider for every batch; add it
+        // back around the invoke to measure what checking provider liveness within the epoch saves.
+        if (reference_providers && ebpf_program_reference_providers(program) != EBPF_SUCCESS) {
+            return;
+        }
+        (void)hook->fire(context, &result);
+        if (reference_providers) {
+            ebpf_program_dereference_providers(program);
+        }
+    }
+
   private:
     ebpf_program_t* program;
     std::vector<ebpf_instruction_t> byte_code;
     _program_info_provider* program_info_provider;
+    single_instance_hook_t* hook;
+    ebpf_link_t* link;
 } ebpf_program_test_state_t;
 
 typedef class _ebpf_map_test_state
@@ -133,6 +164,19 @@ typedef class _ebpf_map_test_state
         ebpf_epoch_exit(&epoch_state);
     }
 
+    void
+    test_find_read_helper(uint32_t cpu_id)
+    {
+        uint32_t key = cpu_id;
+
+        ebpf_epoch_state_t epoch_state;
+        ebpf_epoch_enter(&epoch_state);
+        volatile uint64_t* value = (uint64_t*)ebpf_map_helper_find_entry(map, (uint8_t*)&key, false);
+        uint64_t local = *value;
+        UNREFERENCED_PARAMETER(local);
+        ebpf_epoch_exit(&epoch_state);
+    }
+
     void
     test_find_write(uint32_t cpu_id)
     {
@@ -289,12 +333,32 @@ _ebpf_program_invoke()
 }
 #endif
 
+#if !defined(CONFIG_BPF_JIT_DISABLED)
+static void
+_ebpf_link_invoke()
+{
+    _ebpf_program_test_state_instance->test_link(nullptr, false);
+}
+
+static void
+_ebpf_link_invoke_provider_reference()
+{
+    _ebpf_program_test_state_instance->test_link(nullptr, true);
+}
+#endif
+
 static void
 _map_find_read_test(uint32_t cpu_id)
 {
     _ebpf_map_test_state_instance->test_find_read(cpu_id);
 }
 
+static void
+_map_find_read_helper_test(uint32_t cpu_id)
+{
+    _ebpf_map_test_state_instance->test_find_read_helper(cpu_id);
+}
+
 static void
 _map_find_write_test(uint32_t cpu_id)
 {
@@ -369,6 +433,22 @@ test_bpf_map_lookup_elem_read(bool preemptible)
     measure.run_test();
 }
 
+// Same as test_bpf_map_lookup_elem_read, but through the entry point specialized for the map type.
+template <ebpf_map_type_t map_type>
+void
+test_bpf_map_lookup_elem_read_helper(bool preemptible)
+{
+    size_t iterations = PERFORMANCE_MEASURE_ITERATION_COUNT;
+    ebpf_map_test_state_t map_test_state(map_type);
+    _ebpf_map_test_state_instance = &map_test_state;
+    std::string name = __FUNCTION__;
+    name += "<";
+    name += _ebpf_map_type_t_to_string(map_type);
+    name += ">";
+    _performance_measure measure(name.c_str(), preemptible, _map_find_read_helper_test, iterations);
+    measure.run_test();
+}
+
 template <ebpf_map_type_t map_type>
 void
 test_bpf_map_lookup_elem_write(bool preemptible)
@@ -460,6 +540,46 @@ test_program_invoke_interpret(bool preemptible)
 }
 #endif
 
+#if !defined(CONFIG_BPF_JIT_DISABLED)
+/**
+ * @brief Invoke a program through its link, the way a hook provider does. The preemptible run takes the general
+ * batch path and the non-preemptible run takes the DISPATCH_LEVEL path.
+ *
+ * @param[in] name Name of the test.
+ * @param[in] preemptible Whether to run the test preemptible.
+ * @param[in] reference_providers Also take the per-batch provider rundown reference the link used to take.
+ */
+static void
+_test_program_invoke_link(const char* name, bool preemptible, bool reference_providers)
+{
+    size_t iterations = PERFORMANCE_MEASURE_ITERATION_COUNT * 10;
+    std::vector<ebpf_instruction_t> byte_code = {{EBPF_OP_MOV_IMM, 0, 0, 0, 42}, {EBPF_OP_EXIT}};
+    _ebpf_program_test_state program_state(byte_code);
+    _ebpf_program_test_state_instance = &program_state;
+    program_state.prepare_jit_program();
+    program_state.prepare_link();
+
+    _performance_measure measure(
+        name,
+        preemptible,
+        reference_providers ? _ebpf_link_invoke_provider_reference : _ebpf_link_invoke,
+        iterations);
+    measure.run_test();
+}
+
+void
+test_program_invoke_link(bool preemptible)
+{
+    _test_program_invoke_link(__FUNCTION__, preemptible, false);
+}
+
+void
+test_program_invoke_link_provider_reference(bool preemptible)
+{
+    _test_program_invoke_link(__FUNCTION__, preemptible, true);
+}
+#endif
+
 template <size_t route_count>
 void
 test_lpm_trie_ipv4(bool preemptible)
@@ -479,6 +599,8 @@ test_lpm_trie_ipv4(bool preemptible)
 
 #if !defined(CONFIG_BPF_JIT_DISABLED)
 PERF_TEST(test_program_invoke_jit);
+PERF_TEST(test_program_invoke_link);
+PERF_TEST(test_program_invoke_link_provider_reference);
 #endif
 #if !defined(CONFIG_BPF_INTERPRETER_DISABLED)
 PERF_TEST(test_program_invoke_interpret);
@@ -489,6 +611,12 @@ PERF_TEST(test_bpf_map_lookup_elem_read<BPF_MAP_TYPE_PERCPU_HASH>);
 PERF_TEST(test_bpf_map_lookup_elem_read<BPF_MAP_TYPE_PERCPU_ARRAY>);
 PERF_TEST(test_bpf_map_lookup_elem_read<BPF_MAP_TYPE_LRU_HASH>);
 
+PERF_TEST(test_bpf_map_lookup_elem_read_helper<BPF_MAP_TYPE_HASH>);
+PERF_TEST(test_bpf_map_lookup_elem_read_helper<BPF_MAP_TYPE_ARRAY>);
+PERF_TEST(test_bpf_map_lookup_elem_read_helper<BPF_MAP_TYPE_PERCPU_HASH>);
+PERF_TEST(test_bpf_map_lookup_elem_read_helper<BPF_MAP_TYPE_PERCPU_ARRAY>);
+PERF_TEST(test_bpf_map_lookup_elem_read_helper<BPF_MAP_TYPE_LRU_HASH>);
+
 PERF_TEST(test_bpf_map_lookup_elem_write<BPF_MAP_TYPE_HASH>);
 PERF_TEST(test_bpf_map_lookup_elem_write<BPF_MAP_TYPE_ARRAY>);
 PERF_TEST(test_bpf_map_lookup_elem_write<BPF_MAP_TYPE_PERCPU_HASH>);
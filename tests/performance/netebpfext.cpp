@@ -0,0 +1,161 @@
+// Copyright (c) Microsoft Corporation
+// SPDX-License-Identifier: MIT
+
+#define TEST_AREA "netebpfext"
+
+#include "netebpf_ext_helper.h"
+#include "performance_measure.h"
+
+/**
+ * @brief Hook client whose program returns the same result for every program context.
+ */
+typedef struct _perf_client_context
+{
+    netebpfext_helper_base_client_context_t base;
+    uint32_t result;
+} perf_client_context_t;
+
+static _Must_inspect_result_ ebpf_result_t
+_perf_invoke_program(_In_ const void* client_binding_context, _In_ const void* context, _Out_ uint32_t* result)
+{
+    UNREFERENCED_PARAMETER(context);
+    *result = ((const perf_client_context_t*)client_binding_context)->result;
+    return EBPF_SUCCESS;
+}
+
+static netebpf_ext_helper_t* _perf_helper = nullptr;
+static perf_client_context_t* _perf_client_context = nullptr;
+
+#define PERF_XDP_CHAIN_LENGTH 64
+static std::vector<std::vector<std::vector<uint8_t>>> _perf_xdp_chain;
+static std::vector<fwp_classify_parameters_t> _perf_classify_parameters;
+
+static void
+_perf_xdp_classify_packet()
+{
+    (void)_perf_helper->classify_test_packet(&FWPM_LAYER_INBOUND_MAC_FRAME_NATIVE, 0);
+}
+
+static void
+_perf_xdp_classify_packet_chain()
+{
+    (void)_perf_helper->classify_test_nbl_chain(&_perf_client_context->base, 0, _perf_xdp_chain);
+}
+
+static void
+_perf_sock_ops_connection(uint32_t cpu_id)
+{
+    (void)_perf_helper->test_sock_ops_v4(&_perf_classify_parameters[cpu_id]);
+}
+
+// State shared by every CPU, as all classify callbacks for one attach parameter share one hook client.
+static EX_RUNDOWN_REF _perf_program_array_rundown;
+static volatile long _perf_program_array_active_generation;
+
+static void
+_perf_program_array_rundown_acquire()
+{
+    if (ExAcquireRundownProtection(&_perf_program_array_rundown)) {
+        ExReleaseRundownProtection(&_perf_program_array_rundown);
+    }
+}
+
+static void
+_perf_program_array_published_read()
+{
+    (void)ReadAcquire(&_perf_program_array_active_generation);
+}
+
+// Classify packets for the same XDP client on every CPU. Every classify reads the hook client from the same WFP filter
+// context, so this also measures how that lookup scales across CPUs.
+void
+test_xdp_classify_packet(bool preemptible)
+{
+    NET_IFINDEX if_index = 0;
+    ebpf_extension_data_t npi_specific_characteristics = {.size = sizeof(if_index), .data = &if_index};
+    perf_client_context_t client_context = {};
+    client_context.base.desired_attach_type = BPF_XDP_TEST;
+    client_context.result = XDP_PASS;
+
+    netebpf_ext_helper_t helper(
+        &npi_specific_characteristics, (_ebpf_extension_dispatch_function)_perf_invoke_program, &client_context.base);
+    REQUIRE(helper.classify_test_packet(&FWPM_LAYER_INBOUND_MAC_FRAME_NATIVE, if_index) == FWP_ACTION_PERMIT);
+    _perf_helper = &helper;
+
+    _performance_measure measure(__FUNCTION__, preemptible, _perf_xdp_classify_packet);
+    measure.run_test();
+}
+
+// Classify chains of packets, which are handed to the program in bursts. This includes building and freeing the test
+// NBLs, and is reported per packet.
+void
+test_xdp_classify_packet_chain(bool preemptible)
+{
+    NET_IFINDEX if_index = 0;
+    ebpf_extension_data_t npi_specific_characteristics = {.size = sizeof(if_index), .data = &if_index};
+    perf_client_context_t client_context = {};
+    client_context.base.desired_attach_type = BPF_XDP_TEST;
+    client_context.base.batch_invoke = true;
+    client_context.result = XDP_PASS;
+    size_t iterations = PERFORMANCE_MEASURE_ITERATION_COUNT / 100;
+
+    _perf_xdp_chain.assign(PERF_XDP_CHAIN_LENGTH, {std::vector<uint8_t>(64)});
+
+    netebpf_ext_helper_t helper(
+        &npi_specific_characteristics, (_ebpf_extension_dispatch_function)_perf_invoke_program, &client_context.base);
+    REQUIRE(helper.classify_test_nbl_chain(&client_context.base, if_index, _perf_xdp_chain) == FWP_ACTION_PERMIT);
+    _perf_helper = &helper;
+    _perf_client_context = &client_context;
+
+    _performance_measure measure(__FUNCTION__, preemptible, _perf_xdp_classify_packet_chain, iterations);
+    measure.run_test(PERF_XDP_CHAIN_LENGTH);
+}
+
+// Each iteration establishes and then deletes a flow, so this measures the flow context setup and teardown cost. Each
+// CPU uses its own source port, so that the flows of different CPUs don't collide.
+void
+test_sock_ops_connection(bool preemptible)
+{
+    ebpf_extension_data_t npi_specific_characteristics = {};
+    perf_client_context_t client_context = {};
+    client_context.result = 0;
+
+    _perf_classify_parameters.resize(ebpf_get_cpu_count());
+    for (uint32_t i = 0; i < _perf_classify_parameters.size(); i++) {
+        netebpfext_initialize_fwp_classify_parameters(&_perf_classify_parameters[i]);
+        _perf_classify_parameters[i].source_port = (uint16_t)(_perf_classify_parameters[i].source_port + i);
+    }
+
+    netebpf_ext_helper_t helper(
+        &npi_specific_characteristics, (_ebpf_extension_dispatch_function)_perf_invoke_program, &client_context.base);
+    REQUIRE(helper.test_sock_ops_v4(&_perf_classify_parameters[0]) == FWP_ACTION_PERMIT);
+    _perf_helper = &helper;
+
+    _performance_measure measure(__FUNCTION__, preemptible, _perf_sock_ops_connection);
+    measure.run_test();
+}
+
+// Side by side cost of getting hold of a hook client's program array on every classify: acquiring and releasing the
+// rundown protection of the active generation, as classify callbacks below DISPATCH_LEVEL do, versus reading the
+// active generation, as classify callbacks at DISPATCH_LEVEL do now that generations are retired after a grace period.
+void
+test_hook_program_array_rundown(bool preemptible)
+{
+    ExInitializeRundownProtection(&_perf_program_array_rundown);
+
+    _performance_measure measure(__FUNCTION__, preemptible, _perf_program_array_rundown_acquire);
+    measure.run_test();
+}
+
+void
+test_hook_program_array_published(bool preemptible)
+{
+    _performance_measure measure(__FUNCTION__, preemptible, _perf_program_array_published_read);
+    measure.run_test();
+}
+
+PERF_TEST(test_hook_program_array_rundown);
+PERF_TEST(test_hook_program_array_published);
+PERF_TEST(test_xdp_classify_packet);
+PERF_TEST(test_xdp_classify_packet_chain);
+PERF_TEST(test_sock_ops_connection);
@@ -11,6 +11,10 @@
 #define PERFORMANCE_MEASURE_ITERATION_COUNT 1000000
 #define PERFORMANCE_MEASURE_TIMEOUT 60000
 
+#define PERF_TEST(FUNCTION)                                                               \
+    TEST_CASE(#FUNCTION "_preemption", "[performance_" TEST_AREA "]") { FUNCTION(true); } \
+    TEST_CASE(#FUNCTION "_no_preemption", "[performance_" TEST_AREA "]") { FUNCTION(false); }
+
 /**
  * @brief Test helper function that executes a provided method on each CPU
  * iterations times, measures elapsed time and returns average elapsed time
@@ -13,6 +13,14 @@ _perf_epoch_enter_exit()
     ebpf_epoch_exit(&epoch_state);
 }
 
+static void
+_perf_epoch_enter_exit_dispatch()
+{
+    ebpf_epoch_state_t epoch_state;
+    ebpf_epoch_enter_dispatch(&epoch_state);
+    ebpf_epoch_exit_dispatch(&epoch_state);
+}
+
 static void
 _perf_epoch_enter_alloc_free_exit()
 {
@@ -69,6 +77,24 @@ _perf_bpf_get_smp_processor_id()
     ebpf_epoch_exit(&epoch_state);
 }
 
+// Sized to cover a full 1500 byte Ethernet MTU frame.
+static uint8_t _perf_bpf_csum_diff_from[1500];
+static uint8_t _perf_bpf_csum_diff_to[1500];
+
+static void
+_perf_bpf_csum_diff()
+{
+    ebpf_epoch_state_t epoch_state;
+    ebpf_epoch_enter(&epoch_state);
+    ebpf_core_csum_diff(
+        _perf_bpf_csum_diff_from,
+        sizeof(_perf_bpf_csum_diff_from),
+        _perf_bpf_csum_diff_to,
+        sizeof(_perf_bpf_csum_diff_to),
+        0);
+    ebpf_epoch_exit(&epoch_state);
+}
+
 /**
  * @brief Helper function to set up the hash-table for testing.
  * All tests perform the operation under test multiplier() times.
@@ -76,7 +102,7 @@ _perf_bpf_get_smp_processor_id()
 typedef class _ebpf_hash_table_test_state
 {
   public:
-    _ebpf_hash_table_test_state()
+    _ebpf_hash_table_test_state(size_t key_size = sizeof(uint32_t)) : key_size(key_size)
     {
         cpu_count = ebpf_get_cpu_count();
         REQUIRE(ebpf_platform_initiate() == EBPF_SUCCESS);
@@ -87,23 +113,24 @@ typedef class _ebpf_hash_table_test_state
 
         ebpf_epoch_state_t epoch_state;
         ebpf_epoch_enter(&epoch_state);
-        keys.resize(static_cast<size_t>(cpu_count) * 4ull);
+        key_count = static_cast<size_t>(cpu_count) * 4ull;
+        keys.resize(key_count * key_size);
+        next_key.resize(key_size);
         const ebpf_hash_table_creation_options_t options = {
-            .key_size = sizeof(uint32_t),
+            .key_size = key_size,
             .value_size = sizeof(uint64_t),
-            .minimum_bucket_count = keys.size(),
+            .minimum_bucket_count = key_count,
         };
         REQUIRE(ebpf_hash_table_create(&table, &options) == EBPF_SUCCESS);
-        for (auto& key : keys) {
+        for (auto& byte : keys) {
+            byte = static_cast<uint8_t>(ebpf_random_uint32());
+        }
+        for (size_t index = 0; index < key_count; index++) {
             uint64_t value = 12345678;
-            key = ebpf_random_uint32();
-
             REQUIRE(
                 ebpf_hash_table_update(
-                    table,
-                    reinterpret_cast<uint8_t*>(&key),
-                    reinterpret_cast<uint8_t*>(&value),
-                    EBPF_HASH_TABLE_OPERATION_ANY) == EBPF_SUCCESS);
+                    table, key(index), reinterpret_cast<uint8_t*>(&value), EBPF_HASH_TABLE_OPERATION_ANY) ==
+                EBPF_SUCCESS);
         }
         ebpf_epoch_exit(&epoch_state);
     }
@@ -124,11 +151,11 @@ typedef class _ebpf_hash_table_test_state
     test_find()
     {
         uint8_t* value;
-        for (auto& key : keys) {
+        for (size_t index = 0; index < key_count; index++) {
             ebpf_epoch_state_t epoch_state;
             ebpf_epoch_enter(&epoch_state);
             // Expected to fail.
-            (void)ebpf_hash_table_find(table, reinterpret_cast<uint8_t*>(&key), &value);
+            (void)ebpf_hash_table_find(table, key(index), &value);
             ebpf_epoch_exit(&epoch_state);
         }
     }
@@ -136,13 +163,11 @@ typedef class _ebpf_hash_table_test_state
     void
     test_next_key()
     {
-        uint32_t next_key;
-        for (auto& key : keys) {
+        for (size_t index = 0; index < key_count; index++) {
             ebpf_epoch_state_t epoch_state;
             ebpf_epoch_enter(&epoch_state);
             // Expected to fail.
-            (void)ebpf_hash_table_next_key(
-                table, reinterpret_cast<uint8_t*>(&key), reinterpret_cast<uint8_t*>(&next_key));
+            (void)ebpf_hash_table_next_key(table, key(index), next_key.data());
             ebpf_epoch_exit(&epoch_state);
         }
     }
@@ -160,10 +185,7 @@ typedef class _ebpf_hash_table_test_state
                 ebpf_epoch_enter(&epoch_state);
                 // Expected to fail.
                 (void)ebpf_hash_table_update(
-                    table,
-                    reinterpret_cast<uint8_t*>(&keys[index]),
-                    reinterpret_cast<uint8_t*>(&value),
-                    EBPF_HASH_TABLE_OPERATION_REPLACE);
+                    table, key(index), reinterpret_cast<uint8_t*>(&value), EBPF_HASH_TABLE_OPERATION_REPLACE);
                 ebpf_epoch_exit(&epoch_state);
             }
         }
@@ -174,15 +196,12 @@ typedef class _ebpf_hash_table_test_state
     {
         uint64_t value = 12345678;
         // Update conflicting keys
-        for (auto& key : keys) {
+        for (size_t index = 0; index < key_count; index++) {
             ebpf_epoch_state_t epoch_state;
             ebpf_epoch_enter(&epoch_state);
             // Expected to fail.
             (void)ebpf_hash_table_update(
-                table,
-                reinterpret_cast<uint8_t*>(&key),
-                reinterpret_cast<uint8_t*>(&value),
-                EBPF_HASH_TABLE_OPERATION_REPLACE);
+                table, key(index), reinterpret_cast<uint8_t*>(&value), EBPF_HASH_TABLE_OPERATION_REPLACE);
             ebpf_epoch_exit(&epoch_state);
         }
     }
@@ -190,12 +209,21 @@ typedef class _ebpf_hash_table_test_state
     size_t
     multiplier()
     {
-        return keys.size();
+        return key_count;
     }
 
   private:
+    uint8_t*
+    key(size_t index)
+    {
+        return keys.data() + index * key_size;
+    }
+
     ebpf_hash_table_t* table;
-    std::vector<uint32_t> keys;
+    size_t key_size;
+    size_t key_count;
+    std::vector<uint8_t> keys;
+    std::vector<uint8_t> next_key;
     bool platform_initiated = false;
     bool epoch_initiated = false;
     uint32_t cpu_count;
@@ -268,6 +296,20 @@ test_bpf_get_smp_processor_id(bool preemptible)
     ebpf_core_terminate();
 }
 
+void
+test_bpf_csum_diff(bool preemptible)
+{
+    REQUIRE(ebpf_core_initiate() == EBPF_SUCCESS);
+    for (size_t i = 0; i < sizeof(_perf_bpf_csum_diff_from); i++) {
+        _perf_bpf_csum_diff_from[i] = static_cast<uint8_t>(ebpf_random_uint32());
+        _perf_bpf_csum_diff_to[i] = static_cast<uint8_t>(ebpf_random_uint32());
+    }
+    size_t iterations = PERFORMANCE_MEASURE_ITERATION_COUNT;
+    _performance_measure measure(__FUNCTION__, preemptible, _perf_bpf_csum_diff, iterations);
+    measure.run_test();
+    ebpf_core_terminate();
+}
+
 void
 test_epoch_enter_exit(bool preemptible)
 {
@@ -278,6 +320,17 @@ test_epoch_enter_exit(bool preemptible)
     ebpf_core_terminate();
 }
 
+// ebpf_epoch_enter_dispatch requires DISPATCH_LEVEL, so this only runs without preemption.
+void
+test_epoch_enter_exit_dispatch()
+{
+    REQUIRE(ebpf_core_initiate() == EBPF_SUCCESS);
+    size_t iterations = PERFORMANCE_MEASURE_ITERATION_COUNT * 10;
+    _performance_measure measure(__FUNCTION__, false, _perf_epoch_enter_exit_dispatch, iterations);
+    measure.run_test();
+    ebpf_core_terminate();
+}
+
 void
 test_epoch_enter_exit_alloc_free(bool preemptible)
 {
@@ -288,6 +341,31 @@ test_epoch_enter_exit_alloc_free(bool preemptible)
     ebpf_core_terminate();
 }
 
+// Same as the tests above, but with readers tracked by the per-CPU counter epoch implementation.
+void
+test_epoch_enter_exit_counter(bool preemptible)
+{
+    REQUIRE(ebpf_epoch_set_implementation(EBPF_EPOCH_IMPLEMENTATION_COUNTER) == EBPF_SUCCESS);
+    REQUIRE(ebpf_core_initiate() == EBPF_SUCCESS);
+    size_t iterations = PERFORMANCE_MEASURE_ITERATION_COUNT * 10;
+    _performance_measure measure(__FUNCTION__, preemptible, _perf_epoch_enter_exit, iterations);
+    measure.run_test();
+    ebpf_core_terminate();
+    REQUIRE(ebpf_epoch_set_implementation(EBPF_EPOCH_IMPLEMENTATION_LIST) == EBPF_SUCCESS);
+}
+
+void
+test_epoch_enter_exit_alloc_free_counter(bool preemptible)
+{
+    REQUIRE(ebpf_epoch_set_implementation(EBPF_EPOCH_IMPLEMENTATION_COUNTER) == EBPF_SUCCESS);
+    REQUIRE(ebpf_core_initiate() == EBPF_SUCCESS);
+    size_t iterations = PERFORMANCE_MEASURE_ITERATION_COUNT * 10;
+    _performance_measure measure(__FUNCTION__, preemptible, _perf_epoch_enter_alloc_free_exit, iterations);
+    measure.run_test();
+    ebpf_core_terminate();
+    REQUIRE(ebpf_epoch_set_implementation(EBPF_EPOCH_IMPLEMENTATION_LIST) == EBPF_SUCCESS);
+}
+
 void
 test_ebpf_hash_table_find(bool preemptible)
 {
@@ -297,6 +375,18 @@ test_ebpf_hash_table_find(bool preemptible)
     measure.run_test(instance.multiplier());
 }
 
+// Lookups with the key sizes that have a specialized hash function, plus one that doesn't.
+template <size_t key_size>
+void
+test_ebpf_hash_table_find_key_size(bool preemptible)
+{
+    _ebpf_hash_table_test_state instance(key_size);
+    _ebpf_hash_table_test_state_instance = &instance;
+    std::string name = std::string(__FUNCTION__) + "_" + std::to_string(key_size);
+    _performance_measure measure(name.c_str(), preemptible, _ebpf_hash_table_test_find);
+    measure.run_test(instance.multiplier());
+}
+
 void
 test_ebpf_hash_table_next_key(bool preemptible)
 {
@@ -316,6 +406,21 @@ test_ebpf_hash_table_update(bool preemptible)
     measure.run_test(instance.multiplier());
 }
 
+// Same as test_ebpf_hash_table_update, but with every bucket allocation and release going to the platform allocator.
+void
+test_ebpf_hash_table_update_no_allocation_cache(bool preemptible)
+{
+    REQUIRE(ebpf_epoch_set_allocation_cache_enabled(false) == EBPF_SUCCESS);
+    {
+        _ebpf_hash_table_test_state instance;
+        _ebpf_hash_table_test_state_instance = &instance;
+        _performance_measure measure(
+            __FUNCTION__, preemptible, _ebpf_hash_table_test_replace_value, PERFORMANCE_MEASURE_ITERATION_COUNT / 10);
+        measure.run_test(instance.multiplier());
+    }
+    REQUIRE(ebpf_epoch_set_allocation_cache_enabled(true) == EBPF_SUCCESS);
+}
+
 void
 test_ebpf_hash_table_update_overlapping(bool preemptible)
 {
@@ -330,13 +435,26 @@ test_ebpf_hash_table_update_overlapping(bool preemptible)
 }
 
 PERF_TEST(test_epoch_enter_exit);
+TEST_CASE("test_epoch_enter_exit_dispatch_no_preemption", "[performance_" TEST_AREA "]")
+{
+    test_epoch_enter_exit_dispatch();
+}
 PERF_TEST(test_epoch_enter_exit_alloc_free);
+PERF_TEST(test_epoch_enter_exit_counter);
+PERF_TEST(test_epoch_enter_exit_alloc_free_counter);
 PERF_TEST(test_ebpf_hash_table_find);
+PERF_TEST(test_ebpf_hash_table_find_key_size<4>);
+PERF_TEST(test_ebpf_hash_table_find_key_size<8>);
+PERF_TEST(test_ebpf_hash_table_find_key_size<16>);
+PERF_TEST(test_ebpf_hash_table_find_key_size<40>);
+PERF_TEST(test_ebpf_hash_table_find_key_size<64>);
 PERF_TEST(test_ebpf_hash_table_next_key);
 PERF_TEST(test_ebpf_hash_table_update);
+PERF_TEST(test_ebpf_hash_table_update_no_allocation_cache);
 PERF_TEST(test_ebpf_hash_table_update_overlapping);
 
 PERF_TEST(test_bpf_get_prandom_u32);
 PERF_TEST(test_bpf_ktime_get_boot_ns);
 PERF_TEST(test_bpf_ktime_get_ns);
 PERF_TEST(test_bpf_get_smp_processor_id);
+PERF_TEST(test_bpf_csum_diff);
@@ -0,0 +1,56 @@
+// Copyright (c) Microsoft Corporation
+// SPDX-License-Identifier: MIT
+
+// Sample that denies every bind after the first one of a process, using a bloom filter to remember the processes
+// that have already bound.
+
+#include "bpf_helpers.h"
+
+#define BLOOM_FILTER_HIT_INDEX 0
+#define BLOOM_FILTER_MISS_INDEX 1
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_BLOOM_FILTER);
+    __type(value, uint64_t);
+    __uint(max_entries, 1024);
+} bound_processes SEC(".maps");
+
+// Number of peeks that hit and missed the bloom filter.
+struct
+{
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __type(key, uint32_t);
+    __type(value, uint64_t);
+    __uint(max_entries, 2);
+} peek_results SEC(".maps");
+
+inline void
+count_peek_result(uint32_t index)
+{
+    uint64_t* count = bpf_map_lookup_elem(&peek_results, &index);
+    if (count) {
+        (*count)++;
+    }
+}
+
+SEC("bind")
+bind_action_t
+limit_bind(bind_md_t* ctx)
+{
+    if (ctx->operation != BIND_OPERATION_BIND) {
+        return BIND_PERMIT;
+    }
+
+    uint64_t process_id = ctx->process_id;
+    if (bpf_map_peek_elem(&bound_processes, &process_id) == 0) {
+        count_peek_result(BLOOM_FILTER_HIT_INDEX);
+        return BIND_DENY;
+    }
+
+    count_peek_result(BLOOM_FILTER_MISS_INDEX);
+    if (bpf_map_push_elem(&bound_processes, &process_id, 0) < 0) {
+        return BIND_DENY;
+    }
+    return BIND_PERMIT;
+}
@@ -0,0 +1,27 @@
+// Copyright (c) Microsoft Corporation
+// SPDX-License-Identifier: MIT
+
+// Sample built with bpf2c --instanced, used to test loading more than one instance of a native module.
+
+#include "bpf_helpers.h"
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __type(key, uint32_t);
+    __type(value, uint64_t);
+    __uint(max_entries, 1);
+} bind_count_map SEC(".maps");
+
+SEC("bind")
+bind_action_t
+count_bind(bind_md_t* ctx)
+{
+    uint32_t key = 0;
+    uint64_t* count = bpf_map_lookup_elem(&bind_count_map, &key);
+    if (count) {
+        (*count)++;
+    }
+
+    return BIND_PERMIT;
+}
@@ -0,0 +1,70 @@
+// Copyright (c) Microsoft Corporation
+// SPDX-License-Identifier: MIT
+
+// Sample with maps that no program references, used to test lazy map creation.
+
+#include "bpf_helpers.h"
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __type(key, uint32_t);
+    __type(value, uint64_t);
+    __uint(max_entries, 1);
+} bind_count_map SEC(".maps");
+
+// Inner map template of outer_map. No program references it directly.
+struct
+{
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __type(key, uint32_t);
+    __type(value, uint32_t);
+    __uint(max_entries, 1);
+} inner_map SEC(".maps");
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_ARRAY_OF_MAPS);
+    __type(key, uint32_t);
+    __uint(max_entries, 1);
+    __array(values, inner_map);
+} outer_map SEC(".maps");
+
+// Not referenced by any program.
+struct
+{
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __type(key, uint32_t);
+    __type(value, uint64_t);
+    __uint(max_entries, 1024);
+} unused_map SEC(".maps");
+
+// Not referenced by any program.
+struct
+{
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __type(key, uint32_t);
+    __type(value, uint64_t);
+    __uint(max_entries, 1024);
+} unused_map2 SEC(".maps");
+
+SEC("bind")
+bind_action_t
+count_bind(bind_md_t* ctx)
+{
+    uint32_t key = 0;
+    uint64_t* count = bpf_map_lookup_elem(&bind_count_map, &key);
+    if (count) {
+        (*count)++;
+    }
+
+    void* inner = bpf_map_lookup_elem(&outer_map, &key);
+    if (inner) {
+        uint32_t* value = bpf_map_lookup_elem(inner, &key);
+        if (value) {
+            (*value)++;
+        }
+    }
+
+    return BIND_PERMIT;
+}
@@ -21,3 +21,70 @@ TEST_CASE("export_program_info", "[end_to_end]")
     // Re-populate the ebpf store.
     _populate_ebpf_store();
 }
+
+TEST_CASE("export_store_snapshot", "[end_to_end]")
+{
+    REQUIRE(clear_ebpf_store() == 0);
+    _populate_ebpf_store();
+
+    // There is no snapshot until one is exported.
+    ebpf_store_information_t snapshot;
+    REQUIRE(ebpf_store_load_snapshot(&snapshot) == EBPF_OBJECT_NOT_FOUND);
+
+    REQUIRE(export_store_snapshot() == 0);
+    REQUIRE(ebpf_store_load_snapshot(&snapshot) == EBPF_SUCCESS);
+
+    // The snapshot matches what is read from the individual store keys.
+    ebpf_store_information_t store = {};
+    REQUIRE(ebpf_store_load_program_information(&store.program_info, &store.program_info_count) == EBPF_SUCCESS);
+    REQUIRE(ebpf_store_load_section_information(&store.section_info, &store.section_info_count) == EBPF_SUCCESS);
+    REQUIRE(
+        ebpf_store_load_global_helper_information(&store.global_helper_info, &store.global_helper_info_count) ==
+        EBPF_SUCCESS);
+    REQUIRE(snapshot.program_info_count == store.program_info_count);
+    REQUIRE(snapshot.section_info_count == store.section_info_count);
+    REQUIRE(snapshot.global_helper_info_count == store.global_helper_info_count);
+    for (uint32_t index = 0; index < store.program_info_count; index++) {
+        const ebpf_program_type_descriptor_t* expected = &store.program_info[index]->program_type_descriptor;
+        const ebpf_program_type_descriptor_t* actual = &snapshot.program_info[index]->program_type_descriptor;
+        REQUIRE(IsEqualGUID(expected->program_type, actual->program_type));
+        REQUIRE(std::string(expected->name) == actual->name);
+        REQUIRE(expected->bpf_prog_type == actual->bpf_prog_type);
+        REQUIRE(
+            store.program_info[index]->count_of_program_type_specific_helpers ==
+            snapshot.program_info[index]->count_of_program_type_specific_helpers);
+    }
+    for (uint32_t index = 0; index < store.section_info_count; index++) {
+        REQUIRE(std::string(store.section_info[index]->section_prefix) == snapshot.section_info[index]->section_prefix);
+    }
+    ebpf_store_information_free(&store);
+    ebpf_store_information_free(&snapshot);
+
+    // Any update to the store makes the snapshot stale.
+    REQUIRE(export_all_section_information() == 0);
+    REQUIRE(ebpf_store_load_snapshot(&snapshot) == EBPF_OBJECT_NOT_FOUND);
+
+    // So does an update that bypasses the store helper and leaves the generation unchanged.
+    REQUIRE(export_store_snapshot() == 0);
+    REQUIRE(ebpf_store_load_snapshot(&snapshot) == EBPF_SUCCESS);
+    ebpf_store_information_free(&snapshot);
+
+    HKEY section_key = nullptr;
+    HKEY new_section_key = nullptr;
+    REQUIRE(
+        RegOpenKeyEx(
+            HKEY_CURRENT_USER,
+            EBPF_STORE_REGISTRY_PATH L"\\" EBPF_SECTIONS_REGISTRY_PATH,
+            0,
+            KEY_ALL_ACCESS,
+            &section_key) == ERROR_SUCCESS);
+    REQUIRE(
+        RegCreateKeyEx(
+            section_key, L"snapshot_test", 0, nullptr, 0, KEY_ALL_ACCESS, nullptr, &new_section_key, nullptr) ==
+        ERROR_SUCCESS);
+    RegCloseKey(new_section_key);
+    REQUIRE(ebpf_store_load_snapshot(&snapshot) == EBPF_OBJECT_NOT_FOUND);
+
+    REQUIRE(RegDeleteKey(section_key, L"snapshot_test") == ERROR_SUCCESS);
+    RegCloseKey(section_key);
+}
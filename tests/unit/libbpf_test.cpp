@@ -10,14 +10,18 @@
 #include "catch_wrapper.hpp"
 #include "common_tests.h"
 #include "ebpf_platform.h"
+#include "ebpf_protocol.h"
 #include "ebpf_tracelog.h"
 #include "ebpf_vm_isa.hpp"
 #include "helpers.h"
+#include "mock.h"
 #include "platform.h"
 #include "program_helper.h"
 #include "test_helper.hpp"
 
 #include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <stop_token>
 #include <thread>
 
@@ -987,6 +991,69 @@ TEST_CASE("libbpf create queue", "[libbpf]")
     Platform::_close(map_fd);
 }
 
+TEST_CASE("libbpf create bloom filter", "[libbpf]")
+{
+    _test_helper_libbpf test_helper;
+    test_helper.initialize();
+
+    bpf_map_create_opts opts = {0};
+    const uint32_t max_entries = 100;
+    const uint32_t value_size = sizeof(uint32_t);
+
+    // Bloom filters have no key.
+    int map_fd =
+        bpf_map_create(BPF_MAP_TYPE_BLOOM_FILTER, "MapName", sizeof(uint32_t), value_size, max_entries, &opts);
+    REQUIRE(map_fd < 0);
+
+    // Too many hash functions.
+    opts.map_extra = 16;
+    map_fd = bpf_map_create(BPF_MAP_TYPE_BLOOM_FILTER, "MapName", 0, value_size, max_entries, &opts);
+    REQUIRE(map_fd < 0);
+
+    opts.map_extra = 3;
+    map_fd = bpf_map_create(BPF_MAP_TYPE_BLOOM_FILTER, "MapName", 0, value_size, max_entries, &opts);
+    REQUIRE(map_fd > 0);
+
+    bpf_map_info info;
+    uint32_t info_size = sizeof(info);
+    REQUIRE(bpf_obj_get_info_by_fd(map_fd, &info, &info_size) == 0);
+
+    REQUIRE(info.type == BPF_MAP_TYPE_BLOOM_FILTER);
+    REQUIRE(info.key_size == 0);
+    REQUIRE(info.value_size == value_size);
+    REQUIRE(info.max_entries == max_entries);
+    REQUIRE(info.map_extra == 3);
+
+    // Callers built before map_extra was added pass a structure that ends just before it.
+    info = {};
+    info_size = (uint32_t)offsetof(bpf_map_info, map_extra);
+    REQUIRE(bpf_obj_get_info_by_fd(map_fd, &info, &info_size) == 0);
+    REQUIRE(info_size == offsetof(bpf_map_info, map_extra));
+    REQUIRE(info.max_entries == max_entries);
+    REQUIRE(info.map_extra == 0);
+
+    uint32_t next_key;
+    REQUIRE(bpf_map_get_next_key(map_fd, NULL, &next_key) == -ENOTSUP);
+
+    // Add elements.
+    for (uint32_t value = 0; value < 10; value++) {
+        REQUIRE(bpf_map_update_elem(map_fd, nullptr, &value, 0) == 0);
+    }
+
+    // Lookup tests whether the value was added, and leaves the value unmodified.
+    for (uint32_t value = 0; value < 10; value++) {
+        uint32_t test_value = value;
+        REQUIRE(bpf_map_lookup_elem(map_fd, nullptr, &test_value) == 0);
+        REQUIRE(test_value == value);
+    }
+
+    uint32_t value = 0;
+    REQUIRE(bpf_map_lookup_and_delete_elem(map_fd, nullptr, &value) == -ENOTSUP);
+    REQUIRE(bpf_map_delete_elem(map_fd, nullptr) < 0);
+
+    Platform::_close(map_fd);
+}
+
 TEST_CASE("libbpf create ringbuf", "[libbpf]")
 {
     _test_helper_libbpf test_helper;
@@ -1893,6 +1960,198 @@ TEST_CASE("create map with name", "[libbpf]")
     Platform::_close(map_fd);
 }
 
+TEST_CASE("map descriptor cache", "[libbpf]")
+{
+    _test_helper_end_to_end test_helper;
+    test_helper.initialize();
+
+    // Populate the cached properties of a map, then close it.
+    int map_fd = bpf_map_create(BPF_MAP_TYPE_ARRAY, nullptr, sizeof(uint32_t), sizeof(uint32_t), 1, nullptr);
+    REQUIRE(map_fd > 0);
+    uint32_t key = 0;
+    uint32_t small_value = 0;
+    REQUIRE(bpf_map_lookup_elem(map_fd, &key, &small_value) == 0);
+    Platform::_close(map_fd);
+
+    // A new map with a different value size may reuse the handle value. Its
+    // lookups must not use the properties cached for the old map.
+    map_fd = bpf_map_create(BPF_MAP_TYPE_ARRAY, nullptr, sizeof(uint32_t), sizeof(uint64_t), 1, nullptr);
+    REQUIRE(map_fd > 0);
+    uint64_t large_value = UINT64_MAX;
+    REQUIRE(bpf_map_update_elem(map_fd, &key, &large_value, 0) == 0);
+    large_value = 0;
+    REQUIRE(bpf_map_lookup_elem(map_fd, &key, &large_value) == 0);
+    REQUIRE(large_value == UINT64_MAX);
+
+    // A second fd for the same map, obtained by ID, sees the same data.
+    bpf_map_info info;
+    uint32_t info_size = sizeof(info);
+    REQUIRE(bpf_obj_get_info_by_fd(map_fd, &info, &info_size) == 0);
+    int map_fd2 = bpf_map_get_fd_by_id(info.id);
+    REQUIRE(map_fd2 > 0);
+    large_value = 0;
+    REQUIRE(bpf_map_lookup_elem(map_fd2, &key, &large_value) == 0);
+    REQUIRE(large_value == UINT64_MAX);
+
+    Platform::_close(map_fd2);
+    Platform::_close(map_fd);
+}
+
+TEST_CASE("map descriptor cache skips properties query", "[libbpf]")
+{
+    _test_helper_end_to_end test_helper;
+    test_helper.initialize();
+
+    int map_fd = bpf_map_create(BPF_MAP_TYPE_ARRAY, nullptr, sizeof(uint32_t), sizeof(uint32_t), 1, nullptr);
+    REQUIRE(map_fd > 0);
+
+    // Count the map property queries sent to the execution context.
+    uint32_t query_count = 0;
+    auto original_handler = device_io_control_handler;
+    device_io_control_handler = [&](HANDLE device,
+                                    unsigned long io_control_code,
+                                    void* input_buffer,
+                                    unsigned long input_buffer_size,
+                                    void* output_buffer,
+                                    unsigned long output_buffer_size,
+                                    unsigned long* bytes_returned,
+                                    OVERLAPPED* overlapped) -> BOOL {
+        auto header = reinterpret_cast<const ebpf_operation_header_t*>(input_buffer);
+        if (header->id == ebpf_operation_id_t::EBPF_OPERATION_GET_OBJECT_INFO) {
+            query_count++;
+        }
+        return original_handler(
+            device,
+            io_control_code,
+            input_buffer,
+            input_buffer_size,
+            output_buffer,
+            output_buffer_size,
+            bytes_returned,
+            overlapped);
+    };
+
+    // Only the first lookup queries the map properties.
+    uint32_t key = 0;
+    uint32_t value = 0;
+    for (int i = 0; i < 10; i++) {
+        REQUIRE(bpf_map_lookup_elem(map_fd, &key, &value) == 0);
+        REQUIRE(bpf_map_update_elem(map_fd, &key, &value, 0) == 0);
+    }
+    REQUIRE(query_count == 1);
+
+    // Closing the fd through ebpf_close_fd drops the cached properties, so a map
+    // reusing the handle value is queried again.
+    REQUIRE(ebpf_close_fd(map_fd) == EBPF_SUCCESS);
+    map_fd = bpf_map_create(BPF_MAP_TYPE_ARRAY, nullptr, sizeof(uint32_t), sizeof(uint64_t), 1, nullptr);
+    REQUIRE(map_fd > 0);
+    uint64_t large_value = 0;
+    REQUIRE(bpf_map_lookup_elem(map_fd, &key, &large_value) == 0);
+    REQUIRE(query_count == 2);
+
+    device_io_control_handler = original_handler;
+    REQUIRE(ebpf_close_fd(map_fd) == EBPF_SUCCESS);
+    REQUIRE(ebpf_close_fd(map_fd) == EBPF_INVALID_FD);
+}
+
+typedef struct _async_map_test_context
+{
+    std::mutex lock;
+    std::condition_variable completed;
+    uint32_t outstanding;
+    uint32_t failures;
+} async_map_test_context_t;
+
+static void
+_async_map_test_completion(_Inout_opt_ void* callback_context, ebpf_result_t result)
+{
+    auto context = reinterpret_cast<async_map_test_context_t*>(callback_context);
+    std::unique_lock lock(context->lock);
+    if (result != EBPF_SUCCESS) {
+        context->failures++;
+    }
+    if (--context->outstanding == 0) {
+        context->completed.notify_all();
+    }
+}
+
+static void
+_async_map_test_wait(_Inout_ async_map_test_context_t* context)
+{
+    std::unique_lock lock(context->lock);
+    context->completed.wait(lock, [&] { return context->outstanding == 0; });
+}
+
+TEST_CASE("async map operations", "[libbpf]")
+{
+    _test_helper_end_to_end test_helper;
+    test_helper.initialize();
+
+    const uint32_t entry_count = 64;
+    int map_fd = bpf_map_create(BPF_MAP_TYPE_HASH, nullptr, sizeof(uint32_t), sizeof(uint64_t), entry_count, nullptr);
+    REQUIRE(map_fd > 0);
+
+    std::vector<uint32_t> keys(entry_count);
+    std::vector<uint64_t> values(entry_count);
+    async_map_test_context_t context;
+
+    // Keep all the updates in flight at once.
+    context.outstanding = entry_count;
+    context.failures = 0;
+    for (uint32_t i = 0; i < entry_count; i++) {
+        keys[i] = i;
+        values[i] = (uint64_t)i * 10;
+        REQUIRE(
+            ebpf_map_update_element_async(
+                map_fd, &keys[i], &values[i], BPF_NOEXIST, _async_map_test_completion, &context) == EBPF_SUCCESS);
+    }
+    _async_map_test_wait(&context);
+    REQUIRE(context.failures == 0);
+
+    // Read all the values back.
+    context.outstanding = entry_count;
+    for (uint32_t i = 0; i < entry_count; i++) {
+        values[i] = 0;
+        REQUIRE(
+            ebpf_map_lookup_element_async(map_fd, &keys[i], &values[i], _async_map_test_completion, &context) ==
+            EBPF_SUCCESS);
+    }
+    _async_map_test_wait(&context);
+    REQUIRE(context.failures == 0);
+    for (uint32_t i = 0; i < entry_count; i++) {
+        REQUIRE(values[i] == (uint64_t)i * 10);
+    }
+
+    // Delete all the entries, then verify that a second delete fails.
+    context.outstanding = entry_count;
+    for (uint32_t i = 0; i < entry_count; i++) {
+        REQUIRE(ebpf_map_delete_element_async(map_fd, &keys[i], _async_map_test_completion, &context) == EBPF_SUCCESS);
+    }
+    _async_map_test_wait(&context);
+    REQUIRE(context.failures == 0);
+
+    context.outstanding = 1;
+    REQUIRE(ebpf_map_delete_element_async(map_fd, &keys[0], _async_map_test_completion, &context) == EBPF_SUCCESS);
+    _async_map_test_wait(&context);
+    REQUIRE(context.failures == 1);
+
+    // Invalid parameters are rejected at submission time.
+    REQUIRE(ebpf_map_delete_element_async(map_fd, &keys[0], nullptr, &context) == EBPF_INVALID_ARGUMENT);
+    REQUIRE(
+        ebpf_map_delete_element_async(ebpf_fd_invalid, &keys[0], _async_map_test_completion, &context) ==
+        EBPF_INVALID_ARGUMENT);
+
+    // An operation keeps the map alive, so the map fd can be closed while it is in flight.
+    context.outstanding = 1;
+    context.failures = 0;
+    REQUIRE(
+        ebpf_map_update_element_async(
+            map_fd, &keys[0], &values[0], BPF_NOEXIST, _async_map_test_completion, &context) == EBPF_SUCCESS);
+    Platform::_close(map_fd);
+    _async_map_test_wait(&context);
+    REQUIRE(context.failures == 0);
+}
+
 TEST_CASE("enumerate map IDs", "[libbpf]")
 {
     _test_helper_end_to_end test_helper;
@@ -3237,6 +3496,31 @@ TEST_CASE("libbpf map batch", "[libbpf]")
             map_fd, nullptr, &next_key, fetched_keys.data(), fetched_values.data(), &fetched_batch_size, &opts) ==
         -ENOENT);
 
+    // A batch that fails part way reports the number of elements updated before the failure.
+    uint32_t half_batch_size = batch_size / 2;
+    opts.elem_flags = BPF_NOEXIST;
+    update_batch_size = batch_size - half_batch_size;
+    REQUIRE(
+        bpf_map_update_batch(
+            map_fd, keys.data() + half_batch_size, values.data() + half_batch_size, &update_batch_size, &opts) == 0);
+    REQUIRE(update_batch_size == batch_size - half_batch_size);
+
+    update_batch_size = batch_size;
+    REQUIRE(bpf_map_update_batch(map_fd, keys.data(), values.data(), &update_batch_size, &opts) == -EEXIST);
+    REQUIRE(update_batch_size == half_batch_size);
+
+    // The elements before the failure were updated.
+    fetched_batch_size = batch_size;
+    opts.elem_flags = 0;
+    REQUIRE(
+        bpf_map_lookup_batch(
+            map_fd, nullptr, &next_key, fetched_keys.data(), fetched_values.data(), &fetched_batch_size, &opts) == 0);
+    REQUIRE(fetched_batch_size == batch_size);
+
+    delete_batch_size = batch_size;
+    REQUIRE(bpf_map_delete_batch(map_fd, keys.data(), &delete_batch_size, &opts) == 0);
+    REQUIRE(delete_batch_size == batch_size);
+
     // Negative tests.
     // Batch size 0
 
@@ -3305,6 +3589,76 @@ TEST_CASE("libbpf map batch", "[libbpf]")
     REQUIRE(bpf_map_delete_batch(invalid_map_fd, keys.data(), &delete_batch_size, &opts) == -EBADF);
 }
 
+TEST_CASE("libbpf queue and stack batch", "[libbpf]")
+{
+    _test_helper_end_to_end test_helper;
+    test_helper.initialize();
+
+    const uint32_t max_entries = 20000;
+    std::vector<uint64_t> values(max_entries);
+    for (uint32_t i = 0; i < max_entries; i++) {
+        values[i] = static_cast<uint64_t>(i) * 2ul;
+    }
+
+    for (auto map_type : {BPF_MAP_TYPE_QUEUE, BPF_MAP_TYPE_STACK}) {
+        fd_t map_fd = bpf_map_create(map_type, "MapName", 0, sizeof(uint64_t), max_entries, nullptr);
+        REQUIRE(map_fd > 0);
+
+        bpf_map_batch_opts opts = {};
+
+        // Push all values in one batch.
+        uint32_t update_batch_size = max_entries;
+        REQUIRE(bpf_map_update_batch(map_fd, nullptr, values.data(), &update_batch_size, &opts) == 0);
+        REQUIRE(update_batch_size == max_entries);
+
+        // The map is full.
+        uint64_t extra_value = 0;
+        update_batch_size = 1;
+        REQUIRE(bpf_map_update_batch(map_fd, nullptr, &extra_value, &update_batch_size, &opts) < 0);
+
+        // Values can only be read by draining them.
+        uint32_t out_batch = 0;
+        std::vector<uint64_t> fetched_values(max_entries * 2);
+        uint32_t fetched_batch_size = max_entries;
+        REQUIRE(
+            bpf_map_lookup_batch(
+                map_fd, nullptr, &out_batch, nullptr, fetched_values.data(), &fetched_batch_size, &opts) == -EINVAL);
+
+        // Drain part of the map, then request more values than are left.
+        fetched_batch_size = max_entries / 4;
+        REQUIRE(
+            bpf_map_lookup_and_delete_batch(
+                map_fd, nullptr, &out_batch, nullptr, fetched_values.data(), &fetched_batch_size, &opts) == 0);
+        REQUIRE(fetched_batch_size == max_entries / 4);
+
+        uint32_t remaining_batch_size = max_entries * 2;
+        REQUIRE(
+            bpf_map_lookup_and_delete_batch(
+                map_fd,
+                nullptr,
+                &out_batch,
+                nullptr,
+                fetched_values.data() + fetched_batch_size,
+                &remaining_batch_size,
+                &opts) == 0);
+        REQUIRE(remaining_batch_size == max_entries - fetched_batch_size);
+
+        // Queue pops in push order, stack in reverse order.
+        for (uint32_t i = 0; i < max_entries; i++) {
+            uint32_t expected_index = (map_type == BPF_MAP_TYPE_QUEUE) ? i : max_entries - 1 - i;
+            REQUIRE(fetched_values[i] == values[expected_index]);
+        }
+
+        // The map is empty.
+        fetched_batch_size = max_entries;
+        REQUIRE(
+            bpf_map_lookup_and_delete_batch(
+                map_fd, nullptr, &out_batch, nullptr, fetched_values.data(), &fetched_batch_size, &opts) == -ENOENT);
+
+        Platform::_close(map_fd);
+    }
+}
+
 void
 _hash_of_map_initial_value_test(ebpf_execution_type_t execution_type)
 {
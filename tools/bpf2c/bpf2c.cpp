@@ -137,6 +137,7 @@ main(int argc, char** argv)
         std::string type_string = "";
         std::string hash_algorithm = EBPF_HASH_ALGORITHM;
         bool verify_programs = true;
+        bool instanced = false;
         std::vector<std::string> parameters(argv + 1, argv + argc);
         auto iter = parameters.begin();
         auto iter_end = parameters.end();
@@ -179,6 +180,12 @@ main(int argc, char** argv)
                   return true;
               }}},
 #endif
+            {"--instanced",
+             {"Generate a module that can be loaded as multiple independent instances",
+              [&]() {
+                  instanced = true;
+                  return true;
+              }}},
             {"--bpf",
              {"Input ELF file containing BPF byte code",
               [&]() {
@@ -263,6 +270,7 @@ main(int argc, char** argv)
         }
 
         bpf_code_generator generator(stream, c_name, {hash_value});
+        generator.set_instanced(instanced);
 
         // Capture list of sections.
         std::vector<bpf_code_generator::unsafe_string> sections = generator.program_sections();
@@ -313,6 +313,12 @@ bpf_code_generator::set_program_hash_info(const std::optional<std::vector<uint8_
     current_section->program_info_hash = program_info_hash;
 }
 
+void
+bpf_code_generator::set_instanced(bool instanced)
+{
+    this->instanced = instanced;
+}
+
 void
 bpf_code_generator::generate(const bpf_code_generator::unsafe_string& section_name)
 {
@@ -878,7 +884,8 @@ bpf_code_generator::encode_instructions(const bpf_code_generator::unsafe_string&
 {
     std::vector<output_instruction_t>& program_output = current_section->output;
     auto program_name = !current_section->program_name.empty() ? current_section->program_name : section_name;
-    auto helper_array_prefix = program_name.c_identifier() + "_helpers[{}]";
+    auto helper_array_prefix =
+        instanced ? std::string("runtime_context->helpers[{}]") : program_name.c_identifier() + "_helpers[{}]";
 
     // Encode instructions
     for (size_t i = 0; i < program_output.size(); i++) {
@@ -1124,7 +1131,12 @@ bpf_code_generator::encode_instructions(const bpf_code_generator::unsafe_string&
                     throw bpf_code_generator_exception(
                         "Map " + output.relocation + " doesn't exist", output.instruction_offset);
                 }
-                source = std::format("_maps[{}].address", std::to_string(map_definition->second.index));
+                if (instanced) {
+                    source = std::format(
+                        "runtime_context->maps[{}].address", std::to_string(map_definition->second.index));
+                } else {
+                    source = std::format("_maps[{}].address", std::to_string(map_definition->second.index));
+                }
                 output.lines.push_back(std::format("{} = POINTER({});", destination, source));
                 current_section->referenced_map_indices.insert(map_definitions[output.relocation].index);
             }
@@ -1556,7 +1568,15 @@ bpf_code_generator::emit_c_code(std::ostream& output_stream)
 
         // Emit entry point
         output_stream << "#pragma code_seg(push, " << section.pe_section_name.quoted() << ")" << std::endl;
-        output_stream << std::format("static uint64_t\n{}(void* context)", program_name.c_identifier()) << std::endl;
+        if (instanced) {
+            output_stream << std::format(
+                                 "static uint64_t\n{}(void* context, const program_runtime_context_t* runtime_context)",
+                                 program_name.c_identifier())
+                          << std::endl;
+        } else {
+            output_stream << std::format("static uint64_t\n{}(void* context)", program_name.c_identifier())
+                          << std::endl;
+        }
         output_stream << prolog_line_info << "{" << std::endl;
 
         // Emit prologue
@@ -1627,7 +1647,14 @@ bpf_code_generator::emit_c_code(std::ostream& output_stream)
             auto program_info_hash_name = program_name.c_identifier() + "_program_info_hash";
             output_stream << INDENT "{" << std::endl;
             output_stream << INDENT INDENT << "0," << std::endl;
-            output_stream << INDENT INDENT << program_name.c_identifier() << "," << std::endl;
+            if (instanced) {
+                // program_entry_t stores all entry points as uint64_t (*)(void*); the runtime checks
+                // metadata_table_t.instanced before calling it.
+                output_stream << INDENT INDENT << "(uint64_t(*)(void*))" << program_name.c_identifier() << ","
+                              << std::endl;
+            } else {
+                output_stream << INDENT INDENT << program_name.c_identifier() << "," << std::endl;
+            }
             output_stream << INDENT INDENT << program.pe_section_name.quoted() << "," << std::endl;
             output_stream << INDENT INDENT << name.quoted() << "," << std::endl;
             output_stream << INDENT INDENT << program.program_name.quoted() << "," << std::endl;
@@ -1733,7 +1760,8 @@ bpf_code_generator::emit_c_code(std::ostream& output_stream)
 
     std::string meta_data_table = "metadata_table_t " + c_name.c_identifier() + "_metadata_table = {";
     meta_data_table +=
-        "sizeof(metadata_table_t), _get_programs, _get_maps, _get_hash, _get_version, _get_map_initial_values};\n";
+        "sizeof(metadata_table_t), _get_programs, _get_maps, _get_hash, _get_version, _get_map_initial_values";
+    meta_data_table += instanced ? ", true};\n" : "};\n";
 
     if ((meta_data_table.size() - 1) > LINE_BREAK_WIDTH) {
         meta_data_table.insert(meta_data_table.find_first_of("{") + 1, "\n" INDENT);
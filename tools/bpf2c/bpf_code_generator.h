@@ -287,6 +287,15 @@ class bpf_code_generator
     void
     set_program_hash_info(const std::optional<std::vector<uint8_t>>& program_info_hash);
 
+    /**
+     * @brief Generate programs that take a program_runtime_context_t and read map and helper addresses from it
+     * instead of from the static tables, so that the module can be instantiated more than once.
+     *
+     * @param[in] instanced True to generate an instanced module.
+     */
+    void
+    set_instanced(bool instanced);
+
   private:
     typedef struct _helper_function
     {
@@ -452,4 +461,5 @@ class bpf_code_generator
     btf_section_to_instruction_to_line_info_t section_line_info;
     std::optional<std::vector<uint8_t>> elf_file_hash;
     std::map<unsafe_string, std::vector<unsafe_string>> map_initial_values;
+    bool instanced = false;
 };
@@ -81,6 +81,12 @@ export_global_helper_information()
         ebpf_core_helper_function_prototype, ebpf_core_helper_functions_count);
 }
 
+uint32_t
+export_store_snapshot()
+{
+    return ebpf_store_update_snapshot();
+}
+
 uint32_t
 clear_ebpf_store()
 {
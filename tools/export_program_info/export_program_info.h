@@ -24,5 +24,8 @@ export_all_section_information();
 int
 export_global_helper_information();
 
+uint32_t
+export_store_snapshot();
+
 uint32_t
 clear_ebpf_store();
@@ -46,6 +46,13 @@ main(int argc, char** argv)
         if (status != ERROR_SUCCESS) {
             std::cout << "Failed export_global_helper_information() - ERROR #" << status << std::endl;
         }
+
+        // Export the snapshot last, so that it includes everything exported above.
+        std::cout << "Exporting store snapshot." << std::endl;
+        status = export_store_snapshot();
+        if (status != ERROR_SUCCESS) {
+            std::cout << "Failed export_store_snapshot() - ERROR #" << status << std::endl;
+        }
     } else {
         std::cout << "Clearing eBPF store." << std::endl;
         status = clear_ebpf_store();